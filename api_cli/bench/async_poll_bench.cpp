@@ -0,0 +1,156 @@
+#include "async_executor.hpp"
+#include "async_pricing_service.hpp"
+#include "iss_stub_server.hpp"
+#include "moex_client.hpp"
+#include "price_pipe.hpp"
+#include "pricing_service.hpp"
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Thread-per-ticker PricingService vs coroutine AsyncPricingService polling a
+// local ISS stub that answers after kServerDelayMs. Reports process threads,
+// context switches (whole process, stub server included), fetch rate and mean
+// fetch latency as seen by the poller.
+
+namespace {
+
+constexpr int kServerDelayMs = 50;
+constexpr int kIntervalMs = 100;
+constexpr int kRunMs = 3000;
+
+class TimedProvider : public MarketDataProvider {
+public:
+  explicit TimedProvider(std::shared_ptr<MoexClient> base)
+      : base_(std::move(base)) {}
+
+  PriceUpdate get_price(const std::string &ticker) override {
+    auto start = std::chrono::steady_clock::now();
+    PriceUpdate u = base_->get_price(ticker);
+    record(start);
+    return u;
+  }
+
+  Task<PriceUpdate> get_price_async(std::string ticker) override {
+    auto start = std::chrono::steady_clock::now();
+    PriceUpdate u = co_await base_->get_price_async(std::move(ticker));
+    record(start);
+    co_return u;
+  }
+
+  std::size_t count() const { return count_.load(); }
+  double mean_ms() const {
+    auto n = count_.load();
+    return n ? static_cast<double>(total_ns_.load()) / 1e6 /
+                   static_cast<double>(n)
+             : 0.0;
+  }
+
+private:
+  void record(std::chrono::steady_clock::time_point start) {
+    total_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+    ++count_;
+  }
+
+  std::shared_ptr<MoexClient> base_;
+  std::atomic<long long> total_ns_{0};
+  std::atomic<std::size_t> count_{0};
+};
+
+int process_threads() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("Threads:", 0) == 0) {
+      return std::stoi(line.substr(8));
+    }
+  }
+  return -1;
+}
+
+void run(const char *mode, std::size_t tickers, std::size_t loops) {
+  IssStubServer server(kServerDelayMs);
+  server.start();
+
+  auto client = std::make_shared<MoexClient>(server.base_url());
+  auto provider = std::make_shared<TimedProvider>(client);
+  std::vector<std::string> names;
+  for (std::size_t i = 0; i < tickers; ++i) {
+    names.push_back("T" + std::to_string(i));
+  }
+
+  PriceQueue queue;
+  std::thread drain([&] {
+    std::vector<PriceUpdate> batch;
+    while (queue.read_batch(batch, 1024)) {
+    }
+  });
+
+  std::unique_ptr<AsyncExecutor> executor;
+  std::unique_ptr<AsyncPricingService> async_service;
+  std::unique_ptr<PricingService> service;
+  if (loops > 0) {
+    executor = std::make_unique<AsyncExecutor>(loops);
+    client->set_executor(executor.get());
+    executor->start();
+    async_service = std::make_unique<AsyncPricingService>(
+        provider, names, queue, kIntervalMs, *executor);
+    async_service->start();
+  } else {
+    service = std::make_unique<PricingService>(provider, names, queue,
+                                               kIntervalMs);
+    service->start();
+  }
+
+  // Skip connection setup before measuring.
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  rusage before{};
+  getrusage(RUSAGE_SELF, &before);
+  const std::size_t fetches_before = provider->count();
+  std::this_thread::sleep_for(std::chrono::milliseconds(kRunMs));
+  rusage after{};
+  getrusage(RUSAGE_SELF, &after);
+  const std::size_t fetches = provider->count() - fetches_before;
+  const int threads = process_threads();
+
+  if (async_service) {
+    async_service->stop();
+    executor->stop();
+  } else {
+    service->stop();
+  }
+  drain.join();
+  server.stop();
+
+  std::printf("%-6s tickers=%-5zu threads=%-5d fetches/s=%-7.0f "
+              "mean_latency=%.1fms vcsw/s=%-7.0f ivcsw/s=%.0f\n",
+              mode, tickers, threads, fetches * 1000.0 / kRunMs,
+              provider->mean_ms(),
+              (after.ru_nvcsw - before.ru_nvcsw) * 1000.0 / kRunMs,
+              (after.ru_nivcsw - before.ru_nivcsw) * 1000.0 / kRunMs);
+}
+
+} // namespace
+
+int main() {
+  std::printf("server delay %dms, poll interval %dms; ideal rate is "
+              "tickers / %.2fs\n",
+              kServerDelayMs, kIntervalMs,
+              (kServerDelayMs + kIntervalMs) / 1000.0);
+  for (std::size_t tickers : {100u, 1000u}) {
+    run("sync", tickers, 0);
+    run("async1", tickers, 1);
+    run("async2", tickers, 2);
+  }
+  return 0;
+}
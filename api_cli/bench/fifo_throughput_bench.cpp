@@ -0,0 +1,123 @@
+#include "price_pipe.hpp"
+#include "price_writer.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures updates/sec drained from a pre-filled PriceQueue into a FIFO read
+// by a separate thread, for the old per-line path and the batched one.
+
+namespace {
+
+constexpr std::size_t kUpdates = 1'000'000;
+
+std::string make_fifo() {
+  std::string path = "/tmp/fifo_throughput_bench_" + std::to_string(getpid());
+  ::unlink(path.c_str());
+  if (mkfifo(path.c_str(), 0600) < 0) {
+    std::perror("mkfifo");
+    std::exit(1);
+  }
+  return path;
+}
+
+void fill(PriceQueue &queue) {
+  PriceUpdate upd;
+  upd.ticker = "SBER";
+  upd.status = "OK";
+  for (std::size_t i = 0; i < kUpdates; ++i) {
+    upd.timestamp = 1763653237 + static_cast<std::int64_t>(i);
+    upd.price = 300.0 + static_cast<double>(i % 1000) * 0.01;
+    queue.write(upd);
+  }
+  queue.close();
+}
+
+template <typename Body> double run(const char *name, Body body) {
+  const std::string path = make_fifo();
+  std::size_t bytes = 0;
+  std::thread reader([&] {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    std::vector<char> buf(1 << 16);
+    ssize_t n;
+    while ((n = ::read(fd, buf.data(), buf.size())) > 0) {
+      bytes += static_cast<std::size_t>(n);
+    }
+    ::close(fd);
+  });
+
+  int fd = ::open(path.c_str(), O_WRONLY);
+  PriceQueue queue;
+  fill(queue);
+
+  auto start = std::chrono::steady_clock::now();
+  body(queue, fd);
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  ::close(fd);
+  reader.join();
+  ::unlink(path.c_str());
+
+  const double rate = static_cast<double>(kUpdates) / elapsed;
+  std::cout << name << ": " << static_cast<long long>(rate)
+            << " updates/sec (" << bytes / kUpdates << " bytes/update)\n";
+  return rate;
+}
+
+} // namespace
+
+int main() {
+  std::ofstream null_out("/dev/null");
+
+  const double legacy = run("per-line write + endl echo", [&](PriceQueue &q,
+                                                              int fd) {
+    PriceUpdate update;
+    while (q.read(update)) {
+      std::string line = "{"
+                         "\"timestamp\":" +
+                         std::to_string(update.timestamp) + "," +
+                         "\"ticker\":\"" + update.ticker + "\"," +
+                         "\"price\":" + std::to_string(update.price) + "," +
+                         "\"status\":\"" + update.status + "\"," +
+                         "\"error\":\"" + update.error +
+                         "\""
+                         "}\n";
+      if (::write(fd, line.data(), line.size()) < 0) {
+        break;
+      }
+      null_out << line << std::endl;
+    }
+  });
+
+  const double batched = run("batched writev, no echo", [](PriceQueue &q,
+                                                           int fd) {
+    std::vector<PriceUpdate> batch;
+    PriceSerializer serializer;
+    std::vector<iovec> iov;
+    while (q.read_batch(batch, 512)) {
+      serializer.clear();
+      for (const auto &u : batch) {
+        serializer.append(u);
+      }
+      iov = serializer.iovecs();
+      if (!write_fully(fd, iov.data(), iov.size())) {
+        break;
+      }
+    }
+  });
+
+  std::cout << "speedup: " << batched / legacy << "x\n";
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include "sharded_publisher.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Aggregate throughput of api_cli -> N shard FIFOs, where each consumer does a
+// fixed amount of per-line work standing in for parse + pricing in
+// bsm_pricing. With CPU-bound consumers the aggregate rate should grow with N.
+
+namespace {
+
+constexpr int kTickers = 256;
+constexpr int kRounds = 2000;
+constexpr int kWorkIterations = 400;
+
+double consume(const std::string &path, std::size_t &lines) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  std::vector<char> buf(1 << 16);
+  double sink = 0.0;
+  ssize_t n;
+  while ((n = ::read(fd, buf.data(), buf.size())) > 0) {
+    for (ssize_t i = 0; i < n; ++i) {
+      if (buf[static_cast<std::size_t>(i)] != '\n') {
+        continue;
+      }
+      ++lines;
+      double x = static_cast<double>(lines);
+      for (int k = 0; k < kWorkIterations; ++k) {
+        x = std::log(std::exp(x * 1e-9) + 1.0);
+      }
+      sink += x;
+    }
+  }
+  ::close(fd);
+  return sink;
+}
+
+void run(std::size_t shards) {
+  const auto paths = ShardedPublisher::shard_paths(
+      "/tmp/shard_fanout_bench_" + std::to_string(::getpid()), shards);
+  // Consumers go first: a single-shard publisher blocks in init until its
+  // reader opens the FIFO.
+  for (const auto &p : paths) {
+    ::mkfifo(p.c_str(), 0666);
+  }
+  std::vector<std::size_t> lines(shards, 0);
+  std::vector<std::thread> consumers;
+  for (std::size_t i = 0; i < shards; ++i) {
+    consumers.emplace_back([&, i] { consume(paths[i], lines[i]); });
+  }
+  auto publisher = std::make_unique<ShardedPublisher>(paths, 10);
+  publisher->init();
+  while (publisher->live_channels() < shards) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    publisher->probe();
+  }
+
+  std::vector<PriceUpdate> batch(kTickers);
+  for (int t = 0; t < kTickers; ++t) {
+    batch[t].ticker = "T" + std::to_string(t);
+    batch[t].status = "OK";
+    batch[t].price = 100.0;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < kRounds; ++r) {
+    for (auto &u : batch) {
+      u.timestamp = r;
+    }
+    publisher->publish(batch);
+  }
+  // Closing the write ends lets every consumer hit EOF once drained.
+  publisher.reset();
+  for (auto &c : consumers) {
+    c.join();
+  }
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  std::size_t total = 0;
+  for (auto l : lines) {
+    total += l;
+  }
+  std::cout << shards << " shard(s): "
+            << static_cast<long long>(static_cast<double>(total) / elapsed)
+            << " updates/sec aggregate\n";
+  for (const auto &p : paths) {
+    ::unlink(p.c_str());
+  }
+}
+
+} // namespace
+
+int main() {
+  std::signal(SIGPIPE, SIG_IGN);
+  for (std::size_t shards : {1u, 2u, 4u}) {
+    run(shards);
+  }
+  return 0;
+}
@@ -0,0 +1,64 @@
+#include "synthetic_provider.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Ticks/sec produced by SyntheticMarketDataProvider::get_price for a range of
+// symbol counts and caller threads. Each thread walks its own slice of the
+// symbols, as PricingService workers do.
+
+namespace {
+
+constexpr std::size_t kTicksPerThread = 2'000'000;
+
+void run(std::size_t symbols, std::size_t threads) {
+  SyntheticMarketDataProvider provider;
+  const auto names = SyntheticMarketDataProvider::symbol_names(symbols);
+  for (const auto &n : names) {
+    provider.get_price(n);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (std::size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      std::size_t i = t;
+      double sink = 0.0;
+      for (std::size_t k = 0; k < kTicksPerThread; ++k) {
+        sink += provider.get_price(names[i]).price;
+        i += threads;
+        if (i >= names.size()) {
+          i = t % names.size();
+        }
+      }
+      if (sink < 0.0) {
+        std::cout << sink;
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  std::cout << symbols << " symbols, " << threads << " thread(s): "
+            << static_cast<long long>(
+                   static_cast<double>(kTicksPerThread * threads) / elapsed)
+            << " ticks/sec\n";
+}
+
+} // namespace
+
+int main() {
+  for (std::size_t symbols : {16u, 1024u, 65536u}) {
+    for (std::size_t threads : {1u, 4u}) {
+      run(symbols, threads);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "task.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct HttpResponse {
+  long status{0};
+  std::string body;
+  std::string error; // set when the transfer itself failed
+};
+
+// A handful of event-loop threads, each driving a curl multi handle and a
+// timer heap. Coroutines suspended on http_get() or sleep_for() cost no
+// thread while they wait and are resumed on the loop that serviced them, so
+// thousands of in-flight polls fit on `threads` threads.
+//
+// Anything still suspended when stop() runs is never resumed; callers stop
+// their coroutines first.
+class AsyncExecutor {
+public:
+  explicit AsyncExecutor(std::size_t threads = 1);
+  ~AsyncExecutor();
+
+  AsyncExecutor(const AsyncExecutor &) = delete;
+  AsyncExecutor &operator=(const AsyncExecutor &) = delete;
+
+  void start();
+  void stop();
+
+  // Starts the task on one of the loops; its frame is freed when it ends.
+  void spawn(Task<void> task);
+
+  std::size_t threads() const { return loops_.size(); }
+
+  class ScheduleAwaiter {
+  public:
+    explicit ScheduleAwaiter(AsyncExecutor &ex) : ex_(ex) {}
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h);
+    void await_resume() const noexcept {}
+
+  private:
+    AsyncExecutor &ex_;
+  };
+
+  class SleepAwaiter {
+  public:
+    SleepAwaiter(AsyncExecutor &ex, std::chrono::steady_clock::time_point at)
+        : ex_(ex), at_(at) {}
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h);
+    void await_resume() const noexcept {}
+
+  private:
+    AsyncExecutor &ex_;
+    std::chrono::steady_clock::time_point at_;
+  };
+
+  class HttpAwaiter {
+  public:
+    HttpAwaiter(AsyncExecutor &ex, std::string url)
+        : ex_(ex), url_(std::move(url)) {}
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h);
+    HttpResponse await_resume() { return std::move(response_); }
+
+  private:
+    friend class AsyncExecutor;
+
+    AsyncExecutor &ex_;
+    std::string url_;
+    HttpResponse response_;
+    std::coroutine_handle<> continuation_;
+  };
+
+  // Moves the awaiting coroutine onto an executor thread.
+  ScheduleAwaiter schedule() { return ScheduleAwaiter(*this); }
+
+  SleepAwaiter sleep_for(std::chrono::milliseconds delay) {
+    return SleepAwaiter(*this, std::chrono::steady_clock::now() + delay);
+  }
+
+  // Non-blocking GET; the coroutine resumes once the response is complete.
+  HttpAwaiter http_get(std::string url) {
+    return HttpAwaiter(*this, std::move(url));
+  }
+
+private:
+  struct Loop;
+
+  Loop &pick();
+
+  static thread_local Loop *current_loop_;
+  std::vector<std::unique_ptr<Loop>> loops_;
+  std::atomic<std::size_t> next_loop_{0};
+  std::atomic<bool> running_{false};
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "async_executor.hpp"
+#include "market_data_provider.hpp"
+#include "price_pipe.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// PricingService on coroutines: one polling coroutine per ticker instead of
+// one thread, all multiplexed on the executor's loops. Same emission rules as
+// PricingService (OK updates only when the timestamp advances, every ERROR).
+class AsyncPricingService {
+public:
+  AsyncPricingService(std::shared_ptr<MarketDataProvider> provider,
+                      std::vector<std::string> tickers, PriceQueue &pipe,
+                      int interval_ms, AsyncExecutor &executor);
+  ~AsyncPricingService();
+
+  void start();
+  // Waits for every poller to finish its current fetch or sleep.
+  void stop();
+
+  void add_tickers(const std::vector<std::string> &tickers);
+  // Pollers of removed tickers exit at their next wake-up.
+  void remove_tickers(const std::vector<std::string> &tickers);
+
+  std::vector<std::string> tickers() const;
+  std::size_t in_flight() const { return live_.load(); }
+
+private:
+  struct Poller {
+    std::string ticker;
+    std::atomic<bool> active{true};
+  };
+
+  Task<void> poll(std::shared_ptr<Poller> poller);
+  void launch_locked(const std::string &ticker);
+
+  std::shared_ptr<MarketDataProvider> provider_;
+  PriceQueue &pipe_;
+  int interval_ms_;
+  AsyncExecutor &executor_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<Poller>> pollers_;
+
+  std::mutex done_mutex_;
+  std::condition_variable done_cv_;
+  std::atomic<std::size_t> live_{0};
+  std::atomic<bool> running_{false};
+};
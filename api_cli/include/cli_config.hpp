@@ -4,12 +4,25 @@
 
 struct CliConfig {
   bool test_mode{false};
+  bool echo{false};
   std::string pg_conninfo;
   std::string pg_host;
   std::string pg_port;
   std::string pg_user;
   std::string pg_password;
   std::string pg_db;
+  std::string stream_host;
+  int stream_port{61613};
+  int shards{1};
+  int async_threads{0};
+  bool synthetic{false};
+  int synthetic_symbols{0};
+  double synthetic_rate{1000.0};
+  double synthetic_jumps{0.0};
+  unsigned long long synthetic_seed{42};
+  std::string record_path;
+  std::string replay_path;
+  double replay_speed{1.0};
 };
 
 CliConfig parse_cli(int argc, char **argv);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+// Minimal local stand-in for the MOEX ISS securities endpoint. Answers
+// `GET .../securities/<ticker>.json` over HTTP/1.1 keep-alive with a
+// marketdata block carrying LAST and SYSTIME, after `response_delay_ms` to
+// mimic network latency. Every response gets a fresh SYSTIME second so
+// pollers always see a new tick. Point MoexClient at base_url().
+class IssStubServer {
+public:
+  explicit IssStubServer(int response_delay_ms = 0);
+  ~IssStubServer();
+
+  bool start(int port = 0);
+  void stop();
+
+  int port() const { return port_; }
+  std::string base_url() const;
+
+  std::size_t requests() const { return requests_.load(); }
+
+private:
+  void run();
+
+  int response_delay_ms_;
+  int listen_fd_{-1};
+  int port_{0};
+
+  std::atomic<bool> running_{false};
+  std::atomic<std::size_t> requests_{0};
+  std::thread thread_;
+};
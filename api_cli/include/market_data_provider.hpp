@@ -3,10 +3,17 @@
 #include <string>
 
 #include "price_update.hpp"
+#include "task.hpp"
 
 class MarketDataProvider {
 public:
   virtual ~MarketDataProvider() = default;
 
   virtual PriceUpdate get_price(const std::string &ticker) = 0;
+
+  // Awaitable fetch. Providers with a non-blocking transport override this;
+  // the default runs the synchronous get_price() on the awaiting thread.
+  virtual Task<PriceUpdate> get_price_async(std::string ticker) {
+    co_return get_price(ticker);
+  }
 };
@@ -3,13 +3,23 @@
 #include "market_data_provider.hpp"
 
 #include <string>
+
+class AsyncExecutor;
+
 class MoexClient : public MarketDataProvider {
 public:
-  MoexClient();
+  explicit MoexClient(
+      std::string base_url = "https://iss.moex.com/iss/engines/stock/markets/"
+                             "shares/boards/tqbr/securities/");
   ~MoexClient() override;
 
   PriceUpdate get_price(const std::string &ticker) override;
 
+  // With an executor set, fetches go through its curl multi loop and never
+  // block a thread; without one this falls back to get_price().
+  Task<PriceUpdate> get_price_async(std::string ticker) override;
+  void set_executor(AsyncExecutor *executor) { executor_ = executor; }
+
   static double parse_last_price_from_json(const std::string &body);
 
   static PriceUpdate parse_update_from_json(const std::string &body,
@@ -20,4 +30,7 @@ protected:
 
 private:
   std::string build_url(const std::string &ticker) const;
+
+  std::string base_url_;
+  AsyncExecutor *executor_{nullptr};
 };
@@ -3,8 +3,10 @@
 #include "price_update.hpp"
 
 #include <condition_variable>
+#include <cstddef>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 class PriceQueue {
 public:
@@ -12,6 +14,12 @@ public:
 
   bool read(PriceUpdate &out);
 
+  // Blocks until at least one update is queued, then moves up to max_items
+  // into out (which is cleared first). Returns false once closed and drained.
+  bool read_batch(std::vector<PriceUpdate> &out, std::size_t max_items);
+
+  std::size_t size();
+
   void close();
 
 private:
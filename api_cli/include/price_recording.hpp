@@ -0,0 +1,69 @@
+#pragma once
+
+#include "price_update.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Append-only binary capture of the PriceUpdates api_cli produced. The file
+// starts with an 8-byte magic; each record is
+//
+//   u32 length of the rest of the record
+//   i64 capture time, ns since the epoch
+//   i64 update timestamp, f64 price
+//   u16 ticker/status/error lengths, then the three strings
+//
+// in host byte order. A record cut short by a crash is ignored on read.
+struct RecordedUpdate {
+  std::int64_t capture_ns{};
+  PriceUpdate update;
+};
+
+class PriceRecorder {
+public:
+  explicit PriceRecorder(std::string path);
+  ~PriceRecorder();
+
+  PriceRecorder(const PriceRecorder &) = delete;
+  PriceRecorder &operator=(const PriceRecorder &) = delete;
+
+  bool open();
+  void close();
+
+  // Appends the updates in one write, each recorded at its capture_ns; one
+  // that never went through a PriceQueue is stamped with the current time.
+  bool append(const std::vector<PriceUpdate> &updates);
+  bool append(const RecordedUpdate &record);
+
+  std::uint64_t records() const { return records_; }
+
+private:
+  bool flush();
+
+  std::string path_;
+  std::FILE *file_{nullptr};
+  std::string buffer_;
+  std::uint64_t records_{0};
+};
+
+// Streams records back from a file written by PriceRecorder.
+class PriceRecordingReader {
+public:
+  explicit PriceRecordingReader(std::string path);
+  ~PriceRecordingReader();
+
+  PriceRecordingReader(const PriceRecordingReader &) = delete;
+  PriceRecordingReader &operator=(const PriceRecordingReader &) = delete;
+
+  // False if the file is missing or not a recording.
+  bool open();
+  // False at end of file or at a truncated trailing record.
+  bool next(RecordedUpdate &out);
+
+private:
+  std::string path_;
+  std::FILE *file_{nullptr};
+  std::string record_;
+};
@@ -9,4 +9,7 @@ struct PriceUpdate {
   double price{};
   std::string status;
   std::string error;
+  // When the update was queued for output, ns since the epoch; set by
+  // PriceQueue::write.
+  std::int64_t capture_ns{};
 };
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "price_update.hpp"
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Formats PriceUpdates as newline-delimited JSON into reusable fixed-size
+// chunks. The chunks are exposed as an iovec list so a whole batch goes out in
+// a single writev without being copied into one contiguous string first.
+class PriceSerializer {
+public:
+  explicit PriceSerializer(std::size_t chunk_size = 64 * 1024);
+
+  void append(const PriceUpdate &update);
+
+  void clear();
+
+  const std::vector<iovec> &iovecs();
+
+  std::size_t size() const { return size_; }
+
+  std::string str() const;
+
+private:
+  char *reserve(std::size_t n);
+
+  std::size_t chunk_size_;
+  std::vector<std::string> chunks_;
+  std::vector<std::size_t> used_;
+  std::size_t current_{0};
+  std::size_t size_{0};
+  std::vector<iovec> iov_;
+};
+
+// Writes the whole iovec list, resuming after partial writes and EINTR and
+// waiting for POLLOUT when the descriptor is non-blocking. The array is
+// consumed in place. Returns false with errno set on failure. When `written`
+// is given it receives the number of bytes that made it out, also on failure.
+bool write_fully(int fd, iovec *iov, std::size_t count,
+                 std::size_t *written = nullptr);
+
+// Mirrors what was written to the FIFO on stdout from a background thread so
+// the hot path never blocks on a terminal. Drops chunks when the printer falls
+// too far behind.
+class AsyncEcho {
+public:
+  explicit AsyncEcho(std::size_t max_pending = 1024);
+  ~AsyncEcho();
+
+  void post(std::string chunk);
+  void stop();
+
+  std::size_t dropped() const { return dropped_.load(); }
+
+private:
+  void run();
+
+  std::size_t max_pending_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::string> pending_;
+  bool stopped_{false};
+  std::atomic<std::size_t> dropped_{0};
+  std::thread thread_;
+};
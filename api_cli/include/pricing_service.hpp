@@ -4,10 +4,13 @@
 #include "price_pipe.hpp"
 
 #include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 class PricingService {
@@ -23,16 +26,33 @@ public:
 
   void add_tickers(const std::vector<std::string> &tickers);
 
+  // Stops polling the given tickers. Returns once their workers have exited;
+  // the freed slots are handed to the next tickers that get added.
+  void remove_tickers(const std::vector<std::string> &tickers);
+
+  std::vector<std::string> tickers() const;
+  std::size_t slot_count() const;
+
 private:
-  void worker_thread(std::string ticker);
+  struct Slot {
+    std::string ticker;
+    std::atomic<bool> active{false};
+    std::thread thread;
+  };
+
+  void worker_thread(Slot *slot);
+  void launch_locked(const std::string &ticker);
 
   std::shared_ptr<MarketDataProvider> provider_;
   PriceQueue &pipe_;
   int interval_ms_;
 
-  std::vector<std::string> tickers_;
+  std::vector<std::unique_ptr<Slot>> slots_;
+  std::vector<std::size_t> free_slots_;
+  std::unordered_map<std::string, std::size_t> index_;
 
-  std::mutex mutex_;
+  mutable std::mutex mutex_;
+  std::mutex wake_mutex_;
+  std::condition_variable wake_cv_;
   std::atomic<bool> running_{false};
-  std::vector<std::thread> threads_;
 };
@@ -12,8 +12,11 @@ public:
       std::shared_ptr<MarketDataProvider> base);
 
   PriceUpdate get_price(const std::string &ticker) override;
+  Task<PriceUpdate> get_price_async(std::string ticker) override;
 
 private:
+  PriceUpdate perturb(PriceUpdate base);
+
   std::shared_ptr<MarketDataProvider> base_;
 
   std::unordered_map<std::string, std::int64_t> last_simulated_ts_;
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "market_data_provider.hpp"
+#include "price_pipe.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Plays back a PriceRecorder file into a PriceQueue, keeping the recorded
+// gaps between captures divided by `speed` (speed <= 0 replays as fast as the
+// consumer drains the queue). The queue is closed once the file is exhausted
+// so a replay run ends on its own.
+class ReplayMarketDataProvider : public MarketDataProvider {
+public:
+  explicit ReplayMarketDataProvider(std::string path, double speed = 1.0);
+  ~ReplayMarketDataProvider() override;
+
+  // False if the file cannot be opened or is not a recording.
+  bool start(PriceQueue &out);
+  void stop();
+
+  // Latest replayed update for the ticker; throws if none was replayed yet.
+  PriceUpdate get_price(const std::string &ticker) override;
+
+  std::size_t replayed() const { return replayed_.load(); }
+  bool finished() const { return finished_.load(); }
+
+private:
+  void run();
+
+  std::string path_;
+  double speed_;
+  PriceQueue *out_{nullptr};
+
+  std::mutex latest_mutex_;
+  std::unordered_map<std::string, PriceUpdate> latest_;
+
+  std::mutex wait_mutex_;
+  std::condition_variable wait_cv_;
+
+  std::atomic<bool> running_{false};
+  std::atomic<bool> finished_{false};
+  std::atomic<std::size_t> replayed_{0};
+  std::thread thread_;
+};
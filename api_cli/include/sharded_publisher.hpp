@@ -0,0 +1,62 @@
+#pragma once
+
+#include "price_update.hpp"
+#include "price_writer.hpp"
+#include "shard_ring.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Fans PriceUpdates out to one FIFO per bsm_pricing shard. Tickers are mapped
+// to live consumers through a ShardRing: a FIFO whose reader went away (EPIPE)
+// leaves the ring and its tickers are re-routed in the same call, and FIFOs
+// without a reader are re-probed periodically and join the ring once a reader
+// attaches. With a single FIFO there is nowhere to re-route, so it behaves like
+// the plain FIFO writer: init waits for the reader and publish reports its
+// departure to the caller.
+class ShardedPublisher {
+public:
+  explicit ShardedPublisher(std::vector<std::string> paths,
+                            int probe_interval_ms = 500);
+  ~ShardedPublisher();
+
+  ShardedPublisher(const ShardedPublisher &) = delete;
+  ShardedPublisher &operator=(const ShardedPublisher &) = delete;
+
+  // Creates missing FIFOs. Returns false if one cannot be created. A single
+  // FIFO is opened blocking, waiting for its reader.
+  bool init();
+
+  // Writes the batch to the owning shards, waiting for at least one consumer
+  // if none is attached. Returns false when the only FIFO's reader is gone.
+  bool publish(const std::vector<PriceUpdate> &batch);
+
+  // Tries to attach FIFOs that currently have no reader.
+  void probe();
+
+  std::size_t live_channels() const;
+  int owner_of(const std::string &ticker) const { return ring_.owner(ticker); }
+  std::size_t channel_count() const { return channels_.size(); }
+
+  static std::vector<std::string> shard_paths(const std::string &base,
+                                              std::size_t shards);
+
+private:
+  struct Channel {
+    std::string path;
+    int fd{-1};
+    PriceSerializer serializer;
+    std::vector<const PriceUpdate *> routed;
+    std::vector<std::size_t> ends; // serialized size after each routed update
+    std::vector<iovec> iov;
+  };
+
+  void detach(std::size_t shard);
+
+  std::vector<Channel> channels_;
+  ShardRing ring_;
+  std::chrono::milliseconds probe_interval_;
+  std::chrono::steady_clock::time_point last_probe_;
+};
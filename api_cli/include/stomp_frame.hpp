@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct StompFrame {
+  std::string command;
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+
+  const std::string *header(const std::string &name) const;
+};
+
+std::string serialize_stomp_frame(const StompFrame &frame);
+
+// Incremental decoder for a STOMP byte stream. Heart-beat EOLs between frames
+// are skipped and command/header lines may end in LF or CRLF; content-length
+// is honoured when present, otherwise the body runs up to the terminating
+// NUL.
+class StompFrameParser {
+public:
+  void feed(const char *data, std::size_t size);
+
+  bool next(StompFrame &out);
+
+  void reset();
+
+private:
+  std::string buffer_;
+  std::size_t offset_{0};
+};
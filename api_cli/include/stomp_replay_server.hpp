@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct RecordedFrame {
+  std::int64_t offset_ms{};
+  std::string ticker;
+  std::string body;
+};
+
+// Loads a recording with one frame per line: "<offset_ms>\t<ticker>\t<body>".
+// Blank lines and lines starting with '#' are ignored.
+std::vector<RecordedFrame> load_recorded_frames(const std::string &path);
+
+// Local stand-in for the exchange STOMP feed. Serves one client at a time on
+// 127.0.0.1 and replays the recording to whatever the client subscribed to,
+// keeping the recorded spacing divided by `speed` (speed <= 0 sends frames
+// back to back). The replay cursor survives reconnects, like a live feed.
+class StompReplayServer {
+public:
+  StompReplayServer(std::vector<RecordedFrame> frames, double speed,
+                    bool loop = false,
+                    std::string destination_prefix = "/marketdata/");
+  ~StompReplayServer();
+
+  // Binds to the given port (0 picks an ephemeral one) and starts serving.
+  bool start(int port = 0);
+  void stop();
+
+  int port() const { return port_; }
+
+  // Drops the current client session, e.g. to exercise reconnects.
+  void disconnect_clients() { kick_ = true; }
+
+  std::size_t frames_sent() const { return frames_sent_.load(); }
+  std::size_t sessions() const { return sessions_.load(); }
+
+private:
+  void accept_loop();
+  void serve_client(int fd);
+
+  std::vector<RecordedFrame> frames_;
+  double speed_;
+  bool loop_;
+  std::string destination_prefix_;
+
+  int listen_fd_{-1};
+  int port_{0};
+  std::size_t cursor_{0};
+
+  std::atomic<bool> running_{false};
+  std::atomic<bool> kick_{false};
+  std::atomic<std::size_t> frames_sent_{0};
+  std::atomic<std::size_t> sessions_{0};
+  std::thread thread_;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "market_data_provider.hpp"
+#include "price_pipe.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct StreamingConfig {
+  std::string host{"127.0.0.1"};
+  int port{61613};
+  std::string destination_prefix{"/marketdata/"};
+  int reconnect_delay_ms{200};
+  int max_reconnect_delay_ms{10000};
+};
+
+// Push-based provider: keeps one STOMP session open, subscribes to a
+// destination per ticker and writes a PriceUpdate into the queue as soon as
+// the MESSAGE frame is decoded. Lost sessions are re-established with
+// exponential backoff and every active subscription is replayed.
+class StreamingMarketDataProvider : public MarketDataProvider {
+public:
+  explicit StreamingMarketDataProvider(StreamingConfig cfg);
+  ~StreamingMarketDataProvider() override;
+
+  void start(PriceQueue &out);
+  void stop();
+
+  void subscribe(const std::vector<std::string> &tickers);
+  void unsubscribe(const std::vector<std::string> &tickers);
+
+  // Latest streamed update for the ticker; throws if nothing arrived yet.
+  PriceUpdate get_price(const std::string &ticker) override;
+
+  std::size_t connections() const { return connections_.load(); }
+  std::size_t messages() const { return messages_.load(); }
+
+private:
+  void run();
+  std::string subscription_frame(const std::string &command,
+                                 const std::string &ticker) const;
+  bool send_frame_locked(const std::string &command,
+                         const std::string &ticker);
+  void handle_message(const std::string &destination,
+                      const std::string &body);
+  void sleep_backoff(int delay_ms);
+
+  StreamingConfig cfg_;
+  PriceQueue *out_{nullptr};
+
+  std::mutex socket_mutex_;
+  int fd_{-1};
+  std::unordered_set<std::string> subscriptions_;
+
+  std::mutex latest_mutex_;
+  std::unordered_map<std::string, PriceUpdate> latest_;
+
+  std::mutex wait_mutex_;
+  std::condition_variable wait_cv_;
+
+  std::atomic<bool> running_{false};
+  std::atomic<std::size_t> connections_{0};
+  std::atomic<std::size_t> messages_{0};
+  std::thread thread_;
+};
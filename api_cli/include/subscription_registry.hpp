@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+struct pg_conn;
+
+// Set of tickers api_cli should be polling, kept in sync with the database
+// over one long-lived connection. The database pushes a NOTIFY on
+// `ticker_subscriptions` whenever ticker or bsm_params change (see
+// db_migrations/009); the registry then re-reads the set and reports the
+// difference. A full resync also runs every `resync_interval_sec` in case a
+// notification was missed while disconnected.
+class SubscriptionRegistry {
+public:
+  using ChangeCallback =
+      std::function<void(const std::vector<std::string> &added,
+                         const std::vector<std::string> &removed)>;
+
+  explicit SubscriptionRegistry(std::string conninfo,
+                                int resync_interval_sec = 60);
+  ~SubscriptionRegistry();
+
+  // Connects, subscribes to notifications and loads the initial set.
+  // Returns false if the database is unreachable; start() keeps retrying.
+  bool load();
+
+  void start(ChangeCallback on_change);
+  void stop();
+
+  std::vector<std::string> tickers() const;
+  bool contains(const std::string &ticker) const;
+
+  // Replaces the current set and reports what changed.
+  void apply_snapshot(const std::vector<std::string> &fresh,
+                      std::vector<std::string> &added,
+                      std::vector<std::string> &removed);
+
+private:
+  bool ensure_connected();
+  void disconnect();
+  bool refresh();
+  void run();
+
+  std::string conninfo_;
+  int resync_interval_sec_;
+  pg_conn *conn_{nullptr};
+
+  mutable std::mutex mutex_;
+  std::unordered_set<std::string> tickers_;
+
+  ChangeCallback on_change_;
+  std::mutex wait_mutex_;
+  std::condition_variable wait_cv_;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
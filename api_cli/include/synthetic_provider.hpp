@@ -0,0 +1,97 @@
+#pragma once
+
+#include "market_data_provider.hpp"
+#include "price_pipe.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct SyntheticConfig {
+  std::uint64_t seed{42};
+  double initial_price{100.0};
+  double drift{0.05};      // annualised
+  double volatility{0.25}; // annualised
+  // Merton-style jumps: expected jumps per year and log-size distribution.
+  double jump_intensity{0.0};
+  double jump_mean{0.0};
+  double jump_stddev{0.0};
+  // Simulated market time between consecutive ticks of one symbol. Update
+  // timestamps are whole seconds of that clock, so sub-second ticks share
+  // a timestamp.
+  double tick_seconds{1.0};
+  std::int64_t start_timestamp{0}; // 0 = wall clock at construction
+  // Pacing for start(): total ticks/sec across all symbols, 0 = as fast as
+  // the consumer drains the queue.
+  double ticks_per_sec{0.0};
+};
+
+// Fully offline provider. Every ticker gets its own geometric Brownian motion
+// path driven by an RNG stream seeded from (seed, ticker), so a run is
+// reproducible regardless of the order tickers are first seen. Each path is
+// guarded by its own mutex; the ticker index is only locked exclusively when
+// a new ticker appears.
+class SyntheticMarketDataProvider : public MarketDataProvider {
+public:
+  explicit SyntheticMarketDataProvider(SyntheticConfig cfg = {});
+  ~SyntheticMarketDataProvider() override;
+
+  // Advances the ticker's path by one tick.
+  PriceUpdate get_price(const std::string &ticker) override;
+
+  void subscribe(const std::vector<std::string> &tickers);
+  void unsubscribe(const std::vector<std::string> &tickers);
+
+  // Push mode: a generator thread round-robins over the subscribed tickers
+  // and writes one update per tick into the queue, paced by ticks_per_sec.
+  // Unthrottled, it holds off while the queue is kMaxQueued deep.
+  void start(PriceQueue &out);
+  void stop();
+
+  std::uint64_t ticks() const { return ticks_.load(); }
+
+  // "SYN0000", "SYN0001", ... for load tests that need many symbols.
+  static std::vector<std::string> symbol_names(std::size_t count);
+
+private:
+  struct Path {
+    std::mutex mutex;
+    std::string ticker;
+    std::mt19937_64 rng;
+    std::normal_distribution<double> normal;
+    std::uniform_real_distribution<double> uniform;
+    double price;
+    std::uint64_t steps{0};
+  };
+
+  Path &path_for(const std::string &ticker);
+  PriceUpdate step(Path &path);
+  void run();
+
+  SyntheticConfig cfg_;
+  double tick_seconds_;
+  double dt_;
+  double diffusion_drift_;
+  double diffusion_scale_;
+  double jump_probability_;
+
+  mutable std::shared_mutex index_mutex_;
+  std::unordered_map<std::string, std::unique_ptr<Path>> paths_;
+
+  std::mutex subscriptions_mutex_;
+  std::vector<Path *> subscribed_;
+  std::atomic<std::uint64_t> subscriptions_version_{0};
+
+  PriceQueue *out_{nullptr};
+  std::atomic<bool> running_{false};
+  std::atomic<std::uint64_t> ticks_{0};
+  std::thread thread_;
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+// Lazily started coroutine returning T. A Task runs when it is co_awaited and
+// resumes its awaiter when it finishes (symmetric transfer, so long await
+// chains do not grow the stack). Exceptions propagate to the awaiter.
+template <typename T> class Task;
+
+namespace task_detail {
+
+struct PromiseBase {
+  std::coroutine_handle<> continuation{std::noop_coroutine()};
+  std::exception_ptr error;
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    template <typename P>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<P> h) noexcept {
+      return h.promise().continuation;
+    }
+    void await_resume() noexcept {}
+  };
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() { error = std::current_exception(); }
+};
+
+// Fire-and-forget coroutine: starts immediately, frees itself when done.
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+} // namespace task_detail
+
+template <typename T> class Task {
+public:
+  struct promise_type : task_detail::PromiseBase {
+    std::optional<T> value;
+
+    Task get_return_object() {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    template <typename U> void return_value(U &&v) {
+      value.emplace(std::forward<U>(v));
+    }
+  };
+
+  Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      reset();
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+  ~Task() { reset(); }
+
+  bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) {
+    handle_.promise().continuation = awaiter;
+    return handle_;
+  }
+  T await_resume() {
+    auto &promise = handle_.promise();
+    if (promise.error) {
+      std::rethrow_exception(promise.error);
+    }
+    return std::move(*promise.value);
+  }
+
+private:
+  explicit Task(std::coroutine_handle<promise_type> h) : handle_(h) {}
+  void reset() {
+    if (handle_) {
+      handle_.destroy();
+      handle_ = {};
+    }
+  }
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+template <> class Task<void> {
+public:
+  struct promise_type : task_detail::PromiseBase {
+    Task get_return_object() {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    void return_void() {}
+  };
+
+  Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      reset();
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+  ~Task() { reset(); }
+
+  bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) {
+    handle_.promise().continuation = awaiter;
+    return handle_;
+  }
+  void await_resume() {
+    if (handle_.promise().error) {
+      std::rethrow_exception(handle_.promise().error);
+    }
+  }
+
+private:
+  explicit Task(std::coroutine_handle<promise_type> h) : handle_(h) {}
+  void reset() {
+    if (handle_) {
+      handle_.destroy();
+      handle_ = {};
+    }
+  }
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace task_detail {
+
+template <typename T>
+Detached drive(Task<T> &task, std::promise<T> &result) {
+  try {
+    if constexpr (std::is_void_v<T>) {
+      co_await task;
+      result.set_value();
+    } else {
+      result.set_value(co_await task);
+    }
+  } catch (...) {
+    result.set_exception(std::current_exception());
+  }
+}
+
+} // namespace task_detail
+
+// Runs the task on the calling thread until its first suspension and blocks
+// until it completes, wherever it gets resumed.
+template <typename T> T sync_wait(Task<T> task) {
+  std::promise<T> result;
+  auto future = result.get_future();
+  task_detail::drive(task, result);
+  return future.get();
+}
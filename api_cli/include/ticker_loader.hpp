@@ -3,4 +3,9 @@
 #include <string>
 #include <vector>
 
+struct pg_conn;
+
 std::vector<std::string> load_tickers_from_db(const std::string &conninfo);
+
+// Runs the subscription query on an already open connection.
+bool load_tickers(pg_conn *conn, std::vector<std::string> &out);
@@ -0,0 +1,234 @@
+#include "async_executor.hpp"
+
+#include "async_logger.hpp"
+
+#include <curl/curl.h>
+
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+namespace {
+
+size_t write_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
+  auto *buffer = static_cast<std::string *>(userdata);
+  buffer->append(ptr, size * nmemb);
+  return size * nmemb;
+}
+
+struct Timer {
+  std::chrono::steady_clock::time_point at;
+  std::uint64_t seq;
+  std::coroutine_handle<> handle;
+
+  bool operator>(const Timer &other) const {
+    return at != other.at ? at > other.at : seq > other.seq;
+  }
+};
+
+task_detail::Detached run_spawned(AsyncExecutor &ex, Task<void> task) {
+  co_await ex.schedule();
+  try {
+    co_await task;
+  } catch (const std::exception &e) {
+    log_error("AsyncExecutor", "task failed", {{"error", e.what()}});
+  } catch (...) {
+    log_error("AsyncExecutor", "task failed");
+  }
+}
+
+} // namespace
+
+struct AsyncExecutor::Loop {
+  AsyncExecutor *owner{nullptr};
+  CURLM *multi{nullptr};
+
+  std::mutex mutex;
+  std::vector<std::function<void()>> posted;
+
+  // Only touched on the loop thread.
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+  std::uint64_t timer_seq{0};
+
+  std::thread thread;
+
+  void post(std::function<void()> fn) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      posted.push_back(std::move(fn));
+    }
+    curl_multi_wakeup(multi);
+  }
+
+  void add_request(HttpAwaiter *req) {
+    CURL *easy = curl_easy_init();
+    if (!easy) {
+      req->response_.error = "Failed to init CURL";
+      post([req] { req->continuation_.resume(); });
+      return;
+    }
+    curl_easy_setopt(easy, CURLOPT_URL, req->url_.c_str());
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, &req->response_.body);
+    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, req);
+    curl_multi_add_handle(multi, easy);
+  }
+
+  void complete_transfers() {
+    int pending = 0;
+    while (CURLMsg *msg = curl_multi_info_read(multi, &pending)) {
+      if (msg->msg != CURLMSG_DONE) {
+        continue;
+      }
+      CURL *easy = msg->easy_handle;
+      HttpAwaiter *req = nullptr;
+      curl_easy_getinfo(easy, CURLINFO_PRIVATE, &req);
+      if (msg->data.result != CURLE_OK) {
+        req->response_.error = curl_easy_strerror(msg->data.result);
+      } else {
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE,
+                          &req->response_.status);
+      }
+      curl_multi_remove_handle(multi, easy);
+      curl_easy_cleanup(easy);
+      req->continuation_.resume();
+    }
+  }
+
+  void run();
+};
+
+thread_local AsyncExecutor::Loop *AsyncExecutor::current_loop_ = nullptr;
+
+void AsyncExecutor::Loop::run() {
+  using clock = std::chrono::steady_clock;
+  current_loop_ = this;
+
+  std::vector<std::function<void()>> batch;
+  while (owner->running_) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      batch.swap(posted);
+    }
+    for (auto &fn : batch) {
+      fn();
+    }
+    batch.clear();
+
+    auto now = clock::now();
+    while (!timers.empty() && timers.top().at <= now) {
+      auto h = timers.top().handle;
+      timers.pop();
+      h.resume();
+    }
+
+    int timeout_ms = 1000;
+    if (!timers.empty()) {
+      auto wait = std::chrono::duration<double, std::milli>(
+                      timers.top().at - clock::now())
+                      .count();
+      timeout_ms = wait <= 0 ? 0
+                             : static_cast<int>(std::min<double>(
+                                   std::ceil(wait), timeout_ms));
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!posted.empty()) {
+        timeout_ms = 0;
+      }
+    }
+
+    curl_multi_poll(multi, nullptr, 0, timeout_ms, nullptr);
+    int still_running = 0;
+    curl_multi_perform(multi, &still_running);
+    complete_transfers();
+  }
+  current_loop_ = nullptr;
+}
+
+AsyncExecutor::AsyncExecutor(std::size_t threads) {
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+  if (threads == 0) {
+    threads = 1;
+  }
+  for (std::size_t i = 0; i < threads; ++i) {
+    auto loop = std::make_unique<Loop>();
+    loop->owner = this;
+    loop->multi = curl_multi_init();
+    loops_.push_back(std::move(loop));
+  }
+}
+
+AsyncExecutor::~AsyncExecutor() {
+  stop();
+  for (auto &loop : loops_) {
+    curl_multi_cleanup(loop->multi);
+  }
+  curl_global_cleanup();
+}
+
+void AsyncExecutor::start() {
+  if (running_.exchange(true)) {
+    return;
+  }
+  for (auto &loop : loops_) {
+    loop->thread = std::thread(&Loop::run, loop.get());
+  }
+}
+
+void AsyncExecutor::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  for (auto &loop : loops_) {
+    curl_multi_wakeup(loop->multi);
+  }
+  for (auto &loop : loops_) {
+    if (loop->thread.joinable()) {
+      loop->thread.join();
+    }
+  }
+}
+
+AsyncExecutor::Loop &AsyncExecutor::pick() {
+  // Stay on the current loop when already on one of ours: no cross-thread
+  // handoff and the coroutine keeps its cache-warm thread.
+  if (current_loop_ && current_loop_->owner == this) {
+    return *current_loop_;
+  }
+  return *loops_[next_loop_.fetch_add(1) % loops_.size()];
+}
+
+void AsyncExecutor::spawn(Task<void> task) {
+  run_spawned(*this, std::move(task));
+}
+
+void AsyncExecutor::ScheduleAwaiter::await_suspend(std::coroutine_handle<> h) {
+  ex_.loops_[ex_.next_loop_.fetch_add(1) % ex_.loops_.size()]->post(
+      [h] { h.resume(); });
+}
+
+void AsyncExecutor::SleepAwaiter::await_suspend(std::coroutine_handle<> h) {
+  Loop &loop = ex_.pick();
+  if (&loop == current_loop_) {
+    loop.timers.push(Timer{at_, loop.timer_seq++, h});
+    return;
+  }
+  loop.post([&loop, at = at_, h] {
+    loop.timers.push(Timer{at, loop.timer_seq++, h});
+  });
+}
+
+void AsyncExecutor::HttpAwaiter::await_suspend(std::coroutine_handle<> h) {
+  continuation_ = h;
+  Loop &loop = ex_.pick();
+  if (&loop == current_loop_) {
+    loop.add_request(this);
+    return;
+  }
+  loop.post([&loop, this] { loop.add_request(this); });
+}
@@ -0,0 +1,120 @@
+#include "async_pricing_service.hpp"
+
+#include <chrono>
+
+AsyncPricingService::AsyncPricingService(
+    std::shared_ptr<MarketDataProvider> provider,
+    std::vector<std::string> tickers, PriceQueue &pipe, int interval_ms,
+    AsyncExecutor &executor)
+    : provider_(std::move(provider)), pipe_(pipe), interval_ms_(interval_ms),
+      executor_(executor) {
+  add_tickers(tickers);
+}
+
+AsyncPricingService::~AsyncPricingService() { stop(); }
+
+void AsyncPricingService::start() {
+  if (running_.exchange(true)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &entry : pollers_) {
+    ++live_;
+    executor_.spawn(poll(entry.second));
+  }
+}
+
+void AsyncPricingService::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(done_mutex_);
+  done_cv_.wait(lock, [this] { return live_.load() == 0; });
+  pipe_.close();
+}
+
+void AsyncPricingService::launch_locked(const std::string &ticker) {
+  auto poller = std::make_shared<Poller>();
+  poller->ticker = ticker;
+  pollers_.emplace(ticker, poller);
+  if (running_) {
+    ++live_;
+    executor_.spawn(poll(std::move(poller)));
+  }
+}
+
+void AsyncPricingService::add_tickers(const std::vector<std::string> &tickers) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &t : tickers) {
+    if (pollers_.count(t) == 0) {
+      launch_locked(t);
+    }
+  }
+}
+
+void AsyncPricingService::remove_tickers(
+    const std::vector<std::string> &tickers) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &t : tickers) {
+    auto it = pollers_.find(t);
+    if (it != pollers_.end()) {
+      it->second->active = false;
+      pollers_.erase(it);
+    }
+  }
+}
+
+std::vector<std::string> AsyncPricingService::tickers() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> out;
+  out.reserve(pollers_.size());
+  for (const auto &entry : pollers_) {
+    out.push_back(entry.first);
+  }
+  return out;
+}
+
+Task<void> AsyncPricingService::poll(std::shared_ptr<Poller> poller) {
+  const auto interval = std::chrono::milliseconds(interval_ms_);
+  std::int64_t last_ts = -1;
+
+  while (running_ && poller->active) {
+    PriceUpdate update;
+    bool should_emit = false;
+    try {
+      update = co_await provider_->get_price_async(poller->ticker);
+      if (update.status == "OK") {
+        if (update.timestamp > last_ts) {
+          last_ts = update.timestamp;
+          should_emit = true;
+        }
+      } else if (update.status == "ERROR") {
+        should_emit = true;
+      }
+    } catch (const std::exception &ex) {
+      update = PriceUpdate{};
+      update.timestamp = -1;
+      update.ticker = poller->ticker;
+      update.status = "ERROR";
+      update.error = ex.what();
+      should_emit = true;
+    } catch (...) {
+      update = PriceUpdate{};
+      update.timestamp = -1;
+      update.ticker = poller->ticker;
+      update.status = "ERROR";
+      update.error = "Unknown error during price fetch";
+      should_emit = true;
+    }
+
+    if (should_emit) {
+      pipe_.write(update);
+    }
+    co_await executor_.sleep_for(interval);
+  }
+
+  std::lock_guard<std::mutex> lock(done_mutex_);
+  if (--live_ == 0) {
+    done_cv_.notify_all();
+  }
+}
@@ -0,0 +1,210 @@
+#include "iss_stub_server.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Pending {
+  Clock::time_point due;
+  std::string ticker;
+};
+
+struct Client {
+  std::string in;
+  std::string out;
+  std::deque<Pending> pending;
+};
+
+std::string ticker_from_request(const std::string &request_line) {
+  auto end = request_line.find(".json");
+  if (end == std::string::npos) {
+    return {};
+  }
+  auto begin = request_line.rfind('/', end);
+  if (begin == std::string::npos) {
+    return {};
+  }
+  std::string ticker = request_line.substr(begin + 1, end - begin - 1);
+  for (auto &c : ticker) {
+    c = static_cast<char>(::toupper(static_cast<unsigned char>(c)));
+  }
+  return ticker;
+}
+
+std::string render_response(const std::string &ticker, std::size_t seq) {
+  std::time_t ts = std::time(nullptr) + static_cast<std::time_t>(seq);
+  std::tm tm{};
+  gmtime_r(&ts, &tm);
+  char systime[32];
+  std::strftime(systime, sizeof(systime), "%Y-%m-%d %H:%M:%S", &tm);
+
+  char price[32];
+  std::snprintf(price, sizeof(price), "%.2f",
+                100.0 + static_cast<double>(seq % 1000) * 0.01);
+
+  std::string body = "{\"marketdata\": {\"columns\": [\"SECID\", \"LAST\", "
+                     "\"SYSTIME\"], \"data\": [[\"" +
+                     ticker + "\", " + price + ", \"" + systime + "\"]]}}";
+  return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+         "Content-Length: " +
+         std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+} // namespace
+
+IssStubServer::IssStubServer(int response_delay_ms)
+    : response_delay_ms_(response_delay_ms) {}
+
+IssStubServer::~IssStubServer() { stop(); }
+
+std::string IssStubServer::base_url() const {
+  return "http://127.0.0.1:" + std::to_string(port_) + "/iss/securities/";
+}
+
+bool IssStubServer::start(int port) {
+  if (running_) {
+    return true;
+  }
+
+  listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (listen_fd_ < 0) {
+    return false;
+  }
+  int one = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(static_cast<std::uint16_t>(port));
+  if (::bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) <
+          0 ||
+      ::listen(listen_fd_, 1024) < 0) {
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+
+  socklen_t len = sizeof(addr);
+  getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&addr), &len);
+  port_ = ntohs(addr.sin_port);
+
+  running_ = true;
+  thread_ = std::thread(&IssStubServer::run, this);
+  return true;
+}
+
+void IssStubServer::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (listen_fd_ >= 0) {
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+  }
+}
+
+void IssStubServer::run() {
+  std::unordered_map<int, Client> clients;
+  std::vector<pollfd> fds;
+  std::vector<char> buf(16 * 1024);
+  const auto delay = std::chrono::milliseconds(response_delay_ms_);
+
+  while (running_) {
+    auto now = Clock::now();
+    int timeout_ms = 50;
+    fds.clear();
+    fds.push_back(pollfd{listen_fd_, POLLIN, 0});
+    for (auto &entry : clients) {
+      Client &c = entry.second;
+      short events = POLLIN;
+      if (!c.out.empty()) {
+        events |= POLLOUT;
+      }
+      if (!c.pending.empty()) {
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        c.pending.front().due - now)
+                        .count();
+        timeout_ms = std::max(0, std::min<int>(timeout_ms,
+                                               static_cast<int>(wait) + 1));
+      }
+      fds.push_back(pollfd{entry.first, events, 0});
+    }
+
+    if (::poll(fds.data(), fds.size(), timeout_ms) < 0) {
+      continue;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      int fd;
+      while ((fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK)) >=
+             0) {
+        clients.emplace(fd, Client{});
+      }
+    }
+
+    now = Clock::now();
+    for (std::size_t i = 1; i < fds.size(); ++i) {
+      const int fd = fds[i].fd;
+      Client &c = clients[fd];
+      bool closed = (fds[i].revents & (POLLERR | POLLHUP)) != 0;
+
+      if (!closed && (fds[i].revents & POLLIN)) {
+        ssize_t n = ::recv(fd, buf.data(), buf.size(), 0);
+        if (n <= 0) {
+          closed = true;
+        } else {
+          c.in.append(buf.data(), static_cast<std::size_t>(n));
+          std::size_t end;
+          while ((end = c.in.find("\r\n\r\n")) != std::string::npos) {
+            const std::string line = c.in.substr(0, c.in.find("\r\n"));
+            c.pending.push_back(
+                Pending{now + delay, ticker_from_request(line)});
+            c.in.erase(0, end + 4);
+          }
+        }
+      }
+
+      while (!closed && !c.pending.empty() && c.pending.front().due <= now) {
+        c.out += render_response(c.pending.front().ticker, requests_++);
+        c.pending.pop_front();
+      }
+
+      if (!closed && !c.out.empty()) {
+        ssize_t n = ::send(fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+          c.out.erase(0, static_cast<std::size_t>(n));
+        } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+          closed = true;
+        }
+      }
+
+      if (closed) {
+        ::close(fd);
+        clients.erase(fd);
+      }
+    }
+  }
+
+  for (auto &entry : clients) {
+    ::close(entry.first);
+  }
+}
@@ -1,14 +1,19 @@
+#include "async_executor.hpp"
+#include "async_pricing_service.hpp"
 #include "cli_config.hpp"
 #include "moex_client.hpp"
 #include "price_pipe.hpp"
+#include "price_writer.hpp"
+#include "price_recording.hpp"
 #include "pricing_service.hpp"
 #include "randomized_provider.hpp"
-#include "ticker_loader.hpp"
-
-#include <fcntl.h>
-#include <sys/stat.h>
-#include <unistd.h>
+#include "replay_provider.hpp"
+#include "sharded_publisher.hpp"
+#include "streaming_provider.hpp"
+#include "subscription_registry.hpp"
+#include "synthetic_provider.hpp"
 
+#include <csignal>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -32,24 +37,6 @@ std::string get_pipe_path() {
   return "/tmp/pricing_pipe";
 }
 
-int open_fifo_for_writing(const std::string &path) {
-  if (mkfifo(path.c_str(), 0666) < 0) {
-    if (errno != EEXIST) {
-      std::cerr << "Failed to create fifo at " << path << ": "
-                << std::strerror(errno) << "\n";
-      return -1;
-    }
-  }
-
-  int fd = ::open(path.c_str(), O_WRONLY);
-  if (fd < 0) {
-    std::cerr << "Failed to open fifo for writing at " << path << ": "
-              << std::strerror(errno) << "\n";
-    return -1;
-  }
-  return fd;
-}
-
 } // namespace
 
 CliConfig parse_cli(int argc, char **argv) {
@@ -64,6 +51,8 @@ CliConfig parse_cli(int argc, char **argv) {
 
     if (arg == "--test") {
       cfg.test_mode = true;
+    } else if (arg == "--echo") {
+      cfg.echo = true;
     } else if (arg == "--pg-conninfo") {
       next_string(cfg.pg_conninfo);
     } else if (arg == "--pg-host") {
@@ -76,6 +65,54 @@ CliConfig parse_cli(int argc, char **argv) {
       next_string(cfg.pg_password);
     } else if (arg == "--pg-db" || arg == "--pg-database") {
       next_string(cfg.pg_db);
+    } else if (arg == "--stream-host") {
+      next_string(cfg.stream_host);
+    } else if (arg == "--stream-port") {
+      std::string port;
+      next_string(port);
+      if (!port.empty())
+        cfg.stream_port = std::stoi(port);
+    } else if (arg == "--shards") {
+      std::string shards;
+      next_string(shards);
+      if (!shards.empty())
+        cfg.shards = std::max(1, std::stoi(shards));
+    } else if (arg == "--async-threads") {
+      std::string threads;
+      next_string(threads);
+      if (!threads.empty())
+        cfg.async_threads = std::max(0, std::stoi(threads));
+    } else if (arg == "--synthetic") {
+      cfg.synthetic = true;
+    } else if (arg == "--synthetic-symbols") {
+      std::string symbols;
+      next_string(symbols);
+      if (!symbols.empty())
+        cfg.synthetic_symbols = std::max(0, std::stoi(symbols));
+    } else if (arg == "--synthetic-rate") {
+      std::string rate;
+      next_string(rate);
+      if (!rate.empty())
+        cfg.synthetic_rate = std::max(0.0, std::stod(rate));
+    } else if (arg == "--synthetic-jumps") {
+      std::string jumps;
+      next_string(jumps);
+      if (!jumps.empty())
+        cfg.synthetic_jumps = std::max(0.0, std::stod(jumps));
+    } else if (arg == "--synthetic-seed") {
+      std::string seed;
+      next_string(seed);
+      if (!seed.empty())
+        cfg.synthetic_seed = std::stoull(seed);
+    } else if (arg == "--record") {
+      next_string(cfg.record_path);
+    } else if (arg == "--replay") {
+      next_string(cfg.replay_path);
+    } else if (arg == "--replay-speed") {
+      std::string speed;
+      next_string(speed);
+      if (!speed.empty())
+        cfg.replay_speed = std::stod(speed);
     }
   }
   return cfg;
@@ -84,7 +121,11 @@ CliConfig parse_cli(int argc, char **argv) {
 int main(int argc, char **argv) {
   CliConfig cfg = parse_cli(argc, argv);
 
-  if (cfg.pg_conninfo.empty()) {
+  // Replays and generated symbol sets never need the database.
+  const bool offline = !cfg.replay_path.empty() ||
+                       (cfg.synthetic && cfg.synthetic_symbols > 0);
+
+  if (!offline && cfg.pg_conninfo.empty()) {
     if (cfg.pg_host.empty() || cfg.pg_user.empty() || cfg.pg_db.empty()) {
       std::cerr << "Missing database connection parameters. "
                 << "Provide either --pg-conninfo "
@@ -100,11 +141,16 @@ int main(int argc, char **argv) {
     cfg.pg_conninfo = std::move(ci);
   }
 
-  auto tickers = load_tickers_from_db(cfg.pg_conninfo);
-  if (tickers.empty()) {
-    std::cerr << "No tickers loaded from DB\n Waiting for new\n";
-    tickers = load_tickers_from_db(cfg.pg_conninfo);
-    std::this_thread::sleep_for(5s);
+  SubscriptionRegistry registry(cfg.pg_conninfo);
+  std::vector<std::string> tickers;
+  if (!offline) {
+    if (!registry.load()) {
+      std::cerr << "No tickers loaded from DB\n Waiting for new\n";
+    }
+    tickers = registry.tickers();
+  } else if (cfg.replay_path.empty()) {
+    tickers = SyntheticMarketDataProvider::symbol_names(
+        static_cast<std::size_t>(cfg.synthetic_symbols));
   }
   int interval_ms = 500;
 
@@ -116,66 +162,139 @@ int main(int argc, char **argv) {
   }
   PricingService service(provider, tickers, pipe, interval_ms);
 
-  const std::string pipe_path = get_pipe_path();
-  int fifo_fd = open_fifo_for_writing(pipe_path);
-  if (fifo_fd < 0) {
-    return 1;
+  // --async-threads N: coroutine pollers on N event loops instead of one
+  // thread per ticker.
+  std::unique_ptr<AsyncExecutor> executor;
+  std::unique_ptr<AsyncPricingService> async_service;
+  if (cfg.async_threads > 0) {
+    executor = std::make_unique<AsyncExecutor>(
+        static_cast<std::size_t>(cfg.async_threads));
+    base_provider->set_executor(executor.get());
+    async_service = std::make_unique<AsyncPricingService>(
+        provider, tickers, pipe, interval_ms, *executor);
   }
 
-  service.start();
+  std::shared_ptr<ReplayMarketDataProvider> replay_provider;
+  if (!cfg.replay_path.empty()) {
+    replay_provider = std::make_shared<ReplayMarketDataProvider>(
+        cfg.replay_path, cfg.replay_speed);
+  }
 
-  std::atomic<bool> reload_running{true};
-  std::thread reload_thread([&]() {
-    using namespace std::chrono_literals;
-    std::vector<std::string> known = tickers;
-    while (reload_running.load()) {
-      std::this_thread::sleep_for(5s);
+  std::shared_ptr<SyntheticMarketDataProvider> synthetic_provider;
+  if (cfg.synthetic) {
+    SyntheticConfig synthetic_cfg;
+    synthetic_cfg.seed = cfg.synthetic_seed;
+    synthetic_cfg.ticks_per_sec = cfg.synthetic_rate;
+    synthetic_cfg.jump_intensity = cfg.synthetic_jumps;
+    synthetic_cfg.jump_stddev = 0.05;
+    synthetic_provider =
+        std::make_shared<SyntheticMarketDataProvider>(synthetic_cfg);
+    synthetic_provider->subscribe(tickers);
+  }
 
-      auto fresh = load_tickers_from_db(cfg.pg_conninfo);
-      if (fresh.empty()) {
-        continue;
-      }
+  std::shared_ptr<StreamingMarketDataProvider> stream_provider;
+  if (!cfg.stream_host.empty()) {
+    StreamingConfig stream_cfg;
+    stream_cfg.host = cfg.stream_host;
+    stream_cfg.port = cfg.stream_port;
+    stream_provider = std::make_shared<StreamingMarketDataProvider>(stream_cfg);
+    stream_provider->subscribe(tickers);
+  }
 
-      std::vector<std::string> to_add;
-      for (const auto &t : fresh) {
-        if (std::find(known.begin(), known.end(), t) == known.end()) {
-          known.push_back(t);
-          to_add.push_back(t);
-        }
-      }
+  // A bsm_pricing shard going away must surface as EPIPE, not kill us.
+  std::signal(SIGPIPE, SIG_IGN);
+
+  ShardedPublisher publisher(ShardedPublisher::shard_paths(
+      get_pipe_path(), static_cast<std::size_t>(cfg.shards)));
+  if (!publisher.init()) {
+    return 1;
+  }
+
+  if (replay_provider) {
+    if (!replay_provider->start(pipe)) {
+      return 1;
+    }
+  } else if (synthetic_provider) {
+    synthetic_provider->start(pipe);
+  } else if (stream_provider) {
+    stream_provider->start(pipe);
+  } else if (async_service) {
+    executor->start();
+    async_service->start();
+  } else {
+    service.start();
+  }
 
-      if (!to_add.empty()) {
-        service.add_tickers(to_add);
+  if (!offline) {
+    registry.start([&](const std::vector<std::string> &added,
+                       const std::vector<std::string> &removed) {
+      if (synthetic_provider) {
+        synthetic_provider->unsubscribe(removed);
+        synthetic_provider->subscribe(added);
+      } else if (stream_provider) {
+        stream_provider->unsubscribe(removed);
+        stream_provider->subscribe(added);
+      } else if (async_service) {
+        async_service->remove_tickers(removed);
+        async_service->add_tickers(added);
+      } else {
+        service.remove_tickers(removed);
+        service.add_tickers(added);
       }
+    });
+  }
+
+  std::unique_ptr<PriceRecorder> recorder;
+  if (!cfg.record_path.empty()) {
+    recorder = std::make_unique<PriceRecorder>(cfg.record_path);
+    if (!recorder->open()) {
+      return 1;
     }
-  });
-  PriceUpdate update;
-  while (pipe.read(update)) {
-    std::string line = "{"
-                       "\"timestamp\":" +
-                       std::to_string(update.timestamp) + "," +
-                       "\"ticker\":\"" + update.ticker + "\"," +
-                       "\"price\":" + std::to_string(update.price) + "," +
-                       "\"status\":\"" + update.status + "\"," +
-                       "\"error\":\"" + update.error +
-                       "\""
-                       "}\n";
-
-    ssize_t written = ::write(fifo_fd, line.data(), line.size());
-    std::cout << line << std::endl;
-    if (written < 0) {
-      std::cerr << "Failed to write to fifo " << pipe_path << ": "
-                << std::strerror(errno) << "\n";
+  }
+
+  std::unique_ptr<AsyncEcho> echo;
+  if (cfg.echo) {
+    echo = std::make_unique<AsyncEcho>();
+  }
+
+  constexpr std::size_t kMaxBatch = 512;
+  std::vector<PriceUpdate> batch;
+  batch.reserve(kMaxBatch);
+  PriceSerializer echo_serializer;
+  while (pipe.read_batch(batch, kMaxBatch)) {
+    if (!publisher.publish(batch)) {
       break;
     }
+    if (recorder) {
+      recorder->append(batch);
+    }
+    if (echo) {
+      echo_serializer.clear();
+      for (const auto &update : batch) {
+        echo_serializer.append(update);
+      }
+      echo->post(echo_serializer.str());
+    }
   }
 
-  reload_running.store(false);
-  if (reload_thread.joinable()) {
-    reload_thread.join();
-  }
+  registry.stop();
 
-  ::close(fifo_fd);
+  if (echo) {
+    echo->stop();
+  }
+  if (replay_provider) {
+    replay_provider->stop();
+  }
+  if (synthetic_provider) {
+    synthetic_provider->stop();
+  }
+  if (stream_provider) {
+    stream_provider->stop();
+  }
+  if (async_service) {
+    async_service->stop();
+    executor->stop();
+  }
   service.stop();
   return 0;
 }
@@ -1,5 +1,7 @@
 #include "moex_client.hpp"
 
+#include "async_executor.hpp"
+
 #include <curl/curl.h>
 
 #include <ctime>
@@ -61,7 +63,9 @@ int find_column_index(const std::string &body, std::string_view column_name) {
 
 } // namespace
 
-MoexClient::MoexClient() { curl_global_init(CURL_GLOBAL_DEFAULT); }
+MoexClient::MoexClient(std::string base_url) : base_url_(std::move(base_url)) {
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+}
 
 MoexClient::~MoexClient() { curl_global_cleanup(); }
 
@@ -71,14 +75,28 @@ PriceUpdate MoexClient::get_price(const std::string &ticker) {
   return parse_update_from_json(body, ticker);
 }
 
+Task<PriceUpdate> MoexClient::get_price_async(std::string ticker) {
+  if (!executor_) {
+    co_return get_price(ticker);
+  }
+
+  HttpResponse response = co_await executor_->http_get(build_url(ticker));
+  if (!response.error.empty()) {
+    throw std::runtime_error("CURL request failed: " + response.error);
+  }
+  if (response.status != 200) {
+    throw std::runtime_error("HTTP error: " +
+                             std::to_string(response.status));
+  }
+  co_return parse_update_from_json(response.body, ticker);
+}
+
 std::string MoexClient::build_url(const std::string &ticker) const {
   std::string lower_ticker = ticker;
   for (auto &c : lower_ticker) {
     c = static_cast<char>(::tolower(static_cast<unsigned char>(c)));
   }
-  return "https://iss.moex.com/iss/engines/stock/markets/shares/boards/tqbr/"
-         "securities/" +
-         lower_ticker + ".json?iss.meta=off";
+  return base_url_ + lower_ticker + ".json?iss.meta=off";
 }
 
 std::string MoexClient::http_get(const std::string &url) const {
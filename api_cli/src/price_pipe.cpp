@@ -1,11 +1,18 @@
 #include "price_pipe.hpp"
 
+#include <chrono>
+
 void PriceQueue::write(const PriceUpdate &update) {
+  const std::int64_t now =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
   std::lock_guard<std::mutex> lock(mutex_);
   if (closed_) {
     return;
   }
   queue_.push(update);
+  queue_.back().capture_ns = now;
   cv_.notify_one();
 }
 
@@ -20,6 +27,23 @@ bool PriceQueue::read(PriceUpdate &out) {
   return true;
 }
 
+bool PriceQueue::read_batch(std::vector<PriceUpdate> &out,
+                            std::size_t max_items) {
+  out.clear();
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] { return closed_ || !queue_.empty(); });
+  while (!queue_.empty() && out.size() < max_items) {
+    out.push_back(std::move(queue_.front()));
+    queue_.pop();
+  }
+  return !out.empty();
+}
+
+std::size_t PriceQueue::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size();
+}
+
 void PriceQueue::close() {
   std::lock_guard<std::mutex> lock(mutex_);
   closed_ = true;
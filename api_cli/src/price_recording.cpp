@@ -0,0 +1,173 @@
+#include "price_recording.hpp"
+
+#include "async_logger.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[8] = {'P', 'X', 'R', 'E', 'C', '0', '0', '1'};
+constexpr std::size_t kFixedSize = 8 + 8 + 8 + 3 * 2;
+constexpr std::uint32_t kMaxRecordSize = 1u << 20;
+
+template <typename T> void put(std::string &buf, T value) {
+  char bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  buf.append(bytes, sizeof(T));
+}
+
+template <typename T> T get(const char *&p) {
+  T value;
+  std::memcpy(&value, p, sizeof(T));
+  p += sizeof(T);
+  return value;
+}
+
+std::uint16_t clamp_length(const std::string &s) {
+  return static_cast<std::uint16_t>(std::min<std::size_t>(s.size(), 0xffff));
+}
+
+void encode(std::string &buf, std::int64_t capture_ns, const PriceUpdate &u) {
+  const std::uint16_t ticker_len = clamp_length(u.ticker);
+  const std::uint16_t status_len = clamp_length(u.status);
+  const std::uint16_t error_len = clamp_length(u.error);
+
+  put<std::uint32_t>(buf, static_cast<std::uint32_t>(
+                              kFixedSize + ticker_len + status_len +
+                              error_len));
+  put<std::int64_t>(buf, capture_ns);
+  put<std::int64_t>(buf, u.timestamp);
+  put<double>(buf, u.price);
+  put<std::uint16_t>(buf, ticker_len);
+  put<std::uint16_t>(buf, status_len);
+  put<std::uint16_t>(buf, error_len);
+  buf.append(u.ticker, 0, ticker_len);
+  buf.append(u.status, 0, status_len);
+  buf.append(u.error, 0, error_len);
+}
+
+} // namespace
+
+PriceRecorder::PriceRecorder(std::string path) : path_(std::move(path)) {}
+
+PriceRecorder::~PriceRecorder() { close(); }
+
+bool PriceRecorder::open() {
+  file_ = std::fopen(path_.c_str(), "ab");
+  if (!file_) {
+    log_error("PriceRecorder", "cannot open",
+              {{"path", path_}, {"error", std::strerror(errno)}});
+    return false;
+  }
+  std::fseek(file_, 0, SEEK_END);
+  if (std::ftell(file_) == 0 &&
+      std::fwrite(kMagic, 1, sizeof(kMagic), file_) != sizeof(kMagic)) {
+    log_error("PriceRecorder", "write failed", {{"error", std::strerror(errno)}});
+    close();
+    return false;
+  }
+  return true;
+}
+
+void PriceRecorder::close() {
+  if (file_) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+bool PriceRecorder::append(const RecordedUpdate &record) {
+  if (!file_) {
+    return false;
+  }
+  encode(buffer_, record.capture_ns, record.update);
+  ++records_;
+  return flush();
+}
+
+bool PriceRecorder::append(const std::vector<PriceUpdate> &updates) {
+  if (!file_) {
+    return false;
+  }
+  std::int64_t now = 0;
+  for (const auto &u : updates) {
+    if (u.capture_ns == 0 && now == 0) {
+      now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count();
+    }
+    encode(buffer_, u.capture_ns != 0 ? u.capture_ns : now, u);
+  }
+  records_ += updates.size();
+  return flush();
+}
+
+bool PriceRecorder::flush() {
+  const bool ok = std::fwrite(buffer_.data(), 1, buffer_.size(), file_) ==
+                       buffer_.size() &&
+                   std::fflush(file_) == 0;
+  buffer_.clear();
+  if (!ok) {
+    log_error("PriceRecorder", "write failed", {{"error", std::strerror(errno)}});
+  }
+  return ok;
+}
+
+PriceRecordingReader::PriceRecordingReader(std::string path)
+    : path_(std::move(path)) {}
+
+PriceRecordingReader::~PriceRecordingReader() {
+  if (file_) {
+    std::fclose(file_);
+  }
+}
+
+bool PriceRecordingReader::open() {
+  file_ = std::fopen(path_.c_str(), "rb");
+  if (!file_) {
+    return false;
+  }
+  char magic[sizeof(kMagic)];
+  if (std::fread(magic, 1, sizeof(magic), file_) != sizeof(magic) ||
+      std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+    std::fclose(file_);
+    file_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool PriceRecordingReader::next(RecordedUpdate &out) {
+  if (!file_) {
+    return false;
+  }
+  std::uint32_t length = 0;
+  if (std::fread(&length, 1, sizeof(length), file_) != sizeof(length) ||
+      length < kFixedSize || length > kMaxRecordSize) {
+    return false;
+  }
+  record_.resize(length);
+  if (std::fread(&record_[0], 1, length, file_) != length) {
+    return false;
+  }
+
+  const char *p = record_.data();
+  out.capture_ns = get<std::int64_t>(p);
+  out.update.timestamp = get<std::int64_t>(p);
+  out.update.price = get<double>(p);
+  const auto ticker_len = get<std::uint16_t>(p);
+  const auto status_len = get<std::uint16_t>(p);
+  const auto error_len = get<std::uint16_t>(p);
+  if (kFixedSize + ticker_len + status_len + error_len != length) {
+    return false;
+  }
+  out.update.ticker.assign(p, ticker_len);
+  p += ticker_len;
+  out.update.status.assign(p, status_len);
+  p += status_len;
+  out.update.error.assign(p, error_len);
+  return true;
+}
@@ -0,0 +1,189 @@
+#include "price_writer.hpp"
+
+#include <limits.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr std::size_t kMaxIntLen = 24;
+constexpr std::size_t kMaxPriceLen = 330;
+
+char *append_literal(char *p, const char *s, std::size_t n) {
+  std::memcpy(p, s, n);
+  return p + n;
+}
+
+template <std::size_t N> char *append_literal(char *p, const char (&s)[N]) {
+  return append_literal(p, s, N - 1);
+}
+
+char *append_string(char *p, const std::string &s) {
+  return append_literal(p, s.data(), s.size());
+}
+
+} // namespace
+
+PriceSerializer::PriceSerializer(std::size_t chunk_size)
+    : chunk_size_(chunk_size) {}
+
+char *PriceSerializer::reserve(std::size_t n) {
+  if (chunks_.empty() || used_[current_] + n > chunks_[current_].size()) {
+    if (!chunks_.empty() && used_[current_] > 0) {
+      ++current_;
+    }
+    if (current_ == chunks_.size()) {
+      chunks_.emplace_back();
+      used_.push_back(0);
+    }
+    if (chunks_[current_].size() < n) {
+      chunks_[current_].resize(std::max(chunk_size_, n));
+    }
+  }
+  return chunks_[current_].data() + used_[current_];
+}
+
+void PriceSerializer::append(const PriceUpdate &u) {
+  const std::size_t max_len = 64 + kMaxIntLen + kMaxPriceLen +
+                              u.ticker.size() + u.status.size() +
+                              u.error.size();
+  char *begin = reserve(max_len);
+  char *p = begin;
+
+  p = append_literal(p, "{\"timestamp\":");
+  p = std::to_chars(p, p + kMaxIntLen, u.timestamp).ptr;
+  p = append_literal(p, ",\"ticker\":\"");
+  p = append_string(p, u.ticker);
+  p = append_literal(p, "\",\"price\":");
+  p = std::to_chars(p, p + kMaxPriceLen, u.price, std::chars_format::fixed, 6)
+          .ptr;
+  p = append_literal(p, ",\"status\":\"");
+  p = append_string(p, u.status);
+  p = append_literal(p, "\",\"error\":\"");
+  p = append_string(p, u.error);
+  p = append_literal(p, "\"}\n");
+
+  const auto written = static_cast<std::size_t>(p - begin);
+  used_[current_] += written;
+  size_ += written;
+}
+
+void PriceSerializer::clear() {
+  std::fill(used_.begin(), used_.end(), 0);
+  current_ = 0;
+  size_ = 0;
+}
+
+const std::vector<iovec> &PriceSerializer::iovecs() {
+  iov_.clear();
+  for (std::size_t i = 0; i <= current_ && i < chunks_.size(); ++i) {
+    if (used_[i] > 0) {
+      iov_.push_back(iovec{chunks_[i].data(), used_[i]});
+    }
+  }
+  return iov_;
+}
+
+std::string PriceSerializer::str() const {
+  std::string out;
+  out.reserve(size_);
+  for (std::size_t i = 0; i <= current_ && i < chunks_.size(); ++i) {
+    out.append(chunks_[i].data(), used_[i]);
+  }
+  return out;
+}
+
+bool write_fully(int fd, iovec *iov, std::size_t count, std::size_t *written) {
+  if (written) {
+    *written = 0;
+  }
+  while (count > 0) {
+    const int batch = static_cast<int>(std::min<std::size_t>(count, IOV_MAX));
+    ssize_t n = ::writev(fd, iov, batch);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        pollfd p{fd, POLLOUT, 0};
+        ::poll(&p, 1, -1);
+        continue;
+      }
+      return false;
+    }
+
+    auto left = static_cast<std::size_t>(n);
+    if (written) {
+      *written += left;
+    }
+    while (count > 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+      ++iov;
+      --count;
+    }
+    if (count > 0) {
+      iov->iov_base = static_cast<char *>(iov->iov_base) + left;
+      iov->iov_len -= left;
+    }
+  }
+  return true;
+}
+
+AsyncEcho::AsyncEcho(std::size_t max_pending)
+    : max_pending_(max_pending), thread_(&AsyncEcho::run, this) {}
+
+AsyncEcho::~AsyncEcho() { stop(); }
+
+void AsyncEcho::post(std::string chunk) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_) {
+      return;
+    }
+    if (pending_.size() >= max_pending_) {
+      ++dropped_;
+      return;
+    }
+    pending_.push_back(std::move(chunk));
+  }
+  cv_.notify_one();
+}
+
+void AsyncEcho::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_) {
+      return;
+    }
+    stopped_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void AsyncEcho::run() {
+  std::deque<std::string> local;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return stopped_ || !pending_.empty(); });
+      if (pending_.empty() && stopped_) {
+        break;
+      }
+      local.swap(pending_);
+    }
+    for (const auto &chunk : local) {
+      std::fwrite(chunk.data(), 1, chunk.size(), stdout);
+    }
+    std::fflush(stdout);
+    local.clear();
+  }
+}
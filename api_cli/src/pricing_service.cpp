@@ -1,16 +1,15 @@
 #include "pricing_service.hpp"
 
 #include "price_update.hpp"
-#include "ticker_loader.hpp"
 
 #include <chrono>
-#include <algorithm>
 
 PricingService::PricingService(std::shared_ptr<MarketDataProvider> provider,
                                std::vector<std::string> tickers,
                                PriceQueue &pipe, int interval_ms)
-    : provider_(std::move(provider)), pipe_(pipe), interval_ms_(interval_ms),
-      tickers_(std::move(tickers)) {}
+    : provider_(std::move(provider)), pipe_(pipe), interval_ms_(interval_ms) {
+  add_tickers(tickers);
+}
 
 PricingService::~PricingService() { stop(); }
 
@@ -20,10 +19,12 @@ void PricingService::start() {
   }
 
   std::lock_guard<std::mutex> lock(mutex_);
-  threads_.clear();
-  threads_.reserve(tickers_.size());
-  for (const auto &t : tickers_) {
-    threads_.emplace_back(&PricingService::worker_thread, this, t);
+  for (auto &slot : slots_) {
+    if (!slot->ticker.empty()) {
+      slot->active = true;
+      slot->thread =
+          std::thread(&PricingService::worker_thread, this, slot.get());
+    }
   }
 }
 
@@ -32,45 +33,117 @@ void PricingService::stop() {
     return;
   }
 
+  std::vector<std::thread> threads;
   {
     std::lock_guard<std::mutex> lock(mutex_);
-    for (auto &t : threads_) {
-      if (t.joinable()) {
-        t.join();
+    for (auto &slot : slots_) {
+      slot->active = false;
+      if (slot->thread.joinable()) {
+        threads.push_back(std::move(slot->thread));
       }
     }
-    threads_.clear();
+  }
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+  }
+  wake_cv_.notify_all();
+  for (auto &t : threads) {
+    t.join();
   }
   pipe_.close();
 }
 
+void PricingService::launch_locked(const std::string &ticker) {
+  std::size_t idx;
+  if (!free_slots_.empty()) {
+    idx = free_slots_.back();
+    free_slots_.pop_back();
+  } else {
+    idx = slots_.size();
+    slots_.push_back(std::make_unique<Slot>());
+  }
+
+  Slot *slot = slots_[idx].get();
+  slot->ticker = ticker;
+  index_.emplace(ticker, idx);
+  if (running_) {
+    slot->active = true;
+    slot->thread = std::thread(&PricingService::worker_thread, this, slot);
+  }
+}
+
 void PricingService::add_tickers(const std::vector<std::string> &tickers) {
   std::lock_guard<std::mutex> lock(mutex_);
-  if (!running_) {
+  for (const auto &t : tickers) {
+    if (index_.count(t) == 0) {
+      launch_locked(t);
+    }
+  }
+}
+
+void PricingService::remove_tickers(const std::vector<std::string> &tickers) {
+  std::vector<std::size_t> removed;
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
     for (const auto &t : tickers) {
-      if (std::find(tickers_.begin(), tickers_.end(), t) == tickers_.end()) {
-        tickers_.push_back(t);
+      auto it = index_.find(t);
+      if (it == index_.end()) {
+        continue;
       }
+      Slot &slot = *slots_[it->second];
+      slot.active = false;
+      if (slot.thread.joinable()) {
+        threads.push_back(std::move(slot.thread));
+      }
+      removed.push_back(it->second);
+      index_.erase(it);
     }
+  }
+  if (removed.empty()) {
     return;
   }
 
-  for (const auto &t : tickers) {
-    if (std::find(tickers_.begin(), tickers_.end(), t) != tickers_.end()) {
-      continue;
-    }
-    tickers_.push_back(t);
-    threads_.emplace_back(&PricingService::worker_thread, this, t);
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+  }
+  wake_cv_.notify_all();
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto idx : removed) {
+    slots_[idx]->ticker.clear();
+    free_slots_.push_back(idx);
   }
 }
 
-void PricingService::worker_thread(std::string ticker) {
-  using namespace std::chrono;
+std::vector<std::string> PricingService::tickers() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> out;
+  out.reserve(index_.size());
+  for (const auto &entry : index_) {
+    out.push_back(entry.first);
+  }
+  return out;
+}
+
+std::size_t PricingService::slot_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return slots_.size();
+}
+
+void PricingService::worker_thread(Slot *slot) {
   const auto sleep_duration = std::chrono::milliseconds(interval_ms_);
+  const std::string ticker = [&] {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slot->ticker;
+  }();
 
   std::int64_t last_ts = -1;
 
-  while (running_) {
+  while (running_ && slot->active) {
     try {
       PriceUpdate update = provider_->get_price(ticker);
 
@@ -105,6 +178,8 @@ void PricingService::worker_thread(std::string ticker) {
       pipe_.write(err);
     }
 
-    std::this_thread::sleep_for(sleep_duration);
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    wake_cv_.wait_for(lock, sleep_duration,
+                      [&] { return !running_ || !slot->active; });
   }
 }
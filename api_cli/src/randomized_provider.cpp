@@ -7,7 +7,16 @@ RandomizedMarketDataProvider::RandomizedMarketDataProvider(
     : base_(std::move(base)) {}
 
 PriceUpdate RandomizedMarketDataProvider::get_price(const std::string &ticker) {
-  PriceUpdate base = base_->get_price(ticker);
+  return perturb(base_->get_price(ticker));
+}
+
+Task<PriceUpdate>
+RandomizedMarketDataProvider::get_price_async(std::string ticker) {
+  co_return perturb(co_await base_->get_price_async(std::move(ticker)));
+}
+
+PriceUpdate RandomizedMarketDataProvider::perturb(PriceUpdate base) {
+  const std::string &ticker = base.ticker;
   if (base.status != "OK") {
     return base;
   }
@@ -0,0 +1,107 @@
+#include "replay_provider.hpp"
+
+#include "async_logger.hpp"
+#include "price_recording.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+
+// Bound on how far an unthrottled replay may run ahead of the consumer.
+constexpr std::size_t kMaxQueued = 1 << 16;
+
+} // namespace
+
+ReplayMarketDataProvider::ReplayMarketDataProvider(std::string path,
+                                                   double speed)
+    : path_(std::move(path)), speed_(speed) {}
+
+ReplayMarketDataProvider::~ReplayMarketDataProvider() { stop(); }
+
+bool ReplayMarketDataProvider::start(PriceQueue &out) {
+  if (running_) {
+    return true;
+  }
+  PriceRecordingReader probe(path_);
+  if (!probe.open()) {
+    log_error("ReplayMarketDataProvider", "cannot read recording",
+              {{"path", path_}});
+    return false;
+  }
+  out_ = &out;
+  running_ = true;
+  thread_ = std::thread(&ReplayMarketDataProvider::run, this);
+  return true;
+}
+
+void ReplayMarketDataProvider::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+  }
+  wait_cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  out_->close();
+}
+
+PriceUpdate ReplayMarketDataProvider::get_price(const std::string &ticker) {
+  std::lock_guard<std::mutex> lock(latest_mutex_);
+  auto it = latest_.find(ticker);
+  if (it == latest_.end()) {
+    throw std::runtime_error("No replayed price for " + ticker);
+  }
+  return it->second;
+}
+
+void ReplayMarketDataProvider::run() {
+  using clock = std::chrono::steady_clock;
+
+  PriceRecordingReader reader(path_);
+  reader.open();
+
+  RecordedUpdate record;
+  bool have_base = false;
+  std::int64_t base_capture = 0;
+  clock::time_point base;
+
+  while (running_ && reader.next(record)) {
+    if (!have_base) {
+      have_base = true;
+      base_capture = record.capture_ns;
+      base = clock::now();
+    }
+
+    if (speed_ > 0) {
+      const auto due =
+          base + std::chrono::duration_cast<clock::duration>(
+                     std::chrono::duration<double, std::nano>(
+                         static_cast<double>(record.capture_ns -
+                                             base_capture) /
+                         speed_));
+      std::unique_lock<std::mutex> lock(wait_mutex_);
+      wait_cv_.wait_until(lock, due, [this] { return !running_.load(); });
+    } else {
+      while (running_ && out_->size() > kMaxQueued) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    if (!running_) {
+      break;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(latest_mutex_);
+      latest_[record.update.ticker] = record.update;
+    }
+    out_->write(record.update);
+    ++replayed_;
+  }
+
+  finished_ = true;
+  out_->close();
+}
@@ -0,0 +1,163 @@
+#include "sharded_publisher.hpp"
+
+#include "async_logger.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+ShardedPublisher::ShardedPublisher(std::vector<std::string> paths,
+                                   int probe_interval_ms)
+    : channels_(paths.size()), probe_interval_(probe_interval_ms) {
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    channels_[i].path = std::move(paths[i]);
+  }
+}
+
+ShardedPublisher::~ShardedPublisher() {
+  for (auto &ch : channels_) {
+    if (ch.fd >= 0) {
+      ::close(ch.fd);
+    }
+  }
+}
+
+std::vector<std::string> ShardedPublisher::shard_paths(const std::string &base,
+                                                       std::size_t shards) {
+  if (shards <= 1) {
+    return {base};
+  }
+  std::vector<std::string> paths;
+  paths.reserve(shards);
+  for (std::size_t i = 0; i < shards; ++i) {
+    paths.push_back(base + "_" + std::to_string(i));
+  }
+  return paths;
+}
+
+bool ShardedPublisher::init() {
+  for (const auto &ch : channels_) {
+    if (mkfifo(ch.path.c_str(), 0666) < 0 && errno != EEXIST) {
+      log_error("ShardedPublisher", "failed to create fifo",
+                {{"path", ch.path}, {"error", std::strerror(errno)}});
+      return false;
+    }
+  }
+  if (channels_.size() == 1) {
+    auto &ch = channels_.front();
+    ch.fd = ::open(ch.path.c_str(), O_WRONLY);
+    if (ch.fd < 0) {
+      log_error("ShardedPublisher", "failed to open fifo",
+                {{"path", ch.path}, {"error", std::strerror(errno)}});
+      return false;
+    }
+    ring_.add_shard(0);
+    log_info("ShardedPublisher", "consumer attached", {{"path", ch.path}});
+    return true;
+  }
+  probe();
+  return true;
+}
+
+void ShardedPublisher::probe() {
+  last_probe_ = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < channels_.size(); ++i) {
+    auto &ch = channels_[i];
+    if (ch.fd >= 0) {
+      continue;
+    }
+    // O_NONBLOCK makes open fail with ENXIO instead of waiting for a reader.
+    int fd = ::open(ch.path.c_str(), O_WRONLY | O_NONBLOCK);
+    if (fd < 0) {
+      continue;
+    }
+    ch.fd = fd;
+    ring_.add_shard(static_cast<int>(i));
+    log_info("ShardedPublisher", "consumer attached", {{"path", ch.path}});
+  }
+}
+
+void ShardedPublisher::detach(std::size_t shard) {
+  auto &ch = channels_[shard];
+  if (ch.fd >= 0) {
+    ::close(ch.fd);
+    ch.fd = -1;
+  }
+  ring_.remove_shard(static_cast<int>(shard));
+  log_info("ShardedPublisher", "consumer left", {{"path", ch.path}});
+}
+
+std::size_t ShardedPublisher::live_channels() const {
+  std::size_t live = 0;
+  for (const auto &ch : channels_) {
+    if (ch.fd >= 0) {
+      ++live;
+    }
+  }
+  return live;
+}
+
+bool ShardedPublisher::publish(const std::vector<PriceUpdate> &batch) {
+  if (channels_.size() > 1 &&
+      std::chrono::steady_clock::now() - last_probe_ >= probe_interval_) {
+    probe();
+  }
+
+  std::vector<const PriceUpdate *> pending;
+  pending.reserve(batch.size());
+  for (const auto &u : batch) {
+    pending.push_back(&u);
+  }
+
+  while (!pending.empty()) {
+    while (ring_.empty()) {
+      std::this_thread::sleep_for(probe_interval_ / 5);
+      probe();
+    }
+
+    for (auto &ch : channels_) {
+      ch.serializer.clear();
+      ch.routed.clear();
+      ch.ends.clear();
+    }
+    for (const auto *u : pending) {
+      auto &ch = channels_[static_cast<std::size_t>(ring_.owner(u->ticker))];
+      ch.serializer.append(*u);
+      ch.routed.push_back(u);
+      ch.ends.push_back(ch.serializer.size());
+    }
+    pending.clear();
+
+    for (std::size_t i = 0; i < channels_.size(); ++i) {
+      auto &ch = channels_[i];
+      if (ch.routed.empty()) {
+        continue;
+      }
+      ch.iov = ch.serializer.iovecs();
+      std::size_t written = 0;
+      if (write_fully(ch.fd, ch.iov.data(), ch.iov.size(), &written)) {
+        continue;
+      }
+      if (errno != EPIPE) {
+        log_error("ShardedPublisher", "fifo write failed",
+                  {{"path", ch.path}, {"error", std::strerror(errno)}});
+      }
+      detach(i);
+      if (channels_.size() == 1) {
+        return false;
+      }
+      // Lines that went out whole are not sent again; a partly written line
+      // never reached the reader and is re-routed with the rest.
+      const auto sent = static_cast<std::size_t>(
+          std::upper_bound(ch.ends.begin(), ch.ends.end(), written) -
+          ch.ends.begin());
+      pending.insert(pending.end(), ch.routed.begin() + sent, ch.routed.end());
+    }
+  }
+  return true;
+}
@@ -0,0 +1,112 @@
+#include "stomp_frame.hpp"
+
+#include <stdexcept>
+
+const std::string *StompFrame::header(const std::string &name) const {
+  for (const auto &h : headers) {
+    if (h.first == name) {
+      return &h.second;
+    }
+  }
+  return nullptr;
+}
+
+std::string serialize_stomp_frame(const StompFrame &frame) {
+  std::string out;
+  out.reserve(frame.command.size() + frame.body.size() + 64);
+  out += frame.command;
+  out += '\n';
+  for (const auto &h : frame.headers) {
+    out += h.first;
+    out += ':';
+    out += h.second;
+    out += '\n';
+  }
+  out += '\n';
+  out += frame.body;
+  out += '\0';
+  return out;
+}
+
+void StompFrameParser::feed(const char *data, std::size_t size) {
+  if (offset_ > 0 && (offset_ == buffer_.size() || offset_ >= 64 * 1024)) {
+    buffer_.erase(0, offset_);
+    offset_ = 0;
+  }
+  buffer_.append(data, size);
+}
+
+bool StompFrameParser::next(StompFrame &out) {
+  while (offset_ < buffer_.size() &&
+         (buffer_[offset_] == '\n' || buffer_[offset_] == '\r')) {
+    ++offset_;
+  }
+  if (offset_ >= buffer_.size()) {
+    return false;
+  }
+
+  // Command and header lines end in LF or CRLF; the first empty line ends
+  // the headers.
+  StompFrame frame;
+  std::size_t pos = offset_;
+  std::size_t body_start = std::string::npos;
+  bool first = true;
+  while (true) {
+    const auto eol = buffer_.find('\n', pos);
+    if (eol == std::string::npos) {
+      return false;
+    }
+    std::size_t len = eol - pos;
+    if (len > 0 && buffer_[pos + len - 1] == '\r') {
+      --len;
+    }
+    if (len == 0) {
+      body_start = eol + 1;
+      break;
+    }
+    if (first) {
+      frame.command.assign(buffer_, pos, len);
+      first = false;
+    } else {
+      auto colon = buffer_.find(':', pos);
+      if (colon != std::string::npos && colon < pos + len) {
+        frame.headers.emplace_back(buffer_.substr(pos, colon - pos),
+                                   buffer_.substr(colon + 1,
+                                                  pos + len - colon - 1));
+      }
+    }
+    pos = eol + 1;
+  }
+
+  std::size_t body_end = std::string::npos;
+  if (const auto *cl = frame.header("content-length")) {
+    std::size_t length = 0;
+    try {
+      length = static_cast<std::size_t>(std::stoul(*cl));
+    } catch (const std::exception &) {
+      throw std::runtime_error("STOMP frame has malformed content-length");
+    }
+    if (buffer_.size() < body_start + length + 1) {
+      return false;
+    }
+    body_end = body_start + length;
+    if (buffer_[body_end] != '\0') {
+      throw std::runtime_error("STOMP frame is not NUL terminated");
+    }
+  } else {
+    body_end = buffer_.find('\0', body_start);
+    if (body_end == std::string::npos) {
+      return false;
+    }
+  }
+
+  frame.body.assign(buffer_, body_start, body_end - body_start);
+  offset_ = body_end + 1;
+  out = std::move(frame);
+  return true;
+}
+
+void StompFrameParser::reset() {
+  buffer_.clear();
+  offset_ = 0;
+}
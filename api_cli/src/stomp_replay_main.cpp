@@ -0,0 +1,71 @@
+#include "stomp_replay_server.hpp"
+
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace {
+
+struct ReplayConfig {
+  std::string file;
+  int port{61613};
+  double speed{1.0};
+  bool loop{false};
+};
+
+ReplayConfig parse_replay_cli(int argc, char **argv) {
+  ReplayConfig cfg;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto next_string = [&]() -> std::string {
+      if (i + 1 >= argc)
+        return {};
+      return argv[++i];
+    };
+
+    if (arg == "--file") {
+      cfg.file = next_string();
+    } else if (arg == "--port") {
+      cfg.port = std::stoi(next_string());
+    } else if (arg == "--speed") {
+      cfg.speed = std::stod(next_string());
+    } else if (arg == "--loop") {
+      cfg.loop = true;
+    }
+  }
+  return cfg;
+}
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void on_signal(int) { g_stop = 1; }
+
+} // namespace
+
+int main(int argc, char **argv) {
+  ReplayConfig cfg = parse_replay_cli(argc, argv);
+  if (cfg.file.empty()) {
+    std::cerr << "Usage: stomp_replay --file <recording.tsv> [--port N] "
+              << "[--speed X] [--loop]\n";
+    return 1;
+  }
+
+  StompReplayServer server(load_recorded_frames(cfg.file), cfg.speed,
+                           cfg.loop);
+  if (!server.start(cfg.port)) {
+    std::cerr << "Failed to listen on port " << cfg.port << "\n";
+    return 1;
+  }
+  std::cerr << "stomp_replay: serving " << cfg.file << " on 127.0.0.1:"
+            << server.port() << " at x" << cfg.speed << "\n";
+
+  std::signal(SIGINT, on_signal);
+  std::signal(SIGTERM, on_signal);
+  while (!g_stop) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  }
+
+  server.stop();
+  return 0;
+}
@@ -0,0 +1,267 @@
+#include "stomp_replay_server.hpp"
+
+#include "stomp_frame.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+bool send_all(int fd, const std::string &data) {
+  std::size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n =
+        ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    sent += static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+} // namespace
+
+std::vector<RecordedFrame> load_recorded_frames(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("Failed to open recording " + path);
+  }
+
+  std::vector<RecordedFrame> frames;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    auto tab1 = line.find('\t');
+    auto tab2 = tab1 == std::string::npos ? tab1 : line.find('\t', tab1 + 1);
+    if (tab2 == std::string::npos) {
+      throw std::runtime_error("Malformed recording line: " + line);
+    }
+    RecordedFrame f;
+    f.offset_ms = std::stoll(line.substr(0, tab1));
+    f.ticker = line.substr(tab1 + 1, tab2 - tab1 - 1);
+    f.body = line.substr(tab2 + 1);
+    frames.push_back(std::move(f));
+  }
+  return frames;
+}
+
+StompReplayServer::StompReplayServer(std::vector<RecordedFrame> frames,
+                                     double speed, bool loop,
+                                     std::string destination_prefix)
+    : frames_(std::move(frames)), speed_(speed), loop_(loop),
+      destination_prefix_(std::move(destination_prefix)) {}
+
+StompReplayServer::~StompReplayServer() { stop(); }
+
+bool StompReplayServer::start(int port) {
+  if (running_) {
+    return true;
+  }
+
+  listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    return false;
+  }
+  int one = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(static_cast<std::uint16_t>(port));
+  if (::bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) <
+          0 ||
+      ::listen(listen_fd_, 4) < 0) {
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+
+  socklen_t len = sizeof(addr);
+  getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&addr), &len);
+  port_ = ntohs(addr.sin_port);
+
+  running_ = true;
+  thread_ = std::thread(&StompReplayServer::accept_loop, this);
+  return true;
+}
+
+void StompReplayServer::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (listen_fd_ >= 0) {
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+  }
+}
+
+void StompReplayServer::accept_loop() {
+  while (running_) {
+    pollfd p{listen_fd_, POLLIN, 0};
+    int rc = ::poll(&p, 1, 100);
+    if (rc <= 0) {
+      continue;
+    }
+    int fd = ::accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    kick_ = false;
+    ++sessions_;
+    serve_client(fd);
+    ::close(fd);
+  }
+}
+
+void StompReplayServer::serve_client(int fd) {
+  using clock = std::chrono::steady_clock;
+
+  StompFrameParser parser;
+  std::unordered_map<std::string, std::string> subscription_ids;
+  std::unordered_map<std::string, std::string> subscribed;
+  bool started = false;
+  clock::time_point base;
+  std::int64_t base_offset = 0;
+
+  auto rebase = [&]() {
+    base = clock::now();
+    base_offset = cursor_ < frames_.size() ? frames_[cursor_].offset_ms : 0;
+  };
+  auto due_at = [&](const RecordedFrame &f) {
+    return base + std::chrono::duration_cast<clock::duration>(
+                      std::chrono::duration<double, std::milli>(
+                          static_cast<double>(f.offset_ms - base_offset) /
+                          speed_));
+  };
+
+  std::vector<char> buf(16 * 1024);
+  std::string out;
+  std::size_t message_id = 0;
+
+  while (running_ && !kick_) {
+    int timeout_ms = 50;
+    if (started && cursor_ < frames_.size()) {
+      if (speed_ <= 0) {
+        timeout_ms = 0;
+      } else {
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        due_at(frames_[cursor_]) - clock::now())
+                        .count();
+        timeout_ms = wait <= 0 ? 0 : static_cast<int>(std::min<long long>(
+                                         wait, timeout_ms));
+      }
+    }
+
+    pollfd p{fd, POLLIN, 0};
+    int rc = ::poll(&p, 1, timeout_ms);
+    if (rc < 0 && errno != EINTR) {
+      return;
+    }
+    if (rc > 0) {
+      ssize_t n = ::recv(fd, buf.data(), buf.size(), 0);
+      if (n <= 0) {
+        return;
+      }
+      parser.feed(buf.data(), static_cast<std::size_t>(n));
+      StompFrame frame;
+      try {
+        while (parser.next(frame)) {
+          if (frame.command == "CONNECT" || frame.command == "STOMP") {
+            StompFrame reply;
+            reply.command = "CONNECTED";
+            reply.headers.emplace_back("version", "1.2");
+            if (!send_all(fd, serialize_stomp_frame(reply))) {
+              return;
+            }
+          } else if (frame.command == "SUBSCRIBE") {
+            const auto *dest = frame.header("destination");
+            const auto *id = frame.header("id");
+            if (!dest) {
+              continue;
+            }
+            std::string ticker = *dest;
+            if (ticker.compare(0, destination_prefix_.size(),
+                               destination_prefix_) == 0) {
+              ticker.erase(0, destination_prefix_.size());
+            }
+            std::string sub_id = id ? *id : ticker;
+            subscription_ids[sub_id] = ticker;
+            subscribed[ticker] = sub_id;
+            if (!started) {
+              started = true;
+              rebase();
+            }
+          } else if (frame.command == "UNSUBSCRIBE") {
+            const auto *id = frame.header("id");
+            if (!id) {
+              continue;
+            }
+            auto it = subscription_ids.find(*id);
+            if (it != subscription_ids.end()) {
+              subscribed.erase(it->second);
+              subscription_ids.erase(it);
+            }
+          } else if (frame.command == "DISCONNECT") {
+            return;
+          }
+        }
+      } catch (const std::exception &) {
+        return;
+      }
+    }
+
+    if (!started || cursor_ >= frames_.size()) {
+      continue;
+    }
+
+    out.clear();
+    std::size_t sent = 0;
+    auto now = clock::now();
+    for (std::size_t burst = 0; burst < 256 && cursor_ < frames_.size();
+         ++burst) {
+      const auto &f = frames_[cursor_];
+      if (speed_ > 0 && due_at(f) > now) {
+        break;
+      }
+      auto sub = subscribed.find(f.ticker);
+      if (sub != subscribed.end()) {
+        StompFrame msg;
+        msg.command = "MESSAGE";
+        msg.headers.emplace_back("destination", destination_prefix_ + f.ticker);
+        msg.headers.emplace_back("subscription", sub->second);
+        msg.headers.emplace_back("message-id", std::to_string(++message_id));
+        msg.body = f.body;
+        out += serialize_stomp_frame(msg);
+        ++sent;
+      }
+      if (++cursor_ == frames_.size() && loop_) {
+        cursor_ = 0;
+        rebase();
+      }
+    }
+    if (!out.empty() && !send_all(fd, out)) {
+      return;
+    }
+    frames_sent_ += sent;
+  }
+}
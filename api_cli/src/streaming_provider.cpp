@@ -0,0 +1,265 @@
+#include "streaming_provider.hpp"
+
+#include "async_logger.hpp"
+#include "moex_client.hpp"
+#include "stomp_frame.hpp"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+int connect_tcp(const std::string &host, int port) {
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  addrinfo *res = nullptr;
+  const std::string service = std::to_string(port);
+  if (getaddrinfo(host.c_str(), service.c_str(), &hints, &res) != 0) {
+    return -1;
+  }
+
+  int fd = -1;
+  for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+    fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+      break;
+    }
+    ::close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+
+  if (fd >= 0) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+  return fd;
+}
+
+bool send_all(int fd, const std::string &data) {
+  std::size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n =
+        ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    sent += static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+} // namespace
+
+StreamingMarketDataProvider::StreamingMarketDataProvider(StreamingConfig cfg)
+    : cfg_(std::move(cfg)) {}
+
+StreamingMarketDataProvider::~StreamingMarketDataProvider() { stop(); }
+
+void StreamingMarketDataProvider::start(PriceQueue &out) {
+  if (running_.exchange(true)) {
+    return;
+  }
+  out_ = &out;
+  thread_ = std::thread(&StreamingMarketDataProvider::run, this);
+}
+
+void StreamingMarketDataProvider::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(socket_mutex_);
+    if (fd_ >= 0) {
+      ::shutdown(fd_, SHUT_RDWR);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+  }
+  wait_cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void StreamingMarketDataProvider::subscribe(
+    const std::vector<std::string> &tickers) {
+  std::lock_guard<std::mutex> lock(socket_mutex_);
+  for (const auto &t : tickers) {
+    if (subscriptions_.insert(t).second && fd_ >= 0) {
+      send_frame_locked("SUBSCRIBE", t);
+    }
+  }
+}
+
+void StreamingMarketDataProvider::unsubscribe(
+    const std::vector<std::string> &tickers) {
+  std::lock_guard<std::mutex> lock(socket_mutex_);
+  for (const auto &t : tickers) {
+    if (subscriptions_.erase(t) > 0 && fd_ >= 0) {
+      send_frame_locked("UNSUBSCRIBE", t);
+    }
+  }
+}
+
+PriceUpdate StreamingMarketDataProvider::get_price(const std::string &ticker) {
+  std::lock_guard<std::mutex> lock(latest_mutex_);
+  auto it = latest_.find(ticker);
+  if (it == latest_.end()) {
+    throw std::runtime_error("No streamed price for " + ticker);
+  }
+  return it->second;
+}
+
+std::string StreamingMarketDataProvider::subscription_frame(
+    const std::string &command, const std::string &ticker) const {
+  StompFrame frame;
+  frame.command = command;
+  frame.headers.emplace_back("id", ticker);
+  if (command == "SUBSCRIBE") {
+    frame.headers.emplace_back("destination", cfg_.destination_prefix + ticker);
+    frame.headers.emplace_back("ack", "auto");
+  }
+  return serialize_stomp_frame(frame);
+}
+
+bool StreamingMarketDataProvider::send_frame_locked(const std::string &command,
+                                                    const std::string &ticker) {
+  return send_all(fd_, subscription_frame(command, ticker));
+}
+
+void StreamingMarketDataProvider::handle_message(const std::string &destination,
+                                                 const std::string &body) {
+  std::string ticker = destination;
+  if (ticker.compare(0, cfg_.destination_prefix.size(),
+                     cfg_.destination_prefix) == 0) {
+    ticker.erase(0, cfg_.destination_prefix.size());
+  }
+
+  PriceUpdate update;
+  try {
+    update = MoexClient::parse_update_from_json(body, ticker);
+  } catch (const std::exception &ex) {
+    update.timestamp = -1;
+    update.ticker = ticker;
+    update.price = 0.0;
+    update.status = "ERROR";
+    update.error = ex.what();
+  }
+
+  ++messages_;
+  if (update.status == "OK") {
+    std::lock_guard<std::mutex> lock(latest_mutex_);
+    latest_[ticker] = update;
+  }
+  out_->write(update);
+}
+
+void StreamingMarketDataProvider::sleep_backoff(int delay_ms) {
+  std::unique_lock<std::mutex> lock(wait_mutex_);
+  wait_cv_.wait_for(lock, std::chrono::milliseconds(delay_ms),
+                    [this] { return !running_.load(); });
+}
+
+void StreamingMarketDataProvider::run() {
+  int delay_ms = cfg_.reconnect_delay_ms;
+  std::vector<char> buf(64 * 1024);
+
+  while (running_) {
+    int fd = connect_tcp(cfg_.host, cfg_.port);
+    if (fd < 0) {
+      log_warn("StreamingMarketDataProvider", "connect failed",
+               {{"host", cfg_.host}, {"port", cfg_.port},
+                {"retry_ms", delay_ms}});
+      sleep_backoff(delay_ms);
+      delay_ms = std::min(delay_ms * 2, cfg_.max_reconnect_delay_ms);
+      continue;
+    }
+
+    bool ok = true;
+    {
+      std::lock_guard<std::mutex> lock(socket_mutex_);
+      fd_ = fd;
+      if (!running_) {
+        ok = false;
+      } else {
+        StompFrame connect;
+        connect.command = "CONNECT";
+        connect.headers.emplace_back("accept-version", "1.2");
+        connect.headers.emplace_back("host", cfg_.host);
+        std::string handshake = serialize_stomp_frame(connect);
+        for (const auto &t : subscriptions_) {
+          handshake += subscription_frame("SUBSCRIBE", t);
+        }
+        ok = send_all(fd_, handshake);
+      }
+    }
+
+    if (ok) {
+      ++connections_;
+      delay_ms = cfg_.reconnect_delay_ms;
+    }
+
+    StompFrameParser parser;
+    while (ok && running_) {
+      ssize_t n = ::recv(fd, buf.data(), buf.size(), 0);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        break;
+      }
+      try {
+        parser.feed(buf.data(), static_cast<std::size_t>(n));
+        StompFrame frame;
+        while (parser.next(frame)) {
+          if (frame.command == "MESSAGE") {
+            const auto *dest = frame.header("destination");
+            if (dest) {
+              handle_message(*dest, frame.body);
+            }
+          } else if (frame.command == "ERROR") {
+            const auto *msg = frame.header("message");
+            log_error("StreamingMarketDataProvider", "server error",
+                      {{"error", msg ? *msg : frame.body}});
+            ok = false;
+            break;
+          }
+        }
+      } catch (const std::exception &ex) {
+        log_error("StreamingMarketDataProvider", "protocol error",
+                  {{"error", ex.what()}});
+        ok = false;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(socket_mutex_);
+      fd_ = -1;
+    }
+    ::close(fd);
+
+    if (running_) {
+      sleep_backoff(delay_ms);
+      delay_ms = std::min(delay_ms * 2, cfg_.max_reconnect_delay_ms);
+    }
+  }
+}
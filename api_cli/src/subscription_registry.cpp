@@ -0,0 +1,166 @@
+#include "subscription_registry.hpp"
+
+#include "async_logger.hpp"
+#include "ticker_loader.hpp"
+
+#include <poll.h>
+#include <postgresql/libpq-fe.h>
+
+#include <chrono>
+
+SubscriptionRegistry::SubscriptionRegistry(std::string conninfo,
+                                           int resync_interval_sec)
+    : conninfo_(std::move(conninfo)),
+      resync_interval_sec_(resync_interval_sec) {}
+
+SubscriptionRegistry::~SubscriptionRegistry() {
+  stop();
+  disconnect();
+}
+
+bool SubscriptionRegistry::ensure_connected() {
+  if (conn_ && PQstatus(conn_) == CONNECTION_OK) {
+    return true;
+  }
+  disconnect();
+
+  conn_ = PQconnectdb(conninfo_.c_str());
+  if (!conn_ || PQstatus(conn_) != CONNECTION_OK) {
+    log_error("SubscriptionRegistry", "connection failed",
+              {{"error", conn_ ? PQerrorMessage(conn_)
+                               : "PQconnectdb returned null"}});
+    disconnect();
+    return false;
+  }
+
+  PGresult *res = PQexec(conn_, "LISTEN ticker_subscriptions;");
+  const bool ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+  if (!ok) {
+    log_error("SubscriptionRegistry", "LISTEN failed",
+              {{"error", PQerrorMessage(conn_)}});
+  }
+  PQclear(res);
+  if (!ok) {
+    disconnect();
+  }
+  return ok;
+}
+
+void SubscriptionRegistry::disconnect() {
+  if (conn_) {
+    PQfinish(conn_);
+    conn_ = nullptr;
+  }
+}
+
+bool SubscriptionRegistry::load() {
+  return ensure_connected() && refresh();
+}
+
+bool SubscriptionRegistry::refresh() {
+  std::vector<std::string> fresh;
+  if (!load_tickers(conn_, fresh)) {
+    disconnect();
+    return false;
+  }
+
+  std::vector<std::string> added;
+  std::vector<std::string> removed;
+  apply_snapshot(fresh, added, removed);
+  if (on_change_ && (!added.empty() || !removed.empty())) {
+    on_change_(added, removed);
+  }
+  return true;
+}
+
+void SubscriptionRegistry::apply_snapshot(
+    const std::vector<std::string> &fresh, std::vector<std::string> &added,
+    std::vector<std::string> &removed) {
+  added.clear();
+  removed.clear();
+
+  std::unordered_set<std::string> next(fresh.begin(), fresh.end());
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &t : next) {
+    if (tickers_.count(t) == 0) {
+      added.push_back(t);
+    }
+  }
+  for (const auto &t : tickers_) {
+    if (next.count(t) == 0) {
+      removed.push_back(t);
+    }
+  }
+  tickers_ = std::move(next);
+}
+
+std::vector<std::string> SubscriptionRegistry::tickers() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return {tickers_.begin(), tickers_.end()};
+}
+
+bool SubscriptionRegistry::contains(const std::string &ticker) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tickers_.count(ticker) > 0;
+}
+
+void SubscriptionRegistry::start(ChangeCallback on_change) {
+  if (running_.exchange(true)) {
+    return;
+  }
+  on_change_ = std::move(on_change);
+  thread_ = std::thread(&SubscriptionRegistry::run, this);
+}
+
+void SubscriptionRegistry::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+  }
+  wait_cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void SubscriptionRegistry::run() {
+  using clock = std::chrono::steady_clock;
+  const auto resync_interval = std::chrono::seconds(resync_interval_sec_);
+  auto next_resync = clock::now() + resync_interval;
+
+  while (running_) {
+    if (!conn_ || PQstatus(conn_) != CONNECTION_OK) {
+      // Anything may have changed while we were not listening.
+      if (!ensure_connected() || !refresh()) {
+        std::unique_lock<std::mutex> lock(wait_mutex_);
+        wait_cv_.wait_for(lock, std::chrono::seconds(5),
+                          [this] { return !running_.load(); });
+        continue;
+      }
+      next_resync = clock::now() + resync_interval;
+    }
+
+    pollfd p{PQsocket(conn_), POLLIN, 0};
+    int rc = ::poll(&p, 1, 250);
+    bool changed = false;
+    if (rc > 0) {
+      if (!PQconsumeInput(conn_)) {
+        log_warn("SubscriptionRegistry", "connection lost",
+                 {{"error", PQerrorMessage(conn_)}});
+        disconnect();
+        continue;
+      }
+      while (PGnotify *n = PQnotifies(conn_)) {
+        changed = true;
+        PQfreemem(n);
+      }
+    }
+
+    if (changed || clock::now() >= next_resync) {
+      refresh();
+      next_resync = clock::now() + resync_interval;
+    }
+  }
+}
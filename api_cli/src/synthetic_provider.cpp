@@ -0,0 +1,206 @@
+#include "synthetic_provider.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <unordered_set>
+
+namespace {
+
+constexpr double kSecondsPerYear = 365.0 * 24.0 * 3600.0;
+// Bound on how far an unthrottled generator may run ahead of the consumer.
+constexpr std::size_t kMaxQueued = 1 << 16;
+
+std::uint64_t splitmix64(std::uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+std::uint64_t stream_seed(std::uint64_t seed, const std::string &ticker) {
+  std::uint64_t h = 1469598103934665603ULL;
+  for (unsigned char c : ticker) {
+    h ^= c;
+    h *= 1099511628211ULL;
+  }
+  return splitmix64(seed ^ splitmix64(h));
+}
+
+} // namespace
+
+SyntheticMarketDataProvider::SyntheticMarketDataProvider(SyntheticConfig cfg)
+    : cfg_(cfg) {
+  if (cfg_.start_timestamp <= 0) {
+    cfg_.start_timestamp = static_cast<std::int64_t>(std::time(nullptr));
+  }
+  tick_seconds_ = std::max(cfg_.tick_seconds, 1e-6);
+  dt_ = tick_seconds_ / kSecondsPerYear;
+  diffusion_drift_ =
+      (cfg_.drift - 0.5 * cfg_.volatility * cfg_.volatility) * dt_;
+  diffusion_scale_ = cfg_.volatility * std::sqrt(dt_);
+  jump_probability_ = 1.0 - std::exp(-cfg_.jump_intensity * dt_);
+}
+
+SyntheticMarketDataProvider::~SyntheticMarketDataProvider() { stop(); }
+
+SyntheticMarketDataProvider::Path &
+SyntheticMarketDataProvider::path_for(const std::string &ticker) {
+  {
+    std::shared_lock<std::shared_mutex> lock(index_mutex_);
+    auto it = paths_.find(ticker);
+    if (it != paths_.end()) {
+      return *it->second;
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(index_mutex_);
+  auto &slot = paths_[ticker];
+  if (!slot) {
+    slot = std::make_unique<Path>();
+    slot->ticker = ticker;
+    slot->rng.seed(stream_seed(cfg_.seed, ticker));
+    slot->price = cfg_.initial_price;
+  }
+  return *slot;
+}
+
+PriceUpdate SyntheticMarketDataProvider::step(Path &path) {
+  PriceUpdate update;
+  update.ticker = path.ticker;
+  update.status = "OK";
+
+  std::lock_guard<std::mutex> lock(path.mutex);
+  double log_return =
+      diffusion_drift_ + diffusion_scale_ * path.normal(path.rng);
+  if (jump_probability_ > 0.0 && path.uniform(path.rng) < jump_probability_) {
+    log_return += cfg_.jump_mean + cfg_.jump_stddev * path.normal(path.rng);
+  }
+  path.price *= std::exp(log_return);
+  // The same clock as dt_: counting steps instead of summing tick_seconds
+  // keeps long runs from drifting.
+  ++path.steps;
+
+  update.price = path.price;
+  update.timestamp =
+      cfg_.start_timestamp +
+      static_cast<std::int64_t>(
+          std::floor(static_cast<double>(path.steps) * tick_seconds_));
+  ticks_.fetch_add(1, std::memory_order_relaxed);
+  return update;
+}
+
+PriceUpdate SyntheticMarketDataProvider::get_price(const std::string &ticker) {
+  return step(path_for(ticker));
+}
+
+void SyntheticMarketDataProvider::subscribe(
+    const std::vector<std::string> &tickers) {
+  std::vector<Path *> paths;
+  paths.reserve(tickers.size());
+  for (const auto &t : tickers) {
+    paths.push_back(&path_for(t));
+  }
+
+  std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+  std::unordered_set<Path *> present(subscribed_.begin(), subscribed_.end());
+  for (Path *p : paths) {
+    if (present.insert(p).second) {
+      subscribed_.push_back(p);
+    }
+  }
+  ++subscriptions_version_;
+}
+
+void SyntheticMarketDataProvider::unsubscribe(
+    const std::vector<std::string> &tickers) {
+  std::unordered_set<std::string> gone(tickers.begin(), tickers.end());
+  std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+  subscribed_.erase(std::remove_if(subscribed_.begin(), subscribed_.end(),
+                                   [&](Path *p) {
+                                     return gone.count(p->ticker) > 0;
+                                   }),
+                    subscribed_.end());
+  ++subscriptions_version_;
+}
+
+void SyntheticMarketDataProvider::start(PriceQueue &out) {
+  if (running_.exchange(true)) {
+    return;
+  }
+  out_ = &out;
+  thread_ = std::thread(&SyntheticMarketDataProvider::run, this);
+}
+
+void SyntheticMarketDataProvider::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  out_->close();
+}
+
+void SyntheticMarketDataProvider::run() {
+  using clock = std::chrono::steady_clock;
+  const auto begin = clock::now();
+  std::uint64_t emitted = 0;
+  std::uint64_t seen_version = ~0ULL;
+  std::vector<Path *> paths;
+  std::size_t cursor = 0;
+
+  while (running_) {
+    if (subscriptions_version_.load() != seen_version) {
+      std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+      seen_version = subscriptions_version_.load();
+      paths = subscribed_;
+      cursor = 0;
+    }
+    if (paths.empty()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+
+    std::uint64_t budget = 1024;
+    if (cfg_.ticks_per_sec > 0.0) {
+      const double elapsed =
+          std::chrono::duration<double>(clock::now() - begin).count();
+      const auto due = static_cast<std::uint64_t>(elapsed * cfg_.ticks_per_sec);
+      if (due <= emitted) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+      budget = std::min<std::uint64_t>(budget, due - emitted);
+    } else {
+      while (running_ && out_->size() > kMaxQueued) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      if (!running_) {
+        break;
+      }
+    }
+
+    for (std::uint64_t i = 0; i < budget; ++i) {
+      out_->write(step(*paths[cursor]));
+      if (++cursor == paths.size()) {
+        cursor = 0;
+      }
+    }
+    emitted += budget;
+  }
+}
+
+std::vector<std::string>
+SyntheticMarketDataProvider::symbol_names(std::size_t count) {
+  std::vector<std::string> names;
+  names.reserve(count);
+  char buf[32];
+  for (std::size_t i = 0; i < count; ++i) {
+    std::snprintf(buf, sizeof(buf), "SYN%04zu", i);
+    names.emplace_back(buf);
+  }
+  return names;
+}
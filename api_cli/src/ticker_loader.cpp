@@ -1,44 +1,49 @@
 #include "ticker_loader.hpp"
 
-#include <postgresql/libpq-fe.h>
-
-#include <iostream>
+#include "async_logger.hpp"
 
-std::vector<std::string> load_tickers_from_db(const std::string &conninfo) {
-  std::vector<std::string> result;
+#include <postgresql/libpq-fe.h>
 
-  PGconn *conn = PQconnectdb(conninfo.c_str());
-  if (!conn || PQstatus(conn) != CONNECTION_OK) {
-    std::cerr << "ticker_loader: connection failed: "
-              << (conn ? PQerrorMessage(conn) : "PQconnectdb returned null")
-              << "\n";
-    if (conn) {
-      PQfinish(conn);
-    }
-    return result;
-  }
-  
+bool load_tickers(PGconn *conn, std::vector<std::string> &out) {
+  out.clear();
   PGresult *res = PQexec(
       conn,
-      "select t.name from ticker t "
+      "select distinct t.name from ticker t "
       "join bsm_params bp on t.id = bp.ticker_id;");
   if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-    std::cerr << "ticker_loader: query failed: " << PQerrorMessage(conn);
+    log_error("ticker_loader", "query failed", {{"error", PQerrorMessage(conn)}});
     PQclear(res);
-    PQfinish(conn);
-    return result;
+    return false;
   }
 
   int rows = PQntuples(res);
-  result.reserve(rows);
+  out.reserve(rows);
   for (int i = 0; i < rows; ++i) {
     const char *val = PQgetvalue(res, i, 0);
     if (val) {
-      result.emplace_back(val);
+      out.emplace_back(val);
     }
   }
 
   PQclear(res);
+  return true;
+}
+
+std::vector<std::string> load_tickers_from_db(const std::string &conninfo) {
+  std::vector<std::string> result;
+
+  PGconn *conn = PQconnectdb(conninfo.c_str());
+  if (!conn || PQstatus(conn) != CONNECTION_OK) {
+    log_error("ticker_loader", "connection failed",
+              {{"error", conn ? PQerrorMessage(conn)
+                              : "PQconnectdb returned null"}});
+    if (conn) {
+      PQfinish(conn);
+    }
+    return result;
+  }
+
+  load_tickers(conn, result);
   PQfinish(conn);
   return result;
 }
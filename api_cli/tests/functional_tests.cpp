@@ -1,13 +1,31 @@
+#include "async_pricing_service.hpp"
+#include "iss_stub_server.hpp"
+#include "moex_client.hpp"
 #include "price_pipe.hpp"
+#include "price_recording.hpp"
 #include "pricing_service.hpp"
 #include "randomized_provider.hpp"
+#include "replay_provider.hpp"
+#include "sharded_publisher.hpp"
+#include "stomp_replay_server.hpp"
+#include "streaming_provider.hpp"
 
 #include <gtest/gtest.h>
 
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
 #include <map>
+#include <mutex>
 #include <memory>
 #include <set>
 #include <thread>
+#include <vector>
 
 class FunctionalConstantProvider : public MarketDataProvider {
 public:
@@ -59,3 +77,348 @@ TEST(PricingServiceFunctionalTest, ProducesRandomizedPricesForAllTickers) {
     EXPECT_TRUE(seen_ok_tickers.count(t));
   }
 }
+
+namespace {
+
+std::vector<RecordedFrame> make_frames(const std::vector<std::string> &tickers,
+                                       int per_ticker, int spacing_ms = 0) {
+  std::vector<RecordedFrame> frames;
+  for (int i = 0; i < per_ticker; ++i) {
+    for (const auto &t : tickers) {
+      RecordedFrame f;
+      f.offset_ms = static_cast<std::int64_t>(i) * spacing_ms;
+      f.ticker = t;
+      f.body = R"({"marketdata":{"columns":["SECID","LAST","SYSTIME"],)"
+               R"("data":[[")" +
+               t + "\"," + std::to_string(100 + i) +
+               R"(,"2025-11-20 15:40:37"]]}})";
+      frames.push_back(std::move(f));
+    }
+  }
+  return frames;
+}
+
+} // namespace
+
+TEST(StreamingProviderFunctionalTest, ReceivesReplayedFramesForSubscriptions) {
+  StompReplayServer server(make_frames({"SBER", "GAZP", "LKOH"}, 20),
+                           /*speed=*/0.0);
+  ASSERT_TRUE(server.start());
+
+  StreamingConfig cfg;
+  cfg.port = server.port();
+  StreamingMarketDataProvider provider(cfg);
+  provider.subscribe({"SBER", "GAZP"});
+
+  PriceQueue pipe;
+  provider.start(pipe);
+
+  std::map<std::string, int> per_ticker;
+  for (int i = 0; i < 40; ++i) {
+    PriceUpdate upd;
+    ASSERT_TRUE(pipe.read(upd));
+    EXPECT_EQ(upd.status, "OK");
+    EXPECT_DOUBLE_EQ(upd.price, 100 + per_ticker[upd.ticker]);
+    ++per_ticker[upd.ticker];
+  }
+
+  EXPECT_EQ(per_ticker["SBER"], 20);
+  EXPECT_EQ(per_ticker["GAZP"], 20);
+  EXPECT_EQ(per_ticker.count("LKOH"), 0u);
+  EXPECT_DOUBLE_EQ(provider.get_price("SBER").price, 119.0);
+
+  provider.stop();
+  server.stop();
+}
+
+TEST(StreamingProviderFunctionalTest, ReconnectsAndResubscribes) {
+  StompReplayServer server(make_frames({"SBER"}, 400, /*spacing_ms=*/10),
+                           /*speed=*/1.0);
+  ASSERT_TRUE(server.start());
+
+  StreamingConfig cfg;
+  cfg.port = server.port();
+  cfg.reconnect_delay_ms = 10;
+  StreamingMarketDataProvider provider(cfg);
+  provider.subscribe({"SBER"});
+
+  PriceQueue pipe;
+  provider.start(pipe);
+
+  PriceUpdate upd;
+  ASSERT_TRUE(pipe.read(upd));
+  server.disconnect_clients();
+
+  double last_price = upd.price;
+  for (int i = 0; i < 15; ++i) {
+    ASSERT_TRUE(pipe.read(upd));
+    EXPECT_EQ(upd.ticker, "SBER");
+    EXPECT_GT(upd.price, last_price);
+    last_price = upd.price;
+  }
+
+  EXPECT_GE(server.sessions(), 2u);
+  EXPECT_GE(provider.connections(), 2u);
+
+  provider.stop();
+  server.stop();
+}
+
+namespace {
+
+// Reads newline-delimited updates from one shard FIFO and records which
+// tickers arrived there.
+class ShardReader {
+public:
+  explicit ShardReader(std::string path) : path_(std::move(path)) {
+    thread_ = std::thread([this] {
+      int fd = ::open(path_.c_str(), O_RDONLY | O_NONBLOCK);
+      char buf[4096];
+      std::string partial;
+      while (!stop_) {
+        pollfd p{fd, POLLIN, 0};
+        ::poll(&p, 1, 20);
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0) {
+          if (n == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+          }
+          continue;
+        }
+        partial.append(buf, static_cast<std::size_t>(n));
+        std::size_t pos;
+        while ((pos = partial.find('\n')) != std::string::npos) {
+          auto t = partial.find("\"ticker\":\"");
+          auto end = partial.find('"', t + 10);
+          std::lock_guard<std::mutex> lock(mutex_);
+          tickers_.insert(partial.substr(t + 10, end - t - 10));
+          ++lines_;
+          partial.erase(0, pos + 1);
+        }
+      }
+      ::close(fd);
+    });
+  }
+
+  ~ShardReader() { stop(); }
+
+  void stop() {
+    stop_ = true;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  std::size_t lines() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lines_;
+  }
+
+  std::set<std::string> tickers() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tickers_;
+  }
+
+private:
+  std::string path_;
+  std::atomic<bool> stop_{false};
+  std::mutex mutex_;
+  std::set<std::string> tickers_;
+  std::size_t lines_{0};
+  std::thread thread_;
+};
+
+std::vector<PriceUpdate> make_batch(int tickers, int per_ticker) {
+  std::vector<PriceUpdate> batch;
+  for (int i = 0; i < per_ticker; ++i) {
+    for (int t = 0; t < tickers; ++t) {
+      PriceUpdate upd;
+      upd.timestamp = i;
+      upd.ticker = "TICK" + std::to_string(t);
+      upd.price = 100.0;
+      upd.status = "OK";
+      batch.push_back(upd);
+    }
+  }
+  return batch;
+}
+
+} // namespace
+
+TEST(ShardedPublisherFunctionalTest, FansOutAndRebalancesWhenShardLeaves) {
+  std::signal(SIGPIPE, SIG_IGN);
+  const auto paths = ShardedPublisher::shard_paths(
+      "/tmp/sharded_publisher_test_" + std::to_string(::getpid()), 3);
+  ShardedPublisher publisher(paths, /*probe_interval_ms=*/20);
+  ASSERT_TRUE(publisher.init());
+
+  std::vector<std::unique_ptr<ShardReader>> readers;
+  for (const auto &p : paths) {
+    readers.push_back(std::make_unique<ShardReader>(p));
+  }
+  while (publisher.live_channels() < paths.size()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    publisher.probe();
+  }
+
+  const auto batch = make_batch(/*tickers=*/60, /*per_ticker=*/500);
+  publisher.publish(batch);
+
+  std::size_t total = 0;
+  std::set<std::string> seen;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (total < batch.size() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    total = 0;
+    for (auto &r : readers) {
+      total += r->lines();
+    }
+  }
+  EXPECT_EQ(total, batch.size());
+
+  for (std::size_t i = 0; i < readers.size(); ++i) {
+    const auto tickers = readers[i]->tickers();
+    EXPECT_FALSE(tickers.empty());
+    for (const auto &t : tickers) {
+      EXPECT_TRUE(seen.insert(t).second) << t << " seen on two shards";
+      EXPECT_EQ(publisher.owner_of(t), static_cast<int>(i));
+    }
+  }
+
+  readers[1]->stop();
+  publisher.publish(make_batch(60, 50));
+  EXPECT_EQ(publisher.live_channels(), 2u);
+  for (int t = 0; t < 60; ++t) {
+    EXPECT_NE(publisher.owner_of("TICK" + std::to_string(t)), 1);
+  }
+
+  readers.clear();
+  for (const auto &p : paths) {
+    ::unlink(p.c_str());
+  }
+}
+
+TEST(ShardedPublisherFunctionalTest, SingleShardStopsWhenReaderLeaves) {
+  std::signal(SIGPIPE, SIG_IGN);
+  const auto paths = ShardedPublisher::shard_paths(
+      "/tmp/sharded_publisher_single_" + std::to_string(::getpid()), 1);
+  ASSERT_EQ(paths.size(), 1u);
+  ASSERT_EQ(::mkfifo(paths[0].c_str(), 0666), 0);
+  auto reader = std::make_unique<ShardReader>(paths[0]);
+
+  ShardedPublisher publisher(paths, /*probe_interval_ms=*/20);
+  ASSERT_TRUE(publisher.init());
+  EXPECT_EQ(publisher.live_channels(), 1u);
+
+  const auto batch = make_batch(/*tickers=*/5, /*per_ticker=*/10);
+  EXPECT_TRUE(publisher.publish(batch));
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (reader->lines() < batch.size() &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(reader->lines(), batch.size());
+
+  reader.reset();
+  EXPECT_FALSE(publisher.publish(batch));
+  EXPECT_EQ(publisher.live_channels(), 0u);
+  ::unlink(paths[0].c_str());
+}
+
+TEST(ReplayProviderFunctionalTest, PreservesRecordedSpacingScaledBySpeed) {
+  const std::string path =
+      "/tmp/replay_provider_test_" + std::to_string(::getpid());
+  ::unlink(path.c_str());
+  {
+    PriceRecorder recorder(path);
+    ASSERT_TRUE(recorder.open());
+    for (int i = 0; i < 5; ++i) {
+      PriceUpdate u;
+      u.timestamp = 1000 + i;
+      u.ticker = i % 2 ? "GAZP" : "SBER";
+      u.price = 100.0 + i;
+      u.status = "OK";
+      // 100ms apart in the recording.
+      ASSERT_TRUE(recorder.append(
+          RecordedUpdate{std::int64_t{i} * 100'000'000, u}));
+    }
+  }
+
+  // 400ms of recorded time at 10x should take about 40ms.
+  PriceQueue queue;
+  ReplayMarketDataProvider replay(path, 10.0);
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(replay.start(queue));
+  std::vector<PriceUpdate> got;
+  PriceUpdate upd;
+  while (queue.read(upd)) {
+    got.push_back(upd);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  ASSERT_EQ(got.size(), 5u);
+  EXPECT_EQ(got[3].ticker, "GAZP");
+  EXPECT_EQ(got[4].timestamp, 1004);
+  EXPECT_GE(elapsed, std::chrono::milliseconds(38));
+  EXPECT_LT(elapsed, std::chrono::milliseconds(400));
+  EXPECT_TRUE(replay.finished());
+  EXPECT_DOUBLE_EQ(replay.get_price("SBER").price, 104.0);
+  EXPECT_THROW(replay.get_price("LKOH"), std::runtime_error);
+
+  // Unthrottled replay ignores the spacing entirely.
+  PriceQueue fast_queue;
+  ReplayMarketDataProvider fast(path, 0.0);
+  start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(fast.start(fast_queue));
+  std::size_t count = 0;
+  while (fast_queue.read(upd)) {
+    ++count;
+  }
+  EXPECT_EQ(count, 5u);
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(38));
+
+  ::unlink(path.c_str());
+}
+
+TEST(AsyncPricingServiceFunctionalTest, PollsManyTickersOnOneLoopThread) {
+  IssStubServer server(/*response_delay_ms=*/20);
+  ASSERT_TRUE(server.start());
+
+  AsyncExecutor executor(1);
+  executor.start();
+  auto client = std::make_shared<MoexClient>(server.base_url());
+  client->set_executor(&executor);
+
+  PriceUpdate single = sync_wait(client->get_price_async("SBER"));
+  EXPECT_EQ(single.ticker, "SBER");
+  EXPECT_EQ(single.status, "OK");
+  EXPECT_GT(single.price, 0.0);
+
+  std::vector<std::string> tickers;
+  for (int i = 0; i < 200; ++i) {
+    tickers.push_back("T" + std::to_string(i));
+  }
+  PriceQueue queue;
+  AsyncPricingService service(client, tickers, queue, /*interval_ms=*/10,
+                              executor);
+  service.start();
+
+  // 200 pollers with 20ms server latency on one thread: sequential fetching
+  // would need 4s per round.
+  std::set<std::string> seen;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  PriceUpdate upd;
+  while (seen.size() < tickers.size() &&
+         std::chrono::steady_clock::now() < deadline && queue.read(upd)) {
+    EXPECT_EQ(upd.status, "OK") << upd.error;
+    seen.insert(upd.ticker);
+  }
+  EXPECT_EQ(seen.size(), tickers.size());
+
+  service.remove_tickers({"T0"});
+  service.stop();
+  EXPECT_EQ(service.in_flight(), 0u);
+  executor.stop();
+  server.stop();
+}
@@ -1,15 +1,28 @@
+#include "async_executor.hpp"
+#include "async_logger.hpp"
 #include "moex_client.hpp"
 #include "price_pipe.hpp"
+#include "price_recording.hpp"
+#include "price_writer.hpp"
 #include "pricing_service.hpp"
 #include "randomized_provider.hpp"
+#include "shard_ring.hpp"
+#include "stomp_frame.hpp"
+#include "subscription_registry.hpp"
+#include "synthetic_provider.hpp"
 #include "ticker_loader.hpp"
 
 #include <gtest/gtest.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cmath>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <thread>
 
 static const char *SAMPLE_JSON = R"json(
 {
@@ -54,6 +67,7 @@ TEST(PricePipeTest, BasicWriteRead) {
   PriceUpdate out{};
   bool ok = pipe.read(out);
   EXPECT_TRUE(ok);
+  EXPECT_GT(out.capture_ns, 0);
   EXPECT_EQ(out.timestamp, in.timestamp);
   EXPECT_EQ(out.ticker, in.ticker);
   EXPECT_DOUBLE_EQ(out.price, in.price);
@@ -181,3 +195,438 @@ TEST(RandomizedProviderTest, PriceWithinTenPercentAndMonotonicTs) {
     last_ts = upd.timestamp;
   }
 }
+
+TEST(StompFrameTest, RoundTripAcrossSplitReads) {
+  StompFrame in;
+  in.command = "MESSAGE";
+  in.headers.emplace_back("destination", "/marketdata/SBER");
+  in.headers.emplace_back("subscription", "SBER");
+  in.body = R"({"marketdata":{}})";
+
+  std::string wire = "\n" + serialize_stomp_frame(in) + "\n";
+  wire += serialize_stomp_frame(in);
+
+  StompFrameParser parser;
+  StompFrame out;
+  std::size_t frames = 0;
+  for (char c : wire) {
+    parser.feed(&c, 1);
+    while (parser.next(out)) {
+      ++frames;
+      EXPECT_EQ(out.command, "MESSAGE");
+      ASSERT_NE(out.header("destination"), nullptr);
+      EXPECT_EQ(*out.header("destination"), "/marketdata/SBER");
+      EXPECT_EQ(out.body, in.body);
+    }
+  }
+  EXPECT_EQ(frames, 2u);
+}
+
+TEST(StompFrameTest, HonoursContentLength) {
+  std::string body("a\0b", 3);
+  std::string wire = "MESSAGE\ncontent-length:3\n\n" + body;
+  wire += '\0';
+
+  StompFrameParser parser;
+  parser.feed(wire.data(), wire.size());
+  StompFrame out;
+  ASSERT_TRUE(parser.next(out));
+  EXPECT_EQ(out.body, body);
+  EXPECT_FALSE(parser.next(out));
+}
+
+TEST(StompFrameTest, AcceptsCrlfLineEndings) {
+  std::string wire = "\r\nMESSAGE\r\ndestination:/marketdata/SBER\r\n"
+                     "content-length:2\r\n\r\n{}";
+  wire += '\0';
+  wire += "RECEIPT\r\nreceipt-id:7\r\n\r\n";
+  wire += '\0';
+
+  StompFrameParser parser;
+  std::vector<StompFrame> frames;
+  StompFrame out;
+  for (char c : wire) {
+    parser.feed(&c, 1);
+    while (parser.next(out)) {
+      frames.push_back(out);
+    }
+  }
+  ASSERT_EQ(frames.size(), 2u);
+  EXPECT_EQ(frames[0].command, "MESSAGE");
+  ASSERT_NE(frames[0].header("destination"), nullptr);
+  EXPECT_EQ(*frames[0].header("destination"), "/marketdata/SBER");
+  EXPECT_EQ(frames[0].body, "{}");
+  EXPECT_EQ(frames[1].command, "RECEIPT");
+  ASSERT_NE(frames[1].header("receipt-id"), nullptr);
+  EXPECT_EQ(*frames[1].header("receipt-id"), "7");
+  EXPECT_TRUE(frames[1].body.empty());
+}
+
+TEST(PricePipeTest, ReadBatchDrainsUpToLimit) {
+  PriceQueue pipe;
+  for (int i = 0; i < 5; ++i) {
+    PriceUpdate upd;
+    upd.timestamp = i;
+    pipe.write(upd);
+  }
+
+  std::vector<PriceUpdate> batch;
+  ASSERT_TRUE(pipe.read_batch(batch, 3));
+  ASSERT_EQ(batch.size(), 3u);
+  EXPECT_EQ(batch[2].timestamp, 2);
+  ASSERT_TRUE(pipe.read_batch(batch, 3));
+  EXPECT_EQ(batch.size(), 2u);
+
+  pipe.close();
+  EXPECT_FALSE(pipe.read_batch(batch, 3));
+}
+
+TEST(PriceSerializerTest, MatchesLineFormat) {
+  PriceUpdate upd;
+  upd.timestamp = 1763653237;
+  upd.ticker = "SBER";
+  upd.price = 302.92;
+  upd.status = "OK";
+
+  PriceSerializer serializer(/*chunk_size=*/256);
+  serializer.append(upd);
+  upd.status = "ERROR";
+  upd.error = "network error";
+  upd.price = 0.0;
+  upd.timestamp = -1;
+  serializer.append(upd);
+
+  EXPECT_EQ(serializer.str(),
+            "{\"timestamp\":1763653237,\"ticker\":\"SBER\",\"price\":"
+            "302.920000,\"status\":\"OK\",\"error\":\"\"}\n"
+            "{\"timestamp\":-1,\"ticker\":\"SBER\",\"price\":0.000000,"
+            "\"status\":\"ERROR\",\"error\":\"network error\"}\n");
+}
+
+TEST(PriceSerializerTest, SpillsIntoChunksAndWritesThemFully) {
+  PriceSerializer serializer(/*chunk_size=*/512);
+  PriceUpdate upd;
+  upd.ticker = "GAZP";
+  upd.status = "OK";
+  for (int i = 0; i < 2000; ++i) {
+    upd.timestamp = i;
+    upd.price = 100.0 + i;
+    serializer.append(upd);
+  }
+  const std::string expected = serializer.str();
+  auto iov = serializer.iovecs();
+  ASSERT_GT(iov.size(), 1u);
+
+  int fds[2];
+  ASSERT_EQ(::pipe(fds), 0);
+  ::fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+  std::string received;
+  std::thread reader([&] {
+    char buf[1000];
+    ssize_t n;
+    while ((n = ::read(fds[0], buf, sizeof(buf))) > 0) {
+      received.append(buf, static_cast<std::size_t>(n));
+    }
+  });
+
+  EXPECT_TRUE(write_fully(fds[1], iov.data(), iov.size()));
+  ::close(fds[1]);
+  reader.join();
+  ::close(fds[0]);
+
+  EXPECT_EQ(received, expected);
+}
+
+TEST(ShardRingTest, RemovingShardOnlyMovesItsTickers) {
+  ShardRing ring;
+  for (int s = 0; s < 4; ++s) {
+    ring.add_shard(s);
+  }
+
+  std::map<std::string, int> before;
+  std::map<int, int> load;
+  for (int i = 0; i < 2000; ++i) {
+    const std::string ticker = "T" + std::to_string(i);
+    before[ticker] = ring.owner(ticker);
+    ++load[before[ticker]];
+  }
+  for (int s = 0; s < 4; ++s) {
+    EXPECT_GT(load[s], 250);
+  }
+
+  ring.remove_shard(2);
+  for (const auto &[ticker, owner] : before) {
+    const int now = ring.owner(ticker);
+    EXPECT_NE(now, 2);
+    if (owner != 2) {
+      EXPECT_EQ(now, owner);
+    }
+  }
+
+  ring.add_shard(2);
+  for (const auto &[ticker, owner] : before) {
+    EXPECT_EQ(ring.owner(ticker), owner);
+  }
+}
+
+TEST(PricingServiceTest, RemovedTickersStopAndFreeTheirSlots) {
+  auto provider = std::make_shared<PricingServiceMockProvider>();
+  PriceQueue pipe;
+  PricingService service(provider, {"AAA", "BBB", "CCC"}, pipe, 5);
+  service.start();
+
+  service.remove_tickers({"BBB"});
+  EXPECT_EQ(service.tickers().size(), 2u);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  std::vector<PriceUpdate> drained;
+  pipe.read_batch(drained, 1'000'000);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  pipe.read_batch(drained, 1'000'000);
+  for (const auto &upd : drained) {
+    EXPECT_NE(upd.ticker, "BBB");
+  }
+
+  service.add_tickers({"DDD"});
+  EXPECT_EQ(service.slot_count(), 3u);
+  service.add_tickers({"EEE"});
+  EXPECT_EQ(service.slot_count(), 4u);
+
+  std::set<std::string> seen;
+  while (seen.count("DDD") == 0) {
+    PriceUpdate upd;
+    ASSERT_TRUE(pipe.read(upd));
+    seen.insert(upd.ticker);
+  }
+
+  service.stop();
+}
+
+TEST(SubscriptionRegistryTest, SnapshotDiffReportsAddsAndRemovals) {
+  SubscriptionRegistry registry("");
+  std::vector<std::string> added;
+  std::vector<std::string> removed;
+
+  registry.apply_snapshot({"SBER", "GAZP"}, added, removed);
+  EXPECT_EQ(std::set<std::string>(added.begin(), added.end()),
+            (std::set<std::string>{"SBER", "GAZP"}));
+  EXPECT_TRUE(removed.empty());
+
+  registry.apply_snapshot({"SBER", "LKOH", "LKOH"}, added, removed);
+  EXPECT_EQ(added, std::vector<std::string>{"LKOH"});
+  EXPECT_EQ(removed, std::vector<std::string>{"GAZP"});
+  EXPECT_TRUE(registry.contains("SBER"));
+  EXPECT_FALSE(registry.contains("GAZP"));
+}
+
+TEST(SyntheticProviderTest, PathsDependOnlyOnSeedAndTicker) {
+  SyntheticConfig cfg;
+  cfg.start_timestamp = 1'000'000;
+  cfg.jump_intensity = 1e6;
+  cfg.jump_stddev = 0.01;
+  SyntheticMarketDataProvider a(cfg);
+  SyntheticMarketDataProvider b(cfg);
+
+  // Interleaving another ticker must not perturb SBER's stream.
+  std::int64_t last_ts = cfg.start_timestamp;
+  for (int i = 0; i < 100; ++i) {
+    b.get_price("GAZP");
+    PriceUpdate x = a.get_price("SBER");
+    PriceUpdate y = b.get_price("SBER");
+    EXPECT_EQ(x.status, "OK");
+    EXPECT_DOUBLE_EQ(x.price, y.price);
+    EXPECT_GT(x.price, 0.0);
+    EXPECT_GT(x.timestamp, last_ts);
+    last_ts = x.timestamp;
+  }
+
+  SyntheticConfig reseeded = cfg;
+  reseeded.seed += 1;
+  SyntheticMarketDataProvider c(cfg);
+  SyntheticMarketDataProvider d(reseeded);
+  EXPECT_NE(c.get_price("SBER").price, d.get_price("SBER").price);
+}
+
+TEST(SyntheticProviderTest, LogReturnsMatchConfiguredVolatility) {
+  SyntheticConfig cfg;
+  cfg.drift = 0.0;
+  cfg.volatility = 0.3;
+  cfg.tick_seconds = 86400.0;
+  SyntheticMarketDataProvider provider(cfg);
+
+  constexpr int kSteps = 20000;
+  double prev = cfg.initial_price;
+  double sum_sq = 0.0;
+  for (int i = 0; i < kSteps; ++i) {
+    double price = provider.get_price("VOL").price;
+    double r = std::log(price / prev);
+    sum_sq += r * r;
+    prev = price;
+  }
+  double annualised = std::sqrt(sum_sq / kSteps * 365.0);
+  EXPECT_NEAR(annualised, 0.3, 0.01);
+}
+
+TEST(SyntheticProviderTest, TimestampsFollowTickSeconds) {
+  SyntheticConfig cfg;
+  cfg.start_timestamp = 1'000'000;
+  cfg.tick_seconds = 0.25;
+  SyntheticMarketDataProvider quarter(cfg);
+  std::vector<std::int64_t> ts;
+  for (int i = 0; i < 8; ++i) {
+    ts.push_back(quarter.get_price("SBER").timestamp);
+  }
+  EXPECT_EQ(ts, (std::vector<std::int64_t>{1'000'000, 1'000'000, 1'000'000,
+                                           1'000'001, 1'000'001, 1'000'001,
+                                           1'000'001, 1'000'002}));
+
+  cfg.tick_seconds = 2.5;
+  SyntheticMarketDataProvider slow(cfg);
+  EXPECT_EQ(slow.get_price("SBER").timestamp, 1'000'002);
+  EXPECT_EQ(slow.get_price("SBER").timestamp, 1'000'005);
+}
+
+TEST(SyntheticProviderTest, UnthrottledPushStopsAtQueueBound) {
+  SyntheticMarketDataProvider provider;
+  provider.subscribe(SyntheticMarketDataProvider::symbol_names(4));
+  PriceQueue queue;
+  provider.start(queue);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  const std::size_t queued = queue.size();
+  provider.stop();
+
+  EXPECT_GT(queued, std::size_t{1} << 16);
+  EXPECT_LE(queued, (std::size_t{1} << 16) + 1024);
+}
+
+TEST(SyntheticProviderTest, PushModeRoundRobinsSubscribedTickers) {
+  SyntheticMarketDataProvider provider;
+  provider.subscribe(SyntheticMarketDataProvider::symbol_names(3));
+  PriceQueue queue;
+  provider.start(queue);
+
+  std::map<std::string, int> seen;
+  PriceUpdate upd;
+  for (int i = 0; i < 30; ++i) {
+    ASSERT_TRUE(queue.read(upd));
+    ++seen[upd.ticker];
+  }
+  provider.stop();
+
+  EXPECT_EQ(seen, (std::map<std::string, int>{
+                      {"SYN0000", 10}, {"SYN0001", 10}, {"SYN0002", 10}}));
+}
+
+TEST(PriceRecordingTest, RoundTripsAndIgnoresTruncatedTail) {
+  const std::string path =
+      "/tmp/price_recording_test_" + std::to_string(::getpid());
+  ::unlink(path.c_str());
+
+  PriceUpdate ok;
+  ok.timestamp = 1763653237;
+  ok.ticker = "SBER";
+  ok.price = 301.25;
+  ok.status = "OK";
+  PriceUpdate err;
+  err.timestamp = -1;
+  err.ticker = "GAZP";
+  err.status = "ERROR";
+  err.error = "timeout";
+  {
+    PriceRecorder recorder(path);
+    ASSERT_TRUE(recorder.open());
+    ASSERT_TRUE(recorder.append(RecordedUpdate{5, ok}));
+  }
+  {
+    // Reopening appends instead of writing a second header.
+    PriceRecorder recorder(path);
+    ASSERT_TRUE(recorder.open());
+    // Each update keeps its own enqueue time; an unstamped one gets now.
+    PriceUpdate queued = ok;
+    queued.capture_ns = 7;
+    ASSERT_TRUE(recorder.append(std::vector<PriceUpdate>{queued, err}));
+  }
+  int fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(::write(fd, "\x40\0\0\0abc", 7), 7);
+  ::close(fd);
+
+  PriceRecordingReader reader(path);
+  ASSERT_TRUE(reader.open());
+  RecordedUpdate rec;
+  ASSERT_TRUE(reader.next(rec));
+  EXPECT_EQ(rec.capture_ns, 5);
+  EXPECT_EQ(rec.update.ticker, "SBER");
+  EXPECT_EQ(rec.update.timestamp, 1763653237);
+  EXPECT_DOUBLE_EQ(rec.update.price, 301.25);
+  ASSERT_TRUE(reader.next(rec));
+  EXPECT_EQ(rec.capture_ns, 7);
+  EXPECT_EQ(rec.update.ticker, "SBER");
+  ASSERT_TRUE(reader.next(rec));
+  EXPECT_GT(rec.capture_ns, 7);
+  EXPECT_EQ(rec.update.ticker, "GAZP");
+  EXPECT_EQ(rec.update.status, "ERROR");
+  EXPECT_EQ(rec.update.error, "timeout");
+  EXPECT_FALSE(reader.next(rec));
+
+  ::unlink(path.c_str());
+}
+
+namespace {
+
+Task<int> add_one(int x) { co_return x + 1; }
+
+Task<int> add_two(int x) {
+  int y = co_await add_one(x);
+  co_return co_await add_one(y);
+}
+
+Task<int> fail_after_sleep(AsyncExecutor &ex) {
+  co_await ex.sleep_for(std::chrono::milliseconds(5));
+  throw std::runtime_error("boom");
+}
+
+} // namespace
+
+TEST(TaskTest, ComposesAndPropagatesExceptionsAcrossThreads) {
+  EXPECT_EQ(sync_wait(add_two(40)), 42);
+
+  AsyncExecutor ex(1);
+  ex.start();
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_THROW(sync_wait(fail_after_sleep(ex)), std::runtime_error);
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(5));
+
+  // The default get_price_async wraps the synchronous call.
+  ConstantProvider provider(10.0, 7);
+  PriceUpdate upd = sync_wait(provider.get_price_async("SBER"));
+  EXPECT_EQ(upd.ticker, "SBER");
+  EXPECT_EQ(upd.timestamp, 7);
+  ex.stop();
+}
+
+TEST(AsyncLoggerTest, QuotesValuesAndTruncatesLongLines) {
+  ::testing::internal::CaptureStderr();
+  log_warn("UnitTest", "quoting",
+           {{"plain", "abc"}, {"spaced", "a b"}, {"quoted", "say \"hi\""},
+            {"empty", ""}, {"ratio", 0.25}});
+  log_warn("UnitTest", "long line",
+           {{"blob", std::string(2 * AsyncLogger::kLineBytes, 'x')}});
+  AsyncLogger::instance().flush();
+  std::string output = ::testing::internal::GetCapturedStderr();
+
+  EXPECT_NE(output.find("plain=abc spaced=\"a b\" quoted=\"say \\\"hi\\\"\" "
+                        "empty=\"\" ratio=0.25\n"),
+            std::string::npos);
+
+  auto pos = output.find("msg=\"long line\"");
+  ASSERT_NE(pos, std::string::npos);
+  auto begin = output.rfind("ts=", pos);
+  auto end = output.find('\n', pos);
+  ASSERT_NE(end, std::string::npos);
+  EXPECT_EQ(end + 1 - begin, AsyncLogger::kLineBytes);
+  EXPECT_EQ(output.substr(end - 3, 3), "...");
+}
@@ -0,0 +1,74 @@
+#include "option_pricer.hpp"
+#include "smile_calibration.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Wall time of SmileCalibrator cycles over 64 tickers x 8 maturities x 21
+// strikes, across pool sizes: a cold cycle (no previous fits), a cycle
+// after every quote moved a little (all slices refit, warm-started), and
+// a cycle with nothing changed.
+
+namespace {
+
+constexpr long long kTickers = 64;
+constexpr double kMaturities[] = {0.08, 0.17, 0.25, 0.5, 0.75, 1.0, 1.5, 2.0};
+
+std::vector<OptionQuotePoint> make_quotes(std::mt19937_64 &rng, double shift) {
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<OptionQuotePoint> quotes;
+  for (long long t = 1; t <= kTickers; ++t) {
+    const SviParams base{0.01 + 0.02 * unit(rng), 0.05 + 0.1 * unit(rng),
+                         -0.7 + 0.5 * unit(rng), 0.1 * unit(rng) - 0.05,
+                         0.05 + 0.2 * unit(rng)};
+    for (double T : kMaturities) {
+      SviParams svi = base;
+      svi.a = (base.a + shift) * T;
+      svi.b = base.b * std::sqrt(T);
+      const double S = 100.0, r = 0.04, q = 0.01;
+      const double F = S * std::exp((r - q) * T);
+      for (int k = 0; k <= 20; ++k) {
+        const double K = 70.0 + 3.0 * k;
+        const double vol =
+            std::sqrt(svi_total_variance(svi, std::log(K / F)) / T);
+        quotes.push_back(OptionQuotePoint{
+            t, K, T, OptionPricer::black_scholes_call(S, K, r, q, vol, T), S,
+            r, q});
+      }
+    }
+  }
+  return quotes;
+}
+
+} // namespace
+
+int main() {
+  std::mt19937_64 rng(3);
+  const std::vector<OptionQuotePoint> first = make_quotes(rng, 0.0);
+  rng.seed(3);
+  const std::vector<OptionQuotePoint> moved = make_quotes(rng, 0.001);
+
+  const std::size_t hw =
+      std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  for (std::size_t threads = 1; threads <= hw; threads *= 2) {
+    ThreadPool pool(threads);
+    SmileCalibrator calibrator(pool);
+    const CalibrationStats cold = calibrator.update(first);
+    const CalibrationStats warm = calibrator.update(moved);
+    const CalibrationStats same = calibrator.update(moved);
+    double worst = 0.0;
+    for (const SmileFit &f : calibrator.fits()) {
+      worst = std::max(worst, f.rms_vol_error);
+    }
+    std::printf("threads=%zu  slices=%zu  cold %.2f ms  warm %.2f ms  "
+                "unchanged %.2f ms  worst rms vol error %.2e  failed %zu\n",
+                threads, cold.slices, cold.wall_ms, warm.wall_ms, same.wall_ms,
+                worst, cold.failed + warm.failed);
+  }
+  return 0;
+}
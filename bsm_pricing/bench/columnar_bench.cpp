@@ -0,0 +1,80 @@
+#include "columnar_sink.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+// Quotes/s and bytes/quote of the columnar sink on a feed-like stream (200
+// tickers, 2000 contracts, timestamps rising by about a second per 1000
+// quotes), and the rate the files decode at. For the database path, a
+// ticker_price row costs ~84 bytes of heap tuple plus ~30 bytes per btree
+// entry for only two of the seven prices, at the single-row insert rates
+// ticker_price_bench reports.
+
+namespace {
+
+constexpr std::size_t kQuotes = 5'000'000;
+
+} // namespace
+
+int main() {
+  const std::string dir =
+      (std::filesystem::temp_directory_path() / "bsm_columnar_bench").string();
+
+  std::mt19937_64 rng(11);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<OptionQuote> quotes(1 << 16);
+  for (std::size_t i = 0; i < quotes.size(); ++i) {
+    OptionQuote &q = quotes[i];
+    q.conf_id = static_cast<long long>(rng() % 2000);
+    q.ticker_id = q.conf_id % 200;
+    q.underlying_price = 100.0 + unit(rng);
+    q.option_price = 10.0 * unit(rng);
+    q.delta = unit(rng);
+    q.gamma = 0.01 * unit(rng);
+    q.vega = 30.0 * unit(rng);
+    q.theta = -5.0 * unit(rng);
+    q.rho = 20.0 * unit(rng);
+    q.status = "OK";
+  }
+
+  for (std::size_t batch_rows : {4096u, 65536u}) {
+    std::filesystem::remove_all(dir);
+    ColumnarSinkConfig config;
+    config.dir = dir;
+    config.batch_rows = batch_rows;
+    ColumnarSink sink(config);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < kQuotes; ++i) {
+      OptionQuote &q = quotes[i % quotes.size()];
+      q.timestamp = 1700000000 + static_cast<std::int64_t>(i / 1000);
+      sink.append(q);
+    }
+    sink.close();
+    const double sec = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+
+    std::vector<OptionQuote> read;
+    read.reserve(kQuotes);
+    start = std::chrono::steady_clock::now();
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+      read_columnar_file(entry.path().string(), read);
+    }
+    const double read_sec = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+
+    std::printf("batch %6zu  write %6.2f M quotes/s  %5.1f bytes/quote  "
+                "(%zu raw)  read %6.2f M quotes/s\n",
+                batch_rows, kQuotes / sec / 1e6,
+                static_cast<double>(sink.bytes_written()) / kQuotes,
+                7 * sizeof(double) + 3 * sizeof(std::int64_t),
+                read.size() / read_sec / 1e6);
+  }
+  std::filesystem::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include "compiled_contract.hpp"
+#include "heston.hpp"
+#include "option_pricer.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Nanoseconds per call for a Heston price and Greeks from a compiled slice
+// next to the compiled Black-Scholes kernels, a 21-strike chain through the
+// batch entry point, and the cost of compiling a slice (two characteristic
+// function sweeps), which a config load pays once per contract.
+
+namespace {
+
+constexpr std::size_t kSlices = 64;
+constexpr std::size_t kCalls = 2'000'000;
+
+template <typename Fn> double time_ns(std::size_t n, Fn &&fn) {
+  double sink = 0.0;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < n; ++i) {
+    sink += fn(i);
+  }
+  const double ns = std::chrono::duration<double, std::nano>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  if (sink == 42.0) {
+    std::printf("%f", sink);
+  }
+  return ns / static_cast<double>(n);
+}
+
+} // namespace
+
+int main() {
+  std::mt19937_64 rng(11);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  const double maturities[] = {0.08, 0.25, 0.5, 1.0, 2.0};
+
+  std::vector<BsmParams> rows(kSlices);
+  std::vector<HestonSlice> slices(kSlices);
+  std::vector<CompiledContract> compiled(kSlices);
+  ContractCompiler compiler;
+  for (std::size_t i = 0; i < kSlices; ++i) {
+    BsmParams &p = rows[i];
+    p.K = 80.0 + 40.0 * unit(rng);
+    p.r = 0.05;
+    p.q = 0.01;
+    p.T = maturities[i % 5];
+    p.heston = HestonParams{0.5 + 3.0 * unit(rng), 0.02 + 0.08 * unit(rng),
+                            0.2 + 0.8 * unit(rng), -0.9 + 0.9 * unit(rng),
+                            0.02 + 0.08 * unit(rng)};
+    p.sigma = std::sqrt(p.heston.v0);
+    compiled[i] = compiler.compile(p);
+  }
+
+  const double compile_ns = time_ns(kSlices * 200, [&](std::size_t i) {
+    const BsmParams &p = rows[i % kSlices];
+    slices[i % kSlices] = compile_heston(p.heston, p.r, p.q, p.T);
+    return slices[i % kSlices].c_re[0];
+  });
+
+  std::vector<double> spots(1 << 12);
+  for (double &s : spots) {
+    s = 70.0 + 60.0 * unit(rng);
+  }
+  auto spot = [&](std::size_t i) { return spots[i % spots.size()]; };
+
+  const double bs_price = time_ns(kCalls, [&](std::size_t i) {
+    return price_call(compiled[i % kSlices], spot(i));
+  });
+  const double h_price = time_ns(kCalls, [&](std::size_t i) {
+    return heston_call(slices[i % kSlices], spot(i), rows[i % kSlices].K);
+  });
+  const double bs_greeks = time_ns(kCalls, [&](std::size_t i) {
+    return call_greeks(compiled[i % kSlices], spot(i)).delta;
+  });
+  const double h_greeks = time_ns(kCalls, [&](std::size_t i) {
+    return heston_call_greeks(slices[i % kSlices], spot(i),
+                              rows[i % kSlices].K)
+        .delta;
+  });
+
+  std::vector<double> strikes(21);
+  for (std::size_t k = 0; k < strikes.size(); ++k) {
+    strikes[k] = 70.0 + 3.0 * static_cast<double>(k);
+  }
+  std::vector<double> chain(strikes.size());
+  const double batch = time_ns(kCalls / strikes.size(), [&](std::size_t i) {
+    heston_call_batch(slices[i % kSlices], spot(i), strikes.data(),
+                      chain.data(), strikes.size());
+    return chain[10];
+  });
+
+  std::printf("compile_heston           : %8.1f ns/slice\n", compile_ns);
+  std::printf("price_call (compiled BS) : %8.1f ns\n", bs_price);
+  std::printf("heston_call              : %8.1f ns  (%.1fx)\n", h_price,
+              h_price / bs_price);
+  std::printf("call_greeks (compiled BS): %8.1f ns\n", bs_greeks);
+  std::printf("heston_call_greeks       : %8.1f ns  (%.1fx)\n", h_greeks,
+              h_greeks / bs_greeks);
+  std::printf("heston_call_batch x21    : %8.1f ns/strike\n",
+              batch / static_cast<double>(strikes.size()));
+  return 0;
+}
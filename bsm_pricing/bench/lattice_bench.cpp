@@ -0,0 +1,81 @@
+#include "lattice.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Contracts per second for American calls on dividend payers at 500 and
+// 2000 steps, binomial and trinomial, across pool sizes; then the error
+// against a 16000-step binomial reference as steps grow.
+
+namespace {
+
+constexpr std::size_t kContracts = 256;
+
+void throughput(std::vector<LatticeContract> contracts) {
+  const std::size_t hw =
+      std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  std::vector<double> out(contracts.size());
+  for (std::size_t steps : {500, 2000}) {
+    for (LatticeKind kind : {LatticeKind::Binomial, LatticeKind::Trinomial}) {
+      for (LatticeContract &c : contracts) {
+        c.steps = steps;
+        c.kind = kind;
+      }
+      for (std::size_t threads = 1; threads <= hw; threads *= 2) {
+        ThreadPool pool(threads);
+        auto start = std::chrono::steady_clock::now();
+        american_call_batch(pool, contracts.data(), contracts.size(),
+                            out.data());
+        const double secs = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+        std::printf("%-9s steps=%-5zu threads=%zu  %.0f contracts/s\n",
+                    kind == LatticeKind::Binomial ? "binomial" : "trinomial",
+                    steps, threads,
+                    static_cast<double>(contracts.size()) / secs);
+      }
+    }
+  }
+  if (out[3] == 42.0) {
+    std::printf("%f", out[3]);
+  }
+}
+
+void convergence() {
+  LatticeContract c{100.0, 100.0, 0.05, 0.04, 0.3, 1.0, 16000};
+  const double reference = american_call(c);
+  std::printf("%6s %14s %14s\n", "steps", "binomial err", "trinomial err");
+  for (std::size_t steps = 50; steps <= 3200; steps *= 2) {
+    c.steps = steps;
+    c.kind = LatticeKind::Binomial;
+    const double b = american_call(c);
+    c.kind = LatticeKind::Trinomial;
+    const double t = american_call(c);
+    std::printf("%6zu %14.2e %14.2e\n", steps, std::fabs(b - reference),
+                std::fabs(t - reference));
+  }
+}
+
+} // namespace
+
+int main() {
+  std::mt19937_64 rng(11);
+  std::uniform_real_distribution<double> spot(70.0, 130.0);
+  std::uniform_real_distribution<double> vol(0.1, 0.6);
+  std::uniform_real_distribution<double> dividend(0.01, 0.08);
+  const double maturities[] = {0.08, 0.25, 0.5, 1.0, 2.0};
+
+  std::vector<LatticeContract> contracts(kContracts);
+  for (std::size_t i = 0; i < kContracts; ++i) {
+    contracts[i] = LatticeContract{spot(rng),      100.0,    0.05,
+                                   dividend(rng),  vol(rng), maturities[i % 5]};
+  }
+  throughput(contracts);
+  convergence();
+  return 0;
+}
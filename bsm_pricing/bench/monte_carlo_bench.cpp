@@ -0,0 +1,80 @@
+#include "monte_carlo.hpp"
+#include "option_pricer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+// Paths per second for each payoff across pool sizes, then convergence of
+// the European call against Black-Scholes as paths grow, for plain Philox,
+// Philox with antithetics and the control variate, and Sobol.
+
+namespace {
+
+void throughput() {
+  const McContract contracts[] = {
+      {100.0, 105.0, 0.05, 0.01, 0.25, 1.0, 1, McPayoff::EuropeanCall},
+      {100.0, 100.0, 0.05, 0.01, 0.25, 1.0, 64, McPayoff::AsianArithmeticCall},
+      {100.0, 100.0, 0.05, 0.01, 0.25, 1.0, 64, McPayoff::UpAndOutCall, 130.0},
+  };
+  const char *names[] = {"european 1 step ", "asian 64 steps  ",
+                         "up-and-out 64   "};
+  const std::size_t hw =
+      std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  McConfig cfg;
+  cfg.paths = 1'000'000;
+
+  for (std::size_t threads = 1; threads <= hw; threads *= 2) {
+    ThreadPool pool(threads);
+    MonteCarloEngine engine(pool);
+    for (std::size_t i = 0; i < 3; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      const McResult r = engine.price(contracts[i], cfg);
+      const double secs = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+      std::printf("%s threads=%zu  %.3g paths/s  price=%.5f se=%.2e\n",
+                  names[i], threads, static_cast<double>(r.paths) / secs,
+                  r.price, r.std_error);
+    }
+  }
+}
+
+void convergence() {
+  const McContract c{100.0, 105.0, 0.05, 0.01, 0.25, 1.0, 16};
+  const double exact =
+      OptionPricer::black_scholes_call(c.S, c.K, c.r, c.q, c.sigma, c.T);
+  ThreadPool pool;
+  MonteCarloEngine engine(pool);
+
+  std::printf("%10s %22s %22s %12s\n", "paths", "plain |err| (se)",
+              "anti+cv |err| (se)", "sobol |err|");
+  for (std::size_t paths = 1 << 10; paths <= (1 << 20); paths <<= 2) {
+    McConfig plain;
+    plain.paths = paths;
+    plain.antithetic = false;
+    plain.control_variate = false;
+    McConfig reduced;
+    reduced.paths = paths;
+    McConfig sobol = plain;
+    sobol.sobol = true;
+
+    const McResult a = engine.price(c, plain);
+    const McResult b = engine.price(c, reduced);
+    const McResult s = engine.price(c, sobol);
+    std::printf("%10zu %11.2e (%8.2e) %11.2e (%8.2e) %12.2e\n", paths,
+                std::fabs(a.price - exact), a.std_error,
+                std::fabs(b.price - exact), b.std_error,
+                std::fabs(s.price - exact));
+  }
+}
+
+} // namespace
+
+int main() {
+  throughput();
+  convergence();
+  return 0;
+}
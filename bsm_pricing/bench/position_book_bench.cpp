@@ -0,0 +1,75 @@
+#include "position_book.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// Cost of one quote on the PositionBook as the book grows, against
+// re-summing the whole book per quote, which is what it replaces.
+
+namespace {
+
+constexpr std::size_t kQuotes = 5'000'000;
+
+} // namespace
+
+int main() {
+  std::mt19937_64 rng(9);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  for (std::size_t size : {100u, 10'000u, 1'000'000u}) {
+    std::vector<Position> positions(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      positions[i] = Position{static_cast<long long>(i),
+                              static_cast<long long>(i % 200),
+                              "T" + std::to_string(i % 200), 1.0 + i % 5};
+    }
+    PositionBook book;
+    book.set_positions(positions);
+
+    std::vector<OptionQuote> quotes(1 << 14);
+    for (OptionQuote &q : quotes) {
+      q.conf_id = static_cast<long long>(rng() % size);
+      q.option_price = 10.0 * unit(rng);
+      q.delta = unit(rng);
+      q.gamma = 0.01 * unit(rng);
+      q.vega = 30.0 * unit(rng);
+      q.status = "OK";
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < kQuotes; ++i) {
+      book.on_quote(quotes[i % quotes.size()]);
+    }
+    const double incremental = std::chrono::duration<double, std::nano>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count() /
+                               static_cast<double>(kQuotes);
+
+    // One full pass over the contributions, the floor for re-summing.
+    std::vector<double> contributions(size, 1.0);
+    const std::size_t passes = std::max<std::size_t>(1, 20'000'000 / size);
+    double sink = 0.0;
+    start = std::chrono::steady_clock::now();
+    for (std::size_t p = 0; p < passes; ++p) {
+      for (double c : contributions) {
+        sink += c;
+      }
+      contributions[p % size] += 1e-9;
+    }
+    const double resum = std::chrono::duration<double, std::nano>(
+                             std::chrono::steady_clock::now() - start)
+                             .count() /
+                         static_cast<double>(passes);
+
+    std::printf("positions=%-8zu on_quote %6.1f ns  full re-sum %10.1f ns  "
+                "(%.2f Mquotes/s)\n",
+                size, incremental, resum, 1e3 / incremental);
+    if (sink == 42.0) {
+      std::printf("%f", sink);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,169 @@
+#include "compiled_contract.hpp"
+#include "normal_cdf.hpp"
+#include "option_pricer.hpp"
+#include "vol_surface.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Per-tick cost of pricing a call from the raw bsm_params row versus from
+// the contract compiled at config load, for the price alone and with Greeks.
+// Ticks cycle through 1024 contracts on 8 expiries with fresh spots. The
+// kernels run once per normal CDF mode, and the CDFs are also timed on
+// their own, scalar and batched, as is the vol surface lookup: straight off
+// the splines and through the per-contract memo that a load goes through.
+
+namespace {
+
+constexpr std::size_t kContracts = 1024;
+constexpr std::size_t kTicks = 20'000'000;
+
+struct Tick {
+  std::size_t contract;
+  double spot;
+};
+
+template <typename Fn>
+void run(const char *name, const std::vector<Tick> &ticks, Fn &&fn) {
+  double sink = 0.0;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < kTicks; ++i) {
+    const Tick &t = ticks[i % ticks.size()];
+    sink += fn(t.contract, t.spot);
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  std::cout << name << ": " << elapsed / static_cast<double>(kTicks)
+            << " ns/tick\n";
+  if (sink == 42.0) {
+    std::cout << sink;
+  }
+}
+
+void run_kernels(const std::vector<BsmParams> &rows,
+                 const std::vector<CompiledContract> &compiled,
+                 const std::vector<Tick> &ticks) {
+  run("black_scholes_call        ", ticks, [&](std::size_t c, double S) {
+    const BsmParams &p = rows[c];
+    return OptionPricer::black_scholes_call(S, p.K, p.r, p.q, p.sigma, p.T);
+  });
+  run("price_call (compiled)     ", ticks, [&](std::size_t c, double S) {
+    return price_call(compiled[c], S);
+  });
+  run("black_scholes_call_greeks ", ticks, [&](std::size_t c, double S) {
+    const BsmParams &p = rows[c];
+    return OptionPricer::black_scholes_call_greeks(S, p.K, p.r, p.q, p.sigma,
+                                                   p.T)
+        .delta;
+  });
+  run("call_greeks (compiled)    ", ticks, [&](std::size_t c, double S) {
+    return call_greeks(compiled[c], S).delta;
+  });
+}
+
+void run_cdfs(const std::vector<Tick> &ticks) {
+  // Spots mapped onto [-6, 6) stand in for d1/d2 values.
+  auto arg = [](double S) { return (S - 100.0) / 5.0; };
+  run("exact_normal_cdf          ", ticks,
+      [&](std::size_t, double S) { return exact_normal_cdf(arg(S)); });
+  run("fast_normal_cdf           ", ticks,
+      [&](std::size_t, double S) { return fast_normal_cdf(arg(S)); });
+
+  std::vector<double> xs(ticks.size());
+  for (std::size_t i = 0; i < ticks.size(); ++i) {
+    xs[i] = arg(ticks[i].spot);
+  }
+  std::vector<double> out(xs.size());
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t done = 0; done < kTicks; done += xs.size()) {
+    fast_normal_cdf_batch(xs.data(), out.data(), xs.size());
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  std::cout << "fast_normal_cdf_batch     : "
+            << elapsed / static_cast<double>(kTicks) << " ns/value\n";
+  if (out[7] == 42.0) {
+    std::cout << out[7];
+  }
+}
+
+void run_surface(const std::vector<BsmParams> &rows,
+                 const std::vector<Tick> &ticks) {
+  std::vector<VolPoint> points;
+  const double maturities[] = {0.02, 0.08, 0.17, 0.25, 0.5,
+                               0.75, 1.0,  1.5,  2.0,  3.0};
+  for (double T : maturities) {
+    for (int i = 0; i <= 20; ++i) {
+      const double K = 70.0 + 3.0 * i;
+      const double m = std::log(K / 100.0);
+      points.push_back(VolPoint{1, K, T, 0.2 + 0.3 * m * m - 0.05 * m});
+    }
+  }
+  const VolSurface surface(points);
+  VolSurfaceSet set;
+  set.update(points);
+
+  run("VolSurface::sigma         ", ticks, [&](std::size_t c, double) {
+    return surface.sigma(rows[c].K, rows[c].T);
+  });
+  double sigma = 0.0;
+  run("VolSurfaceSet::sigma (memo)", ticks, [&](std::size_t c, double) {
+    set.sigma(1, rows[c].K, rows[c].T, sigma);
+    return sigma;
+  });
+}
+
+} // namespace
+
+int main() {
+  std::mt19937_64 rng(7);
+  std::uniform_real_distribution<double> strike(80.0, 120.0);
+  std::uniform_real_distribution<double> vol(0.1, 0.6);
+  std::uniform_real_distribution<double> spot(70.0, 130.0);
+  const double maturities[] = {0.08, 0.25, 0.5, 0.75, 1.0, 1.5, 2.0, 3.0};
+
+  std::vector<BsmParams> rows(kContracts);
+  for (std::size_t i = 0; i < kContracts; ++i) {
+    BsmParams &p = rows[i];
+    p.K = strike(rng);
+    p.r = 0.05;
+    p.q = 0.01;
+    p.sigma = vol(rng);
+    p.T = maturities[i % 8];
+    p.ticker_id = static_cast<long long>(i);
+    p.conf_id = 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  ContractCompiler compiler;
+  std::vector<CompiledContract> compiled;
+  compiled.reserve(kContracts);
+  for (const auto &p : rows) {
+    compiled.push_back(compiler.compile(p));
+  }
+  auto compile_us = std::chrono::duration<double, std::micro>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  std::cout << "compiled " << kContracts << " contracts ("
+            << compiler.distinct_factors() << " discount factor sets) in "
+            << compile_us << " us\n";
+
+  std::vector<Tick> ticks(1 << 16);
+  for (std::size_t i = 0; i < ticks.size(); ++i) {
+    ticks[i] = Tick{rng() % kContracts, spot(rng)};
+  }
+
+  run_cdfs(ticks);
+  run_surface(rows, ticks);
+  for (CdfMode mode : {CdfMode::Exact, CdfMode::Fast}) {
+    OptionPricer::set_cdf_mode(mode);
+    std::cout << (mode == CdfMode::Exact ? "-- exact CDF\n" : "-- fast CDF\n");
+    run_kernels(rows, compiled, ticks);
+  }
+  return 0;
+}
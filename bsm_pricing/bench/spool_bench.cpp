@@ -0,0 +1,64 @@
+#include "quote_spool.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Append rate of the quote spool, which the DB thread pays per quote while
+// Postgres is down, and the rate its segments are read back at for replay.
+// The replay insert itself needs a server and is logged by SpoolReplayer.
+
+namespace {
+
+constexpr std::size_t kQuotes = 5'000'000;
+
+} // namespace
+
+int main() {
+  const std::string dir =
+      (std::filesystem::temp_directory_path() / "bsm_spool_bench").string();
+  std::filesystem::remove_all(dir);
+
+  std::vector<std::string> segments;
+  {
+    QuoteSpool spool(dir);
+    OptionQuote q;
+    q.ticker_id = 7;
+    q.status = "OK";
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < kQuotes; ++i) {
+      q.timestamp = 1700000000 + static_cast<long long>(i / 1000);
+      q.conf_id = static_cast<long long>(i % 1000);
+      q.underlying_price = 250.0 + 1e-3 * (i % 97);
+      q.option_price = 10.0 + 1e-3 * (i % 89);
+      spool.append(q);
+    }
+    const double append_ns = std::chrono::duration<double, std::nano>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count() /
+                             static_cast<double>(kQuotes);
+    segments = spool.seal_and_list();
+    std::printf("append   %8.1f ns/quote  %6.2f M quotes/s  %zu segments\n",
+                append_ns, 1e3 / append_ns, segments.size());
+  }
+
+  std::vector<SpoolRecord> records;
+  records.reserve(kSpoolSegmentRecords);
+  std::size_t read = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const std::string &path : segments) {
+    records.clear();
+    QuoteSpool::read_segment(path, records);
+    read += records.size();
+  }
+  const double read_ms = std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  std::printf("read     %8.1f ms        %6.2f M records/s (%zu records)\n",
+              read_ms, read / read_ms / 1e3, read);
+
+  std::filesystem::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include "option_pricer.hpp"
+#include "tick_store.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Compression ratio, append cost and query latency of the TickStore on a
+// feed-like stream: 1000 contracts on 100 underlyings ticking about once a
+// second, spots on a 0.01 grid, prices from Black-Scholes. Latencies are
+// per query, including the JSON reply the socket would send.
+
+namespace {
+
+constexpr long long kContracts = 1000;
+constexpr std::size_t kTicksPerContract = 4000;
+constexpr int kQueries = 2000;
+
+template <typename F> double time_us(F &&f) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kQueries; ++i) {
+    f(i);
+  }
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         kQueries;
+}
+
+} // namespace
+
+int main() {
+  for (std::size_t chunk_points : {64u, 256u, 1024u}) {
+    TickStoreConfig config;
+    config.chunk_points = chunk_points;
+    config.memory_budget_bytes = std::size_t{1} << 30;
+    TickStore store(config);
+
+    std::mt19937_64 rng(4);
+    std::normal_distribution<double> move(0.0, 0.03);
+    std::vector<double> spots(100, 250.0);
+    std::vector<std::int64_t> ts(kContracts, 1700000000);
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t t = 0; t < kTicksPerContract; ++t) {
+      for (double &s : spots) {
+        s = std::round((s + move(rng)) * 100.0) / 100.0;
+      }
+      for (long long c = 0; c < kContracts; ++c) {
+        ts[c] += rng() % 8 == 0 ? 2 : 1;
+        const double spot = spots[c % 100];
+        const double strike = 200.0 + 10.0 * (c / 100);
+        store.append(c, ts[c], spot,
+                     OptionPricer::black_scholes_call(spot, strike, 0.05, 0.0,
+                                                      0.3, 0.5));
+      }
+    }
+    // Includes pricing, as the service pays it too; see pricing benches.
+    const double append_ns = std::chrono::duration<double, std::nano>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count() /
+                             static_cast<double>(kContracts * kTicksPerContract);
+
+    const TickStoreStats st = store.stats();
+    const double last_us = time_us([&](int i) {
+      tick_query_reply(store, "last " + std::to_string(i % kContracts) + " 100");
+    });
+    const double range_us = time_us([&](int i) {
+      const long long c = i % kContracts;
+      const std::int64_t from = 1700000000 + 1000 + (i * 37) % 2000;
+      tick_query_reply(store, "range " + std::to_string(c) + " " +
+                                  std::to_string(from) + " " +
+                                  std::to_string(from + 300));
+    });
+
+    std::printf("chunk %5zu  %5.2f bytes/point  ratio %4.2fx  "
+                "append+price %5.0f ns  last 100 %6.1f us  "
+                "5-min range %6.1f us\n",
+                chunk_points, static_cast<double>(st.bytes) / st.points,
+                static_cast<double>(st.raw_bytes) / st.bytes, append_ns,
+                last_us, range_us);
+  }
+  return 0;
+}
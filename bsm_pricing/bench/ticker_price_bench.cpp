@@ -0,0 +1,160 @@
+#include <postgresql/libpq-fe.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+// Single-row insert rate into ticker_price-shaped tables already holding
+// `rows` rows (default 100M, spread over the last 30 days): the old heap
+// table with its bigserial key and unique btree, the daily-partitioned
+// table through the parent, and straight into today's partition, as
+// PostgresWriter does. Needs a server; everything lives in a scratch
+// schema tp_bench that is dropped at the end.
+//
+//   ticker_price_bench CONNINFO [rows] [inserts]
+
+namespace {
+
+constexpr int kSeedDays = 30;
+constexpr long long kSeedChunk = 10'000'000;
+
+bool exec(PGconn *conn, const std::string &sql) {
+  PGresult *res = PQexec(conn, sql.c_str());
+  const ExecStatusType status = PQresultStatus(res);
+  const bool ok = status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK;
+  if (!ok) {
+    std::fprintf(stderr, "%s\n%s", sql.c_str(), PQerrorMessage(conn));
+  }
+  PQclear(res);
+  return ok;
+}
+
+std::string columns() {
+  return "(ts_exchange timestamptz NOT NULL, ticker_id bigint NOT NULL, "
+         "conf_id bigint NOT NULL, base_price double precision, "
+         "calculated_price double precision NOT NULL, "
+         "created_at timestamptz NOT NULL DEFAULT now())";
+}
+
+bool create_tables(PGconn *conn) {
+  if (!exec(conn, "DROP SCHEMA IF EXISTS tp_bench CASCADE; "
+                  "CREATE SCHEMA tp_bench;") ||
+      !exec(conn, "CREATE TABLE tp_bench.heap (id bigserial PRIMARY KEY, " +
+                      columns().substr(1) + ";") ||
+      !exec(conn, "CREATE UNIQUE INDEX ON tp_bench.heap "
+                  "(ts_exchange, ticker_id, conf_id);") ||
+      !exec(conn, "CREATE TABLE tp_bench.part " + columns() +
+                      " PARTITION BY RANGE (ts_exchange);") ||
+      !exec(conn, "CREATE UNIQUE INDEX ON tp_bench.part "
+                  "(ts_exchange, ticker_id, conf_id);") ||
+      !exec(conn,
+            "CREATE INDEX ON tp_bench.part USING brin (ts_exchange);")) {
+    return false;
+  }
+  // One partition per UTC day, from the first seeded day through tomorrow.
+  return exec(conn,
+              "DO $$ DECLARE today date := (now() AT TIME ZONE 'UTC')::date; "
+              "BEGIN FOR i IN -" +
+                  std::to_string(kSeedDays) +
+                  "..1 LOOP EXECUTE format('CREATE TABLE tp_bench.%I "
+                  "PARTITION OF tp_bench.part FOR VALUES FROM (%L) TO (%L)', "
+                  "'p' || to_char(today + i, 'YYYYMMDD'), "
+                  "(today + i)::timestamp AT TIME ZONE 'UTC', "
+                  "(today + i + 1)::timestamp AT TIME ZONE 'UTC'); "
+                  "END LOOP; END $$;");
+}
+
+bool seed(PGconn *conn, const std::string &table, long long rows) {
+  // Rows in time order over the seeded days, as the feed writes them.
+  const std::string span = std::to_string(kSeedDays * 86400.0 / rows);
+  for (long long begin = 1; begin <= rows; begin += kSeedChunk) {
+    const long long end = std::min(rows, begin + kSeedChunk - 1);
+    if (!exec(conn,
+              "INSERT INTO " + table +
+                  " (ts_exchange, ticker_id, conf_id, base_price, "
+                  "calculated_price) "
+                  "SELECT date_trunc('day', now() AT TIME ZONE 'UTC') "
+                  "AT TIME ZONE 'UTC' - interval '" +
+                  std::to_string(kSeedDays) +
+                  " days' + g * " + span +
+                  " * interval '1 second', g % 500, g, 100.0, 1.0 "
+                  "FROM generate_series(" +
+                  std::to_string(begin) + ", " + std::to_string(end) +
+                  ") AS g;")) {
+      return false;
+    }
+  }
+  return exec(conn, "VACUUM ANALYZE " + table + ";");
+}
+
+void run_inserts(PGconn *conn, const char *label, const std::string &table,
+                 long long first_conf, long long inserts) {
+  const std::string sql =
+      "INSERT INTO " + table +
+      " (ts_exchange, ticker_id, conf_id, base_price, calculated_price) "
+      "VALUES (to_timestamp($1), $2::bigint, $3::bigint, "
+      "$4::double precision, $5::double precision);";
+  const long long now_sec = static_cast<long long>(std::time(nullptr));
+  long long failed = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (long long i = 0; i < inserts; ++i) {
+    const std::string ts = std::to_string(now_sec);
+    const std::string ticker = std::to_string(i % 500);
+    const std::string conf = std::to_string(first_conf + i);
+    const char *values[5] = {ts.c_str(), ticker.c_str(), conf.c_str(),
+                             "100.0", "1.0"};
+    PGresult *res = PQexecParams(conn, sql.c_str(), 5, nullptr, values,
+                                 nullptr, nullptr, 0);
+    failed += PQresultStatus(res) != PGRES_COMMAND_OK;
+    PQclear(res);
+  }
+  const double sec = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+  std::printf("%-22s %9.0f rows/s  %7.1f us/row  (%lld failed)\n", label,
+              inserts / sec, sec * 1e6 / inserts, failed);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s CONNINFO [rows] [inserts]\n", argv[0]);
+    return 1;
+  }
+  const long long rows = argc > 2 ? std::atoll(argv[2]) : 100'000'000;
+  const long long inserts = argc > 3 ? std::atoll(argv[3]) : 200'000;
+
+  PGconn *conn = PQconnectdb(argv[1]);
+  if (PQstatus(conn) != CONNECTION_OK) {
+    std::fprintf(stderr, "%s", PQerrorMessage(conn));
+    PQfinish(conn);
+    return 1;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  if (!create_tables(conn) || !seed(conn, "tp_bench.heap", rows) ||
+      !seed(conn, "tp_bench.part", rows)) {
+    PQfinish(conn);
+    return 1;
+  }
+  std::printf("seeded %lld rows per table in %.0f s\n", rows,
+              std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            start)
+                  .count());
+
+  char today[32];
+  const std::time_t t = std::time(nullptr);
+  std::strftime(today, sizeof(today), "tp_bench.p%Y%m%d", std::gmtime(&t));
+  run_inserts(conn, "heap", "tp_bench.heap", rows + 1, inserts);
+  run_inserts(conn, "partitioned, parent", "tp_bench.part", rows + 1, inserts);
+  run_inserts(conn, "partitioned, direct", today, rows + inserts + 1,
+              inserts);
+
+  exec(conn, "DROP SCHEMA tp_bench CASCADE;");
+  PQfinish(conn);
+  return 0;
+}
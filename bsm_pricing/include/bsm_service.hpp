@@ -1,12 +1,31 @@
 #pragma once
 
+#include "columnar_sink.hpp"
+#include "compiled_contract.hpp"
+#include "heston.hpp"
 #include "messages.hpp"
 #include "option_pricer.hpp"
+#include "position_book.hpp"
+#include "position_query_server.hpp"
 #include "postgres_writer.hpp"
 #include "price_pipe.hpp"
+#include "quote_spool.hpp"
+#include "realized_vol.hpp"
+#include "scenario_engine.hpp"
+#include "smile_calibration.hpp"
+#include "thread_pool.hpp"
+#include "tick_store.hpp"
+#include "vol_surface.hpp"
 
+#include <postgresql/libpq-fe.h>
+
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -17,40 +36,235 @@
 
 class BsmService {
 public:
+  using QuoteSink = std::function<void(const OptionQuote &)>;
+
+  // Reads newline-delimited JSON updates, as produced by api_cli over a FIFO.
   BsmService(PricePipe<std::string> &json_pipe, std::size_t num_threads,
              const std::string &conninfo);
 
+  // Embedded mode: updates arrive already typed through submit().
+  BsmService(std::size_t num_threads, const std::string &conninfo);
+
   ~BsmService();
 
+  // Loads parameters before any worker runs: from the snapshot when one is
+  // set and readable (the live load then follows in the background),
+  // otherwise with one blocking, connect-timeout-bounded database query.
   void start();
   void stop();
 
+  // Restricts the parameter load to the tickers this instance owns on the
+  // shard ring, plus any ticker that gets routed here after a rebalance, for
+  // as long as it keeps ticking here.
+  void set_shard(int shard_id, int shard_count);
+
+  // Hands typed updates straight to the workers, waiting while the target
+  // worker's bounded queue is full. Every update of one ticker goes to the
+  // same worker, so a ticker's ticks are priced in the order submitted.
+  // Safe to call from any thread once start() has run.
+  void submit(PriceUpdateIn update);
+  void submit(std::vector<PriceUpdateIn> &updates);
+
+  // Replaces the database/stdout stage with a callback on the writer thread.
+  // Must be set before start().
+  void set_quote_sink(QuoteSink sink);
+
+  // Every successful parameter load is also written here, and start() comes
+  // up from this file without waiting on Postgres. Must be set before
+  // start().
+  void set_params_snapshot(const std::string &path);
+
+  // Ticks dropped because their ticker had no parameters loaded yet.
+  std::uint64_t dropped_no_params() const { return dropped_no_params_.load(); }
+
+  // A tick prices every contract loaded for its ticker, one quote each.
+  // Each contract remembers its last spot and result until the next
+  // parameter load; a tick at the same spot reuses the price and Greeks.
+  // With skip_unchanged_writes such a contract produces no quote at all,
+  // since the previous one already carried the same output. Must be set
+  // before start().
+  void set_skip_unchanged_writes(bool skip) { skip_unchanged_writes_ = skip; }
+
+  // Every interval_sec, revalues each loaded contract that has seen a tick
+  // over `grid` from its last spot, on a pool of `threads`, and writes the
+  // per-ticker P&L report to `path` (see scenario_engine.hpp). Must be set
+  // before start().
+  void set_scenario_report(const std::string &path, const ScenarioGrid &grid,
+                           int interval_sec, std::size_t threads);
+  std::uint64_t scenario_runs() const { return scenario_runs_.load(); }
+
+  // Each parameter load hands option_quote to a calibration thread, which
+  // fits an SVI smile to every (ticker, maturity) slice, refitting only
+  // slices whose quotes changed, on a pool of `threads` (see
+  // smile_calibration.hpp), and then republishes the loaded rows with the
+  // new smiles. Reloads never wait for it. Must be set before start().
+  void set_calibration_threads(std::size_t threads);
+  std::uint64_t calibration_cycles() const {
+    return calibration_cycles_.load();
+  }
+  // Wall time of the most recent calibration cycle.
+  double last_calibration_ms() const { return last_calibration_ms_.load(); }
+
+  // Rows of position are loaded with the parameters, and every OK quote
+  // updates their running exposure in O(1) (see position_book.hpp). With
+  // a socket path, start() also serves the aggregates there (see
+  // position_query_server.hpp). Must be set before start().
+  void set_position_socket(const std::string &path);
+  const PositionBook &position_book() const { return positions_; }
+
+  // Every OK tick feeds a per-ticker realized vol estimate (see
+  // realized_vol.hpp), which rows with a realized vol_source price with
+  // once it is ready. Every interval_sec (0: never) the estimates of loaded
+  // tickers are upserted into realized_vol. Must be set before start().
+  void set_realized_vol(const RealizedVolConfig &config, int persist_sec);
+  const RealizedVolBook &realized_vol() const { return *realized_; }
+
+  // Quotes the writer cannot store while Postgres is down go to a spool in
+  // `dir` instead of stdout, and a background replayer bulk-inserts them
+  // once it is back (see quote_spool.hpp). Must be set before start().
+  void set_quote_spool(const std::string &dir);
+  std::uint64_t spooled_quotes() const {
+    return spool_ ? spool_->appended() : 0;
+  }
+  // Quotes the writer could not store in Postgres: spooled when a spool is
+  // set, otherwise printed to stdout and lost to the database.
+  std::uint64_t failed_writes() const { return failed_writes_.load(); }
+
+  // Quotes also go to columnar files (see columnar_sink.hpp), or, with
+  // exclusive, only there and not to Postgres. The file prefix is taken
+  // from the shard. Must be set before start().
+  void set_columnar_sink(const ColumnarSinkConfig &config, bool exclusive);
+  const ColumnarSink *columnar_sink() const { return columnar_.get(); }
+
+  // Every OK quote's spot and price go into a compressed per-contract
+  // history (see tick_store.hpp), queried on a Unix socket at
+  // socket_path when it is not empty. Must be set before start().
+  void set_tick_store(const TickStoreConfig &config,
+                      const std::string &socket_path);
+  const TickStore *tick_store() const { return ticks_.get(); }
+
+  // Keeps ticker_price's upcoming daily partitions created (see migration
+  // 016) and, with days > 0, drops partitions older than that. Runs hourly
+  // from the config thread of every shard; the SQL functions serialize on an
+  // advisory lock, so any one live shard is enough. Must be set before
+  // start().
+  void set_ticker_price_retention(int days);
+
+  std::uint64_t cache_hits() const { return cache_hits_.load(); }
+  std::uint64_t cache_misses() const { return cache_misses_.load(); }
+  std::uint64_t skipped_writes() const { return skipped_writes_.load(); }
+
+  // Adds the contract to the ticker's, or replaces the one with its conf_id.
   void set_params_for_testing(const std::string &ticker, double K, double r,
                               double q, double sigma, double T,
                               long long ticker_id, long long conf_id);
+  void set_params_for_testing(const std::string &ticker, const BsmParams &p);
+  void set_positions_for_testing(const std::vector<Position> &positions);
 
 private:
-  struct BsmParams {
-    double K;
-    double r;
-    double q;
-    double sigma;
-    double T;
+  struct Contract {
+    CompiledContract call;
+    PricingModel model;
+    std::uint32_t lattice_steps;
+    HestonParams heston_params;
+    std::shared_ptr<const HestonSlice> heston; // set for Heston only
     long long ticker_id;
     long long conf_id;
+    VolSource vol_source;
   };
 
-  void worker_thread();
+  struct CachedPrice {
+    double spot;
+    double sigma;
+    CallGreeks result;
+  };
+
+  // One ticker's contracts, in conf_id order, and beside each its last spot,
+  // sigma and result (NaN spot: none). Immutable once published but for the
+  // cache, which only the worker the ticker routes to reads or writes.
+  struct TickerParams {
+    std::vector<Contract> contracts;
+    bool adopted{false}; // from another shard; its ticks keep the adoption
+    mutable std::vector<CachedPrice> cache;
+  };
+  using ParamsSet =
+      std::unordered_map<std::string, std::shared_ptr<const TickerParams>>;
+
+  // Heston contracts with the same rates, maturity and model parameters
+  // share one compiled slice: the strikes of a maturity.
+  using HestonSlices =
+      std::map<std::array<double, 8>, std::shared_ptr<const HestonSlice>>;
+
+  static Contract make_contract(ContractCompiler &compiler,
+                                HestonSlices &slices, const BsmParams &p);
+  // Closed form for Bsm contracts (compiled unless sigma differs from the
+  // row's), the lattice for the American models, the precompiled
+  // quadrature for Heston, which ignores sigma.
+  static CallGreeks price(const Contract &contract, double spot,
+                          double sigma);
+  // Prices the Heston contracts at `pending` (indices into contracts) with
+  // one batch call per shared slice, into results.
+  static void price_heston(const std::vector<Contract> &contracts,
+                           std::vector<std::size_t> &pending, double spot,
+                           std::vector<CallGreeks> &results);
+  // The row's sigma, or the realized estimate its vol_source asks for.
+  static double effective_sigma(const Contract &contract,
+                                const RealizedVol &realized);
+
+  void install_params(std::unordered_map<long long, BsmParams> params);
+  // Makes set the published params. Caller holds params_mutex_.
+  void publish_params_set(ParamsSet set);
+  static std::shared_ptr<const TickerParams>
+  make_ticker_params(std::vector<Contract> contracts, bool adopted);
+  struct WorkQueue;
+  void worker_thread(WorkQueue &queue);
   void dispatcher_thread();
-  void config_thread();
+  void config_thread(PGconn *conn, bool loaded);
   void db_thread();
+  void scenario_thread();
+  bool refresh_params(PGconn *&conn);
+  void calibration_thread();
+  // Applies the published smiles, snapshots and installs. Under
+  // calibration_mutex_.
+  std::size_t publish_params(std::unordered_map<long long, BsmParams> params);
+  // Every ticker's rows, or only those in ticker_ids (a bigint[] literal)
+  // when it is not empty.
+  bool load_params(PGconn *conn, const std::string &ticker_ids,
+                   std::unordered_map<long long, BsmParams> &params);
+  // Loads and installs the rows of newly adopted tickers without a full
+  // reload.
+  bool adopt_tickers(PGconn *conn, const std::vector<long long> &ticker_ids);
+  bool load_vol_surface_points(PGconn *conn, const std::string &ticker_ids,
+                               std::vector<VolPoint> &points);
+  bool load_option_quotes(PGconn *conn, const std::string &ticker_ids,
+                          std::vector<OptionQuotePoint> &quotes);
+  bool load_positions(PGconn *conn, const std::string &ticker_ids,
+                      std::vector<Position> &positions);
+  bool load_owned_ticker_ids(PGconn *conn, std::string &ids);
+  void persist_realized_vol(PGconn *conn);
+  // Feeds a quote leaving db_thread to the in-process consumers.
+  void record_quote(const OptionQuote &q);
+  void maintain_ticker_price(PGconn *conn);
+  void wait_for_retry();
+  WorkQueue &queue_for(const std::string &ticker);
+  // False once the queue is closed. Called with queue.mutex held.
+  static bool wait_for_room(WorkQueue &queue,
+                            std::unique_lock<std::mutex> &lock);
+  void close_queues();
 
-  PricePipe<std::string> &json_pipe_;
+  PricePipe<std::string> *json_pipe_{nullptr};
+  QuoteSink quote_sink_;
 
-  std::queue<std::string> queue_;
-  std::mutex queue_mutex_;
-  std::condition_variable queue_cv_;
-  bool queue_closed_{false};
+  // One per worker, by ticker hash. Bounded: producers wait on room_cv
+  // while it is full.
+  struct WorkQueue {
+    std::queue<PriceUpdateIn> items;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::condition_variable room_cv;
+    bool closed{false};
+  };
+  std::vector<std::unique_ptr<WorkQueue>> queues_;
 
   std::queue<OptionQuote> out_queue_;
   std::mutex out_mutex_;
@@ -60,10 +274,94 @@ private:
 
   std::size_t num_threads_;
 
-  std::unordered_map<std::string, BsmParams> params_;
+  // Every loaded contract, by the ticker whose ticks price it. A change
+  // publishes a new set, sharing the tickers it leaves alone (and their
+  // cached prices), then bumps params_version_; a worker keeps its own
+  // pointer and only takes params_mutex_ to refresh it when the version
+  // moves. params_, last_spots_ and the adoption state are under
+  // params_mutex_.
+  std::shared_ptr<const ParamsSet> params_{std::make_shared<ParamsSet>()};
+  std::atomic<std::uint64_t> params_version_{0};
+  std::unordered_map<std::string, double> last_spots_; // survives reloads
+  // Sharded only: every ticker table name to its id, as of the last full
+  // load, and the tickers adopted from other shards with their last tick.
+  std::unordered_map<std::string, long long> known_tickers_;
+  std::unordered_map<std::string, std::chrono::steady_clock::time_point>
+      adopted_tickers_;
   std::mutex params_mutex_;
 
+  bool skip_unchanged_writes_{false};
+  std::atomic<std::uint64_t> cache_hits_{0};
+  std::atomic<std::uint64_t> cache_misses_{0};
+  std::atomic<std::uint64_t> skipped_writes_{0};
+  std::atomic<std::uint64_t> failed_writes_{0};
+
+  // Rows whose ticker has points in vol_surface_point take their sigma from
+  // the surface, resolved at load; the tick path never sees the surface.
+  // Only used by whichever thread runs refresh_params.
+  VolSurfaceSet surfaces_;
+
+  // Rows whose ticker has a calibrated smile take their sigma from it,
+  // over any surface. calibration_thread owns the calibrator and its pool,
+  // created with the first quotes, and publishes a copy as smiles_. The
+  // latest load (before smiles), its pending quotes and smiles_ are under
+  // calibration_mutex_.
+  std::size_t calibration_threads_{1};
+  std::unique_ptr<ThreadPool> calibration_pool_;
+  std::unique_ptr<SmileCalibrator> calibrator_;
+  std::shared_ptr<const SmileCalibrator> smiles_;
+  std::unordered_map<long long, BsmParams> loaded_params_;
+  std::vector<OptionQuotePoint> pending_quotes_;
+  bool quotes_pending_{false};
+  std::mutex calibration_mutex_;
+  std::condition_variable calibration_cv_;
+  std::atomic<std::uint64_t> calibration_cycles_{0};
+  std::atomic<double> last_calibration_ms_{0.0};
+
+  // Replaced on each parameter load, updated by the workers as they price.
+  PositionBook positions_;
+  std::string position_socket_path_;
+  std::unique_ptr<PositionQueryServer> position_server_;
+
+  std::unique_ptr<RealizedVolBook> realized_{
+      std::make_unique<RealizedVolBook>()};
+  int realized_persist_sec_{60};
+  std::chrono::steady_clock::time_point last_realized_persist_{};
+
+  // Created by start() when a spool dir is set; db_thread appends to it.
+  std::string spool_dir_;
+  std::unique_ptr<QuoteSpool> spool_;
+  std::unique_ptr<SpoolReplayer> replayer_;
+
+  ColumnarSinkConfig columnar_config_;
+  bool columnar_only_{false};
+  std::unique_ptr<ColumnarSink> columnar_;
+
+  std::unique_ptr<TickStore> ticks_;
+  std::string tick_socket_path_;
+  std::unique_ptr<TickQueryServer> tick_server_;
+
+  int retention_days_{0};
+  std::chrono::steady_clock::time_point last_partition_maintenance_{};
+  bool partitions_maintained_{false};
+
+  std::string scenario_path_;
+  ScenarioGrid scenario_grid_;
+  int scenario_interval_sec_{5};
+  std::size_t scenario_threads_{1};
+  std::atomic<std::uint64_t> scenario_runs_{0};
+
   std::string conninfo_;
+  std::string snapshot_path_;
+  std::atomic<std::uint64_t> dropped_no_params_{0};
+
+  int shard_id_{0};
+  int shard_count_{1};
+  // Ticker ids adopted since config_thread last looked.
+  std::vector<long long> pending_adoptions_;
+  bool reload_requested_{false};
+  std::mutex config_mutex_;
+  std::condition_variable config_cv_;
 
   int reload_interval_sec_{5};
 
@@ -72,4 +370,6 @@ private:
   std::thread dispatcher_thread_;
   std::thread db_thread_;
   std::thread config_thread_;
+  std::thread calibration_thread_;
+  std::thread scenario_thread_;
 };
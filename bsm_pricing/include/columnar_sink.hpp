@@ -0,0 +1,115 @@
+#pragma once
+
+#include "messages.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct ColumnarSinkConfig {
+  std::string dir;
+  // Files are "<prefix>_<seq>.bsmcol"; give each writer its own prefix.
+  std::string prefix{"quotes"};
+  // A batch is flushed at this many rows or this age, whichever is first.
+  std::size_t batch_rows{65536};
+  int flush_ms{1000};
+  // A file is closed and the next one started at this many rows or age.
+  std::uint64_t file_rows{std::uint64_t{1} << 22};
+  int rotate_sec{300};
+};
+
+// Columnar file layout, all little-endian. A file is a 16-byte header
+// (magic "BSMCOL01", creation time in epoch seconds) and then batches. A
+// batch is a 64-byte header (magic "BTCH", rows, dictionary sizes, index
+// widths, the byte length of each column) and then kColumnarColumns
+// columns, each zero-padded to 8 bytes so the double columns can be mapped
+// and read in place:
+//   timestamp      int64 first value, then zigzag LEB128 deltas
+//   ticker_id      int64 dictionary, then 1/2/4-byte indices into it
+//   conf_id        int64 dictionary, then 1/2/4-byte indices into it
+//   underlying_price, option_price, delta, gamma, vega, theta, rho
+//                  raw float64
+// Only OK quotes are stored.
+constexpr std::size_t kColumnarColumns = 10;
+
+// Decodes every batch of a file; false if it is not a complete file.
+bool read_columnar_file(const std::string &path,
+                        std::vector<OptionQuote> &out);
+
+// Output sink that accumulates quotes into columnar batches and appends
+// them to rotating files in the layout above. The file being written is
+// "<name>.part" and is renamed once closed, so readers only ever see
+// complete files. append() only copies into the open batch; a full batch is
+// swapped for an empty one and encoded by the caller that filled it, a
+// stale one by a flusher thread, outside the append lock. The double
+// columns go from the batch to the file as they are (writev), only the
+// integer columns are encoded. Thread-safe.
+class ColumnarSink {
+public:
+  // Creates config.dir if needed; throws std::runtime_error if unusable.
+  explicit ColumnarSink(const ColumnarSinkConfig &config);
+  ~ColumnarSink();
+
+  ColumnarSink(const ColumnarSink &) = delete;
+  ColumnarSink &operator=(const ColumnarSink &) = delete;
+
+  void append(const OptionQuote &q);
+
+  // Writes the open batch and closes the current file.
+  void close();
+
+  std::uint64_t rows_written() const { return rows_written_.load(); }
+  std::uint64_t bytes_written() const { return bytes_written_.load(); }
+  std::uint64_t batches_written() const { return batches_written_.load(); }
+  std::uint64_t files_closed() const { return files_closed_.load(); }
+
+private:
+  struct Batch {
+    std::vector<std::int64_t> timestamp;
+    std::vector<std::int64_t> ticker_id;
+    std::vector<std::int64_t> conf_id;
+    std::vector<double> values[7];
+    std::chrono::steady_clock::time_point opened{};
+
+    std::size_t size() const { return timestamp.size(); }
+    void clear();
+  };
+
+  void flush(bool force);
+  void write_batch(Batch &batch);
+  bool open_file();
+  void close_file();
+  void flusher();
+
+  ColumnarSinkConfig config_;
+
+  std::mutex mutex_; // active_
+  Batch active_;
+
+  std::mutex io_mutex_; // spare_, the file and the encode buffers
+  Batch spare_;
+  int fd_{-1};
+  std::string path_;
+  std::uint64_t next_seq_{0};
+  std::uint64_t file_rows_{0};
+  std::chrono::steady_clock::time_point file_opened_{};
+  std::vector<std::uint8_t> encoded_[3];
+  std::unordered_map<std::int64_t, std::uint32_t> dict_;
+
+  std::mutex flusher_mutex_;
+  std::condition_variable flusher_cv_;
+  bool stopping_{false};
+  std::thread flusher_thread_;
+
+  std::atomic<std::uint64_t> rows_written_{0};
+  std::atomic<std::uint64_t> bytes_written_{0};
+  std::atomic<std::uint64_t> batches_written_{0};
+  std::atomic<std::uint64_t> files_closed_{0};
+};
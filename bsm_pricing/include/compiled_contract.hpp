@@ -0,0 +1,100 @@
+#pragma once
+
+#include "messages.hpp"
+#include "option_pricer.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+// Everything in a Black-Scholes call that depends only on the bsm_params row,
+// computed once at config load. What is left per tick is log(S), two CDFs and
+// a few multiply-adds (plus one exp for the Greeks).
+struct CompiledContract {
+  double K{};
+  double r{};
+  double q{};
+  double sigma{};
+  double T{};
+
+  double log_K{};
+  double drift{};           // (r - q + sigma^2 / 2) * T
+  double sigma_sqrtT{};
+  double inv_sigma_sqrtT{};
+  double sqrtT{};
+  double half_sigma_over_sqrtT{};
+  double df_q{};            // exp(-q T)
+  double K_df_r{};          // K exp(-r T)
+
+  bool valid{false};        // false prices to 0, as black_scholes_call does
+};
+
+// Compiles the rows of one parameter load. Rows that share maturity and
+// rates share one set of discount factors, so a load of many strikes on few
+// expiries costs few exp() calls.
+class ContractCompiler {
+public:
+  CompiledContract compile(const BsmParams &p);
+
+  std::size_t distinct_factors() const { return factors_.size(); }
+
+private:
+  struct Factors {
+    double sqrtT;
+    double df_r;
+    double df_q;
+  };
+
+  struct Key {
+    std::uint64_t T;
+    std::uint64_t r;
+    std::uint64_t q;
+    bool operator==(const Key &o) const {
+      return T == o.T && r == o.r && q == o.q;
+    }
+  };
+
+  struct KeyHash {
+    std::size_t operator()(const Key &k) const {
+      std::uint64_t h = k.T * 0x9e3779b97f4a7c15ULL;
+      h ^= k.r + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+      h ^= k.q + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+      return static_cast<std::size_t>(h);
+    }
+  };
+
+  std::unordered_map<Key, Factors, KeyHash> factors_;
+};
+
+inline double price_call(const CompiledContract &c, double S) {
+  if (!c.valid || S <= 0.0) {
+    return 0.0;
+  }
+  const double d1 = (std::log(S) - c.log_K + c.drift) * c.inv_sigma_sqrtT;
+  const double d2 = d1 - c.sigma_sqrtT;
+  return S * c.df_q * OptionPricer::normal_cdf(d1) -
+         c.K_df_r * OptionPricer::normal_cdf(d2);
+}
+
+inline CallGreeks call_greeks(const CompiledContract &c, double S) {
+  CallGreeks g;
+  if (!c.valid || S <= 0.0) {
+    return g;
+  }
+  const double d1 = (std::log(S) - c.log_K + c.drift) * c.inv_sigma_sqrtT;
+  const double d2 = d1 - c.sigma_sqrtT;
+  const double Nd1 = OptionPricer::normal_cdf(d1);
+  const double Nd2 = OptionPricer::normal_cdf(d2);
+  const double nd1 = OptionPricer::normal_pdf(d1);
+  const double S_df_q = S * c.df_q;
+
+  g.price = S_df_q * Nd1 - c.K_df_r * Nd2;
+  g.delta = c.df_q * Nd1;
+  g.gamma = c.df_q * nd1 * c.inv_sigma_sqrtT / S;
+  g.vega = S_df_q * nd1 * c.sqrtT;
+  g.theta = -S_df_q * nd1 * c.half_sigma_over_sqrtT - c.r * c.K_df_r * Nd2 +
+            c.q * S_df_q * Nd1;
+  g.rho = c.T * c.K_df_r * Nd2;
+  return g;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "messages.hpp"
+#include "option_pricer.hpp"
+
+#include <cstddef>
+
+// Heston European call by Lewis's single-integral formula,
+//
+//   C = S e^{-qT} - sqrt(S K) e^{-(r+q)T/2} / pi
+//         * int_0^inf Re[e^{iux} phi(u - i/2)] / (u^2 + 1/4) du,
+//   x = ln(S/K) + (r - q) T,
+//
+// with phi the characteristic function of the centred log-return, in the
+// branch-cut-safe form of Albrecher et al. The integral is a fixed
+// kHestonNodes-point Gauss-Legendre rule on [0, U], U chosen where the
+// integrand has decayed. Nothing under the integral but e^{iux} depends on
+// spot or strike, so compile_heston() folds phi, the node weights and the
+// denominator into one complex coefficient per node; a price is then one
+// sincos per node, vectorized across nodes.
+constexpr std::size_t kHestonNodes = 64;
+
+struct HestonSlice {
+  double r{};
+  double q{};
+  double T{};
+  double df_q{};        // exp(-qT)
+  double half_df{};     // exp(-(r+q)T/2) / pi
+  double sqrt_v0{};
+  double sigma_bar{};   // control variate vol: sqrt of mean expected variance
+  double theta_step{};  // maturity bump behind theta
+  double df_q_step{};   // the two discount factors at T - theta_step
+  double half_df_step{};
+  bool valid{false};    // false prices to 0
+
+  // Per node: u, then the coefficient c = w phi(u - i/2) / (u^2 + 1/4), its
+  // derivative in v0 and its value at T - theta_step (rotated so it takes
+  // the same e^{iux}).
+  alignas(32) double u[kHestonNodes];
+  alignas(32) double c_re[kHestonNodes];
+  alignas(32) double c_im[kHestonNodes];
+  alignas(32) double dv_re[kHestonNodes];
+  alignas(32) double dv_im[kHestonNodes];
+  alignas(32) double dt_re[kHestonNodes];
+  alignas(32) double dt_im[kHestonNodes];
+};
+
+// Invalid (zero) unless T > 0, kappa > 0, theta > 0, xi > 0, v0 >= 0 and
+// |rho| < 1. Costs 2 kHestonNodes characteristic-function evaluations;
+// strikes sharing model and maturity should share one slice.
+HestonSlice compile_heston(const HestonParams &p, double r, double q,
+                           double T);
+
+double heston_call(const HestonSlice &s, double S, double K);
+
+// Delta and gamma are exact for the quadrature; vega is per unit of
+// sqrt(v0), rho per unit of r with the slice held fixed, theta per year
+// from a forward step in maturity.
+CallGreeks heston_call_greeks(const HestonSlice &s, double S, double K);
+
+// out[i] = heston_call(s, S, K[i]): every strike of one maturity.
+void heston_call_batch(const HestonSlice &s, double S, const double *K,
+                       double *out, std::size_t n);
+// out[i] = heston_call_greeks(s, S, K[i]).
+void heston_call_greeks_batch(const HestonSlice &s, double S, const double *K,
+                              CallGreeks *out, std::size_t n);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "option_pricer.hpp"
+#include "thread_pool.hpp"
+
+#include <cstddef>
+
+enum class LatticeKind { Binomial, Trinomial };
+
+// Used when bsm_params.lattice_steps is unset. With the extrapolation below
+// 256 steps are within about 1e-4 of the converged price on typical
+// contracts (see lattice_bench).
+constexpr std::size_t kDefaultLatticeSteps = 256;
+
+struct LatticeContract {
+  double S{};
+  double K{};
+  double r{};
+  double q{};
+  double sigma{};
+  double T{};
+  std::size_t steps{kDefaultLatticeSteps}; // rounded up to even, at least 4
+  LatticeKind kind{LatticeKind::Binomial};
+};
+
+// American call by backward induction over one time slice at a time, in
+// O(steps) memory. The slice before expiry takes the Black-Scholes value
+// instead of the kinked payoff, and the result is Richardson-extrapolated
+// as 2 P(N) - P(N/2), which removes the leading 1/N error term.
+//
+// When q <= 0 and r >= 0 early exercise never pays, and both functions
+// return the closed-form European figures. Contracts black_scholes_call
+// would reject price to 0.
+double american_call(const LatticeContract &c);
+
+// Price as above; delta, gamma and theta from the first slices of the
+// N-step lattice; vega and rho by forward bumps of the extrapolated price.
+CallGreeks american_call_greeks(const LatticeContract &c);
+
+// out[i] = american_call(contracts[i]), contracts spread over the pool.
+void american_call_batch(ThreadPool &pool, const LatticeContract *contracts,
+                         std::size_t n, double *out);
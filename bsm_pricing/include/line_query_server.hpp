@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Unix domain socket server for one-line queries: a client sends one
+// request line and gets the handler's reply plus a newline back, then the
+// connection closes. Clients are served one at a time on the server's
+// thread; one that stalls is dropped after a second.
+class LineQueryServer {
+public:
+  using Handler = std::function<std::string(const std::string &request)>;
+
+  // `component` names the server in log lines.
+  LineQueryServer(std::string component, std::string path, Handler handler);
+  ~LineQueryServer();
+
+  // Replaces any stale socket file at the path. False if it cannot bind.
+  bool start();
+  void stop();
+
+  std::size_t requests() const { return requests_.load(); }
+
+private:
+  void accept_loop();
+  void serve_client(int fd);
+
+  std::string component_;
+  std::string path_;
+  Handler handler_;
+  int listen_fd_{-1};
+  std::atomic<bool> running_{false};
+  std::atomic<std::size_t> requests_{0};
+  std::thread thread_;
+};
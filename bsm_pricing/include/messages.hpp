@@ -16,8 +16,55 @@ struct OptionQuote {
   std::string ticker;
   double underlying_price{};
   double option_price{};
+  double delta{};
+  double gamma{};
+  double vega{};
+  double theta{};
+  double rho{};
   long long ticker_id{};
   long long conf_id{};
   std::string status;
   std::string error;
 };
+
+// bsm_params.model. Bsm is the closed-form European call; the lattice
+// models price the American call (see lattice.hpp), Heston the European
+// call under stochastic variance.
+enum class PricingModel : std::uint32_t {
+  Bsm = 0,
+  AmericanBinomial = 1,
+  AmericanTrinomial = 2,
+  Heston = 3,
+};
+
+// bsm_params.heston_* (see heston.hpp); only read for PricingModel::Heston.
+struct HestonParams {
+  double kappa{}; // mean reversion speed of the variance
+  double theta{}; // long-run variance
+  double xi{};    // vol of variance
+  double rho{};   // spot/variance correlation
+  double v0{};    // current variance
+};
+
+// bsm_params.vol_source: the row's own volatility, or the ticker's online
+// realized vol (see realized_vol.hpp) once it is ready. Heston ignores it.
+enum class VolSource : std::uint32_t {
+  Param = 0,
+  RealizedEwma = 1,
+  RealizedWindow = 2,
+};
+
+struct BsmParams {
+  double K{};
+  double r{};
+  double q{};
+  double sigma{};
+  double T{};
+  long long ticker_id{};
+  long long conf_id{};
+  PricingModel model{PricingModel::Bsm};
+  std::uint32_t lattice_steps{}; // 0: kDefaultLatticeSteps
+  HestonParams heston;
+  VolSource vol_source{VolSource::Param};
+  std::string ticker; // ticker.name; its ticks price every row that has it
+};
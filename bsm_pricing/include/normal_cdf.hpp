@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// Standard normal CDF, exact (std::erfc) and fast.
+//
+// The fast path interpolates a table of Phi and phi on [-8, 8] at a step of
+// 1/64 with cubic Hermite splines. Outside that range it returns Phi(+-8),
+// which is within 6.2e-16 of 0 or 1. The Hermite remainder bound
+// h^4/384 * max|Phi''''| is 2.1e-10 (a 1e-6 sweep measures 8.6e-11 near
+// |x| = 0.74); the unit tests sweep the domain against
+// kFastNormalCdfMaxError. NaN propagates.
+constexpr double kFastNormalCdfMaxError = 2.5e-10;
+
+double exact_normal_cdf(double x);
+double fast_normal_cdf(double x);
+
+// out[i] = fast_normal_cdf(x[i]). Uses AVX2 gathers when the CPU has them
+// (results may then differ from the scalar path in the last bit or two).
+// x and out may alias exactly.
+void fast_normal_cdf_batch(const double *x, double *out, std::size_t n);
+
+// Inverse of the standard normal CDF for p in (0, 1) (Acklam's rational
+// approximation, relative error below 1.2e-9). Meant for turning uniform
+// and Sobol draws into normals, where that accuracy is far inside sampling
+// noise. Returns -inf/+inf at 0/1.
+double inverse_normal_cdf(double p);
@@ -1,11 +1,37 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
+
+// Price and first-order sensitivities of a European call. theta is per
+// year; vega and rho are per unit (not per 1%) of sigma and r.
+struct CallGreeks {
+  double price{};
+  double delta{};
+  double gamma{};
+  double vega{};
+  double theta{};
+  double rho{};
+};
+
+enum class CdfMode { Exact, Fast };
 
 class OptionPricer {
 public:
+  // Which normal CDF the pricer uses (see normal_cdf.hpp). The default is
+  // Fast when built with BSM_FAST_NORMAL_CDF, Exact otherwise.
+  static void set_cdf_mode(CdfMode mode);
+  static CdfMode cdf_mode();
+
   static double normal_cdf(double x);
+  static void normal_cdf_batch(const double *x, double *out, std::size_t n);
+  static double normal_pdf(double x);
 
   static double black_scholes_call(double S, double K, double r, double q,
                                    double sigma, double T);
+
+  // Same price as black_scholes_call, plus Greeks from the shared d1/d2.
+  static CallGreeks black_scholes_call_greeks(double S, double K, double r,
+                                              double q, double sigma,
+                                              double T);
 };
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "messages.hpp"
+
+#include <string>
+#include <unordered_map>
+
+// On-disk copy of the last good parameter load, so a restart can price from
+// the first tick. Layout: a 24-byte header (magic "BSMPRM04", record count,
+// name bytes), one fixed 120-byte record per bsm_params row, then the ticker
+// names they point into. Rows are keyed by conf_id.
+// Files with another magic (older layouts) are ignored, not migrated.
+// The file is mapped, not parsed, on read; writes go to "<path>.tmp" and are
+// renamed into place, so a reader never sees a half-written snapshot.
+bool write_params_snapshot(
+    const std::string &path,
+    const std::unordered_map<long long, BsmParams> &params);
+
+// Replaces `params` only when the whole file validates.
+bool read_params_snapshot(const std::string &path,
+                          std::unordered_map<long long, BsmParams> &params);
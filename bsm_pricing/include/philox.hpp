@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+// 3"). A pure function of (counter, key): any thread can produce the numbers
+// for any path/step without sharing generator state, so Monte Carlo results
+// do not depend on how paths are split across threads.
+class Philox4x32 {
+public:
+  using Counter = std::array<std::uint32_t, 4>;
+  using Key = std::array<std::uint32_t, 2>;
+
+  static Counter generate(Counter ctr, Key key) {
+    for (int round = 0; round < 10; ++round) {
+      if (round > 0) {
+        key[0] += kWeyl0;
+        key[1] += kWeyl1;
+      }
+      const std::uint64_t p0 = static_cast<std::uint64_t>(kMul0) * ctr[0];
+      const std::uint64_t p1 = static_cast<std::uint64_t>(kMul1) * ctr[2];
+      ctr = {static_cast<std::uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0],
+             static_cast<std::uint32_t>(p1),
+             static_cast<std::uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1],
+             static_cast<std::uint32_t>(p0)};
+    }
+    return ctr;
+  }
+
+  // 52 random bits mapped into the open interval (0, 1); with 53 the top
+  // value would round up to 1.0.
+  static double to_unit(std::uint32_t hi, std::uint32_t lo) {
+    const std::uint64_t bits =
+        ((static_cast<std::uint64_t>(hi) << 32) | lo) >> 12;
+    return (static_cast<double>(bits) + 0.5) * (1.0 / 4503599627370496.0);
+  }
+
+private:
+  static constexpr std::uint32_t kMul0 = 0xD2511F53;
+  static constexpr std::uint32_t kMul1 = 0xCD9E8D57;
+  static constexpr std::uint32_t kWeyl0 = 0x9E3779B9;
+  static constexpr std::uint32_t kWeyl1 = 0xBB67AE85;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "messages.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// One row of position: `quantity` calls on the bsm_params row conf_id.
+struct Position {
+  long long conf_id{};
+  long long ticker_id{};
+  std::string ticker;
+  double quantity{};
+};
+
+// Quantity-weighted value and Greeks of a set of positions. `priced`
+// counts the positions that have seen a quote since they were loaded.
+struct Exposure {
+  double value{};
+  double delta{};
+  double gamma{};
+  double vega{};
+  double theta{};
+  double rho{};
+  std::size_t positions{};
+  std::size_t priced{};
+};
+
+// Running exposure per underlying and for the whole book. Each position
+// keeps its current contribution, so a quote costs one hash lookup and the
+// difference from the previous contribution added to two aggregates,
+// whatever the size of the book. Incremental sums drift by rounding; every
+// set_positions() and every kResumEvery quotes re-sum the aggregates from
+// the contributions. Thread-safe: one mutex, held for amortized O(1) on the
+// quote path.
+class PositionBook {
+public:
+  // Replaces the positions. A contract still held keeps its last quote; a
+  // repeated conf_id keeps the first row.
+  void set_positions(const std::vector<Position> &positions);
+
+  // Applies an OK quote to the position on its conf_id. False when there is
+  // none, the quote is not OK or it is older than the last one applied
+  // (workers can finish ticks out of order).
+  bool on_quote(const OptionQuote &q);
+
+  Exposure portfolio() const;
+  bool underlying(const std::string &ticker, Exposure &out) const;
+  // Every underlying with a position, by ticker.
+  std::vector<std::pair<std::string, Exposure>> underlyings() const;
+
+  std::uint64_t updates() const;
+  // Quotes rejected by on_quote() for being older than the applied one.
+  std::uint64_t stale_quotes() const;
+
+  static constexpr std::uint64_t kResumEvery = 1 << 16;
+
+private:
+  struct Slot {
+    double quantity;
+    Exposure contribution; // quantity * last quote, priced = 1 once quoted
+    Exposure *underlying;  // node in underlyings_, stable across rehash
+    std::int64_t timestamp; // of the last quote applied
+  };
+
+  // Rebuilds underlyings_ and portfolio_ from the slots. Caller holds mutex_.
+  void resum();
+
+  mutable std::mutex mutex_;
+  std::unordered_map<long long, Slot> slots_;
+  std::unordered_map<std::string, Exposure> underlyings_;
+  Exposure portfolio_;
+  std::uint64_t updates_{0};
+  std::uint64_t stale_quotes_{0};
+};
+
+// {"value":..,"delta":..,...,"positions":n,"priced":n}
+std::string exposure_json(const Exposure &e);
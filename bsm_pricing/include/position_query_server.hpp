@@ -0,0 +1,25 @@
+#pragma once
+
+#include "line_query_server.hpp"
+#include "position_book.hpp"
+
+#include <string>
+
+// Serves PositionBook aggregates on a Unix domain socket (see
+// line_query_server.hpp), one JSON line per request:
+//
+//   portfolio      {"portfolio":{...}}
+//   ticker SBER    {"ticker":"SBER","exposure":{...}}
+//   all (or "")    {"updates":n,"portfolio":{...},"underlyings":[...]}
+//
+// with each exposure as in exposure_json(). Unknown requests and tickers
+// get {"error":"..."}. A request is a few lock-held copies, so no client
+// waits long.
+class PositionQueryServer : public LineQueryServer {
+public:
+  PositionQueryServer(const PositionBook &book, std::string path);
+};
+
+// The reply to one request line, without the trailing newline.
+std::string position_query_reply(const PositionBook &book,
+                                 const std::string &request);
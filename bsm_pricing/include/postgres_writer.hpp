@@ -4,8 +4,14 @@
 
 #include <postgresql/libpq-fe.h>
 
+#include <chrono>
+#include <cstdint>
 #include <string>
 
+// The daily partition of ticker_price (see migration 016) that holds an
+// exchange timestamp: "ticker_price_pYYYYMMDD" for its UTC day.
+std::string ticker_price_partition(std::int64_t epoch_sec);
+
 class PostgresWriter {
 public:
   explicit PostgresWriter(const std::string &conninfo);
@@ -15,11 +21,24 @@ public:
     return conn_ && PQstatus(conn_) == CONNECTION_OK;
   }
 
+  // False when the quote could not be stored. While disconnected, a
+  // reconnect is attempted at most once per backoff interval (doubling up
+  // to 30 s), so a down server costs a failed write, not a connect per
+  // quote. Rows go straight into the quote's daily partition, skipping
+  // the parent's tuple routing; while that partition does not exist they
+  // go through the parent, and the partition is retried a minute later.
   bool write(const OptionQuote &quote);
 
 private:
   PGconn *conn_{nullptr};
   std::string conninfo_;
+  std::chrono::steady_clock::time_point next_attempt_{};
+  std::chrono::milliseconds backoff_{0};
+
+  std::int64_t day_{INT64_MIN};
+  std::string partition_sql_;
+  bool direct_{true};
+  std::chrono::steady_clock::time_point retry_direct_at_{};
 
   bool ensure_connected();
 };
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "messages.hpp"
+
+#include <postgresql/libpq-fe.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One ticker_price row. `commit` is written after the payload, so a record
+// torn by a crash reads as the end of its segment.
+struct SpoolRecord {
+  std::int64_t timestamp;
+  std::int64_t ticker_id;
+  std::int64_t conf_id;
+  double base_price;
+  double calculated_price;
+  std::uint32_t commit;
+  std::uint32_t reserved;
+};
+
+constexpr std::size_t kSpoolSegmentRecords = 65536; // 3 MiB segments
+
+// Append-only spool of quotes that could not be written to Postgres, as a
+// directory of fixed-size segment files "<seq>.spool" (a 64-byte header,
+// then records). The active segment is preallocated and mapped, so an
+// append is a copy into the page cache; a full segment is sealed and the
+// next one created. Sealed segments are drained by SpoolReplayer and then
+// removed. Segments found in the directory at construction are pending
+// from an earlier run and are drained first. Thread-safe.
+class QuoteSpool {
+public:
+  // Creates `dir` if needed; throws std::runtime_error if it is unusable.
+  explicit QuoteSpool(std::string dir,
+                      std::size_t records_per_segment = kSpoolSegmentRecords);
+  ~QuoteSpool();
+
+  QuoteSpool(const QuoteSpool &) = delete;
+  QuoteSpool &operator=(const QuoteSpool &) = delete;
+
+  // Stores an OK quote; other quotes are skipped and count as stored.
+  // False when no segment could be created or mapped.
+  bool append(const OptionQuote &q);
+
+  // Seals the active segment if it holds records, then returns every sealed
+  // segment, oldest first.
+  std::vector<std::string> seal_and_list();
+
+  // The committed records of a sealed segment. False if it cannot be read.
+  static bool read_segment(const std::string &path,
+                           std::vector<SpoolRecord> &out);
+
+  void remove_segment(const std::string &path);
+
+  const std::string &dir() const { return dir_; }
+
+  // Records appended and not yet removed, across all segments.
+  std::uint64_t pending() const { return pending_.load(); }
+  std::uint64_t appended() const { return appended_.load(); }
+
+private:
+  struct Sealed {
+    std::string path;
+    std::uint64_t records;
+  };
+
+  bool open_active();
+  void seal_active();
+  std::string segment_path(std::uint64_t seq) const;
+
+  std::string dir_;
+  std::size_t capacity_;
+
+  std::mutex mutex_;
+  std::deque<Sealed> sealed_;
+  std::uint64_t next_seq_{0};
+  int active_fd_{-1};
+  void *active_map_{nullptr};
+  std::string active_path_;
+  std::size_t active_count_{0};
+
+  std::atomic<std::uint64_t> pending_{0};
+  std::atomic<std::uint64_t> appended_{0};
+};
+
+// Drains sealed spool segments into ticker_price once Postgres is
+// reachable: every interval, it connects if needed and inserts each segment
+// in batches of unnest() arrays with ON CONFLICT (ts_exchange, ticker_id,
+// conf_id) DO NOTHING, so rows the live writer or an interrupted drain
+// already stored are skipped. A batch rejected for its data (SQLSTATE
+// class 22 or 23, e.g. a conf_id whose bsm_params row is gone) is retried
+// row by row, and the rows rejected on their own are appended to
+// "quarantine.tsv" in the spool directory, so one bad row cannot hold up
+// the spool. Any other failure, such as a lost connection, leaves the
+// segment for the next drain. A segment is removed once every row is in or
+// quarantined. Logs the throughput and wall time of each drain.
+class SpoolReplayer {
+public:
+  SpoolReplayer(QuoteSpool &spool, std::string conninfo,
+                int interval_ms = 1000);
+  ~SpoolReplayer();
+
+  void start();
+  void stop();
+
+  std::uint64_t replayed() const { return replayed_.load(); }
+  std::uint64_t quarantined() const { return quarantined_.load(); }
+  // Wall time of the most recent drain that emptied the spool.
+  double last_drain_ms() const { return last_drain_ms_.load(); }
+
+private:
+  enum class InsertResult { Ok, Rejected, Retry };
+
+  void run();
+  bool drain();
+  InsertResult insert(const std::vector<SpoolRecord> &records,
+                      std::size_t begin, std::size_t end, std::string &error);
+  // Row by row after [begin, end) was rejected as a batch. False on a
+  // failure that is not about the row.
+  bool insert_rows(const std::vector<SpoolRecord> &records, std::size_t begin,
+                   std::size_t end);
+  void quarantine(const SpoolRecord &r, const std::string &error);
+
+  QuoteSpool &spool_;
+  std::string conninfo_;
+  int interval_ms_;
+  PGconn *conn_{nullptr};
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool running_{false};
+  std::thread thread_;
+
+  std::atomic<std::uint64_t> replayed_{0};
+  std::atomic<std::uint64_t> quarantined_{0};
+  std::atomic<double> last_drain_ms_{0.0};
+};
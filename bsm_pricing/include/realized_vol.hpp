@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Returns in the windowed estimate.
+constexpr std::size_t kRealizedVolWindow = 256;
+
+struct RealizedVolConfig {
+  // Time-based EWMA: an observation's weight halves every half_life_sec.
+  double half_life_sec{600.0};
+  // A gap longer than this (a session break, a feed outage) starts a new
+  // return chain instead of producing one return over the gap.
+  std::int64_t max_gap_sec{300};
+  // Trading seconds per year the variance rate is scaled by; the default
+  // is 252 days of a 9-hour session.
+  double seconds_per_year{252.0 * 9.0 * 3600.0};
+  // Returns an estimate needs before it is reported as ready.
+  std::uint64_t min_returns{20};
+};
+
+struct RealizedVol {
+  double ewma{};   // annualized
+  double window{}; // annualized, over the last kRealizedVolWindow returns
+  std::uint64_t returns{};
+  bool ewma_ready{false};
+  bool window_ready{false};
+};
+
+// Online realized volatility per ticker from the spot stream. Both
+// estimators are variance per unit time, sum(r^2) / sum(dt), so irregular
+// ticks and several ticks in one (whole-second) timestamp weigh correctly:
+// the EWMA decays both sums by exp(-dt ln2 / half_life), read from a table
+// since dt is whole seconds up to max_gap_sec; the window keeps a ring of
+// the last kRealizedVolWindow returns and their running sums, re-summed
+// once per lap so subtraction error cannot accumulate. An update is O(1):
+// a ticker's scalars share a cache line, the ring sits behind them.
+// Tickers are spread over kShards shards by hash, each with its own lock,
+// so updates of different tickers rarely contend. A tick older than the
+// ticker's last is ignored, so callers should feed one ticker's ticks in
+// order (BsmService routes each ticker to one worker). Thread-safe.
+class RealizedVolBook {
+public:
+  explicit RealizedVolBook(const RealizedVolConfig &config = {});
+
+  // Returns the ticker's estimate after the tick.
+  RealizedVol on_tick(const std::string &ticker, std::int64_t timestamp,
+                      double price);
+
+  // False when the ticker has never ticked.
+  bool get(const std::string &ticker, RealizedVol &out) const;
+
+  // Every ticker that has ticked, by ticker.
+  std::vector<std::pair<std::string, RealizedVol>> snapshot() const;
+
+  const RealizedVolConfig &config() const { return config_; }
+
+private:
+  struct alignas(64) State {
+    double last_log_price{};
+    std::int64_t last_ts{};
+    double ewma_r2{};
+    double ewma_dt{};
+    double window_r2{};
+    double window_dt{};
+    std::uint64_t returns{};
+    std::uint32_t head{};
+    bool started{false};
+    std::array<double, kRealizedVolWindow> r2{};
+    std::array<std::uint32_t, kRealizedVolWindow> dt{};
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::size_t> index;
+    std::vector<State> states;
+  };
+
+  static constexpr std::size_t kShards = 64;
+
+  RealizedVol estimate(const State &s) const;
+  Shard &shard_for(const std::string &ticker);
+  const Shard &shard_for(const std::string &ticker) const;
+
+  RealizedVolConfig config_;
+  std::vector<double> decay_; // by whole-second dt, 0..max_gap_sec
+
+  std::array<Shard, kShards> shards_;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "messages.hpp"
+#include "thread_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Spot shocks are relative (-0.1 is a 10% fall), vol shocks absolute
+// (+0.05 adds five vol points); shocked vols are floored at 1e-4.
+struct ScenarioGrid {
+  std::vector<double> spot_shocks;
+  std::vector<double> vol_shocks;
+};
+
+// `spot_points` shocks evenly over [-max_spot, max_spot] and likewise for
+// vol; 21, 0.2, 21, 0.1 gives the usual 21x21 grid. Counts below 1 are
+// treated as 1, which yields a single zero shock.
+ScenarioGrid make_scenario_grid(std::size_t spot_points, double max_spot,
+                                std::size_t vol_points, double max_vol);
+
+// One option held long, with the spot of its underlying to shock from.
+struct ScenarioContract {
+  std::string ticker;
+  BsmParams params;
+  double spot{};
+};
+
+// P&L of every contract of one ticker, summed, against the unshocked value:
+// pnl[i * vol_shocks.size() + j] for spot shock i and vol shock j.
+struct TickerPnl {
+  std::string ticker;
+  std::size_t contracts{};
+  double base_value{};
+  std::vector<double> pnl;
+};
+
+struct ScenarioReport {
+  std::int64_t timestamp{};
+  ScenarioGrid grid;
+  std::vector<TickerPnl> tickers; // sorted by ticker
+};
+
+// Revalues every (contract x scenario) cell. Contracts are spread over the
+// pool; a Bsm contract evaluates a whole row of spot shocks per vol shock
+// with one batched CDF call each for d1 and d2, American ones run the
+// lattice per cell, Heston ones compile one slice per vol shock (shifting
+// sqrt(v0) and sqrt(theta)). Per-ticker sums are taken in input order, so a report
+// does not depend on the pool size.
+class ScenarioEngine {
+public:
+  explicit ScenarioEngine(ThreadPool &pool) : pool_(pool) {}
+
+  ScenarioReport run(const std::vector<ScenarioContract> &contracts,
+                     const ScenarioGrid &grid) const;
+
+private:
+  ThreadPool &pool_;
+};
+
+// Writes the report as one JSON document to "<path>.tmp" and renames it
+// into place, so readers always see a whole report.
+bool write_scenario_report(const std::string &path,
+                           const ScenarioReport &report);
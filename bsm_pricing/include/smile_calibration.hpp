@@ -0,0 +1,114 @@
+#pragma once
+
+#include "messages.hpp"
+#include "thread_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One row of option_quote: an observed call price and the market it was
+// observed in.
+struct OptionQuotePoint {
+  long long ticker_id{};
+  double K{};
+  double T{};
+  double price{};
+  double S{};
+  double r{};
+  double q{};
+};
+
+// Raw SVI (Gatheral) total implied variance at log-moneyness k = ln(K/F):
+//
+//   w(k) = a + b (rho (k - m) + sqrt((k - m)^2 + s^2)).
+struct SviParams {
+  double a{};
+  double b{};
+  double rho{};
+  double m{};
+  double s{};
+};
+
+double svi_total_variance(const SviParams &p, double k);
+
+// Black-Scholes vol that reproduces a call price, by safeguarded Newton.
+// False when the price is outside the no-arbitrage bounds or the inputs
+// are unusable.
+bool implied_call_vol(double price, double S, double K, double r, double q,
+                      double T, double &out);
+
+// Quotes of one (ticker, maturity) slice.
+struct SmileSlice {
+  long long ticker_id{};
+  double T{};
+  std::vector<OptionQuotePoint> quotes;
+};
+
+struct SmileFit {
+  long long ticker_id{};
+  double T{};
+  double forward{};          // mean forward of the slice's quotes
+  SviParams svi;
+  double rms_vol_error{};    // against the quotes' implied vols
+  std::size_t quotes{};      // quotes that had an implied vol
+  int iterations{};
+  bool converged{false};
+  bool valid{false};         // false: too few usable quotes or no fit
+};
+
+// Fits SVI to the implied vols of `slice` by Levenberg-Marquardt with the
+// analytic Jacobian of sqrt(w(k) / T), keeping b >= 0, |rho| < 1, s > 0
+// and the minimum variance non-negative. `warm`, typically the slice's
+// previous fit, seeds the solver; without it the seed comes from the
+// quotes. Needs kMinSmileQuotes usable quotes.
+constexpr std::size_t kMinSmileQuotes = 5;
+SmileFit calibrate_svi(const SmileSlice &slice, const SviParams *warm);
+
+struct CalibrationStats {
+  std::size_t slices{};  // slices with enough quotes
+  std::size_t fitted{};  // refitted this cycle because their quotes changed
+  std::size_t reused{};  // unchanged since the previous cycle
+  std::size_t failed{};  // refitted without a usable result
+  double wall_ms{};
+};
+
+// Calibrated smiles of one parameter load, keyed by ticker_id. Each cycle
+// groups quotes into (ticker, maturity) slices and refits, in parallel on
+// the pool, only the slices whose quotes changed, warm-started from their
+// previous fit. Not thread-safe; BsmService updates it on its calibration
+// thread and hands readers a copy.
+class SmileCalibrator {
+public:
+  explicit SmileCalibrator(ThreadPool &pool) : pool_(pool) {}
+
+  // Replaces the quotes; unusable ones are dropped with a warning.
+  CalibrationStats update(const std::vector<OptionQuotePoint> &quotes);
+
+  // Between calibrated maturities total variance, each slice taken at its
+  // own forward moneyness, is interpolated linearly in T; outside them the
+  // nearest slice's vol is used. False when the ticker has no valid fit.
+  bool sigma(long long ticker_id, double K, double T, double &out) const;
+
+  // Overrides the row volatility of every contract whose ticker has a
+  // calibrated smile. Returns the number of rows overridden.
+  std::size_t apply(std::unordered_map<long long, BsmParams> &params) const;
+
+  // Valid fits, by ticker then maturity.
+  std::vector<SmileFit> fits() const;
+
+  const CalibrationStats &last_stats() const { return stats_; }
+
+private:
+  struct Entry {
+    std::uint64_t fingerprint;
+    SmileFit fit;
+  };
+
+  ThreadPool &pool_;
+  // Per ticker, sorted by maturity.
+  std::unordered_map<long long, std::vector<Entry>> slices_;
+  CalibrationStats stats_;
+};
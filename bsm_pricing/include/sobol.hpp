@@ -0,0 +1,25 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Sobol low-discrepancy sequence with the Joe-Kuo (new-joe-kuo-6.21201)
+// direction numbers, up to kMaxDims dimensions. point() computes any index
+// directly, so threads can take disjoint index ranges.
+class SobolSequence {
+public:
+  static constexpr std::size_t kMaxDims = 16;
+
+  // Throws std::invalid_argument unless 1 <= dims <= kMaxDims.
+  explicit SobolSequence(std::size_t dims);
+
+  std::size_t dims() const { return dims_; }
+
+  // Writes point `index` (index 0 is the origin) into out[0, dims), in [0, 1).
+  void point(std::uint64_t index, double *out) const;
+
+private:
+  std::size_t dims_;
+  std::array<std::array<std::uint32_t, 32>, kMaxDims> directions_{};
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads for data-parallel loops. parallel_for() hands out
+// indices one at a time from a shared counter, so uneven tasks balance
+// themselves; the calling thread works too. Calls are serialized.
+class ThreadPool {
+public:
+  // `threads` counts the caller: ThreadPool(1) runs everything inline.
+  explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency());
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  std::size_t threads() const { return workers_.size() + 1; }
+
+  // Runs fn(i) for every i in [0, n) and returns once all have finished.
+  // The first exception thrown by fn is rethrown here.
+  void parallel_for(std::size_t n, const std::function<void(std::size_t)> &fn);
+
+private:
+  struct Job;
+
+  void worker_loop();
+  static void run(Job &job);
+
+  std::vector<std::thread> workers_;
+
+  std::mutex submit_mutex_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable done_cv_;
+  Job *job_{nullptr};
+  std::uint64_t generation_{0};
+  std::size_t busy_{0};
+  bool stop_{false};
+};
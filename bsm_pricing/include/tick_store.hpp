@@ -0,0 +1,127 @@
+#pragma once
+
+#include "line_query_server.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TickStoreConfig {
+  // Bytes kept across all contracts: compressed chunks plus their and each
+  // contract's bookkeeping. Beyond it the oldest sealed chunks are evicted,
+  // then contracts that have nothing sealed left, least recently appended
+  // first.
+  std::size_t memory_budget_bytes{std::size_t{64} << 20};
+  // Points per chunk. Larger chunks compress a little better; a query
+  // decodes whole chunks.
+  std::size_t chunk_points{256};
+};
+
+struct TickPoint {
+  std::int64_t timestamp{};
+  double spot{};
+  double price{};
+};
+
+struct TickStoreStats {
+  std::size_t contracts{};
+  std::uint64_t points{};
+  std::uint64_t chunks{};
+  std::uint64_t evicted_chunks{};
+  std::size_t bytes{};     // everything counted against the budget
+  std::size_t raw_bytes{}; // the same points as TickPoints
+};
+
+// Rolling in-memory history of (timestamp, spot, option price) per
+// contract, compressed as in Facebook's Gorilla: a chunk stores its first
+// point raw, then each timestamp as a delta-of-delta in a 1-, 9-, 12-, 16-
+// or 68-bit code and each value as the XOR with the previous one, which is
+// a single bit when the value repeats and otherwise only the bits between
+// the leading and trailing zeros. A contract appends to its open chunk and
+// seals it at chunk_points; sealed chunks are evicted oldest-sealed first
+// whenever the total exceeds the memory budget, and once none are left
+// whole idle contracts go, open chunk included, so an append is amortized
+// O(1) and memory stays bounded however many contracts tick. Queries decode
+// only the chunks they touch.
+// Thread-safe.
+class TickStore {
+public:
+  explicit TickStore(const TickStoreConfig &config = {});
+
+  void append(long long conf_id, std::int64_t timestamp, double spot,
+              double price);
+
+  // The contract's newest `n` points, oldest first.
+  std::vector<TickPoint> last(long long conf_id, std::size_t n) const;
+  // The contract's points with from <= timestamp <= to, in append order.
+  std::vector<TickPoint> range(long long conf_id, std::int64_t from,
+                               std::int64_t to) const;
+
+  TickStoreStats stats() const;
+
+private:
+  struct Chunk {
+    std::vector<std::uint64_t> words;
+    std::uint64_t bits{};
+    std::uint32_t count{};
+    std::int64_t min_ts{};
+    std::int64_t max_ts{};
+    // Encoder state, for appending to the open chunk.
+    std::int64_t prev_ts{};
+    std::int64_t prev_delta{};
+    std::uint64_t prev_value[2]{};
+    std::uint8_t lead[2]{};
+    std::uint8_t trail[2]{};
+
+    void put(std::uint64_t value, unsigned width);
+    void append(std::int64_t timestamp, double spot, double price);
+    void decode(std::vector<TickPoint> &out) const;
+    std::size_t bytes() const { return words.capacity() * sizeof(std::uint64_t); }
+  };
+
+  struct Series {
+    std::deque<Chunk> sealed;
+    Chunk open;
+    std::list<long long>::iterator lru;
+  };
+
+  // A series' map node, bucket and LRU entry, beyond its chunks' words.
+  static const std::size_t kSeriesBytes;
+  // A sealed chunk's deque slot and seal_order_ entry.
+  static const std::size_t kSealedBytes;
+
+  // Evicts until within budget, never touching series `keep`.
+  void evict(long long keep);
+
+  TickStoreConfig config_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<long long, Series> series_;
+  std::deque<long long> seal_order_; // conf_id per sealed chunk, oldest first
+  std::list<long long> lru_;         // conf_id, least recently appended first
+  std::size_t bytes_{0};
+  std::uint64_t points_{0};
+  std::uint64_t evicted_chunks_{0};
+};
+
+// Serves TickStore history on a Unix domain socket (see
+// line_query_server.hpp), one JSON line per request:
+//
+//   last 11 100              {"conf_id":11,"points":[[ts,spot,price],...]}
+//   range 11 1700000000 1700003600   the same, for that time range
+//   stats                    {"contracts":n,"points":n,...,"ratio":x}
+//
+// Unknown requests get {"error":"..."}.
+class TickQueryServer : public LineQueryServer {
+public:
+  TickQueryServer(const TickStore &store, std::string path);
+};
+
+// The reply to one request line, without the trailing newline.
+std::string tick_query_reply(const TickStore &store,
+                             const std::string &request);
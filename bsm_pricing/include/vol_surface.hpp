@@ -0,0 +1,96 @@
+#pragma once
+
+#include "messages.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One row of vol_surface_point.
+struct VolPoint {
+  long long ticker_id{};
+  double K{};
+  double T{};
+  double sigma{};
+};
+
+// Implied vol surface of one underlying. Each maturity slice is a natural
+// cubic spline in strike, flat beyond the outermost strikes; between slices
+// total variance sigma^2 T is interpolated linearly in T, and before the
+// first or after the last slice that slice's vol is used. Spline
+// coefficients are computed once here, so sigma() is two binary searches
+// and two cubic evaluations. Results are floored at kMinSurfaceVol, since a
+// spline through sparse quotes can undershoot.
+class VolSurface {
+public:
+  static constexpr double kMinSurfaceVol = 1e-4;
+
+  // Points need positive finite K, T and sigma; throws std::invalid_argument
+  // otherwise or when there are none. A repeated (K, T) keeps the first.
+  explicit VolSurface(std::vector<VolPoint> points);
+
+  double sigma(double K, double T) const;
+
+  std::size_t maturities() const { return slices_.size(); }
+
+private:
+  // On [x[i], x[i+1]): sigma = a + b h + c h^2 + d h^3, h = K - x[i].
+  struct Slice {
+    double T;
+    std::vector<double> x;
+    std::vector<double> a;
+    std::vector<double> b;
+    std::vector<double> c;
+    std::vector<double> d;
+  };
+
+  static double eval(const Slice &s, double K);
+
+  std::vector<Slice> slices_;
+};
+
+// The surfaces of one parameter load, keyed by ticker_id. Only surfaces
+// whose points changed since the previous load are rebuilt, and the sigma
+// resolved for each contract (ticker, K, T) is kept until its surface
+// changes. Not thread-safe; BsmService only touches it while loading
+// parameters.
+class VolSurfaceSet {
+public:
+  // Replaces the surfaces with those in `points`; invalid points are
+  // dropped with a warning. Returns how many surfaces were (re)built.
+  std::size_t update(const std::vector<VolPoint> &points);
+
+  // False when the ticker has no surface.
+  bool sigma(long long ticker_id, double K, double T, double &out);
+
+  // Overrides the row volatility of every contract whose ticker has a
+  // surface. Returns the number of rows overridden.
+  std::size_t apply(std::unordered_map<long long, BsmParams> &params);
+
+  std::size_t size() const { return surfaces_.size(); }
+
+private:
+  struct ContractKey {
+    std::uint64_t K;
+    std::uint64_t T;
+    bool operator==(const ContractKey &o) const {
+      return K == o.K && T == o.T;
+    }
+  };
+
+  struct ContractKeyHash {
+    std::size_t operator()(const ContractKey &k) const {
+      return static_cast<std::size_t>(k.K * 0x9e3779b97f4a7c15ULL ^ k.T);
+    }
+  };
+
+  struct Entry {
+    std::uint64_t fingerprint;
+    VolSurface surface;
+    std::unordered_map<ContractKey, double, ContractKeyHash> sigmas;
+  };
+
+  std::unordered_map<long long, Entry> surfaces_;
+};
@@ -1,11 +1,54 @@
 #include "bsm_service.hpp"
 
+#include "async_logger.hpp"
+#include "heston.hpp"
+#include "lattice.hpp"
+#include "params_snapshot.hpp"
+#include "shard_ring.hpp"
+
+#include <algorithm>
 #include <chrono>
-#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
 #include <postgresql/libpq-fe.h>
 
 namespace {
 
+constexpr std::chrono::hours kPartitionMaintenanceInterval{1};
+constexpr int kPartitionDaysAhead = 2;
+// Updates waiting for one worker. A producer that finds its queue this deep
+// waits, so a burst backs up into it instead of into memory.
+constexpr std::size_t kMaxQueuedPerWorker = 1 << 14;
+
+bool parse_pricing_model(const std::string &name, PricingModel &model) {
+  if (name == "bsm") {
+    model = PricingModel::Bsm;
+  } else if (name == "american_binomial") {
+    model = PricingModel::AmericanBinomial;
+  } else if (name == "american_trinomial") {
+    model = PricingModel::AmericanTrinomial;
+  } else if (name == "heston") {
+    model = PricingModel::Heston;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool parse_vol_source(const std::string &name, VolSource &source) {
+  if (name == "param") {
+    source = VolSource::Param;
+  } else if (name == "realized_ewma") {
+    source = VolSource::RealizedEwma;
+  } else if (name == "realized_window") {
+    source = VolSource::RealizedWindow;
+  } else {
+    return false;
+  }
+  return true;
+}
+
 bool parse_price_update(const std::string &line, PriceUpdateIn &out) {
   try {
     auto get_value = [&](const std::string &key) -> std::string {
@@ -54,16 +97,201 @@ bool parse_price_update(const std::string &line, PriceUpdateIn &out) {
   }
 }
 
-PGconn *create_pg_connection() { return nullptr; }
+// One JSON object per quote, for the stdout fallback when the DB is down.
+std::string quote_json(const OptionQuote &q) {
+  char underlying[32];
+  char option[32];
+  std::snprintf(underlying, sizeof(underlying), "%g", q.underlying_price);
+  std::snprintf(option, sizeof(option), "%g", q.option_price);
+  return "{\"timestamp\":" + std::to_string(q.timestamp) + ",\"ticker\":\"" +
+         q.ticker + "\",\"underlying_price\":" + underlying +
+         ",\"option_price\":" + option + ",\"status\":\"" + q.status +
+         "\",\"error\":\"" + q.error + "\"}";
+}
+
+std::array<double, 8> heston_key(double r, double q, double T,
+                                 const HestonParams &h) {
+  return {r, q, T, h.kappa, h.theta, h.xi, h.rho, h.v0};
+}
+
+// A bigint[] literal for a ($1::bigint[]) parameter, e.g. "{1,2,3}".
+std::string bigint_array(const std::vector<long long> &ids) {
+  std::string out = "{";
+  for (long long id : ids) {
+    if (out.size() > 1) {
+      out += ',';
+    }
+    out += std::to_string(id);
+  }
+  out += '}';
+  return out;
+}
+
+// Bounds every connection attempt, so the blocking load in start() cannot
+// hang on an unreachable host for the kernel's TCP timeout.
+PGconn *connect_params_db(const std::string &conninfo) {
+  const char *keywords[] = {"dbname", "connect_timeout", nullptr};
+  const char *values[] = {conninfo.c_str(), "3", nullptr};
+  return PQconnectdbParams(keywords, values, /*expand_dbname=*/1);
+}
 
 } // namespace
 
 BsmService::BsmService(PricePipe<std::string> &json_pipe,
                        std::size_t num_threads, const std::string &conninfo)
-    : json_pipe_(json_pipe), num_threads_(num_threads), conninfo_(conninfo) {}
+    : BsmService(num_threads, conninfo) {
+  json_pipe_ = &json_pipe;
+}
+
+BsmService::BsmService(std::size_t num_threads, const std::string &conninfo)
+    : num_threads_(std::max<std::size_t>(num_threads, 1)),
+      conninfo_(conninfo) {
+  queues_.reserve(num_threads_);
+  for (std::size_t i = 0; i < num_threads_; ++i) {
+    queues_.push_back(std::make_unique<WorkQueue>());
+  }
+}
 
 BsmService::~BsmService() { stop(); }
 
+void BsmService::set_shard(int shard_id, int shard_count) {
+  shard_id_ = shard_id;
+  shard_count_ = shard_count < 1 ? 1 : shard_count;
+}
+
+void BsmService::set_quote_sink(QuoteSink sink) {
+  quote_sink_ = std::move(sink);
+}
+
+BsmService::WorkQueue &BsmService::queue_for(const std::string &ticker) {
+  return *queues_[std::hash<std::string>()(ticker) % queues_.size()];
+}
+
+bool BsmService::wait_for_room(WorkQueue &queue,
+                               std::unique_lock<std::mutex> &lock) {
+  queue.room_cv.wait(lock, [&queue] {
+    return queue.closed || queue.items.size() < kMaxQueuedPerWorker;
+  });
+  return !queue.closed;
+}
+
+void BsmService::close_queues() {
+  for (auto &queue : queues_) {
+    {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      queue->closed = true;
+    }
+    queue->cv.notify_all();
+    queue->room_cv.notify_all();
+  }
+}
+
+void BsmService::submit(PriceUpdateIn update) {
+  WorkQueue &queue = queue_for(update.ticker);
+  {
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    if (!wait_for_room(queue, lock)) {
+      return;
+    }
+    queue.items.push(std::move(update));
+  }
+  queue.cv.notify_one();
+}
+
+void BsmService::submit(std::vector<PriceUpdateIn> &updates) {
+  // One pass per worker queue, so each lock is taken once per batch (more
+  // only when the queue fills) and a ticker's updates keep their order.
+  std::vector<std::uint32_t> routes(updates.size());
+  for (std::size_t i = 0; i < updates.size(); ++i) {
+    routes[i] = static_cast<std::uint32_t>(
+        std::hash<std::string>()(updates[i].ticker) % queues_.size());
+  }
+  for (std::size_t q = 0; q < queues_.size(); ++q) {
+    WorkQueue &queue = *queues_[q];
+    std::size_t next = 0;
+    while (next < updates.size()) {
+      bool open = true;
+      bool pushed = false;
+      {
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        for (; next < updates.size(); ++next) {
+          if (routes[next] != q) {
+            continue;
+          }
+          if (queue.items.size() >= kMaxQueuedPerWorker) {
+            if (pushed) {
+              break;
+            }
+            if (!(open = wait_for_room(queue, lock))) {
+              break;
+            }
+          }
+          queue.items.push(std::move(updates[next]));
+          pushed = true;
+        }
+      }
+      if (pushed) {
+        queue.cv.notify_one();
+      }
+      if (!open) {
+        updates.clear();
+        return;
+      }
+    }
+  }
+  updates.clear();
+}
+
+void BsmService::set_params_snapshot(const std::string &path) {
+  snapshot_path_ = path;
+}
+
+void BsmService::set_scenario_report(const std::string &path,
+                                     const ScenarioGrid &grid,
+                                     int interval_sec, std::size_t threads) {
+  scenario_path_ = path;
+  scenario_grid_ = grid;
+  scenario_interval_sec_ = interval_sec < 1 ? 1 : interval_sec;
+  scenario_threads_ = threads < 1 ? 1 : threads;
+}
+
+void BsmService::set_calibration_threads(std::size_t threads) {
+  calibration_threads_ = threads < 1 ? 1 : threads;
+}
+
+void BsmService::set_realized_vol(const RealizedVolConfig &config,
+                                  int persist_sec) {
+  realized_ = std::make_unique<RealizedVolBook>(config);
+  realized_persist_sec_ = persist_sec < 0 ? 0 : persist_sec;
+}
+
+void BsmService::set_quote_spool(const std::string &dir) { spool_dir_ = dir; }
+
+void BsmService::set_columnar_sink(const ColumnarSinkConfig &config,
+                                   bool exclusive) {
+  columnar_config_ = config;
+  columnar_only_ = exclusive;
+}
+
+void BsmService::set_tick_store(const TickStoreConfig &config,
+                                const std::string &socket_path) {
+  ticks_ = std::make_unique<TickStore>(config);
+  tick_socket_path_ = socket_path;
+}
+
+void BsmService::set_ticker_price_retention(int days) {
+  retention_days_ = days < 0 ? 0 : days;
+}
+
+void BsmService::set_position_socket(const std::string &path) {
+  position_socket_path_ = path;
+}
+
+void BsmService::set_positions_for_testing(
+    const std::vector<Position> &positions) {
+  positions_.set_positions(positions);
+}
+
 void BsmService::set_params_for_testing(const std::string &ticker, double K,
                                         double r, double q, double sigma,
                                         double T, long long ticker_id,
@@ -76,34 +304,255 @@ void BsmService::set_params_for_testing(const std::string &ticker, double K,
   p.T = T;
   p.ticker_id = ticker_id;
   p.conf_id = conf_id;
+  set_params_for_testing(ticker, p);
+}
 
+void BsmService::set_params_for_testing(const std::string &ticker,
+                                        const BsmParams &p) {
+  ContractCompiler compiler;
+  HestonSlices slices;
   std::lock_guard<std::mutex> lock(params_mutex_);
-  params_[ticker] = p;
+  ParamsSet set = *params_;
+  std::vector<Contract> contracts;
+  bool adopted = false;
+  auto old = set.find(ticker);
+  if (old != set.end()) {
+    contracts = old->second->contracts;
+    adopted = old->second->adopted;
+  }
+  for (const Contract &c : contracts) {
+    if (c.heston) {
+      slices.emplace(heston_key(c.call.r, c.call.q, c.call.T, c.heston_params),
+                     c.heston);
+    }
+  }
+  const Contract contract = make_contract(compiler, slices, p);
+  auto it = std::lower_bound(
+      contracts.begin(), contracts.end(), p.conf_id,
+      [](const Contract &c, long long id) { return c.conf_id < id; });
+  if (it != contracts.end() && it->conf_id == p.conf_id) {
+    *it = contract;
+  } else {
+    contracts.insert(it, contract);
+  }
+  set[ticker] = make_ticker_params(std::move(contracts), adopted);
+  publish_params_set(std::move(set));
+}
+
+BsmService::Contract BsmService::make_contract(ContractCompiler &compiler,
+                                              HestonSlices &slices,
+                                              const BsmParams &p) {
+  Contract contract{compiler.compile(p), p.model,     p.lattice_steps,
+                    p.heston,              nullptr,     p.ticker_id,
+                    p.conf_id,             p.vol_source};
+  if (p.model == PricingModel::Heston) {
+    std::shared_ptr<const HestonSlice> &slice =
+        slices[heston_key(p.r, p.q, p.T, p.heston)];
+    if (!slice) {
+      slice = std::make_shared<HestonSlice>(
+          compile_heston(p.heston, p.r, p.q, p.T));
+    }
+    contract.heston = slice;
+  }
+  return contract;
+}
+
+CallGreeks BsmService::price(const Contract &contract, double spot,
+                             double sigma) {
+  const CompiledContract &c = contract.call;
+  if (contract.model == PricingModel::Bsm) {
+    return sigma == c.sigma ? call_greeks(c, spot)
+                            : OptionPricer::black_scholes_call_greeks(
+                                  spot, c.K, c.r, c.q, sigma, c.T);
+  }
+  if (contract.model == PricingModel::Heston) {
+    return heston_call_greeks(*contract.heston, spot, c.K);
+  }
+  LatticeContract lattice{spot, c.K, c.r, c.q, sigma, c.T};
+  if (contract.lattice_steps > 0) {
+    lattice.steps = contract.lattice_steps;
+  }
+  lattice.kind = contract.model == PricingModel::AmericanTrinomial
+                     ? LatticeKind::Trinomial
+                     : LatticeKind::Binomial;
+  return american_call_greeks(lattice);
+}
+
+void BsmService::price_heston(const std::vector<Contract> &contracts,
+                              std::vector<std::size_t> &pending, double spot,
+                              std::vector<CallGreeks> &results) {
+  std::sort(pending.begin(), pending.end(),
+            [&](std::size_t l, std::size_t r) {
+              return std::less<const HestonSlice *>()(
+                  contracts[l].heston.get(), contracts[r].heston.get());
+            });
+  std::vector<double> strikes;
+  std::vector<CallGreeks> out;
+  for (std::size_t begin = 0; begin < pending.size();) {
+    const HestonSlice *slice = contracts[pending[begin]].heston.get();
+    std::size_t end = begin;
+    strikes.clear();
+    while (end < pending.size() &&
+           contracts[pending[end]].heston.get() == slice) {
+      strikes.push_back(contracts[pending[end]].call.K);
+      ++end;
+    }
+    out.resize(strikes.size());
+    heston_call_greeks_batch(*slice, spot, strikes.data(), out.data(),
+                             strikes.size());
+    for (std::size_t i = begin; i < end; ++i) {
+      results[pending[i]] = out[i - begin];
+    }
+    begin = end;
+  }
+}
+
+double BsmService::effective_sigma(const Contract &contract,
+                                   const RealizedVol &realized) {
+  if (contract.model == PricingModel::Heston) {
+    return contract.call.sigma;
+  }
+  if (contract.vol_source == VolSource::RealizedEwma && realized.ewma_ready &&
+      realized.ewma > 0.0) {
+    return realized.ewma;
+  }
+  if (contract.vol_source == VolSource::RealizedWindow &&
+      realized.window_ready && realized.window > 0.0) {
+    return realized.window;
+  }
+  return contract.call.sigma;
+}
+
+void BsmService::install_params(
+    std::unordered_map<long long, BsmParams> params) {
+  ContractCompiler compiler;
+  HestonSlices slices;
+  std::unordered_map<std::string, std::vector<Contract>> contracts;
+  for (const auto &entry : params) {
+    const BsmParams &p = entry.second;
+    contracts[p.ticker].push_back(make_contract(compiler, slices, p));
+  }
+  for (auto &entry : contracts) {
+    std::sort(entry.second.begin(), entry.second.end(),
+              [](const Contract &l, const Contract &r) {
+                return l.conf_id < r.conf_id;
+              });
+  }
+
+  std::lock_guard<std::mutex> lock(params_mutex_);
+  ParamsSet set;
+  set.reserve(contracts.size());
+  for (auto &entry : contracts) {
+    const bool adopted = adopted_tickers_.count(entry.first) != 0;
+    set.emplace(entry.first,
+                make_ticker_params(std::move(entry.second), adopted));
+  }
+  publish_params_set(std::move(set));
+}
+
+std::shared_ptr<const BsmService::TickerParams>
+BsmService::make_ticker_params(std::vector<Contract> contracts, bool adopted) {
+  auto params = std::make_shared<TickerParams>();
+  params->cache.assign(
+      contracts.size(),
+      CachedPrice{std::numeric_limits<double>::quiet_NaN(), 0.0, {}});
+  params->contracts = std::move(contracts);
+  params->adopted = adopted;
+  return params;
+}
+
+void BsmService::publish_params_set(ParamsSet set) {
+  params_ = std::make_shared<const ParamsSet>(std::move(set));
+  params_version_.fetch_add(1, std::memory_order_release);
 }
 
 void BsmService::start() {
   if (running_.exchange(true)) {
     return;
   }
+
+  // A snapshot is enough to start pricing; the live load then catches up in
+  // config_thread. Without one, block on the database once so workers do not
+  // drop everything until the first reload.
+  bool warm = false;
+  if (!snapshot_path_.empty()) {
+    auto t0 = std::chrono::steady_clock::now();
+    std::unordered_map<long long, BsmParams> snapshot;
+    if (read_params_snapshot(snapshot_path_, snapshot)) {
+      auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - t0)
+                    .count();
+      log_info("BsmService", "loaded params from snapshot",
+               {{"params", snapshot.size()}, {"elapsed_us", us}});
+      install_params(std::move(snapshot));
+      warm = true;
+    }
+  }
+  PGconn *conn = nullptr;
+  bool loaded = false;
+  if (!warm && !conninfo_.empty()) {
+    loaded = refresh_params(conn);
+  }
+
+  if (!columnar_config_.dir.empty()) {
+    ColumnarSinkConfig config = columnar_config_;
+    config.prefix += "_s" + std::to_string(shard_id_);
+    try {
+      columnar_ = std::make_unique<ColumnarSink>(config);
+    } catch (const std::exception &e) {
+      log_error("BsmService", "columnar sink disabled",
+                {{"dir", config.dir}, {"error", e.what()}});
+    }
+  }
+  if (!spool_dir_.empty() && !quote_sink_ && !columnar_only_) {
+    try {
+      spool_ = std::make_unique<QuoteSpool>(spool_dir_);
+      if (!conninfo_.empty()) {
+        replayer_ = std::make_unique<SpoolReplayer>(*spool_, conninfo_);
+        replayer_->start();
+      }
+    } catch (const std::exception &e) {
+      log_error("BsmService", "quote spool disabled",
+                {{"dir", spool_dir_}, {"error", e.what()}});
+    }
+  }
+
   threads_.clear();
   threads_.reserve(num_threads_);
   for (std::size_t i = 0; i < num_threads_; ++i) {
-    threads_.emplace_back(&BsmService::worker_thread, this);
+    threads_.emplace_back(&BsmService::worker_thread, this,
+                          std::ref(*queues_[i]));
+  }
+  if (json_pipe_) {
+    dispatcher_thread_ = std::thread(&BsmService::dispatcher_thread, this);
   }
-  dispatcher_thread_ = std::thread(&BsmService::dispatcher_thread, this);
   db_thread_ = std::thread(&BsmService::db_thread, this);
-  config_thread_ = std::thread(&BsmService::config_thread, this);
+  calibration_thread_ = std::thread(&BsmService::calibration_thread, this);
+  config_thread_ = std::thread(&BsmService::config_thread, this, conn, loaded);
+  if (!scenario_path_.empty()) {
+    scenario_thread_ = std::thread(&BsmService::scenario_thread, this);
+  }
+  if (!position_socket_path_.empty()) {
+    position_server_ =
+        std::make_unique<PositionQueryServer>(positions_, position_socket_path_);
+    if (!position_server_->start()) {
+      position_server_.reset();
+    }
+  }
+  if (ticks_ && !tick_socket_path_.empty()) {
+    tick_server_ =
+        std::make_unique<TickQueryServer>(*ticks_, tick_socket_path_);
+    if (!tick_server_->start()) {
+      tick_server_.reset();
+    }
+  }
 }
 
 void BsmService::stop() {
   if (!running_.exchange(false)) {
     return;
   }
-  {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    queue_closed_ = true;
-  }
-  queue_cv_.notify_all();
+  close_queues();
 
   if (dispatcher_thread_.joinable()) {
     dispatcher_thread_.join();
@@ -123,67 +572,197 @@ void BsmService::stop() {
   if (db_thread_.joinable()) {
     db_thread_.join();
   }
+  if (replayer_) {
+    replayer_->stop();
+    replayer_.reset();
+  }
+  spool_.reset();
+  if (columnar_) {
+    columnar_->close();
+    log_info("BsmService", "columnar sink closed",
+             {{"rows", columnar_->rows_written()},
+              {"bytes", columnar_->bytes_written()},
+              {"files", columnar_->files_closed()}});
+    columnar_.reset();
+  }
+  AsyncLogger::instance().flush();
 
+  {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+  }
+  config_cv_.notify_all();
   if (config_thread_.joinable()) {
     config_thread_.join();
   }
+  {
+    std::lock_guard<std::mutex> lock(calibration_mutex_);
+  }
+  calibration_cv_.notify_all();
+  if (calibration_thread_.joinable()) {
+    calibration_thread_.join();
+  }
+  if (scenario_thread_.joinable()) {
+    scenario_thread_.join();
+  }
+  if (position_server_) {
+    position_server_->stop();
+    position_server_.reset();
+  }
+  if (tick_server_) {
+    tick_server_->stop();
+    tick_server_.reset();
+  }
 }
 
-void BsmService::worker_thread() {
+void BsmService::worker_thread(WorkQueue &queue) {
+  // This worker's view of the params, refreshed when the version moves.
+  // Reused across ticks: sigmas, results and cache hits, and the Heston
+  // contracts left to price.
+  std::shared_ptr<const ParamsSet> params;
+  std::uint64_t params_seen = ~std::uint64_t{0};
+  std::vector<double> sigmas;
+  std::vector<CallGreeks> results;
+  std::vector<char> hits;
+  std::vector<std::size_t> heston;
+  std::vector<OptionQuote> outs;
+
   while (true) {
-    std::string line;
+    PriceUpdateIn in;
     {
-      std::unique_lock<std::mutex> lock(queue_mutex_);
-      queue_cv_.wait(lock, [this] { return queue_closed_ || !queue_.empty(); });
-      if (queue_.empty() && queue_closed_) {
+      std::unique_lock<std::mutex> lock(queue.mutex);
+      queue.cv.wait(lock,
+                    [&queue] { return queue.closed || !queue.items.empty(); });
+      if (queue.items.empty() && queue.closed) {
         break;
       }
-      line = std::move(queue_.front());
-      queue_.pop();
-    }
-
-    PriceUpdateIn in{};
-    if (!parse_price_update(line, in)) {
-      continue;
+      in = std::move(queue.items.front());
+      queue.items.pop();
+      if (queue.items.size() + 1 == kMaxQueuedPerWorker) {
+        queue.room_cv.notify_all();
+      }
     }
 
     OptionQuote out{};
     out.timestamp = in.timestamp;
     out.ticker = in.ticker;
     out.underlying_price = in.price;
+    outs.clear();
 
     if (in.status != "OK") {
       out.status = "ERROR";
       out.error = in.error.empty() ? "Upstream price error" : in.error;
+      outs.push_back(std::move(out));
     } else {
-      BsmParams params;
-      bool has_params = false;
-      {
+      const RealizedVol realized =
+          realized_->on_tick(in.ticker, in.timestamp, in.price);
+      if (params_version_.load(std::memory_order_acquire) != params_seen) {
         std::lock_guard<std::mutex> lock(params_mutex_);
-        auto it = params_.find(in.ticker);
-        if (it != params_.end()) {
-          params = it->second;
-          has_params = true;
-        }
+        params = params_;
+        params_seen = params_version_.load(std::memory_order_relaxed);
       }
 
-      if (!has_params) {
+      auto it = params->find(in.ticker);
+      if (it == params->end()) {
+        bool adopt = false;
+        long long adopt_id = 0;
+        if (shard_count_ > 1) {
+          // Routed here after a rebalance: adopt it, if it is a real ticker.
+          std::lock_guard<std::mutex> lock(params_mutex_);
+          auto known = known_tickers_.find(in.ticker);
+          if (known != known_tickers_.end() &&
+              adopted_tickers_
+                  .emplace(in.ticker, std::chrono::steady_clock::now())
+                  .second) {
+            adopt = true;
+            adopt_id = known->second;
+          }
+        }
+        if (adopt) {
+          std::lock_guard<std::mutex> lock(config_mutex_);
+          pending_adoptions_.push_back(adopt_id);
+          reload_requested_ = true;
+          config_cv_.notify_all();
+        }
+        ++dropped_no_params_;
         continue;
       }
+      const TickerParams &ticker = *it->second;
+      if (ticker.adopted) {
+        std::lock_guard<std::mutex> lock(params_mutex_);
+        auto adopted = adopted_tickers_.find(in.ticker);
+        if (adopted != adopted_tickers_.end()) {
+          adopted->second = std::chrono::steady_clock::now();
+        }
+      }
 
-      double call_price = OptionPricer::black_scholes_call(
-          in.price, params.K, params.r, params.q, params.sigma, params.T);
-      out.option_price = call_price;
-      out.ticker_id = params.ticker_id;
-      out.conf_id = params.conf_id;
-      out.status = "OK";
-      out.error.clear();
+      // Heston contracts are left for one batch call per maturity.
+      const std::vector<Contract> &contracts = ticker.contracts;
+      std::vector<CachedPrice> &cache = ticker.cache;
+      const std::size_t n = contracts.size();
+      sigmas.resize(n);
+      results.resize(n);
+      hits.resize(n);
+      heston.clear();
+      for (std::size_t i = 0; i < n; ++i) {
+        sigmas[i] = effective_sigma(contracts[i], realized);
+        hits[i] = cache[i].spot == in.price && cache[i].sigma == sigmas[i];
+        if (hits[i]) {
+          results[i] = cache[i].result;
+        } else if (contracts[i].model == PricingModel::Heston) {
+          heston.push_back(i);
+        } else {
+          results[i] = price(contracts[i], in.price, sigmas[i]);
+        }
+      }
+      price_heston(contracts, heston, in.price, results);
+
+      bool fresh = false;
+      for (std::size_t i = 0; i < n; ++i) {
+        const Contract &contract = contracts[i];
+        const CallGreeks &greeks = results[i];
+        if (hits[i]) {
+          ++cache_hits_;
+          if (skip_unchanged_writes_) {
+            ++skipped_writes_;
+            continue;
+          }
+        } else {
+          ++cache_misses_;
+          cache[i] = CachedPrice{in.price, sigmas[i], greeks};
+          fresh = true;
+        }
+
+        out.option_price = greeks.price;
+        out.delta = greeks.delta;
+        out.gamma = greeks.gamma;
+        out.vega = greeks.vega;
+        out.theta = greeks.theta;
+        out.rho = greeks.rho;
+        out.ticker_id = contract.ticker_id;
+        out.conf_id = contract.conf_id;
+        out.status = "OK";
+        outs.push_back(out);
+      }
+      if (fresh) {
+        std::lock_guard<std::mutex> lock(params_mutex_);
+        last_spots_[in.ticker] = in.price;
+      }
+      if (outs.empty()) {
+        continue;
+      }
+      // Exposure follows pricing, not the database; on_quote drops quotes
+      // another worker has already overtaken.
+      for (const OptionQuote &q : outs) {
+        positions_.on_quote(q);
+      }
     }
     {
       std::lock_guard<std::mutex> lock(out_mutex_);
       if (!out_closed_) {
-        out_queue_.push(out);
-        ++out_queue_size_;
+        for (OptionQuote &q : outs) {
+          out_queue_.push(std::move(q));
+        }
+        out_queue_size_ += outs.size();
       }
     }
     out_cv_.notify_one();
@@ -193,32 +772,48 @@ void BsmService::worker_thread() {
 void BsmService::dispatcher_thread() {
   while (running_) {
     std::string line;
-    if (!json_pipe_.read(line)) {
+    if (!json_pipe_->read(line)) {
       break;
     }
 
-    {
-      std::lock_guard<std::mutex> lock(queue_mutex_);
-      if (!queue_closed_) {
-        queue_.push(std::move(line));
-      }
+    PriceUpdateIn in;
+    if (!parse_price_update(line, in)) {
+      continue;
     }
-    queue_cv_.notify_one();
+    submit(std::move(in));
   }
 
-  {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    queue_closed_ = true;
-  }
-  queue_cv_.notify_all();
+  close_queues();
 }
 
 void BsmService::db_thread() {
+  if (quote_sink_ || (columnar_ && columnar_only_)) {
+    while (true) {
+      OptionQuote out;
+      {
+        std::unique_lock<std::mutex> lock(out_mutex_);
+        out_cv_.wait(lock,
+                     [this] { return out_closed_ || !out_queue_.empty(); });
+        if (out_queue_.empty() && out_closed_) {
+          break;
+        }
+        out = std::move(out_queue_.front());
+        out_queue_.pop();
+        --out_queue_size_;
+      }
+      record_quote(out);
+      if (quote_sink_) {
+        quote_sink_(out);
+      }
+    }
+    return;
+  }
+
   PostgresWriter writer(conninfo_);
   if (!writer.is_connected()) {
-    std::cerr
-        << "PostgresWriter: connection is not ready in BsmService db_thread, "
-        << "results will be printed to stdout\n";
+    log_warn("BsmService", spool_ ? "writer connection not ready, spooling quotes"
+                                  : "writer connection not ready, printing "
+                                    "quotes to stdout");
   }
 
   using namespace std::chrono_literals;
@@ -236,94 +831,643 @@ void BsmService::db_thread() {
       out_queue_.pop();
       --out_queue_size_;
     }
+    record_quote(out);
 
-    if (writer.is_connected()) {
-      if (!writer.write(out)) {
+    if (conninfo_.empty() || !writer.write(out)) {
+      ++failed_writes_;
+      if (!spool_ || !spool_->append(out)) {
+        AsyncLogger::instance().write_stdout(quote_json(out));
       }
-    } else {
-      std::cout << "{" << "\"timestamp\":" << out.timestamp << ","
-                << "\"ticker\":\"" << out.ticker << "\","
-                << "\"underlying_price\":" << out.underlying_price << ","
-                << "\"option_price\":" << out.option_price << ","
-                << "\"status\":\"" << out.status << "\"," << "\"error\":\""
-                << out.error << "\"" << "}\n";
     }
 
     auto now = std::chrono::steady_clock::now();
     if (now - last_log >= 1s) {
-      std::cerr << "BsmService: pending DB writes: " << out_queue_size_.load()
-                << "\n";
+      log_info("BsmService", "writer status",
+               {{"pending_writes", out_queue_size_.load()},
+                {"dropped_no_params", dropped_no_params_.load()},
+                {"cache_hits", cache_hits_.load()},
+                {"cache_misses", cache_misses_.load()},
+                {"skipped_writes", skipped_writes_.load()},
+                {"failed_writes", failed_writes_.load()},
+                {"spool_pending", spool_ ? spool_->pending() : 0}});
       last_log = now;
     }
   }
 }
 
-void BsmService::config_thread() {
-  using namespace std::chrono_literals;
+void BsmService::record_quote(const OptionQuote &q) {
+  if (columnar_) {
+    columnar_->append(q);
+  }
+  if (ticks_ && q.status == "OK") {
+    ticks_->append(q.conf_id, q.timestamp, q.underlying_price, q.option_price);
+  }
+}
 
-  PGconn *conn = nullptr;
+void BsmService::scenario_thread() {
+  ThreadPool pool(scenario_threads_);
+  ScenarioEngine engine(pool);
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(config_mutex_);
+      config_cv_.wait_for(lock, std::chrono::seconds(scenario_interval_sec_),
+                          [this] { return !running_; });
+      if (!running_) {
+        break;
+      }
+    }
 
-  while (running_) {
-    if (!conn) {
-      conn = PQconnectdb(conninfo_.c_str());
-      if (!conn || PQstatus(conn) != CONNECTION_OK) {
-        std::cerr << "BsmService config_thread: connection failed: "
-                  << (conn ? PQerrorMessage(conn) : "PQconnectdb returned null")
-                  << "\n";
-        if (conn) {
-          PQfinish(conn);
-          conn = nullptr;
+    std::vector<ScenarioContract> contracts;
+    {
+      std::lock_guard<std::mutex> lock(params_mutex_);
+      contracts.reserve(params_->size());
+      for (const auto &entry : *params_) {
+        auto spot = last_spots_.find(entry.first);
+        if (spot == last_spots_.end()) {
+          continue;
+        }
+        RealizedVol realized;
+        realized_->get(entry.first, realized);
+        for (const Contract &c : entry.second->contracts) {
+          BsmParams p;
+          p.K = c.call.K;
+          p.r = c.call.r;
+          p.q = c.call.q;
+          p.sigma = effective_sigma(c, realized);
+          p.T = c.call.T;
+          p.ticker_id = c.ticker_id;
+          p.conf_id = c.conf_id;
+          p.model = c.model;
+          p.lattice_steps = c.lattice_steps;
+          p.heston = c.heston_params;
+          p.ticker = entry.first;
+          contracts.push_back(ScenarioContract{entry.first, p, spot->second});
         }
-        std::this_thread::sleep_for(5s);
-        continue;
       }
     }
 
-    PGresult *res =
-        PQexec(conn, "SELECT t.name, p.strike, p.rate, p.dividend_yield, "
-                     "p.volatility, p.maturity_years, "
-                     "       p.ticker_id, p.id "
-                     "FROM bsm_params p "
-                     "JOIN ticker t ON t.id = p.ticker_id;");
+    auto t0 = std::chrono::steady_clock::now();
+    const ScenarioReport report = engine.run(contracts, scenario_grid_);
+    if (write_scenario_report(scenario_path_, report)) {
+      ++scenario_runs_;
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - t0)
+                  .count();
+    if (ms > scenario_interval_sec_ * 1000) {
+      log_warn("BsmService", "scenario run slower than its interval",
+               {{"elapsed_ms", ms}, {"contracts", contracts.size()}});
+    }
+  }
+}
 
-    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-      std::cerr << "BsmService config_thread: query failed: "
-                << PQerrorMessage(conn);
-      PQclear(res);
-      PQfinish(conn);
-      conn = nullptr;
-      std::this_thread::sleep_for(5s);
+void BsmService::config_thread(PGconn *conn, bool loaded) {
+  const auto interval = std::chrono::seconds(reload_interval_sec_);
+  auto next_reload = std::chrono::steady_clock::now() + interval;
+  while (running_) {
+    std::vector<long long> adopt;
+    if (loaded) {
+      std::unique_lock<std::mutex> lock(config_mutex_);
+      config_cv_.wait_until(lock, next_reload,
+                            [this] { return !running_ || reload_requested_; });
+      reload_requested_ = false;
+      adopt.swap(pending_adoptions_);
+      if (!running_) {
+        break;
+      }
+    }
+    // New adoptions load just their rows; the full reload keeps its
+    // schedule and picks them up if this fails.
+    if (loaded && !adopt.empty() &&
+        std::chrono::steady_clock::now() < next_reload &&
+        adopt_tickers(conn, adopt)) {
       continue;
     }
+    loaded = refresh_params(conn);
+    next_reload = std::chrono::steady_clock::now() + interval;
+    if (!loaded) {
+      wait_for_retry();
+    } else {
+      persist_realized_vol(conn);
+      maintain_ticker_price(conn);
+    }
+  }
+
+  if (conn) {
+    PQfinish(conn);
+  }
+}
+
+bool BsmService::refresh_params(PGconn *&conn) {
+  if (!conn) {
+    conn = connect_params_db(conninfo_);
+    if (!conn || PQstatus(conn) != CONNECTION_OK) {
+      log_error("BsmService", "params connection failed",
+                {{"error", conn ? PQerrorMessage(conn)
+                                : "PQconnectdb returned null"}});
+      if (conn) {
+        PQfinish(conn);
+        conn = nullptr;
+      }
+      return false;
+    }
+  }
+
+  std::string owned;
+  std::unordered_map<long long, BsmParams> new_params;
+  std::vector<VolPoint> surface_points;
+  std::vector<OptionQuotePoint> option_quotes;
+  std::vector<Position> positions;
+  bool ok = (shard_count_ == 1 || load_owned_ticker_ids(conn, owned)) &&
+            load_params(conn, owned, new_params);
+  if (ok) {
+    // The other loads cover just the tickers that have rows, each once.
+    std::vector<long long> ticker_ids;
+    ticker_ids.reserve(new_params.size());
+    for (const auto &entry : new_params) {
+      ticker_ids.push_back(entry.second.ticker_id);
+    }
+    std::sort(ticker_ids.begin(), ticker_ids.end());
+    ticker_ids.erase(std::unique(ticker_ids.begin(), ticker_ids.end()),
+                     ticker_ids.end());
+    const std::string ids = bigint_array(ticker_ids);
+    ok = load_vol_surface_points(conn, ids, surface_points) &&
+         load_option_quotes(conn, ids, option_quotes) &&
+         load_positions(conn, ids, positions);
+  }
+  if (!ok) {
+    PQfinish(conn);
+    conn = nullptr;
+    return false;
+  }
+  const std::size_t rebuilt = surfaces_.update(surface_points);
+  const std::size_t from_surface = surfaces_.apply(new_params);
+  if (rebuilt > 0) {
+    log_info("BsmService", "rebuilt vol surfaces",
+             {{"rebuilt", rebuilt},
+              {"surfaces", surfaces_.size()},
+              {"contracts_on_surface", from_surface}});
+  }
+
+  // Fitting the smiles can take a while; the calibration thread does it and
+  // republishes these rows with the result. Until then they carry the last
+  // published smiles.
+  {
+    std::lock_guard<std::mutex> lock(calibration_mutex_);
+    pending_quotes_ = std::move(option_quotes);
+    quotes_pending_ = true;
+    loaded_params_ = new_params;
+    publish_params(std::move(new_params));
+  }
+  calibration_cv_.notify_one();
+
+  positions_.set_positions(positions);
+  return true;
+}
 
-    std::unordered_map<std::string, BsmParams> new_params;
+std::size_t BsmService::publish_params(
+    std::unordered_map<long long, BsmParams> params) {
+  const std::size_t from_smile = smiles_ ? smiles_->apply(params) : 0;
+  if (!snapshot_path_.empty()) {
+    write_params_snapshot(snapshot_path_, params);
+  }
+  install_params(std::move(params));
+  return from_smile;
+}
 
-    int rows = PQntuples(res);
-    for (int i = 0; i < rows; ++i) {
-      std::string ticker = PQgetvalue(res, i, 0);
-      BsmParams p;
-      p.K = std::atof(PQgetvalue(res, i, 1));
-      p.r = std::atof(PQgetvalue(res, i, 2));
-      p.q = std::atof(PQgetvalue(res, i, 3));
-      p.sigma = std::atof(PQgetvalue(res, i, 4));
-      p.T = std::atof(PQgetvalue(res, i, 5));
-      p.ticker_id = std::atoll(PQgetvalue(res, i, 6));
-      p.conf_id = std::atoll(PQgetvalue(res, i, 7));
+bool BsmService::adopt_tickers(PGconn *conn,
+                               const std::vector<long long> &ticker_ids) {
+  std::unordered_map<long long, BsmParams> rows;
+  if (!conn || !load_params(conn, bigint_array(ticker_ids), rows)) {
+    return false;
+  }
+  surfaces_.apply(rows);
 
-      new_params[ticker] = p;
+  // Added beside the installed contracts, so the price cache survives; the
+  // next full reload brings the tickers' surfaces, quotes and positions.
+  ContractCompiler compiler;
+  HestonSlices slices;
+  std::unordered_map<std::string, std::vector<Contract>> contracts;
+  {
+    std::lock_guard<std::mutex> lock(calibration_mutex_);
+    for (const auto &entry : rows) {
+      loaded_params_[entry.first] = entry.second;
     }
+    if (smiles_) {
+      smiles_->apply(rows);
+    }
+  }
+  for (const auto &entry : rows) {
+    contracts[entry.second.ticker].push_back(
+        make_contract(compiler, slices, entry.second));
+  }
+  for (auto &entry : contracts) {
+    std::sort(entry.second.begin(), entry.second.end(),
+              [](const Contract &l, const Contract &r) {
+                return l.conf_id < r.conf_id;
+              });
+  }
+  {
+    std::lock_guard<std::mutex> lock(params_mutex_);
+    ParamsSet set = *params_;
+    for (auto &entry : contracts) {
+      set.emplace(entry.first, make_ticker_params(std::move(entry.second),
+                                                  /*adopted=*/true));
+    }
+    publish_params_set(std::move(set));
+  }
+  log_info("BsmService", "adopted tickers",
+           {{"tickers", ticker_ids.size()}, {"contracts", rows.size()}});
+  return true;
+}
 
+void BsmService::calibration_thread() {
+  std::size_t last_slices = 0;
+  std::unique_lock<std::mutex> lock(calibration_mutex_);
+  while (true) {
+    calibration_cv_.wait(lock,
+                         [this] { return !running_ || quotes_pending_; });
+    if (!running_) {
+      break;
+    }
+    std::vector<OptionQuotePoint> quotes = std::move(pending_quotes_);
+    pending_quotes_.clear();
+    quotes_pending_ = false;
+    if (!calibrator_ && quotes.empty()) {
+      continue;
+    }
+    lock.unlock();
+
+    if (!calibrator_) {
+      calibration_pool_ = std::make_unique<ThreadPool>(calibration_threads_);
+      calibrator_ = std::make_unique<SmileCalibrator>(*calibration_pool_);
+    }
+    const CalibrationStats stats = calibrator_->update(quotes);
+    // Unchanged smiles are already on the installed rows; republishing
+    // would only flush the price cache.
+    const bool changed = stats.fitted > 0 || stats.slices != last_slices;
+    last_slices = stats.slices;
+    std::shared_ptr<const SmileCalibrator> smiles;
+    if (changed) {
+      smiles = std::make_shared<const SmileCalibrator>(*calibrator_);
+    }
+
+    lock.lock();
+    ++calibration_cycles_;
+    last_calibration_ms_ = stats.wall_ms;
+    if (changed) {
+      smiles_ = std::move(smiles);
+      const std::size_t from_smile = publish_params(loaded_params_);
+      log_info("BsmService", "calibrated smiles",
+               {{"fitted", stats.fitted},
+                {"reused", stats.reused},
+                {"failed", stats.failed},
+                {"wall_ms", stats.wall_ms},
+                {"contracts_on_smile", from_smile}});
+    }
+  }
+}
+
+bool BsmService::load_params(
+    PGconn *conn, const std::string &ticker_ids,
+    std::unordered_map<long long, BsmParams> &params) {
+  static const char *kParamsQuery =
+      "SELECT t.name, p.strike, p.rate, p.dividend_yield, "
+      "p.volatility, p.maturity_years, "
+      "       p.ticker_id, p.id, p.model, p.lattice_steps, "
+      "       p.heston_kappa, p.heston_theta, p.heston_xi, p.heston_rho, "
+      "       p.heston_v0, p.vol_source "
+      "FROM bsm_params p "
+      "JOIN ticker t ON t.id = p.ticker_id";
+
+  PGresult *res = nullptr;
+  if (!ticker_ids.empty()) {
+    const std::string query =
+        std::string(kParamsQuery) + " WHERE p.ticker_id = ANY($1::bigint[]);";
+    const char *values[1] = {ticker_ids.c_str()};
+    res = PQexecParams(conn, query.c_str(), 1, nullptr, values, nullptr,
+                       nullptr, 0);
+  } else {
+    res = PQexec(conn, (std::string(kParamsQuery) + ";").c_str());
+  }
+
+  if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+    log_error("BsmService", "params query failed",
+              {{"error", PQerrorMessage(conn)}});
     PQclear(res);
+    return false;
+  }
 
-    {
-      std::lock_guard<std::mutex> lock(params_mutex_);
-      params_ = std::move(new_params);
+  int rows = PQntuples(res);
+  params.reserve(static_cast<std::size_t>(rows));
+  for (int i = 0; i < rows; ++i) {
+    std::string ticker = PQgetvalue(res, i, 0);
+    BsmParams p;
+    p.K = std::atof(PQgetvalue(res, i, 1));
+    p.r = std::atof(PQgetvalue(res, i, 2));
+    p.q = std::atof(PQgetvalue(res, i, 3));
+    p.sigma = std::atof(PQgetvalue(res, i, 4));
+    p.T = std::atof(PQgetvalue(res, i, 5));
+    p.ticker_id = std::atoll(PQgetvalue(res, i, 6));
+    p.conf_id = std::atoll(PQgetvalue(res, i, 7));
+    p.ticker = ticker;
+    if (!parse_pricing_model(PQgetvalue(res, i, 8), p.model)) {
+      log_warn("BsmService", "skipping params row with unknown model",
+               {{"ticker", ticker}, {"model", PQgetvalue(res, i, 8)}});
+      continue;
+    }
+    if (!PQgetisnull(res, i, 9)) {
+      p.lattice_steps =
+          static_cast<std::uint32_t>(std::atol(PQgetvalue(res, i, 9)));
+    }
+    if (!parse_vol_source(PQgetvalue(res, i, 15), p.vol_source)) {
+      log_warn("BsmService", "skipping params row with unknown vol source",
+               {{"ticker", ticker}, {"vol_source", PQgetvalue(res, i, 15)}});
+      continue;
+    }
+    if (p.model == PricingModel::Heston) {
+      bool complete = true;
+      double *fields[] = {&p.heston.kappa, &p.heston.theta, &p.heston.xi,
+                          &p.heston.rho, &p.heston.v0};
+      for (int f = 0; f < 5; ++f) {
+        complete = complete && !PQgetisnull(res, i, 10 + f);
+        *fields[f] = std::atof(PQgetvalue(res, i, 10 + f));
+      }
+      if (!complete) {
+        log_warn("BsmService", "skipping heston row without heston params",
+                 {{"ticker", ticker}});
+        continue;
+      }
     }
 
-    std::this_thread::sleep_for(std::chrono::seconds(reload_interval_sec_));
+    params[p.conf_id] = std::move(p);
   }
 
-  if (conn) {
-    PQfinish(conn);
+  PQclear(res);
+  return true;
+}
+
+bool BsmService::load_vol_surface_points(PGconn *conn,
+                                         const std::string &ticker_ids,
+                                         std::vector<VolPoint> &points) {
+  const char *values[1] = {ticker_ids.c_str()};
+  PGresult *res = PQexecParams(
+      conn,
+      "SELECT ticker_id, strike, maturity_years, volatility "
+      "FROM vol_surface_point WHERE ticker_id = ANY($1::bigint[]);",
+      1, nullptr, values, nullptr, nullptr, 0);
+  if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+    log_error("BsmService", "vol surface query failed",
+              {{"error", PQerrorMessage(conn)}});
+    PQclear(res);
+    return false;
+  }
+
+  int rows = PQntuples(res);
+  points.reserve(static_cast<std::size_t>(rows));
+  for (int i = 0; i < rows; ++i) {
+    VolPoint p;
+    p.ticker_id = std::atoll(PQgetvalue(res, i, 0));
+    p.K = std::atof(PQgetvalue(res, i, 1));
+    p.T = std::atof(PQgetvalue(res, i, 2));
+    p.sigma = std::atof(PQgetvalue(res, i, 3));
+    points.push_back(p);
+  }
+
+  PQclear(res);
+  return true;
+}
+
+bool BsmService::load_option_quotes(PGconn *conn,
+                                    const std::string &ticker_ids,
+                                    std::vector<OptionQuotePoint> &quotes) {
+  const char *values[1] = {ticker_ids.c_str()};
+  PGresult *res = PQexecParams(
+      conn,
+      "SELECT ticker_id, strike, maturity_years, price, underlying_price, "
+      "rate, dividend_yield "
+      "FROM option_quote WHERE ticker_id = ANY($1::bigint[]);",
+      1, nullptr, values, nullptr, nullptr, 0);
+  if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+    log_error("BsmService", "option quote query failed",
+              {{"error", PQerrorMessage(conn)}});
+    PQclear(res);
+    return false;
+  }
+
+  int rows = PQntuples(res);
+  quotes.reserve(static_cast<std::size_t>(rows));
+  for (int i = 0; i < rows; ++i) {
+    OptionQuotePoint q;
+    q.ticker_id = std::atoll(PQgetvalue(res, i, 0));
+    q.K = std::atof(PQgetvalue(res, i, 1));
+    q.T = std::atof(PQgetvalue(res, i, 2));
+    q.price = std::atof(PQgetvalue(res, i, 3));
+    q.S = std::atof(PQgetvalue(res, i, 4));
+    q.r = std::atof(PQgetvalue(res, i, 5));
+    q.q = std::atof(PQgetvalue(res, i, 6));
+    quotes.push_back(q);
+  }
+
+  PQclear(res);
+  return true;
+}
+
+bool BsmService::load_positions(PGconn *conn,
+                                const std::string &ticker_ids,
+                                std::vector<Position> &positions) {
+  const char *values[1] = {ticker_ids.c_str()};
+  PGresult *res = PQexecParams(
+      conn,
+      "SELECT po.conf_id, p.ticker_id, t.name, po.quantity "
+      "FROM position po "
+      "JOIN bsm_params p ON p.id = po.conf_id "
+      "JOIN ticker t ON t.id = p.ticker_id "
+      "WHERE p.ticker_id = ANY($1::bigint[]);",
+      1, nullptr, values, nullptr, nullptr, 0);
+  if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+    log_error("BsmService", "position query failed",
+              {{"error", PQerrorMessage(conn)}});
+    PQclear(res);
+    return false;
+  }
+
+  int rows = PQntuples(res);
+  positions.reserve(static_cast<std::size_t>(rows));
+  for (int i = 0; i < rows; ++i) {
+    Position p;
+    p.conf_id = std::atoll(PQgetvalue(res, i, 0));
+    p.ticker_id = std::atoll(PQgetvalue(res, i, 1));
+    p.ticker = PQgetvalue(res, i, 2);
+    p.quantity = std::atof(PQgetvalue(res, i, 3));
+    positions.push_back(std::move(p));
+  }
+
+  PQclear(res);
+  return true;
+}
+
+void BsmService::persist_realized_vol(PGconn *conn) {
+  const auto now = std::chrono::steady_clock::now();
+  if (realized_persist_sec_ <= 0 ||
+      now - last_realized_persist_ <
+          std::chrono::seconds(realized_persist_sec_)) {
+    return;
+  }
+  last_realized_persist_ = now;
+
+  std::unordered_map<std::string, long long> ticker_ids;
+  {
+    std::lock_guard<std::mutex> lock(params_mutex_);
+    for (const auto &entry : *params_) {
+      ticker_ids.emplace(entry.first,
+                         entry.second->contracts.front().ticker_id);
+    }
+  }
+  // One statement over four arrays; a vol that is not ready goes in as NULL.
+  std::string ids = "{", ewma = "{", window = "{", returns = "{";
+  std::size_t rows = 0;
+  char buf[32];
+  auto vol = [&](bool ready, double v) {
+    if (!ready) {
+      return std::string("NULL");
+    }
+    std::snprintf(buf, sizeof(buf), "%.10g", v);
+    return std::string(buf);
+  };
+  for (const auto &entry : realized_->snapshot()) {
+    auto id = ticker_ids.find(entry.first);
+    if (id == ticker_ids.end() || entry.second.returns == 0) {
+      continue;
+    }
+    const char *sep = rows++ ? "," : "";
+    ids += sep + std::to_string(id->second);
+    ewma += sep + vol(entry.second.ewma_ready, entry.second.ewma);
+    window += sep + vol(entry.second.window_ready, entry.second.window);
+    returns += sep + std::to_string(entry.second.returns);
+  }
+  if (rows == 0) {
+    return;
+  }
+  ids += '}';
+  ewma += '}';
+  window += '}';
+  returns += '}';
+
+  const char *values[4] = {ids.c_str(), ewma.c_str(), window.c_str(),
+                           returns.c_str()};
+  PGresult *res = PQexecParams(
+      conn,
+      "INSERT INTO realized_vol (ticker_id, ewma_vol, window_vol, returns) "
+      "SELECT * FROM unnest($1::bigint[], $2::float8[], $3::float8[], "
+      "$4::bigint[]) "
+      "ON CONFLICT (ticker_id) DO UPDATE SET ewma_vol = EXCLUDED.ewma_vol, "
+      "window_vol = EXCLUDED.window_vol, returns = EXCLUDED.returns, "
+      "updated_at = now();",
+      4, nullptr, values, nullptr, nullptr, 0);
+  if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+    log_warn("BsmService", "realized vol upsert failed",
+             {{"error", PQerrorMessage(conn)}});
+  }
+  PQclear(res);
+}
+
+void BsmService::wait_for_retry() {
+  std::unique_lock<std::mutex> lock(config_mutex_);
+  config_cv_.wait_for(lock, std::chrono::seconds(5),
+                      [this] { return !running_; });
+}
+
+bool BsmService::load_owned_ticker_ids(PGconn *conn, std::string &ids) {
+  PGresult *res = PQexec(conn, "SELECT id, name FROM ticker;");
+  if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+    log_error("BsmService", "ticker query failed",
+              {{"error", PQerrorMessage(conn)}});
+    PQclear(res);
+    return false;
+  }
+
+  ShardRing ring;
+  for (int s = 0; s < shard_count_; ++s) {
+    ring.add_shard(s);
+  }
+
+  std::unordered_map<std::string, long long> known;
+  const int rows = PQntuples(res);
+  known.reserve(static_cast<std::size_t>(rows));
+  for (int i = 0; i < rows; ++i) {
+    known.emplace(PQgetvalue(res, i, 1), std::atoll(PQgetvalue(res, i, 0)));
+  }
+  PQclear(res);
+
+  // An adoption lapses once its ticker has gone a reload interval without
+  // a tick (the feed moved it back) or has left the ticker table.
+  const auto stale = std::chrono::steady_clock::now() -
+                     std::chrono::seconds(reload_interval_sec_);
+  std::vector<long long> owned;
+  {
+    std::lock_guard<std::mutex> lock(params_mutex_);
+    for (auto it = adopted_tickers_.begin(); it != adopted_tickers_.end();) {
+      if (it->second < stale || known.count(it->first) == 0) {
+        it = adopted_tickers_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    for (const auto &entry : known) {
+      if (ring.owner(entry.first) == shard_id_ ||
+          adopted_tickers_.count(entry.first) != 0) {
+        owned.push_back(entry.second);
+      }
+    }
+    known_tickers_ = std::move(known);
+  }
+  ids = bigint_array(owned);
+  return true;
+}
+
+void BsmService::maintain_ticker_price(PGconn *conn) {
+  const auto now = std::chrono::steady_clock::now();
+  if (partitions_maintained_ &&
+      now - last_partition_maintenance_ < kPartitionMaintenanceInterval) {
+    return;
+  }
+  partitions_maintained_ = true;
+  last_partition_maintenance_ = now;
+
+  const std::string days_ahead = std::to_string(kPartitionDaysAhead);
+  const char *ahead[1] = {days_ahead.c_str()};
+  PGresult *res =
+      PQexecParams(conn, "SELECT ticker_price_ensure_partitions($1::int);", 1,
+                   nullptr, ahead, nullptr, nullptr, 0);
+  if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+    log_warn("BsmService", "ticker_price partition maintenance failed",
+             {{"error", PQerrorMessage(conn)}});
+    PQclear(res);
+    return;
+  }
+  const int created = std::atoi(PQgetvalue(res, 0, 0));
+  PQclear(res);
+
+  int dropped = 0;
+  if (retention_days_ > 0) {
+    const std::string days = std::to_string(retention_days_);
+    const char *values[1] = {days.c_str()};
+    res = PQexecParams(conn,
+                       "SELECT ticker_price_drop_before("
+                       "date_trunc('day', now() AT TIME ZONE 'UTC') "
+                       "AT TIME ZONE 'UTC' - make_interval(days => $1::int));",
+                       1, nullptr, values, nullptr, nullptr, 0);
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+      log_warn("BsmService", "ticker_price retention failed",
+               {{"error", PQerrorMessage(conn)}});
+    } else {
+      dropped = std::atoi(PQgetvalue(res, 0, 0));
+    }
+    PQclear(res);
+  }
+  if (created > 0 || dropped > 0) {
+    log_info("BsmService", "ticker_price partitions maintained",
+             {{"created", created}, {"dropped", dropped}});
   }
 }
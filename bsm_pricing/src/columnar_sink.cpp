@@ -0,0 +1,483 @@
+#include "columnar_sink.hpp"
+
+#include "async_logger.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kFileMagic[8] = {'B', 'S', 'M', 'C', 'O', 'L', '0', '1'};
+constexpr char kBatchMagic[4] = {'B', 'T', 'C', 'H'};
+constexpr std::size_t kAlign = 8;
+constexpr std::uint8_t kZeros[kAlign] = {};
+
+struct FileHeader {
+  char magic[8];
+  std::int64_t created;
+};
+
+struct BatchHeader {
+  char magic[4];
+  std::uint32_t rows;
+  std::uint32_t ticker_dict;
+  std::uint32_t conf_dict;
+  std::uint8_t ticker_width;
+  std::uint8_t conf_width;
+  std::uint16_t reserved;
+  std::uint32_t column_bytes[kColumnarColumns];
+  std::uint32_t reserved2;
+};
+
+static_assert(sizeof(FileHeader) == 16, "columnar file header layout");
+static_assert(sizeof(BatchHeader) == 64, "columnar batch header layout");
+
+std::size_t padded(std::size_t n) { return (n + kAlign - 1) & ~(kAlign - 1); }
+
+template <typename T> void put(std::vector<std::uint8_t> &out, T v) {
+  const auto *p = reinterpret_cast<const std::uint8_t *>(&v);
+  out.insert(out.end(), p, p + sizeof(T));
+}
+
+void encode_deltas(const std::vector<std::int64_t> &in,
+                   std::vector<std::uint8_t> &out) {
+  out.clear();
+  put(out, in.front());
+  for (std::size_t i = 1; i < in.size(); ++i) {
+    const std::int64_t d = in[i] - in[i - 1];
+    std::uint64_t zz = (static_cast<std::uint64_t>(d) << 1) ^
+                       static_cast<std::uint64_t>(d >> 63);
+    while (zz >= 0x80) {
+      out.push_back(static_cast<std::uint8_t>(zz | 0x80));
+      zz >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(zz));
+  }
+}
+
+// Dictionary in first-seen order, then the narrowest indices that fit it.
+void encode_dictionary(const std::vector<std::int64_t> &in,
+                       std::unordered_map<std::int64_t, std::uint32_t> &dict,
+                       std::vector<std::uint8_t> &out, std::uint32_t &size,
+                       std::uint8_t &width) {
+  dict.clear();
+  out.clear();
+  for (std::int64_t v : in) {
+    if (dict.emplace(v, static_cast<std::uint32_t>(dict.size())).second) {
+      put(out, v);
+    }
+  }
+  size = static_cast<std::uint32_t>(dict.size());
+  width = size <= 0x100 ? 1 : size <= 0x10000 ? 2 : 4;
+  for (std::int64_t v : in) {
+    const std::uint32_t index = dict.find(v)->second;
+    if (width == 1) {
+      out.push_back(static_cast<std::uint8_t>(index));
+    } else if (width == 2) {
+      put(out, static_cast<std::uint16_t>(index));
+    } else {
+      put(out, index);
+    }
+  }
+}
+
+bool write_all(int fd, iovec *iov, int count) {
+  while (count > 0) {
+    ssize_t n = ::writev(fd, iov, count);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    auto left = static_cast<std::size_t>(n);
+    while (count > 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+      ++iov;
+      --count;
+    }
+    if (count > 0) {
+      iov->iov_base = static_cast<char *>(iov->iov_base) + left;
+      iov->iov_len -= left;
+    }
+  }
+  return true;
+}
+
+bool has_prefix(const std::string &name, const std::string &prefix) {
+  return name.size() > prefix.size() + 1 &&
+         name.compare(0, prefix.size(), prefix) == 0 &&
+         name[prefix.size()] == '_';
+}
+
+struct Reader {
+  const std::uint8_t *data;
+  std::size_t size;
+  std::size_t pos;
+
+  bool take(std::size_t n, const std::uint8_t *&p) {
+    if (size - pos < n) {
+      return false;
+    }
+    p = data + pos;
+    pos += n;
+    return true;
+  }
+};
+
+template <typename T> T load(const std::uint8_t *p) {
+  T v;
+  std::memcpy(&v, p, sizeof(T));
+  return v;
+}
+
+bool decode_deltas(const std::uint8_t *p, std::size_t bytes,
+                   std::size_t rows, std::vector<OptionQuote> &out,
+                   std::size_t first) {
+  if (bytes < sizeof(std::int64_t)) {
+    return false;
+  }
+  std::int64_t ts = load<std::int64_t>(p);
+  out[first].timestamp = ts;
+  std::size_t pos = sizeof(std::int64_t);
+  for (std::size_t i = 1; i < rows; ++i) {
+    std::uint64_t zz = 0;
+    for (int shift = 0;; shift += 7) {
+      if (pos >= bytes || shift > 63) {
+        return false;
+      }
+      const std::uint8_t b = p[pos++];
+      zz |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+      if (!(b & 0x80)) {
+        break;
+      }
+    }
+    ts += static_cast<std::int64_t>((zz >> 1) ^ (~(zz & 1) + 1));
+    out[first + i].timestamp = ts;
+  }
+  return pos == bytes;
+}
+
+bool decode_dictionary(const std::uint8_t *p, std::size_t bytes,
+                       std::size_t rows, std::uint32_t size,
+                       std::uint8_t width, std::vector<OptionQuote> &out,
+                       std::size_t first, long long OptionQuote::*field) {
+  if ((width != 1 && width != 2 && width != 4) ||
+      bytes != size * sizeof(std::int64_t) + rows * width) {
+    return false;
+  }
+  const std::uint8_t *indices = p + size * sizeof(std::int64_t);
+  for (std::size_t i = 0; i < rows; ++i) {
+    const std::uint32_t index =
+        width == 1   ? indices[i]
+        : width == 2 ? load<std::uint16_t>(indices + 2 * i)
+                     : load<std::uint32_t>(indices + 4 * i);
+    if (index >= size) {
+      return false;
+    }
+    out[first + i].*field =
+        load<std::int64_t>(p + index * sizeof(std::int64_t));
+  }
+  return true;
+}
+
+} // namespace
+
+bool read_columnar_file(const std::string &path,
+                        std::vector<OptionQuote> &out) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<std::size_t>(st.st_size) < sizeof(FileHeader)) {
+    ::close(fd);
+    return false;
+  }
+  const std::size_t size = static_cast<std::size_t>(st.st_size);
+  void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  Reader r{static_cast<const std::uint8_t *>(map), size, 0};
+  const std::uint8_t *p = nullptr;
+  r.take(sizeof(FileHeader), p);
+  bool ok = std::memcmp(p, kFileMagic, sizeof(kFileMagic)) == 0;
+  double OptionQuote::*const values[7] = {
+      &OptionQuote::underlying_price, &OptionQuote::option_price,
+      &OptionQuote::delta,            &OptionQuote::gamma,
+      &OptionQuote::vega,             &OptionQuote::theta,
+      &OptionQuote::rho};
+  while (ok && r.pos < r.size) {
+    if (!r.take(sizeof(BatchHeader), p)) {
+      ok = false;
+      break;
+    }
+    const BatchHeader h = load<BatchHeader>(p);
+    // Every row carries seven doubles, which bounds rows before resizing.
+    if (std::memcmp(h.magic, kBatchMagic, sizeof(kBatchMagic)) != 0 ||
+        h.rows == 0 || h.rows > (r.size - r.pos) / (7 * sizeof(double))) {
+      ok = false;
+      break;
+    }
+    const std::size_t first = out.size();
+    out.resize(first + h.rows);
+    const std::uint8_t *col[kColumnarColumns];
+    for (std::size_t c = 0; c < kColumnarColumns && ok; ++c) {
+      ok = r.take(padded(h.column_bytes[c]), col[c]);
+    }
+    ok = ok && decode_deltas(col[0], h.column_bytes[0], h.rows, out, first) &&
+         decode_dictionary(col[1], h.column_bytes[1], h.rows, h.ticker_dict,
+                           h.ticker_width, out, first,
+                           &OptionQuote::ticker_id) &&
+         decode_dictionary(col[2], h.column_bytes[2], h.rows, h.conf_dict,
+                           h.conf_width, out, first, &OptionQuote::conf_id);
+    for (std::size_t v = 0; v < 7 && ok; ++v) {
+      ok = h.column_bytes[3 + v] == h.rows * sizeof(double);
+      for (std::size_t i = 0; i < h.rows && ok; ++i) {
+        out[first + i].*values[v] =
+            load<double>(col[3 + v] + i * sizeof(double));
+      }
+    }
+    for (std::size_t i = first; i < out.size(); ++i) {
+      out[i].status = "OK";
+    }
+  }
+  ::munmap(map, size);
+  return ok;
+}
+
+void ColumnarSink::Batch::clear() {
+  timestamp.clear();
+  ticker_id.clear();
+  conf_id.clear();
+  for (auto &v : values) {
+    v.clear();
+  }
+}
+
+ColumnarSink::ColumnarSink(const ColumnarSinkConfig &config)
+    : config_(config) {
+  config_.batch_rows = std::max<std::size_t>(config_.batch_rows, 1);
+  config_.flush_ms = std::max(config_.flush_ms, 1);
+  config_.file_rows = std::max<std::uint64_t>(config_.file_rows, 1);
+  if (::mkdir(config_.dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    throw std::runtime_error("cannot create columnar directory " +
+                             config_.dir + ": " + std::strerror(errno));
+  }
+  DIR *d = ::opendir(config_.dir.c_str());
+  if (!d) {
+    throw std::runtime_error("cannot open columnar directory " + config_.dir +
+                             ": " + std::strerror(errno));
+  }
+  // Continue numbering after files an earlier run left, .part ones too.
+  while (dirent *e = ::readdir(d)) {
+    const std::string name = e->d_name;
+    if (has_prefix(name, config_.prefix)) {
+      next_seq_ = std::max<std::uint64_t>(
+          next_seq_,
+          std::strtoull(name.c_str() + config_.prefix.size() + 1, nullptr,
+                        10) +
+              1);
+    }
+  }
+  ::closedir(d);
+
+  for (Batch *b : {&active_, &spare_}) {
+    b->timestamp.reserve(config_.batch_rows);
+    b->ticker_id.reserve(config_.batch_rows);
+    b->conf_id.reserve(config_.batch_rows);
+    for (auto &v : b->values) {
+      v.reserve(config_.batch_rows);
+    }
+  }
+  flusher_thread_ = std::thread(&ColumnarSink::flusher, this);
+}
+
+ColumnarSink::~ColumnarSink() { close(); }
+
+void ColumnarSink::append(const OptionQuote &q) {
+  if (q.status != "OK") {
+    return;
+  }
+  bool full;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (active_.size() == 0) {
+      active_.opened = std::chrono::steady_clock::now();
+    }
+    active_.timestamp.push_back(q.timestamp);
+    active_.ticker_id.push_back(q.ticker_id);
+    active_.conf_id.push_back(q.conf_id);
+    active_.values[0].push_back(q.underlying_price);
+    active_.values[1].push_back(q.option_price);
+    active_.values[2].push_back(q.delta);
+    active_.values[3].push_back(q.gamma);
+    active_.values[4].push_back(q.vega);
+    active_.values[5].push_back(q.theta);
+    active_.values[6].push_back(q.rho);
+    full = active_.size() >= config_.batch_rows;
+  }
+  if (full) {
+    flush(/*force=*/true);
+  }
+}
+
+void ColumnarSink::flush(bool force) {
+  std::lock_guard<std::mutex> io(io_mutex_);
+  const auto now = std::chrono::steady_clock::now();
+  bool swapped = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (active_.size() > 0 &&
+        (force || now - active_.opened >=
+                      std::chrono::milliseconds(config_.flush_ms))) {
+      std::swap(active_, spare_);
+      swapped = true;
+    }
+  }
+  if (swapped) {
+    write_batch(spare_);
+    spare_.clear();
+  }
+  if (fd_ >= 0 && (file_rows_ >= config_.file_rows ||
+                   now - file_opened_ >=
+                       std::chrono::seconds(config_.rotate_sec))) {
+    close_file();
+  }
+}
+
+void ColumnarSink::write_batch(Batch &batch) {
+  if (fd_ < 0 && !open_file()) {
+    return;
+  }
+  const std::size_t rows = batch.size();
+  BatchHeader h{};
+  std::memcpy(h.magic, kBatchMagic, sizeof(kBatchMagic));
+  h.rows = static_cast<std::uint32_t>(rows);
+  encode_deltas(batch.timestamp, encoded_[0]);
+  encode_dictionary(batch.ticker_id, dict_, encoded_[1], h.ticker_dict,
+                    h.ticker_width);
+  encode_dictionary(batch.conf_id, dict_, encoded_[2], h.conf_dict,
+                    h.conf_width);
+
+  iovec iov[1 + 2 * kColumnarColumns];
+  int count = 0;
+  std::size_t bytes = sizeof(h);
+  iov[count++] = {&h, sizeof(h)};
+  auto add = [&](std::size_t c, const void *data, std::size_t len) {
+    h.column_bytes[c] = static_cast<std::uint32_t>(len);
+    iov[count++] = {const_cast<void *>(data), len};
+    if (padded(len) != len) {
+      iov[count++] = {const_cast<std::uint8_t *>(kZeros), padded(len) - len};
+    }
+    bytes += padded(len);
+  };
+  for (std::size_t c = 0; c < 3; ++c) {
+    add(c, encoded_[c].data(), encoded_[c].size());
+  }
+  for (std::size_t v = 0; v < 7; ++v) {
+    add(3 + v, batch.values[v].data(), rows * sizeof(double));
+  }
+
+  const off_t start = ::lseek(fd_, 0, SEEK_CUR);
+  if (!write_all(fd_, iov, count)) {
+    log_error("ColumnarSink", "write failed, dropping batch",
+              {{"path", path_}, {"rows", rows}, {"error", std::strerror(errno)}});
+    // Cut off whatever part of the batch made it, so the file stays whole.
+    if (::ftruncate(fd_, start) != 0 || ::lseek(fd_, start, SEEK_SET) < 0) {
+      close_file();
+    }
+    return;
+  }
+  file_rows_ += rows;
+  rows_written_ += rows;
+  bytes_written_ += bytes;
+  ++batches_written_;
+}
+
+bool ColumnarSink::open_file() {
+  char name[32];
+  std::snprintf(name, sizeof(name), "_%020llu.bsmcol",
+                static_cast<unsigned long long>(next_seq_));
+  const std::string path = config_.dir + "/" + config_.prefix + name;
+  const std::string part = path + ".part";
+  int fd = ::open(part.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  FileHeader header{};
+  std::memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+  header.created = static_cast<std::int64_t>(std::time(nullptr));
+  iovec iov{&header, sizeof(header)};
+  if (fd < 0 || !write_all(fd, &iov, 1)) {
+    log_error("ColumnarSink", "cannot create file",
+              {{"path", part}, {"error", std::strerror(errno)}});
+    if (fd >= 0) {
+      ::close(fd);
+      ::unlink(part.c_str());
+    }
+    return false;
+  }
+  ++next_seq_;
+  fd_ = fd;
+  path_ = path;
+  file_rows_ = 0;
+  file_opened_ = std::chrono::steady_clock::now();
+  bytes_written_ += sizeof(header);
+  return true;
+}
+
+void ColumnarSink::close_file() {
+  if (fd_ < 0) {
+    return;
+  }
+  ::fdatasync(fd_);
+  ::close(fd_);
+  fd_ = -1;
+  if (::rename((path_ + ".part").c_str(), path_.c_str()) != 0) {
+    log_error("ColumnarSink", "cannot rename closed file",
+              {{"path", path_}, {"error", std::strerror(errno)}});
+    return;
+  }
+  ++files_closed_;
+}
+
+void ColumnarSink::flusher() {
+  std::unique_lock<std::mutex> lock(flusher_mutex_);
+  while (!stopping_) {
+    flusher_cv_.wait_for(lock,
+                         std::chrono::milliseconds(std::max(config_.flush_ms / 2, 1)));
+    if (stopping_) {
+      break;
+    }
+    lock.unlock();
+    flush(/*force=*/false);
+    lock.lock();
+  }
+}
+
+void ColumnarSink::close() {
+  {
+    std::lock_guard<std::mutex> lock(flusher_mutex_);
+    stopping_ = true;
+  }
+  flusher_cv_.notify_all();
+  if (flusher_thread_.joinable()) {
+    flusher_thread_.join();
+  }
+  flush(/*force=*/true);
+  std::lock_guard<std::mutex> io(io_mutex_);
+  close_file();
+}
@@ -0,0 +1,47 @@
+#include "compiled_contract.hpp"
+
+#include <cstring>
+
+namespace {
+
+std::uint64_t bits(double v) {
+  std::uint64_t out;
+  std::memcpy(&out, &v, sizeof(out));
+  return out;
+}
+
+} // namespace
+
+CompiledContract ContractCompiler::compile(const BsmParams &p) {
+  CompiledContract c;
+  c.K = p.K;
+  c.r = p.r;
+  c.q = p.q;
+  c.sigma = p.sigma;
+  c.T = p.T;
+  c.valid = p.K > 0.0 && p.sigma > 0.0 && p.T > 0.0;
+  if (!c.valid) {
+    return c;
+  }
+
+  const Key key{bits(p.T), bits(p.r), bits(p.q)};
+  auto it = factors_.find(key);
+  if (it == factors_.end()) {
+    Factors f;
+    f.sqrtT = std::sqrt(p.T);
+    f.df_r = std::exp(-p.r * p.T);
+    f.df_q = std::exp(-p.q * p.T);
+    it = factors_.emplace(key, f).first;
+  }
+  const Factors &f = it->second;
+
+  c.log_K = std::log(p.K);
+  c.drift = (p.r - p.q + 0.5 * p.sigma * p.sigma) * p.T;
+  c.sqrtT = f.sqrtT;
+  c.sigma_sqrtT = p.sigma * f.sqrtT;
+  c.inv_sigma_sqrtT = 1.0 / c.sigma_sqrtT;
+  c.half_sigma_over_sqrtT = p.sigma / (2.0 * f.sqrtT);
+  c.df_q = f.df_q;
+  c.K_df_r = p.K * f.df_r;
+  return c;
+}
@@ -0,0 +1,199 @@
+#include "lattice.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+struct Rollback {
+  double price{};
+  double delta{};
+  double gamma{};
+  double theta{};
+};
+
+bool early_exercise_possible(const LatticeContract &c) {
+  return c.q > 0.0 || c.r < 0.0;
+}
+
+bool valid(const LatticeContract &c) {
+  return c.S > 0.0 && c.K > 0.0 && c.sigma > 0.0 && c.T > 0.0;
+}
+
+std::size_t steps_of(const LatticeContract &c) {
+  const std::size_t n = std::max<std::size_t>(c.steps, 4);
+  return n + (n & 1);
+}
+
+// Delta and gamma from three node values around the spot.
+void slope_and_curvature(const double *s, const double *v, Rollback &out) {
+  const double up = (v[2] - v[1]) / (s[2] - s[1]);
+  const double down = (v[1] - v[0]) / (s[1] - s[0]);
+  out.delta = (v[2] - v[0]) / (s[2] - s[0]);
+  out.gamma = (up - down) / (0.5 * (s[2] - s[0]));
+}
+
+// Cox-Ross-Rubinstein. Node i of slice j sits at S u^(2i - j); moving back a
+// slice multiplies every node's spot by u, so spots and values are both
+// updated in place and the inner loop has no loop-carried dependency.
+Rollback binomial(const LatticeContract &c, std::size_t n, bool greeks) {
+  thread_local std::vector<double> s;
+  thread_local std::vector<double> v;
+
+  const double dt = c.T / static_cast<double>(n);
+  const double step = c.sigma * std::sqrt(dt);
+  const double u = std::exp(step);
+  const double d = 1.0 / u;
+  const double disc = std::exp(-c.r * dt);
+  const double p = (std::exp((c.r - c.q) * dt) - d) / (u - d);
+  const double pu = disc * p;
+  const double pd = disc * (1.0 - p);
+  const double K = c.K;
+
+  s.resize(n);
+  v.resize(n);
+  const double base = static_cast<double>(n - 1);
+  for (std::size_t i = 0; i < n; ++i) {
+    s[i] = c.S * std::exp((2.0 * static_cast<double>(i) - base) * step);
+    v[i] = std::max(
+        OptionPricer::black_scholes_call(s[i], K, c.r, c.q, c.sigma, dt),
+        s[i] - K);
+  }
+
+  Rollback out;
+  double s2[3];
+  double v2[3];
+  for (std::size_t j = n - 1; j-- > 0;) {
+    double *sp = s.data();
+    double *vp = v.data();
+    for (std::size_t i = 0; i <= j; ++i) {
+      sp[i] *= u;
+      vp[i] = std::max(pu * vp[i + 1] + pd * vp[i], sp[i] - K);
+    }
+    if (!greeks) {
+      continue;
+    }
+    if (j == 2) {
+      std::copy(sp, sp + 3, s2);
+      std::copy(vp, vp + 3, v2);
+    } else if (j == 1) {
+      out.delta = (vp[1] - vp[0]) / (sp[1] - sp[0]);
+    }
+  }
+  out.price = v[0];
+  if (greeks) {
+    const double delta = out.delta;
+    slope_and_curvature(s2, v2, out);
+    out.delta = delta;
+    out.theta = (v2[1] - out.price) / (2.0 * dt);
+  }
+  return out;
+}
+
+// Log-space trinomial with dx = sigma sqrt(3 dt). Node i of slice j sits at
+// S exp((i - j) dx), so every slice reads its spots from one shared grid at
+// an offset.
+Rollback trinomial(const LatticeContract &c, std::size_t n, bool greeks) {
+  thread_local std::vector<double> grid;
+  thread_local std::vector<double> v;
+
+  const double dt = c.T / static_cast<double>(n);
+  const double dx = c.sigma * std::sqrt(3.0 * dt);
+  const double nu = c.r - c.q - 0.5 * c.sigma * c.sigma;
+  const double disc = std::exp(-c.r * dt);
+  const double a = (c.sigma * c.sigma * dt + nu * nu * dt * dt) / (dx * dx);
+  const double b = nu * dt / dx;
+  const double pu = disc * 0.5 * (a + b);
+  const double pd = disc * 0.5 * (a - b);
+  const double pm = disc * (1.0 - a);
+  const double K = c.K;
+
+  grid.resize(2 * n + 1);
+  for (std::size_t k = 0; k < grid.size(); ++k) {
+    grid[k] = c.S * std::exp((static_cast<double>(k) -
+                              static_cast<double>(n)) * dx);
+  }
+  const std::size_t last = n - 1;
+  v.resize(2 * last + 1);
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    const double spot = grid[i + 1];
+    v[i] = std::max(
+        OptionPricer::black_scholes_call(spot, K, c.r, c.q, c.sigma, dt),
+        spot - K);
+  }
+
+  Rollback out;
+  for (std::size_t j = last; j-- > 0;) {
+    const double *sp = grid.data() + (n - j);
+    double *vp = v.data();
+    for (std::size_t i = 0; i <= 2 * j; ++i) {
+      vp[i] = std::max(pd * vp[i] + pm * vp[i + 1] + pu * vp[i + 2],
+                       sp[i] - K);
+    }
+    if (greeks && j == 1) {
+      slope_and_curvature(sp, vp, out);
+      out.theta = vp[1];
+    }
+  }
+  out.price = v[0];
+  if (greeks) {
+    out.theta = (out.theta - out.price) / dt;
+  }
+  return out;
+}
+
+Rollback roll_back(const LatticeContract &c, std::size_t n, bool greeks) {
+  return c.kind == LatticeKind::Trinomial ? trinomial(c, n, greeks)
+                                          : binomial(c, n, greeks);
+}
+
+double extrapolated(const LatticeContract &c) {
+  const std::size_t n = steps_of(c);
+  return 2.0 * roll_back(c, n, false).price - roll_back(c, n / 2, false).price;
+}
+
+} // namespace
+
+double american_call(const LatticeContract &c) {
+  if (!valid(c)) {
+    return 0.0;
+  }
+  if (!early_exercise_possible(c)) {
+    return OptionPricer::black_scholes_call(c.S, c.K, c.r, c.q, c.sigma, c.T);
+  }
+  return extrapolated(c);
+}
+
+CallGreeks american_call_greeks(const LatticeContract &c) {
+  CallGreeks g;
+  if (!valid(c)) {
+    return g;
+  }
+  if (!early_exercise_possible(c)) {
+    return OptionPricer::black_scholes_call_greeks(c.S, c.K, c.r, c.q,
+                                                   c.sigma, c.T);
+  }
+
+  const std::size_t n = steps_of(c);
+  const Rollback full = roll_back(c, n, true);
+  g.price = 2.0 * full.price - roll_back(c, n / 2, false).price;
+  g.delta = full.delta;
+  g.gamma = full.gamma;
+  g.theta = full.theta;
+
+  constexpr double kBump = 1e-4;
+  LatticeContract bumped = c;
+  bumped.sigma += kBump;
+  g.vega = (extrapolated(bumped) - g.price) / kBump;
+  bumped = c;
+  bumped.r += kBump;
+  g.rho = (extrapolated(bumped) - g.price) / kBump;
+  return g;
+}
+
+void american_call_batch(ThreadPool &pool, const LatticeContract *contracts,
+                         std::size_t n, double *out) {
+  pool.parallel_for(n,
+                    [&](std::size_t i) { out[i] = american_call(contracts[i]); });
+}
@@ -0,0 +1,161 @@
+#include "line_query_server.hpp"
+
+#include "async_logger.hpp"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+constexpr std::size_t kMaxRequest = 256;
+constexpr int kClientTimeoutMs = 1000;
+
+// Sends without blocking past the deadline, so a client that never reads
+// its reply cannot hold up the accept thread.
+bool send_all(int fd, const std::string &data,
+              std::chrono::steady_clock::time_point deadline) {
+  std::size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = ::send(fd, data.data() + sent, data.size() - sent,
+                       MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n >= 0) {
+      sent += static_cast<std::size_t>(n);
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      return false;
+    }
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          deadline - std::chrono::steady_clock::now())
+                          .count();
+    if (left <= 0) {
+      return false;
+    }
+    pollfd p{fd, POLLOUT, 0};
+    if (::poll(&p, 1, static_cast<int>(left)) < 0 && errno != EINTR) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+LineQueryServer::LineQueryServer(std::string component, std::string path,
+                                 Handler handler)
+    : component_(std::move(component)), path_(std::move(path)),
+      handler_(std::move(handler)) {}
+
+LineQueryServer::~LineQueryServer() { stop(); }
+
+bool LineQueryServer::start() {
+  if (running_) {
+    return true;
+  }
+
+  sockaddr_un addr{};
+  if (path_.empty() || path_.size() >= sizeof(addr.sun_path)) {
+    log_error(component_, "socket path empty or too long",
+              {{"path", path_}});
+    return false;
+  }
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path_.c_str(), path_.size() + 1);
+
+  listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    return false;
+  }
+  ::unlink(path_.c_str());
+  if (::bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) <
+          0 ||
+      ::listen(listen_fd_, 8) < 0) {
+    log_error(component_, "bind failed",
+              {{"path", path_}, {"error", std::strerror(errno)}});
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+
+  running_ = true;
+  thread_ = std::thread(&LineQueryServer::accept_loop, this);
+  return true;
+}
+
+void LineQueryServer::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (listen_fd_ >= 0) {
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    ::unlink(path_.c_str());
+  }
+}
+
+void LineQueryServer::accept_loop() {
+  while (running_) {
+    pollfd p{listen_fd_, POLLIN, 0};
+    int rc = ::poll(&p, 1, 100);
+    if (rc <= 0) {
+      continue;
+    }
+    int fd = ::accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    serve_client(fd);
+    ::close(fd);
+  }
+}
+
+void LineQueryServer::serve_client(int fd) {
+  // Read up to the first newline, EOF or kMaxRequest bytes and send the
+  // reply; a client that stalls either is dropped after kClientTimeoutMs.
+  std::string request;
+  char buf[kMaxRequest];
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(kClientTimeoutMs);
+  while (request.find('\n') == std::string::npos &&
+         request.size() < kMaxRequest) {
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          deadline - std::chrono::steady_clock::now())
+                          .count();
+    if (left <= 0 || !running_) {
+      return;
+    }
+    pollfd p{fd, POLLIN, 0};
+    int rc = ::poll(&p, 1, static_cast<int>(left));
+    if (rc < 0 && errno != EINTR) {
+      return;
+    }
+    if (rc <= 0) {
+      continue;
+    }
+    ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    request.append(buf, static_cast<std::size_t>(n));
+  }
+  request = request.substr(0, request.find('\n'));
+  ++requests_;
+  if (!send_all(fd, handler_(request) + "\n", deadline)) {
+    log_warn(component_, "client dropped before reading its reply");
+  }
+}
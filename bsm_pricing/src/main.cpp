@@ -1,5 +1,6 @@
 #include "bsm_service.hpp"
 #include "messages.hpp"
+#include "option_pricer.hpp"
 #include "postgres_writer.hpp"
 #include "price_pipe.hpp"
 
@@ -7,6 +8,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -23,6 +25,25 @@ struct CliConfig {
   std::string pg_password;
   std::string pg_db;
   std::string pipe_path{"/tmp/pricing_pipe"};
+  std::string params_snapshot;
+  bool skip_unchanged_writes{false};
+  std::string scenario_report;
+  int scenario_interval{5};
+  std::size_t scenario_threads{1};
+  std::size_t calibration_threads{1};
+  std::string positions_socket;
+  std::string quote_spool;
+  int retention_days{0};
+  std::string columnar_dir;
+  bool columnar_only{false};
+  std::string tick_socket;
+  std::size_t tick_memory_mb{64};
+  double realized_vol_half_life{600.0};
+  int realized_vol_persist{60};
+  bool exact_cdf{false};
+  bool fast_cdf{false};
+  int shard_id{0};
+  int shard_count{1};
 };
 
 CliConfig parse_cli(int argc, char **argv) {
@@ -49,6 +70,74 @@ CliConfig parse_cli(int argc, char **argv) {
       next_string(cfg.pg_db);
     } else if (arg == "--pipe-path") {
       next_string(cfg.pipe_path);
+    } else if (arg == "--params-snapshot") {
+      next_string(cfg.params_snapshot);
+    } else if (arg == "--skip-unchanged-writes") {
+      cfg.skip_unchanged_writes = true;
+    } else if (arg == "--scenario-report") {
+      next_string(cfg.scenario_report);
+    } else if (arg == "--scenario-interval") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.scenario_interval = std::max(1, std::stoi(value));
+    } else if (arg == "--scenario-threads") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.scenario_threads =
+            static_cast<std::size_t>(std::max(1, std::stoi(value)));
+    } else if (arg == "--realized-vol-half-life") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.realized_vol_half_life = std::stod(value);
+    } else if (arg == "--realized-vol-persist") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.realized_vol_persist = std::max(0, std::stoi(value));
+    } else if (arg == "--positions-socket") {
+      next_string(cfg.positions_socket);
+    } else if (arg == "--quote-spool") {
+      next_string(cfg.quote_spool);
+    } else if (arg == "--columnar-dir") {
+      next_string(cfg.columnar_dir);
+    } else if (arg == "--columnar-only") {
+      cfg.columnar_only = true;
+    } else if (arg == "--tick-socket") {
+      next_string(cfg.tick_socket);
+    } else if (arg == "--tick-memory-mb") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.tick_memory_mb =
+            static_cast<std::size_t>(std::max(1, std::stoi(value)));
+    } else if (arg == "--retention-days") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.retention_days = std::max(0, std::stoi(value));
+    } else if (arg == "--calibration-threads") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.calibration_threads =
+            static_cast<std::size_t>(std::max(1, std::stoi(value)));
+    } else if (arg == "--exact-cdf") {
+      cfg.exact_cdf = true;
+    } else if (arg == "--fast-cdf") {
+      cfg.fast_cdf = true;
+    } else if (arg == "--shard-id") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.shard_id = std::stoi(value);
+    } else if (arg == "--shard-count") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.shard_count = std::stoi(value);
     }
   }
   return cfg;
@@ -87,6 +176,18 @@ int main(int argc, char **argv) {
     cfg.pg_conninfo = std::move(ci);
   }
 
+  if (cfg.shard_count < 1 || cfg.shard_id < 0 ||
+      cfg.shard_id >= cfg.shard_count) {
+    std::cerr << "Invalid shard: --shard-id must be in [0, --shard-count)\n";
+    return 1;
+  }
+
+  if (cfg.exact_cdf) {
+    OptionPricer::set_cdf_mode(CdfMode::Exact);
+  } else if (cfg.fast_cdf) {
+    OptionPricer::set_cdf_mode(CdfMode::Fast);
+  }
+
   int fifo_fd = open_fifo_for_reading(cfg.pipe_path);
   if (fifo_fd < 0) {
     return 1;
@@ -100,6 +201,38 @@ int main(int argc, char **argv) {
   }
 
   BsmService service(json_pipe, threads, cfg.pg_conninfo);
+  service.set_shard(cfg.shard_id, cfg.shard_count);
+  if (!cfg.params_snapshot.empty()) {
+    service.set_params_snapshot(cfg.params_snapshot);
+  }
+  service.set_skip_unchanged_writes(cfg.skip_unchanged_writes);
+  service.set_calibration_threads(cfg.calibration_threads);
+  RealizedVolConfig realized_vol;
+  realized_vol.half_life_sec = cfg.realized_vol_half_life;
+  service.set_realized_vol(realized_vol, cfg.realized_vol_persist);
+  if (!cfg.positions_socket.empty()) {
+    service.set_position_socket(cfg.positions_socket);
+  }
+  if (!cfg.quote_spool.empty()) {
+    service.set_quote_spool(cfg.quote_spool);
+  }
+  service.set_ticker_price_retention(cfg.retention_days);
+  if (!cfg.tick_socket.empty()) {
+    TickStoreConfig ticks;
+    ticks.memory_budget_bytes = cfg.tick_memory_mb << 20;
+    service.set_tick_store(ticks, cfg.tick_socket);
+  }
+  if (!cfg.columnar_dir.empty()) {
+    ColumnarSinkConfig columnar;
+    columnar.dir = cfg.columnar_dir;
+    service.set_columnar_sink(columnar, cfg.columnar_only);
+  }
+  if (!cfg.scenario_report.empty()) {
+    // 21x21: spot -20%..+20% in 2% steps, vol -10..+10 points in 1s.
+    service.set_scenario_report(cfg.scenario_report,
+                                make_scenario_grid(21, 0.2, 21, 0.1),
+                                cfg.scenario_interval, cfg.scenario_threads);
+  }
   service.start();
 
   FILE *f = fdopen(fifo_fd, "r");
@@ -0,0 +1,340 @@
+#include "monte_carlo.hpp"
+
+#include "normal_cdf.hpp"
+#include "option_pricer.hpp"
+#include "philox.hpp"
+#include "sobol.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Sums over one tile's samples: y is the discounted payoff, x the control.
+struct Moments {
+  double n{0};
+  double sy{0};
+  double syy{0};
+  double sx{0};
+  double sxx{0};
+  double sxy{0};
+};
+
+// Builds W(t_1..t_n) on an even grid from normals in bridge order: the
+// terminal point first, then midpoints breadth-first, so the leading
+// (best-distributed) Sobol dimensions set the coarse shape of the path.
+class BrownianBridge {
+public:
+  BrownianBridge(std::size_t steps, double dt) {
+    const auto time = [dt](long i) { return (i + 1) * dt; };
+    const long n = static_cast<long>(steps);
+    plan_.push_back(Step{n - 1, -1, -1, 0.0, 0.0, std::sqrt(time(n - 1))});
+
+    std::vector<std::pair<long, long>> queue{{-1, n - 1}};
+    for (std::size_t head = 0; head < queue.size(); ++head) {
+      const long l = queue[head].first;
+      const long r = queue[head].second;
+      if (r - l < 2) {
+        continue;
+      }
+      const long m = l + (r - l) / 2;
+      const double tl = l < 0 ? 0.0 : time(l);
+      const double tm = time(m);
+      const double tr = time(r);
+      plan_.push_back(Step{m, l, r, (tr - tm) / (tr - tl), (tm - tl) / (tr - tl),
+                           std::sqrt((tm - tl) * (tr - tm) / (tr - tl))});
+      queue.emplace_back(l, m);
+      queue.emplace_back(m, r);
+    }
+  }
+
+  void build(const double *z, double *w) const {
+    for (std::size_t k = 0; k < plan_.size(); ++k) {
+      const Step &s = plan_[k];
+      double v = s.sd * z[k];
+      if (s.left >= 0) {
+        v += s.wl * w[s.left];
+      }
+      if (s.right >= 0) {
+        v += s.wr * w[s.right];
+      }
+      w[s.target] = v;
+    }
+  }
+
+private:
+  struct Step {
+    long target;
+    long left; // -1: W(0) = 0
+    long right;
+    double wl;
+    double wr;
+    double sd;
+  };
+
+  std::vector<Step> plan_;
+};
+
+struct Setup {
+  McContract c;
+  McConfig cfg;
+  std::size_t base_per_tile;
+  std::size_t total_base;
+  double mu_dt;
+  double vol_dt;
+  double disc;
+  double log_barrier;
+  Philox4x32::Key key;
+  const SobolSequence *sobol;
+  const BrownianBridge *bridge;
+};
+
+// Normals for base paths [base0, base0 + nb), step-major: z[s * nb + j].
+void fill_normals(const Setup &su, std::size_t base0, std::size_t nb,
+                  std::vector<double> &z) {
+  const std::size_t n = su.c.steps;
+  z.resize(n * nb);
+  if (!su.sobol) {
+    for (std::size_t j = 0; j < nb; ++j) {
+      const std::uint64_t g = base0 + j;
+      for (std::size_t s = 0; s < n; s += 2) {
+        const auto out = Philox4x32::generate(
+            {static_cast<std::uint32_t>(s / 2), static_cast<std::uint32_t>(g),
+             static_cast<std::uint32_t>(g >> 32), 0},
+            su.key);
+        z[s * nb + j] = inverse_normal_cdf(Philox4x32::to_unit(out[0], out[1]));
+        if (s + 1 < n) {
+          z[(s + 1) * nb + j] =
+              inverse_normal_cdf(Philox4x32::to_unit(out[2], out[3]));
+        }
+      }
+    }
+    return;
+  }
+
+  const std::size_t dims = su.sobol->dims();
+  const double inv_sqrt_dt = 1.0 / std::sqrt(su.c.T / static_cast<double>(n));
+  double u[SobolSequence::kMaxDims];
+  std::vector<double> bz(n);
+  std::vector<double> w(n);
+  for (std::size_t j = 0; j < nb; ++j) {
+    const std::uint64_t g = base0 + j;
+    su.sobol->point(g + 1, u); // skip the origin, it maps to -inf
+    for (std::size_t k = 0; k < dims; ++k) {
+      bz[k] = inverse_normal_cdf(u[k]);
+    }
+    for (std::size_t k = dims; k < n; k += 2) {
+      const auto out = Philox4x32::generate(
+          {static_cast<std::uint32_t>(k / 2), static_cast<std::uint32_t>(g),
+           static_cast<std::uint32_t>(g >> 32), 1},
+          su.key);
+      bz[k] = inverse_normal_cdf(Philox4x32::to_unit(out[0], out[1]));
+      if (k + 1 < n) {
+        bz[k + 1] = inverse_normal_cdf(Philox4x32::to_unit(out[2], out[3]));
+      }
+    }
+    su.bridge->build(bz.data(), w.data());
+    double prev = 0.0;
+    for (std::size_t s = 0; s < n; ++s) {
+      z[s * nb + j] = (w[s] - prev) * inv_sqrt_dt;
+      prev = w[s];
+    }
+  }
+}
+
+Moments price_tile(const Setup &su, std::size_t tile) {
+  thread_local std::vector<double> z;
+  thread_local std::vector<double> log_s;
+  thread_local std::vector<double> sum;
+  thread_local std::vector<double> log_sum;
+  thread_local std::vector<double> alive;
+
+  const McContract &c = su.c;
+  const std::size_t n = c.steps;
+  const std::size_t base0 = tile * su.base_per_tile;
+  const std::size_t nb = std::min(su.base_per_tile, su.total_base - base0);
+  const bool anti = su.cfg.antithetic;
+  const std::size_t np = anti ? 2 * nb : nb;
+
+  fill_normals(su, base0, nb, z);
+  log_s.assign(np, std::log(c.S));
+  sum.assign(np, 0.0);
+  log_sum.assign(np, 0.0);
+  alive.assign(np, 1.0);
+
+  for (std::size_t s = 0; s < n; ++s) {
+    const double *zs = &z[s * nb];
+    for (std::size_t j = 0; j < nb; ++j) {
+      const double dz = su.vol_dt * zs[j];
+      log_s[j] += su.mu_dt + dz;
+      if (anti) {
+        log_s[j + nb] += su.mu_dt - dz;
+      }
+    }
+    switch (c.payoff) {
+    case McPayoff::EuropeanCall:
+      break;
+    case McPayoff::AsianArithmeticCall:
+      for (std::size_t p = 0; p < np; ++p) {
+        sum[p] += std::exp(log_s[p]);
+        log_sum[p] += log_s[p];
+      }
+      break;
+    case McPayoff::UpAndOutCall:
+      for (std::size_t p = 0; p < np; ++p) {
+        alive[p] = log_s[p] < su.log_barrier ? alive[p] : 0.0;
+      }
+      break;
+    case McPayoff::DownAndOutCall:
+      for (std::size_t p = 0; p < np; ++p) {
+        alive[p] = log_s[p] > su.log_barrier ? alive[p] : 0.0;
+      }
+      break;
+    }
+  }
+
+  const double inv_n = 1.0 / static_cast<double>(n);
+  auto sample = [&](std::size_t p, double &y, double &x) {
+    const double st = std::exp(log_s[p]);
+    switch (c.payoff) {
+    case McPayoff::EuropeanCall:
+      y = su.disc * std::max(st - c.K, 0.0);
+      x = su.disc * st;
+      break;
+    case McPayoff::AsianArithmeticCall:
+      y = su.disc * std::max(sum[p] * inv_n - c.K, 0.0);
+      x = su.disc * std::max(std::exp(log_sum[p] * inv_n) - c.K, 0.0);
+      break;
+    case McPayoff::UpAndOutCall:
+    case McPayoff::DownAndOutCall:
+      x = su.disc * std::max(st - c.K, 0.0);
+      y = alive[p] * x;
+      break;
+    }
+  };
+
+  Moments m;
+  for (std::size_t j = 0; j < nb; ++j) {
+    double y, x;
+    sample(j, y, x);
+    if (anti) {
+      double y2, x2;
+      sample(j + nb, y2, x2);
+      y = 0.5 * (y + y2);
+      x = 0.5 * (x + x2);
+    }
+    m.n += 1.0;
+    m.sy += y;
+    m.syy += y * y;
+    m.sx += x;
+    m.sxx += x * x;
+    m.sxy += x * y;
+  }
+  return m;
+}
+
+} // namespace
+
+double geometric_asian_call(double S, double K, double r, double q,
+                            double sigma, double T, std::size_t steps) {
+  const double n = static_cast<double>(steps);
+  const double mu =
+      std::log(S) + (r - q - 0.5 * sigma * sigma) * T * (n + 1.0) / (2.0 * n);
+  const double var =
+      sigma * sigma * T * (n + 1.0) * (2.0 * n + 1.0) / (6.0 * n * n);
+  const double sd = std::sqrt(var);
+  const double d1 = (mu - std::log(K) + var) / sd;
+  const double d2 = d1 - sd;
+  return std::exp(-r * T) * (std::exp(mu + 0.5 * var) * exact_normal_cdf(d1) -
+                             K * exact_normal_cdf(d2));
+}
+
+McResult MonteCarloEngine::price(const McContract &c,
+                                 const McConfig &cfg) const {
+  const bool barrier = c.payoff == McPayoff::UpAndOutCall ||
+                       c.payoff == McPayoff::DownAndOutCall;
+  if (!(c.S > 0.0 && c.K > 0.0 && c.sigma > 0.0 && c.T > 0.0) ||
+      c.steps == 0 || (barrier && !(c.barrier > 0.0))) {
+    throw std::invalid_argument("MonteCarloEngine: invalid contract");
+  }
+  if (cfg.paths == 0 || cfg.tile_paths < 2) {
+    throw std::invalid_argument("MonteCarloEngine: invalid config");
+  }
+
+  Setup su;
+  su.c = c;
+  su.cfg = cfg;
+  su.base_per_tile = cfg.antithetic ? cfg.tile_paths / 2 : cfg.tile_paths;
+  su.total_base = cfg.antithetic ? (cfg.paths + 1) / 2 : cfg.paths;
+  const double dt = c.T / static_cast<double>(c.steps);
+  su.mu_dt = (c.r - c.q - 0.5 * c.sigma * c.sigma) * dt;
+  su.vol_dt = c.sigma * std::sqrt(dt);
+  su.disc = std::exp(-c.r * c.T);
+  su.log_barrier = barrier ? std::log(c.barrier) : 0.0;
+  su.key = {static_cast<std::uint32_t>(cfg.seed),
+            static_cast<std::uint32_t>(cfg.seed >> 32)};
+
+  std::unique_ptr<SobolSequence> sobol;
+  std::unique_ptr<BrownianBridge> bridge;
+  if (cfg.sobol) {
+    sobol = std::make_unique<SobolSequence>(
+        std::min(c.steps, SobolSequence::kMaxDims));
+    bridge = std::make_unique<BrownianBridge>(c.steps, dt);
+  }
+  su.sobol = sobol.get();
+  su.bridge = bridge.get();
+
+  const std::size_t tiles =
+      (su.total_base + su.base_per_tile - 1) / su.base_per_tile;
+  std::vector<Moments> partial(tiles);
+  pool_.parallel_for(tiles,
+                     [&](std::size_t t) { partial[t] = price_tile(su, t); });
+
+  Moments m;
+  for (const Moments &p : partial) {
+    m.n += p.n;
+    m.sy += p.sy;
+    m.syy += p.syy;
+    m.sx += p.sx;
+    m.sxx += p.sxx;
+    m.sxy += p.sxy;
+  }
+
+  const double n = m.n;
+  const double mean_y = m.sy / n;
+  const double denom = n > 1.0 ? n - 1.0 : 1.0;
+  const double var_y = (m.syy - m.sy * mean_y) / denom;
+
+  McResult result;
+  result.paths = cfg.antithetic ? 2 * su.total_base : su.total_base;
+  double var = var_y;
+  result.price = mean_y;
+  if (cfg.control_variate) {
+    double expected_x = 0.0;
+    switch (c.payoff) {
+    case McPayoff::EuropeanCall:
+      expected_x = c.S * std::exp(-c.q * c.T);
+      break;
+    case McPayoff::AsianArithmeticCall:
+      expected_x = geometric_asian_call(c.S, c.K, c.r, c.q, c.sigma, c.T,
+                                        c.steps);
+      break;
+    case McPayoff::UpAndOutCall:
+    case McPayoff::DownAndOutCall:
+      expected_x =
+          OptionPricer::black_scholes_call(c.S, c.K, c.r, c.q, c.sigma, c.T);
+      break;
+    }
+    const double mean_x = m.sx / n;
+    const double var_x = (m.sxx - m.sx * mean_x) / denom;
+    const double cov = (m.sxy - m.sx * mean_y) / denom;
+    const double beta = var_x > 0.0 ? cov / var_x : 0.0;
+    result.price = mean_y - beta * (mean_x - expected_x);
+    var = var_y - 2.0 * beta * cov + beta * beta * var_x;
+  }
+  result.std_error = std::sqrt(std::max(var, 0.0) / n);
+  return result;
+}
@@ -0,0 +1,165 @@
+#include "normal_cdf.hpp"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BSM_HAVE_X86_SIMD 1
+#endif
+
+namespace {
+
+constexpr double kRange = 8.0;
+constexpr int kStepsPerUnit = 64;
+constexpr int kIntervals = static_cast<int>(2 * kRange) * kStepsPerUnit;
+constexpr double kStep = 1.0 / kStepsPerUnit;
+
+// Node i holds {Phi(x_i), kStep * phi(x_i)} with x_i = -kRange + i * kStep;
+// scaling the slope by the step keeps the per-interval cubic in t in [0, 1].
+struct CdfTable {
+  double node[kIntervals + 1][2];
+
+  CdfTable() {
+    for (int i = 0; i <= kIntervals; ++i) {
+      const double x = -kRange + i * kStep;
+      node[i][0] = exact_normal_cdf(x);
+      node[i][1] = kStep * 0.3989422804014327 * std::exp(-0.5 * x * x);
+    }
+  }
+};
+
+const CdfTable &table() {
+  static const CdfTable t;
+  return t;
+}
+
+inline double hermite(const double *n, double t) {
+  const double f0 = n[0], d0 = n[1], f1 = n[2], d1 = n[3];
+  const double c2 = 3.0 * (f1 - f0) - 2.0 * d0 - d1;
+  const double c3 = 2.0 * (f0 - f1) + d0 + d1;
+  return f0 + t * (d0 + t * (c2 + t * c3));
+}
+
+double fast_scalar(const CdfTable &tab, double x) {
+  if (std::isnan(x)) {
+    return x;
+  }
+  x = x < -kRange ? -kRange : (x > kRange ? kRange : x);
+  const double u = (x + kRange) * kStepsPerUnit;
+  int i = static_cast<int>(u);
+  if (i >= kIntervals) {
+    i = kIntervals - 1;
+  }
+  return hermite(tab.node[i], u - i);
+}
+
+#ifdef BSM_HAVE_X86_SIMD
+__attribute__((target("avx2,fma"))) void
+batch_avx2(const CdfTable &tab, const double *x, double *out, std::size_t n) {
+  const double *base = &tab.node[0][0];
+  const __m256d lo = _mm256_set1_pd(-kRange);
+  const __m256d hi = _mm256_set1_pd(kRange);
+  const __m256d scale = _mm256_set1_pd(kStepsPerUnit);
+  const __m256d three = _mm256_set1_pd(3.0);
+  const __m256d two = _mm256_set1_pd(2.0);
+  const __m128i last = _mm_set1_epi32(kIntervals - 1);
+
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m256d v = _mm256_loadu_pd(x + i);
+    const __m256d nan = _mm256_cmp_pd(v, v, _CMP_UNORD_Q);
+    const __m256d c = _mm256_max_pd(_mm256_min_pd(v, hi), lo);
+    const __m256d u = _mm256_mul_pd(_mm256_add_pd(c, hi), scale);
+    const __m128i idx = _mm_min_epi32(_mm256_cvttpd_epi32(u), last);
+    const __m256d t = _mm256_sub_pd(u, _mm256_cvtepi32_pd(idx));
+    const __m128i off = _mm_slli_epi32(idx, 1);
+
+    const __m256d f0 = _mm256_i32gather_pd(base, off, 8);
+    const __m256d d0 = _mm256_i32gather_pd(base + 1, off, 8);
+    const __m256d f1 = _mm256_i32gather_pd(base + 2, off, 8);
+    const __m256d d1 = _mm256_i32gather_pd(base + 3, off, 8);
+
+    const __m256d df = _mm256_sub_pd(f1, f0);
+    const __m256d c2 =
+        _mm256_sub_pd(_mm256_fmsub_pd(three, df, _mm256_mul_pd(two, d0)), d1);
+    const __m256d c3 =
+        _mm256_add_pd(_mm256_fnmadd_pd(two, df, d0), d1);
+    __m256d r = _mm256_fmadd_pd(t, c3, c2);
+    r = _mm256_fmadd_pd(t, r, d0);
+    r = _mm256_fmadd_pd(t, r, f0);
+    _mm256_storeu_pd(out + i, _mm256_blendv_pd(r, v, nan));
+  }
+  for (; i < n; ++i) {
+    out[i] = fast_scalar(tab, x[i]);
+  }
+}
+
+bool have_avx2() {
+  static const bool have = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  }();
+  return have;
+}
+#endif
+
+} // namespace
+
+double exact_normal_cdf(double x) {
+  return 0.5 * std::erfc(-x / std::sqrt(2.0));
+}
+
+double fast_normal_cdf(double x) { return fast_scalar(table(), x); }
+
+void fast_normal_cdf_batch(const double *x, double *out, std::size_t n) {
+  const CdfTable &tab = table();
+#ifdef BSM_HAVE_X86_SIMD
+  if (have_avx2()) {
+    batch_avx2(tab, x, out, n);
+    return;
+  }
+#endif
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = fast_scalar(tab, x[i]);
+  }
+}
+
+double inverse_normal_cdf(double p) {
+  static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02,
+                             -2.759285104469687e+02, 1.383577518672690e+02,
+                             -3.066479806614716e+01, 2.506628277459239e+00};
+  static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02,
+                             -1.556989798598866e+02, 6.680131188771972e+01,
+                             -1.328068155288572e+01};
+  static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01,
+                             -2.400758277161838e+00, -2.549732539343734e+00,
+                             4.374664141464968e+00,  2.938163982698783e+00};
+  static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01,
+                             2.445134137142996e+00, 3.754408661907416e+00};
+  constexpr double kLow = 0.02425;
+
+  if (p <= 0.0) {
+    return -HUGE_VAL;
+  }
+  if (p >= 1.0) {
+    return HUGE_VAL;
+  }
+  if (p < kLow) {
+    const double q = std::sqrt(-2.0 * std::log(p));
+    return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q +
+            c[5]) /
+           ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+  }
+  if (p > 1.0 - kLow) {
+    const double q = std::sqrt(-2.0 * std::log1p(-p));
+    return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q +
+             c[5]) /
+           ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+  }
+  const double q = p - 0.5;
+  const double r = q * q;
+  return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r +
+          a[5]) *
+         q /
+         (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+}
@@ -1,7 +1,48 @@
 #include "option_pricer.hpp"
 
+#include "normal_cdf.hpp"
+
+#include <atomic>
+
+namespace {
+
+#ifdef BSM_FAST_NORMAL_CDF
+std::atomic<CdfMode> g_cdf_mode{CdfMode::Fast};
+#else
+std::atomic<CdfMode> g_cdf_mode{CdfMode::Exact};
+#endif
+
+} // namespace
+
+void OptionPricer::set_cdf_mode(CdfMode mode) {
+    g_cdf_mode.store(mode, std::memory_order_relaxed);
+}
+
+CdfMode OptionPricer::cdf_mode() {
+    return g_cdf_mode.load(std::memory_order_relaxed);
+}
+
 double OptionPricer::normal_cdf(double x) {
-    return 0.5 * std::erfc(-x / std::sqrt(2.0));
+    if (g_cdf_mode.load(std::memory_order_relaxed) == CdfMode::Fast) {
+        return fast_normal_cdf(x);
+    }
+    return exact_normal_cdf(x);
+}
+
+void OptionPricer::normal_cdf_batch(const double *x, double *out,
+                                    std::size_t n) {
+    if (g_cdf_mode.load(std::memory_order_relaxed) == CdfMode::Fast) {
+        fast_normal_cdf_batch(x, out, n);
+        return;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = exact_normal_cdf(x[i]);
+    }
+}
+
+double OptionPricer::normal_pdf(double x) {
+    static const double kInvSqrt2Pi = 0.3989422804014327;
+    return kInvSqrt2Pi * std::exp(-0.5 * x * x);
 }
 
 double OptionPricer::black_scholes_call(double S, double K, double r, double q,
@@ -17,3 +58,30 @@ double OptionPricer::black_scholes_call(double S, double K, double r, double q,
     double Nd2 = normal_cdf(d2);
     return S * std::exp(-q * T) * Nd1 - K * std::exp(-r * T) * Nd2;
 }
+
+CallGreeks OptionPricer::black_scholes_call_greeks(double S, double K, double r,
+                                                   double q, double sigma,
+                                                   double T) {
+    CallGreeks g;
+    if (S <= 0.0 || K <= 0.0 || sigma <= 0.0 || T <= 0.0) {
+        return g;
+    }
+    double sqrtT = std::sqrt(T);
+    double d1 = (std::log(S / K) + (r - q + 0.5 * sigma * sigma) * T) /
+                (sigma * sqrtT);
+    double d2 = d1 - sigma * sqrtT;
+    double Nd1 = normal_cdf(d1);
+    double Nd2 = normal_cdf(d2);
+    double nd1 = normal_pdf(d1);
+    double dq = std::exp(-q * T);
+    double dr = std::exp(-r * T);
+
+    g.price = S * dq * Nd1 - K * dr * Nd2;
+    g.delta = dq * Nd1;
+    g.gamma = dq * nd1 / (S * sigma * sqrtT);
+    g.vega = S * dq * nd1 * sqrtT;
+    g.theta = -S * dq * nd1 * sigma / (2.0 * sqrtT) - r * K * dr * Nd2 +
+              q * S * dq * Nd1;
+    g.rho = K * T * dr * Nd2;
+    return g;
+}
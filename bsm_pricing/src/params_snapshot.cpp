@@ -0,0 +1,178 @@
+#include "params_snapshot.hpp"
+
+#include "async_logger.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = {'B', 'S', 'M', 'P', 'R', 'M', '0', '4'};
+
+struct SnapshotHeader {
+  char magic[8];
+  std::uint64_t count;
+  std::uint64_t names_bytes;
+};
+
+struct ParamsRecord {
+  double K;
+  double r;
+  double q;
+  double sigma;
+  double T;
+  std::int64_t ticker_id;
+  std::int64_t conf_id;
+  std::uint32_t name_offset;
+  std::uint32_t name_len;
+  std::uint32_t model;
+  std::uint32_t lattice_steps;
+  double heston_kappa;
+  double heston_theta;
+  double heston_xi;
+  double heston_rho;
+  double heston_v0;
+  std::uint32_t vol_source;
+  std::uint32_t reserved;
+};
+
+static_assert(sizeof(SnapshotHeader) == 24, "snapshot header layout");
+static_assert(sizeof(ParamsRecord) == 120, "snapshot record layout");
+
+} // namespace
+
+bool write_params_snapshot(
+    const std::string &path,
+    const std::unordered_map<long long, BsmParams> &params) {
+  std::vector<ParamsRecord> records;
+  records.reserve(params.size());
+  std::string names;
+  for (const auto &entry : params) {
+    const BsmParams &p = entry.second;
+    ParamsRecord rec{};
+    rec.K = p.K;
+    rec.r = p.r;
+    rec.q = p.q;
+    rec.sigma = p.sigma;
+    rec.T = p.T;
+    rec.ticker_id = p.ticker_id;
+    rec.conf_id = p.conf_id;
+    rec.name_offset = static_cast<std::uint32_t>(names.size());
+    rec.name_len = static_cast<std::uint32_t>(p.ticker.size());
+    rec.model = static_cast<std::uint32_t>(p.model);
+    rec.lattice_steps = p.lattice_steps;
+    rec.heston_kappa = p.heston.kappa;
+    rec.heston_theta = p.heston.theta;
+    rec.heston_xi = p.heston.xi;
+    rec.heston_rho = p.heston.rho;
+    rec.heston_v0 = p.heston.v0;
+    rec.vol_source = static_cast<std::uint32_t>(p.vol_source);
+    names += p.ticker;
+    records.push_back(rec);
+  }
+
+  SnapshotHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.count = records.size();
+  header.names_bytes = names.size();
+
+  const std::string tmp = path + ".tmp";
+  FILE *f = std::fopen(tmp.c_str(), "wb");
+  if (!f) {
+    log_error("ParamsSnapshot", "cannot open",
+              {{"path", tmp}, {"error", std::strerror(errno)}});
+    return false;
+  }
+  bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 &&
+            std::fwrite(records.data(), sizeof(ParamsRecord), records.size(),
+                        f) == records.size() &&
+            std::fwrite(names.data(), 1, names.size(), f) == names.size() &&
+            std::fflush(f) == 0 && ::fsync(::fileno(f)) == 0;
+  ok = std::fclose(f) == 0 && ok;
+  if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    log_error("ParamsSnapshot", "write failed",
+              {{"path", path}, {"error", std::strerror(errno)}});
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool read_params_snapshot(const std::string &path,
+                          std::unordered_map<long long, BsmParams> &params) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<std::size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+    ::close(fd);
+    return false;
+  }
+  const std::size_t size = static_cast<std::size_t>(st.st_size);
+  void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  const auto *base = static_cast<const char *>(map);
+  const auto *header = reinterpret_cast<const SnapshotHeader *>(base);
+  const std::size_t body = size - sizeof(SnapshotHeader);
+  bool ok = std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 &&
+            header->count <= body / sizeof(ParamsRecord) &&
+            header->names_bytes ==
+                body - header->count * sizeof(ParamsRecord);
+
+  std::unordered_map<long long, BsmParams> loaded;
+  if (ok) {
+    const auto *records =
+        reinterpret_cast<const ParamsRecord *>(base + sizeof(SnapshotHeader));
+    const char *names = reinterpret_cast<const char *>(records + header->count);
+    loaded.reserve(header->count);
+    for (std::uint64_t i = 0; i < header->count; ++i) {
+      const ParamsRecord &rec = records[i];
+      if (static_cast<std::uint64_t>(rec.name_offset) + rec.name_len >
+              header->names_bytes ||
+          rec.model >
+              static_cast<std::uint32_t>(PricingModel::Heston) ||
+          rec.vol_source >
+              static_cast<std::uint32_t>(VolSource::RealizedWindow)) {
+        ok = false;
+        break;
+      }
+      BsmParams p;
+      p.K = rec.K;
+      p.r = rec.r;
+      p.q = rec.q;
+      p.sigma = rec.sigma;
+      p.T = rec.T;
+      p.ticker_id = rec.ticker_id;
+      p.conf_id = rec.conf_id;
+      p.model = static_cast<PricingModel>(rec.model);
+      p.lattice_steps = rec.lattice_steps;
+      p.heston = HestonParams{rec.heston_kappa, rec.heston_theta,
+                              rec.heston_xi, rec.heston_rho, rec.heston_v0};
+      p.vol_source = static_cast<VolSource>(rec.vol_source);
+      p.ticker.assign(names + rec.name_offset, rec.name_len);
+      loaded[p.conf_id] = p;
+    }
+  }
+  ::munmap(map, size);
+
+  if (!ok) {
+    log_warn("ParamsSnapshot", "ignoring malformed snapshot", {{"path", path}});
+    return false;
+  }
+  params = std::move(loaded);
+  return true;
+}
@@ -0,0 +1,168 @@
+#include "position_book.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+void add(Exposure &to, const Exposure &e, double sign) {
+  to.value += sign * e.value;
+  to.delta += sign * e.delta;
+  to.gamma += sign * e.gamma;
+  to.vega += sign * e.vega;
+  to.theta += sign * e.theta;
+  to.rho += sign * e.rho;
+}
+
+void append_field(std::string &out, const char *key, double v) {
+  char buf[48];
+  std::snprintf(buf, sizeof(buf), "\"%s\":%.10g,", key, v);
+  out += buf;
+}
+
+} // namespace
+
+void PositionBook::set_positions(const std::vector<Position> &positions) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unordered_map<long long, Slot> slots;
+  std::unordered_map<std::string, Exposure> underlyings;
+  Exposure portfolio;
+  slots.reserve(positions.size());
+  for (const Position &p : positions) {
+    if (slots.count(p.conf_id)) {
+      continue;
+    }
+    Exposure &under = underlyings[p.ticker];
+    Slot slot{p.quantity, Exposure{}, &under, 0};
+    auto old = slots_.find(p.conf_id);
+    if (old != slots_.end() && old->second.contribution.priced) {
+      // Rescale the last quote to the new quantity.
+      const double scale = old->second.quantity != 0.0
+                               ? p.quantity / old->second.quantity
+                               : 0.0;
+      add(slot.contribution, old->second.contribution, scale);
+      slot.contribution.priced = 1;
+      slot.timestamp = old->second.timestamp;
+      ++under.priced;
+      ++portfolio.priced;
+    }
+    add(under, slot.contribution, 1.0);
+    add(portfolio, slot.contribution, 1.0);
+    ++under.positions;
+    ++portfolio.positions;
+    slots.emplace(p.conf_id, slot);
+  }
+  slots_ = std::move(slots);
+  underlyings_ = std::move(underlyings);
+  portfolio_ = portfolio;
+}
+
+bool PositionBook::on_quote(const OptionQuote &q) {
+  if (q.status != "OK") {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = slots_.find(q.conf_id);
+  if (it == slots_.end()) {
+    return false;
+  }
+  Slot &slot = it->second;
+  if (slot.contribution.priced && q.timestamp < slot.timestamp) {
+    ++stale_quotes_;
+    return false;
+  }
+  const double n = slot.quantity;
+  Exposure next;
+  next.value = n * q.option_price;
+  next.delta = n * q.delta;
+  next.gamma = n * q.gamma;
+  next.vega = n * q.vega;
+  next.theta = n * q.theta;
+  next.rho = n * q.rho;
+  next.priced = 1;
+
+  Exposure diff = next;
+  add(diff, slot.contribution, -1.0);
+  add(*slot.underlying, diff, 1.0);
+  add(portfolio_, diff, 1.0);
+  if (!slot.contribution.priced) {
+    ++slot.underlying->priced;
+    ++portfolio_.priced;
+  }
+  slot.contribution = next;
+  slot.timestamp = q.timestamp;
+  if (++updates_ % kResumEvery == 0) {
+    resum();
+  }
+  return true;
+}
+
+void PositionBook::resum() {
+  for (auto &entry : underlyings_) {
+    Exposure &e = entry.second;
+    const std::size_t positions = e.positions;
+    const std::size_t priced = e.priced;
+    e = Exposure{};
+    e.positions = positions;
+    e.priced = priced;
+  }
+  const std::size_t positions = portfolio_.positions;
+  const std::size_t priced = portfolio_.priced;
+  portfolio_ = Exposure{};
+  portfolio_.positions = positions;
+  portfolio_.priced = priced;
+  for (const auto &entry : slots_) {
+    add(*entry.second.underlying, entry.second.contribution, 1.0);
+    add(portfolio_, entry.second.contribution, 1.0);
+  }
+}
+
+Exposure PositionBook::portfolio() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return portfolio_;
+}
+
+bool PositionBook::underlying(const std::string &ticker, Exposure &out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = underlyings_.find(ticker);
+  if (it == underlyings_.end()) {
+    return false;
+  }
+  out = it->second;
+  return true;
+}
+
+std::vector<std::pair<std::string, Exposure>>
+PositionBook::underlyings() const {
+  std::vector<std::pair<std::string, Exposure>> out;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out.assign(underlyings_.begin(), underlyings_.end());
+  }
+  std::sort(out.begin(), out.end(),
+            [](const auto &l, const auto &r) { return l.first < r.first; });
+  return out;
+}
+
+std::uint64_t PositionBook::updates() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return updates_;
+}
+
+std::uint64_t PositionBook::stale_quotes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stale_quotes_;
+}
+
+std::string exposure_json(const Exposure &e) {
+  std::string out = "{";
+  append_field(out, "value", e.value);
+  append_field(out, "delta", e.delta);
+  append_field(out, "gamma", e.gamma);
+  append_field(out, "vega", e.vega);
+  append_field(out, "theta", e.theta);
+  append_field(out, "rho", e.rho);
+  out += "\"positions\":" + std::to_string(e.positions) +
+         ",\"priced\":" + std::to_string(e.priced) + "}";
+  return out;
+}
@@ -0,0 +1,53 @@
+#include "position_query_server.hpp"
+
+namespace {
+
+std::string trim(const std::string &s) {
+  const auto begin = s.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  return s.substr(begin, s.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+} // namespace
+
+std::string position_query_reply(const PositionBook &book,
+                                 const std::string &request) {
+  const std::string req = trim(request);
+  if (req == "portfolio") {
+    return "{\"portfolio\":" + exposure_json(book.portfolio()) + "}";
+  }
+  if (req.rfind("ticker ", 0) == 0) {
+    const std::string ticker = trim(req.substr(7));
+    Exposure e;
+    if (!book.underlying(ticker, e)) {
+      return "{\"error\":\"unknown ticker\"}";
+    }
+    return "{\"ticker\":\"" + ticker + "\",\"exposure\":" + exposure_json(e) +
+           "}";
+  }
+  if (req.empty() || req == "all") {
+    std::string out = "{\"updates\":" + std::to_string(book.updates()) +
+                      ",\"portfolio\":" + exposure_json(book.portfolio()) +
+                      ",\"underlyings\":[";
+    bool first = true;
+    for (const auto &entry : book.underlyings()) {
+      if (!first) {
+        out += ',';
+      }
+      first = false;
+      out += "{\"ticker\":\"" + entry.first +
+             "\",\"exposure\":" + exposure_json(entry.second) + "}";
+    }
+    return out + "]}";
+  }
+  return "{\"error\":\"unknown request\"}";
+}
+
+PositionQueryServer::PositionQueryServer(const PositionBook &book,
+                                         std::string path)
+    : LineQueryServer("PositionQueryServer", std::move(path),
+                      [&book](const std::string &request) {
+                        return position_query_reply(book, request);
+                      }) {}
@@ -1,7 +1,57 @@
 #include "postgres_writer.hpp"
 
+#include "async_logger.hpp"
+
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
-#include <iostream>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+constexpr std::chrono::milliseconds kMinBackoff{250};
+constexpr std::chrono::milliseconds kMaxBackoff{30000};
+constexpr std::chrono::seconds kPartitionRetry{60};
+constexpr std::int64_t kSecondsPerDay = 86400;
+
+// A duplicate (ts, ticker, conf) is a quote that is already stored, e.g.
+// re-sent after a reconnect; it is not a failure to spool and retry.
+std::string insert_sql(const std::string &table) {
+  return "INSERT INTO " + table +
+         " (ts_exchange, ticker_id, conf_id, base_price, calculated_price) "
+         "VALUES (to_timestamp($1), $2::bigint, $3::bigint, "
+         "$4::double precision, $5::double precision) "
+         "ON CONFLICT (ts_exchange, ticker_id, conf_id) DO NOTHING;";
+}
+
+const std::string &parent_sql() {
+  static const std::string sql = insert_sql("ticker_price");
+  return sql;
+}
+
+std::int64_t utc_day(std::int64_t epoch_sec) {
+  return epoch_sec >= 0 ? epoch_sec / kSecondsPerDay
+                        : -((-epoch_sec + kSecondsPerDay - 1) / kSecondsPerDay);
+}
+
+bool undefined_table(const PGresult *res) {
+  const char *state = PQresultErrorField(res, PG_DIAG_SQLSTATE);
+  return state && std::strcmp(state, "42P01") == 0;
+}
+
+} // namespace
+
+std::string ticker_price_partition(std::int64_t epoch_sec) {
+  const std::time_t t = static_cast<std::time_t>(epoch_sec);
+  std::tm tm{};
+  gmtime_r(&t, &tm);
+  // Sized for any int fields, so the compiler can prove no truncation.
+  char name[sizeof("ticker_price_p") + 3 * 11];
+  std::snprintf(name, sizeof(name), "ticker_price_p%04d%02d%02d",
+                tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+  return name;
+}
 
 PostgresWriter::PostgresWriter(const std::string &conninfo)
     : conn_(nullptr), conninfo_(conninfo) {
@@ -26,18 +76,32 @@ bool PostgresWriter::ensure_connected() {
   }
 
   if (conninfo_.empty()) {
-    std::cerr << "PostgresWriter: empty conninfo, cannot connect\n";
+    log_warn("PostgresWriter", "empty conninfo, cannot connect");
     return false;
   }
 
-  conn_ = PQconnectdb(conninfo_.c_str());
+  const auto now = std::chrono::steady_clock::now();
+  if (now < next_attempt_) {
+    return false;
+  }
+
+  // Bounded like the params and spool connections, so an unreachable host
+  // stalls the db thread for seconds, not the kernel's TCP timeout.
+  const char *keywords[] = {"dbname", "connect_timeout", nullptr};
+  const char *values[] = {conninfo_.c_str(), "3", nullptr};
+  conn_ = PQconnectdbParams(keywords, values, /*expand_dbname=*/1);
   if (PQstatus(conn_) != CONNECTION_OK) {
-    std::cerr << "PostgresWriter: connection failed: " << PQerrorMessage(conn_);
+    backoff_ = std::min(kMaxBackoff, std::max(kMinBackoff, backoff_ * 2));
+    next_attempt_ = now + backoff_;
+    log_error("PostgresWriter", "connection failed",
+              {{"error", PQerrorMessage(conn_)},
+               {"retry_ms", static_cast<long long>(backoff_.count())}});
     PQfinish(conn_);
     conn_ = nullptr;
     return false;
   }
 
+  backoff_ = std::chrono::milliseconds{0};
   return true;
 }
 
@@ -61,17 +125,35 @@ bool PostgresWriter::write(const OptionQuote &quote) {
                                 conf_id_str.c_str(), opt_price_str.c_str(),
                                 calc_price_str.c_str()};
 
-  PGresult *res =
-      PQexecParams(conn_,
-                   "INSERT INTO ticker_price (ts_exchange, ticker_id, conf_id, "
-                   "base_price, calculated_price) "
-                   "VALUES (to_timestamp($1), $2::bigint, $3::bigint, "
-                   "$4::double precision, $5::double precision);",
-                   5, nullptr, paramValues, nullptr, nullptr, 0);
+  const std::int64_t day = utc_day(quote.timestamp);
+  if (day != day_) {
+    day_ = day;
+    partition_sql_ = insert_sql(ticker_price_partition(quote.timestamp));
+    direct_ = true;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  if (!direct_ && now >= retry_direct_at_) {
+    direct_ = true;
+  }
+
+  auto exec = [&](const std::string &sql) {
+    return PQexecParams(conn_, sql.c_str(), 5, nullptr, paramValues, nullptr,
+                        nullptr, 0);
+  };
+  PGresult *res = exec(direct_ ? partition_sql_ : parent_sql());
+  if (direct_ && PQresultStatus(res) != PGRES_COMMAND_OK &&
+      undefined_table(res)) {
+    log_warn("PostgresWriter", "no partition for quote day, using parent",
+             {{"partition", ticker_price_partition(quote.timestamp)}});
+    direct_ = false;
+    retry_direct_at_ = now + kPartitionRetry;
+    PQclear(res);
+    res = exec(parent_sql());
+  }
 
   if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-    std::cerr << "PostgresWriter: insert into ticker_price failed: "
-              << PQerrorMessage(conn_);
+    log_error("PostgresWriter", "insert into ticker_price failed",
+              {{"ticker", quote.ticker}, {"error", PQerrorMessage(conn_)}});
     PQclear(res);
     return false;
   }
@@ -0,0 +1,465 @@
+#include "quote_spool.hpp"
+
+#include "async_logger.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kSegmentMagic[8] = {'Q', 'S', 'P', 'O', 'O', 'L', '0', '1'};
+constexpr std::uint32_t kCommit = 0x51c0ffeeU;
+constexpr std::size_t kReplayBatch = 5000;
+
+struct SegmentHeader {
+  char magic[8];
+  std::uint64_t seq;
+  std::uint64_t capacity;
+  char reserved[40];
+};
+
+static_assert(sizeof(SegmentHeader) == 64, "spool header layout");
+static_assert(sizeof(SpoolRecord) == 48, "spool record layout");
+
+std::size_t segment_bytes(std::size_t capacity) {
+  return sizeof(SegmentHeader) + capacity * sizeof(SpoolRecord);
+}
+
+bool parse_seq(const std::string &name, std::uint64_t &seq) {
+  const std::string suffix = ".spool";
+  if (name.size() <= suffix.size() ||
+      name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+    return false;
+  }
+  const std::string digits = name.substr(0, name.size() - suffix.size());
+  if (digits.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+  seq = std::stoull(digits);
+  return true;
+}
+
+void append_number(std::string &out, double v) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.17g", v);
+  out += buf;
+}
+
+// Data exceptions and integrity constraint violations are about the rows;
+// retrying them cannot succeed.
+bool rejects_rows(const PGresult *res) {
+  const char *state = PQresultErrorField(res, PG_DIAG_SQLSTATE);
+  return state &&
+         (std::strncmp(state, "22", 2) == 0 || std::strncmp(state, "23", 2) == 0);
+}
+
+} // namespace
+
+QuoteSpool::QuoteSpool(std::string dir, std::size_t records_per_segment)
+    : dir_(std::move(dir)), capacity_(std::max<std::size_t>(records_per_segment, 1)) {
+  if (::mkdir(dir_.c_str(), 0755) != 0 && errno != EEXIST) {
+    throw std::runtime_error("cannot create spool directory " + dir_ + ": " +
+                             std::strerror(errno));
+  }
+  DIR *d = ::opendir(dir_.c_str());
+  if (!d) {
+    throw std::runtime_error("cannot open spool directory " + dir_ + ": " +
+                             std::strerror(errno));
+  }
+  std::vector<std::uint64_t> seqs;
+  while (dirent *e = ::readdir(d)) {
+    std::uint64_t seq;
+    if (parse_seq(e->d_name, seq)) {
+      seqs.push_back(seq);
+    }
+  }
+  ::closedir(d);
+  std::sort(seqs.begin(), seqs.end());
+
+  std::vector<SpoolRecord> records;
+  for (std::uint64_t seq : seqs) {
+    const std::string path = segment_path(seq);
+    records.clear();
+    if (read_segment(path, records) && !records.empty()) {
+      sealed_.push_back(Sealed{path, records.size()});
+      pending_ += records.size();
+    } else {
+      ::unlink(path.c_str());
+    }
+    next_seq_ = seq + 1;
+  }
+  if (!sealed_.empty()) {
+    log_info("QuoteSpool", "found pending segments",
+             {{"segments", sealed_.size()}, {"records", pending_.load()}});
+  }
+}
+
+QuoteSpool::~QuoteSpool() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  seal_active();
+}
+
+std::string QuoteSpool::segment_path(std::uint64_t seq) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%020llu.spool",
+                static_cast<unsigned long long>(seq));
+  return dir_ + "/" + name;
+}
+
+bool QuoteSpool::open_active() {
+  const std::string path = segment_path(next_seq_);
+  const std::size_t bytes = segment_bytes(capacity_);
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  // Reserve the blocks up front: a store into a mapped page the file
+  // system cannot back would be SIGBUS instead of an error.
+  if (fd < 0 || ::posix_fallocate(fd, 0, static_cast<off_t>(bytes)) != 0) {
+    log_error("QuoteSpool", "cannot create segment",
+              {{"path", path}, {"error", std::strerror(errno)}});
+    if (fd >= 0) {
+      ::close(fd);
+      ::unlink(path.c_str());
+    }
+    return false;
+  }
+  void *map = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    log_error("QuoteSpool", "cannot map segment",
+              {{"path", path}, {"error", std::strerror(errno)}});
+    ::close(fd);
+    ::unlink(path.c_str());
+    return false;
+  }
+  SegmentHeader header{};
+  std::memcpy(header.magic, kSegmentMagic, sizeof(kSegmentMagic));
+  header.seq = next_seq_;
+  header.capacity = capacity_;
+  std::memcpy(map, &header, sizeof(header));
+
+  ++next_seq_;
+  active_fd_ = fd;
+  active_map_ = map;
+  active_path_ = path;
+  active_count_ = 0;
+  return true;
+}
+
+void QuoteSpool::seal_active() {
+  if (!active_map_) {
+    return;
+  }
+  const std::size_t bytes = segment_bytes(capacity_);
+  ::msync(active_map_, bytes, MS_ASYNC);
+  ::munmap(active_map_, bytes);
+  ::close(active_fd_);
+  if (active_count_ > 0) {
+    sealed_.push_back(Sealed{active_path_, active_count_});
+  } else {
+    ::unlink(active_path_.c_str());
+  }
+  active_map_ = nullptr;
+  active_fd_ = -1;
+  active_path_.clear();
+  active_count_ = 0;
+}
+
+bool QuoteSpool::append(const OptionQuote &q) {
+  if (q.status != "OK") {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!active_map_ && !open_active()) {
+    return false;
+  }
+  auto *records = reinterpret_cast<SpoolRecord *>(
+      static_cast<char *>(active_map_) + sizeof(SegmentHeader));
+  SpoolRecord &rec = records[active_count_];
+  rec.timestamp = q.timestamp;
+  rec.ticker_id = q.ticker_id;
+  rec.conf_id = q.conf_id;
+  rec.base_price = q.underlying_price;
+  rec.calculated_price = q.option_price;
+  rec.reserved = 0;
+  std::atomic_thread_fence(std::memory_order_release);
+  rec.commit = kCommit;
+
+  ++active_count_;
+  ++pending_;
+  ++appended_;
+  if (active_count_ == capacity_) {
+    seal_active();
+  }
+  return true;
+}
+
+std::vector<std::string> QuoteSpool::seal_and_list() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  seal_active();
+  std::vector<std::string> out;
+  out.reserve(sealed_.size());
+  for (const Sealed &s : sealed_) {
+    out.push_back(s.path);
+  }
+  return out;
+}
+
+bool QuoteSpool::read_segment(const std::string &path,
+                              std::vector<SpoolRecord> &out) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<std::size_t>(st.st_size) < sizeof(SegmentHeader)) {
+    ::close(fd);
+    return false;
+  }
+  const std::size_t size = static_cast<std::size_t>(st.st_size);
+  void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  const auto *header = static_cast<const SegmentHeader *>(map);
+  const bool ok =
+      std::memcmp(header->magic, kSegmentMagic, sizeof(kSegmentMagic)) == 0;
+  if (ok) {
+    const std::size_t n = std::min<std::size_t>(
+        header->capacity, (size - sizeof(SegmentHeader)) / sizeof(SpoolRecord));
+    const auto *records = reinterpret_cast<const SpoolRecord *>(
+        static_cast<const char *>(map) + sizeof(SegmentHeader));
+    for (std::size_t i = 0; i < n && records[i].commit == kCommit; ++i) {
+      out.push_back(records[i]);
+    }
+  }
+  ::munmap(map, size);
+  return ok;
+}
+
+void QuoteSpool::remove_segment(const std::string &path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(sealed_.begin(), sealed_.end(),
+                         [&](const Sealed &s) { return s.path == path; });
+  if (it == sealed_.end()) {
+    return;
+  }
+  ::unlink(path.c_str());
+  pending_ -= it->records;
+  sealed_.erase(it);
+}
+
+SpoolReplayer::SpoolReplayer(QuoteSpool &spool, std::string conninfo,
+                             int interval_ms)
+    : spool_(spool), conninfo_(std::move(conninfo)),
+      interval_ms_(std::max(interval_ms, 1)) {}
+
+SpoolReplayer::~SpoolReplayer() { stop(); }
+
+void SpoolReplayer::start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_) {
+    return;
+  }
+  running_ = true;
+  thread_ = std::thread(&SpoolReplayer::run, this);
+}
+
+void SpoolReplayer::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (conn_) {
+    PQfinish(conn_);
+    conn_ = nullptr;
+  }
+}
+
+void SpoolReplayer::run() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait_for(lock, std::chrono::milliseconds(interval_ms_),
+                   [this] { return !running_; });
+      if (!running_) {
+        break;
+      }
+    }
+    if (spool_.pending() > 0) {
+      drain();
+    }
+  }
+}
+
+bool SpoolReplayer::drain() {
+  if (!conn_ || PQstatus(conn_) != CONNECTION_OK) {
+    if (conn_) {
+      PQfinish(conn_);
+    }
+    const char *keywords[] = {"dbname", "connect_timeout", nullptr};
+    const char *values[] = {conninfo_.c_str(), "3", nullptr};
+    conn_ = PQconnectdbParams(keywords, values, /*expand_dbname=*/1);
+    if (PQstatus(conn_) != CONNECTION_OK) {
+      PQfinish(conn_);
+      conn_ = nullptr;
+      return false;
+    }
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::uint64_t rows = 0;
+  std::vector<SpoolRecord> records;
+  for (const std::string &path : spool_.seal_and_list()) {
+    records.clear();
+    if (!QuoteSpool::read_segment(path, records)) {
+      log_error("SpoolReplayer", "unreadable segment, dropping it",
+                {{"path", path}});
+      spool_.remove_segment(path);
+      continue;
+    }
+    for (std::size_t begin = 0; begin < records.size(); begin += kReplayBatch) {
+      const std::size_t end = std::min(records.size(), begin + kReplayBatch);
+      std::string error;
+      const InsertResult result = insert(records, begin, end, error);
+      if (result == InsertResult::Retry) {
+        return false;
+      }
+      if (result == InsertResult::Rejected) {
+        log_warn("SpoolReplayer", "replay batch rejected, inserting row by row",
+                 {{"path", path}, {"rows", end - begin}, {"error", error}});
+        if (!insert_rows(records, begin, end)) {
+          return false;
+        }
+      }
+    }
+    spool_.remove_segment(path);
+    rows += records.size();
+    replayed_ += records.size();
+  }
+
+  const double ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  if (rows > 0) {
+    if (spool_.pending() == 0) {
+      last_drain_ms_ = ms;
+    }
+    log_info("SpoolReplayer", "drained spool",
+             {{"records", rows},
+              {"elapsed_ms", ms},
+              {"records_per_sec", ms > 0.0 ? rows * 1000.0 / ms : 0.0},
+              {"still_pending", spool_.pending()}});
+  }
+  return true;
+}
+
+SpoolReplayer::InsertResult
+SpoolReplayer::insert(const std::vector<SpoolRecord> &records,
+                      std::size_t begin, std::size_t end, std::string &error) {
+  std::string ts = "{", ticker = "{", conf = "{", base = "{", calc = "{";
+  for (std::size_t i = begin; i < end; ++i) {
+    const char *sep = i == begin ? "" : ",";
+    const SpoolRecord &r = records[i];
+    ts += sep + std::to_string(r.timestamp);
+    ticker += sep + std::to_string(r.ticker_id);
+    conf += sep + std::to_string(r.conf_id);
+    base += sep;
+    append_number(base, r.base_price);
+    calc += sep;
+    append_number(calc, r.calculated_price);
+  }
+  ts += '}';
+  ticker += '}';
+  conf += '}';
+  base += '}';
+  calc += '}';
+
+  const char *values[5] = {ts.c_str(), ticker.c_str(), conf.c_str(),
+                           base.c_str(), calc.c_str()};
+  PGresult *res = PQexecParams(
+      conn_,
+      "INSERT INTO ticker_price (ts_exchange, ticker_id, conf_id, "
+      "base_price, calculated_price) "
+      "SELECT to_timestamp(t), i, c, b, p "
+      "FROM unnest($1::bigint[], $2::bigint[], $3::bigint[], "
+      "$4::double precision[], $5::double precision[]) AS u(t, i, c, b, p) "
+      "ON CONFLICT (ts_exchange, ticker_id, conf_id) DO NOTHING;",
+      5, nullptr, values, nullptr, nullptr, 0);
+  InsertResult result = InsertResult::Ok;
+  if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+    error = PQerrorMessage(conn_);
+    if (PQstatus(conn_) != CONNECTION_OK) {
+      PQfinish(conn_);
+      conn_ = nullptr;
+      result = InsertResult::Retry;
+    } else {
+      result = rejects_rows(res) ? InsertResult::Rejected : InsertResult::Retry;
+    }
+    if (result == InsertResult::Retry) {
+      log_error("SpoolReplayer", "replay insert failed", {{"error", error}});
+    }
+  }
+  PQclear(res);
+  return result;
+}
+
+bool SpoolReplayer::insert_rows(const std::vector<SpoolRecord> &records,
+                                std::size_t begin, std::size_t end) {
+  for (std::size_t i = begin; i < end; ++i) {
+    std::string error;
+    const InsertResult result = insert(records, i, i + 1, error);
+    if (result == InsertResult::Retry) {
+      return false;
+    }
+    if (result == InsertResult::Rejected) {
+      quarantine(records[i], error);
+    }
+  }
+  return true;
+}
+
+void SpoolReplayer::quarantine(const SpoolRecord &r, const std::string &error) {
+  const std::string path = spool_.dir() + "/quarantine.tsv";
+  std::string line = std::to_string(r.timestamp) + '\t' +
+                     std::to_string(r.ticker_id) + '\t' +
+                     std::to_string(r.conf_id) + '\t';
+  append_number(line, r.base_price);
+  line += '\t';
+  append_number(line, r.calculated_price);
+  line += '\t';
+  for (char c : error) {
+    line += c == '\n' || c == '\t' ? ' ' : c;
+  }
+  line += '\n';
+
+  FILE *f = std::fopen(path.c_str(), "a");
+  const bool ok = f && std::fwrite(line.data(), 1, line.size(), f) ==
+                           line.size();
+  if (f) {
+    std::fclose(f);
+  }
+  ++quarantined_;
+  log_error("SpoolReplayer", ok ? "quarantined spooled row"
+                                : "dropped spooled row, quarantine unwritable",
+            {{"path", path},
+             {"ticker_id", static_cast<long long>(r.ticker_id)},
+             {"conf_id", static_cast<long long>(r.conf_id)},
+             {"error", error}});
+}
@@ -0,0 +1,122 @@
+#include "realized_vol.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+RealizedVolBook::RealizedVolBook(const RealizedVolConfig &config)
+    : config_(config) {
+  config_.max_gap_sec = std::max<std::int64_t>(config_.max_gap_sec, 1);
+  decay_.resize(static_cast<std::size_t>(config_.max_gap_sec) + 1);
+  const double rate = config_.half_life_sec > 0.0
+                          ? std::log(2.0) / config_.half_life_sec
+                          : 0.0;
+  for (std::size_t dt = 0; dt < decay_.size(); ++dt) {
+    decay_[dt] = std::exp(-rate * static_cast<double>(dt));
+  }
+}
+
+RealizedVolBook::Shard &
+RealizedVolBook::shard_for(const std::string &ticker) {
+  return shards_[std::hash<std::string>()(ticker) % kShards];
+}
+
+const RealizedVolBook::Shard &
+RealizedVolBook::shard_for(const std::string &ticker) const {
+  return shards_[std::hash<std::string>()(ticker) % kShards];
+}
+
+RealizedVol RealizedVolBook::on_tick(const std::string &ticker,
+                                     std::int64_t timestamp, double price) {
+  const bool usable = price > 0.0 && std::isfinite(price);
+  const double log_price = usable ? std::log(price) : 0.0;
+
+  Shard &shard = shard_for(ticker);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.index.find(ticker);
+  if (it == shard.index.end()) {
+    if (!usable) {
+      return RealizedVol{};
+    }
+    it = shard.index.emplace(ticker, shard.states.size()).first;
+    shard.states.emplace_back();
+  }
+  State &s = shard.states[it->second];
+  if (!usable || (s.started && timestamp < s.last_ts)) {
+    return estimate(s);
+  }
+  if (!s.started || timestamp - s.last_ts > config_.max_gap_sec) {
+    s.started = true;
+    s.last_log_price = log_price;
+    s.last_ts = timestamp;
+    return estimate(s);
+  }
+
+  const auto dt = static_cast<std::uint32_t>(timestamp - s.last_ts);
+  const double r = log_price - s.last_log_price;
+  const double r2 = r * r;
+  s.last_log_price = log_price;
+  s.last_ts = timestamp;
+  ++s.returns;
+
+  const double decay = decay_[dt];
+  s.ewma_r2 = decay * s.ewma_r2 + r2;
+  s.ewma_dt = decay * s.ewma_dt + dt;
+
+  const std::uint32_t h = s.head;
+  s.window_r2 += r2 - s.r2[h];
+  s.window_dt += static_cast<double>(dt) - s.dt[h];
+  s.r2[h] = r2;
+  s.dt[h] = dt;
+  s.head = h + 1 == kRealizedVolWindow ? 0 : h + 1;
+  if (s.head == 0) {
+    s.window_r2 = 0.0;
+    s.window_dt = 0.0;
+    for (std::size_t i = 0; i < kRealizedVolWindow; ++i) {
+      s.window_r2 += s.r2[i];
+      s.window_dt += s.dt[i];
+    }
+  }
+  return estimate(s);
+}
+
+RealizedVol RealizedVolBook::estimate(const State &s) const {
+  RealizedVol out;
+  out.returns = s.returns;
+  if (s.ewma_dt > 0.0) {
+    out.ewma = std::sqrt(s.ewma_r2 / s.ewma_dt * config_.seconds_per_year);
+    out.ewma_ready = s.returns >= config_.min_returns;
+  }
+  if (s.window_dt > 0.0) {
+    out.window =
+        std::sqrt(std::max(s.window_r2, 0.0) / s.window_dt *
+                  config_.seconds_per_year);
+    out.window_ready = s.returns >= config_.min_returns;
+  }
+  return out;
+}
+
+bool RealizedVolBook::get(const std::string &ticker, RealizedVol &out) const {
+  const Shard &shard = shard_for(ticker);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.index.find(ticker);
+  if (it == shard.index.end()) {
+    return false;
+  }
+  out = estimate(shard.states[it->second]);
+  return true;
+}
+
+std::vector<std::pair<std::string, RealizedVol>>
+RealizedVolBook::snapshot() const {
+  std::vector<std::pair<std::string, RealizedVol>> out;
+  for (const Shard &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (const auto &entry : shard.index) {
+      out.emplace_back(entry.first, estimate(shard.states[entry.second]));
+    }
+  }
+  std::sort(out.begin(), out.end(),
+            [](const auto &l, const auto &r) { return l.first < r.first; });
+  return out;
+}
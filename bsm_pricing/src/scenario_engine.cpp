@@ -0,0 +1,236 @@
+#include "scenario_engine.hpp"
+
+#include "async_logger.hpp"
+#include "heston.hpp"
+#include "lattice.hpp"
+#include "option_pricer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+namespace {
+
+constexpr double kMinScenarioVol = 1e-4;
+
+std::vector<double> even_shocks(std::size_t points, double max) {
+  points = std::max<std::size_t>(points, 1);
+  std::vector<double> out(points, 0.0);
+  if (points == 1) {
+    return out;
+  }
+  for (std::size_t i = 0; i < points; ++i) {
+    out[i] = -max + 2.0 * max * static_cast<double>(i) /
+                        static_cast<double>(points - 1);
+  }
+  // Exact zero in the middle, whatever the rounding above did.
+  if (points % 2 == 1) {
+    out[points / 2] = 0.0;
+  }
+  return out;
+}
+
+double lattice_value(const BsmParams &p, double S, double sigma) {
+  LatticeContract c{S, p.K, p.r, p.q, sigma, p.T};
+  if (p.lattice_steps > 0) {
+    c.steps = p.lattice_steps;
+  }
+  c.kind = p.model == PricingModel::AmericanTrinomial ? LatticeKind::Trinomial
+                                                      : LatticeKind::Binomial;
+  return american_call(c);
+}
+
+// Values of one contract at every cell, spot-major, plus the base value.
+void revalue(const ScenarioContract &sc, const ScenarioGrid &grid,
+             double &base, double *cells) {
+  const BsmParams &p = sc.params;
+  const std::size_t ns = grid.spot_shocks.size();
+  const std::size_t nv = grid.vol_shocks.size();
+
+  if (p.model == PricingModel::Heston) {
+    // A vol shock moves both the current and the long-run vol.
+    base = heston_call(compile_heston(p.heston, p.r, p.q, p.T), sc.spot, p.K);
+    for (std::size_t j = 0; j < nv; ++j) {
+      HestonParams shocked = p.heston;
+      const double v0 = std::max(std::sqrt(p.heston.v0) + grid.vol_shocks[j],
+                                 kMinScenarioVol);
+      const double theta = std::max(
+          std::sqrt(p.heston.theta) + grid.vol_shocks[j], kMinScenarioVol);
+      shocked.v0 = v0 * v0;
+      shocked.theta = theta * theta;
+      const HestonSlice slice = compile_heston(shocked, p.r, p.q, p.T);
+      for (std::size_t i = 0; i < ns; ++i) {
+        cells[i * nv + j] =
+            heston_call(slice, sc.spot * (1.0 + grid.spot_shocks[i]), p.K);
+      }
+    }
+    return;
+  }
+
+  if (p.model != PricingModel::Bsm) {
+    base = lattice_value(p, sc.spot, p.sigma);
+    for (std::size_t i = 0; i < ns; ++i) {
+      const double S = sc.spot * (1.0 + grid.spot_shocks[i]);
+      for (std::size_t j = 0; j < nv; ++j) {
+        cells[i * nv + j] = lattice_value(
+            p, S, std::max(p.sigma + grid.vol_shocks[j], kMinScenarioVol));
+      }
+    }
+    return;
+  }
+
+  base = OptionPricer::black_scholes_call(sc.spot, p.K, p.r, p.q, p.sigma,
+                                          p.T);
+  if (!(p.K > 0.0 && p.T > 0.0)) {
+    std::fill(cells, cells + ns * nv, 0.0);
+    return;
+  }
+
+  thread_local std::vector<double> spot;
+  thread_local std::vector<double> log_moneyness;
+  thread_local std::vector<double> d1;
+  thread_local std::vector<double> d2;
+  spot.resize(ns);
+  log_moneyness.resize(ns);
+  d1.resize(ns);
+  d2.resize(ns);
+  for (std::size_t i = 0; i < ns; ++i) {
+    spot[i] = sc.spot * (1.0 + grid.spot_shocks[i]);
+    log_moneyness[i] = spot[i] > 0.0 ? std::log(spot[i] / p.K) : -INFINITY;
+  }
+
+  const double sqrtT = std::sqrt(p.T);
+  const double df_q = std::exp(-p.q * p.T);
+  const double K_df_r = p.K * std::exp(-p.r * p.T);
+  for (std::size_t j = 0; j < nv; ++j) {
+    const double sigma = std::max(p.sigma + grid.vol_shocks[j], kMinScenarioVol);
+    const double sigma_sqrtT = sigma * sqrtT;
+    const double drift = (p.r - p.q + 0.5 * sigma * sigma) * p.T;
+    for (std::size_t i = 0; i < ns; ++i) {
+      d1[i] = (log_moneyness[i] + drift) / sigma_sqrtT;
+      d2[i] = d1[i] - sigma_sqrtT;
+    }
+    OptionPricer::normal_cdf_batch(d1.data(), d1.data(), ns);
+    OptionPricer::normal_cdf_batch(d2.data(), d2.data(), ns);
+    for (std::size_t i = 0; i < ns; ++i) {
+      cells[i * nv + j] =
+          spot[i] > 0.0 ? spot[i] * df_q * d1[i] - K_df_r * d2[i] : 0.0;
+    }
+  }
+}
+
+void append_number(std::string &out, double v) {
+  char buf[32];
+  const int n = std::snprintf(buf, sizeof(buf), "%.10g", v);
+  out.append(buf, static_cast<std::size_t>(n));
+}
+
+void append_array(std::string &out, const std::vector<double> &values) {
+  out += '[';
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    if (i > 0) {
+      out += ',';
+    }
+    append_number(out, values[i]);
+  }
+  out += ']';
+}
+
+} // namespace
+
+ScenarioGrid make_scenario_grid(std::size_t spot_points, double max_spot,
+                                std::size_t vol_points, double max_vol) {
+  return ScenarioGrid{even_shocks(spot_points, max_spot),
+                      even_shocks(vol_points, max_vol)};
+}
+
+ScenarioReport ScenarioEngine::run(
+    const std::vector<ScenarioContract> &contracts,
+    const ScenarioGrid &grid) const {
+  ScenarioReport report;
+  report.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+  report.grid = grid;
+
+  const std::size_t cells = grid.spot_shocks.size() * grid.vol_shocks.size();
+  std::vector<double> values(contracts.size() * cells);
+  std::vector<double> bases(contracts.size());
+  pool_.parallel_for(contracts.size(), [&](std::size_t c) {
+    revalue(contracts[c], grid, bases[c], &values[c * cells]);
+  });
+
+  std::map<std::string, std::vector<std::size_t>> by_ticker;
+  for (std::size_t c = 0; c < contracts.size(); ++c) {
+    by_ticker[contracts[c].ticker].push_back(c);
+  }
+  report.tickers.resize(by_ticker.size());
+  std::vector<const std::vector<std::size_t> *> members;
+  for (const auto &entry : by_ticker) {
+    report.tickers[members.size()].ticker = entry.first;
+    members.push_back(&entry.second);
+  }
+  pool_.parallel_for(report.tickers.size(), [&](std::size_t t) {
+    TickerPnl &out = report.tickers[t];
+    out.contracts = members[t]->size();
+    out.pnl.assign(cells, 0.0);
+    for (std::size_t c : *members[t]) {
+      out.base_value += bases[c];
+      const double *v = &values[c * cells];
+      for (std::size_t k = 0; k < cells; ++k) {
+        out.pnl[k] += v[k] - bases[c];
+      }
+    }
+  });
+  return report;
+}
+
+bool write_scenario_report(const std::string &path,
+                           const ScenarioReport &report) {
+  const std::size_t nv = report.grid.vol_shocks.size();
+  std::string json = "{\"timestamp\":" + std::to_string(report.timestamp) +
+                     ",\"spot_shocks\":";
+  append_array(json, report.grid.spot_shocks);
+  json += ",\"vol_shocks\":";
+  append_array(json, report.grid.vol_shocks);
+  json += ",\"tickers\":[";
+  for (std::size_t t = 0; t < report.tickers.size(); ++t) {
+    const TickerPnl &tp = report.tickers[t];
+    if (t > 0) {
+      json += ',';
+    }
+    json += "{\"ticker\":\"" + tp.ticker +
+            "\",\"contracts\":" + std::to_string(tp.contracts) +
+            ",\"base_value\":";
+    append_number(json, tp.base_value);
+    json += ",\"pnl\":[";
+    for (std::size_t i = 0; nv > 0 && i < tp.pnl.size() / nv; ++i) {
+      if (i > 0) {
+        json += ',';
+      }
+      append_array(json, std::vector<double>(tp.pnl.begin() + i * nv,
+                                             tp.pnl.begin() + (i + 1) * nv));
+    }
+    json += "]}";
+  }
+  json += "]}\n";
+
+  const std::string tmp = path + ".tmp";
+  FILE *f = std::fopen(tmp.c_str(), "wb");
+  bool ok = f != nullptr;
+  if (ok) {
+    ok = std::fwrite(json.data(), 1, json.size(), f) == json.size();
+    ok = std::fclose(f) == 0 && ok;
+  }
+  if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    log_error("ScenarioEngine", "report write failed",
+              {{"path", path}, {"error", std::strerror(errno)}});
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
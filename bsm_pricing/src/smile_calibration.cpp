@@ -0,0 +1,479 @@
+#include "smile_calibration.hpp"
+
+#include "async_logger.hpp"
+#include "option_pricer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+namespace {
+
+constexpr double kMinSmileVol = 1e-4;
+constexpr double kMaxImpliedVol = 10.0;
+constexpr int kMaxImpliedIterations = 100;
+constexpr int kMaxLmIterations = 200;
+constexpr double kMaxRho = 0.999;
+constexpr double kMinS = 1e-4;
+constexpr int kParams = 5;
+
+bool usable(const OptionQuotePoint &q) {
+  return std::isfinite(q.K) && std::isfinite(q.T) && std::isfinite(q.price) &&
+         std::isfinite(q.S) && std::isfinite(q.r) && std::isfinite(q.q) &&
+         q.K > 0.0 && q.T > 0.0 && q.price > 0.0 && q.S > 0.0;
+}
+
+bool by_strike(const OptionQuotePoint &l, const OptionQuotePoint &r) {
+  return l.K != r.K ? l.K < r.K : l.price < r.price;
+}
+
+std::uint64_t bits(double v) {
+  std::uint64_t out;
+  std::memcpy(&out, &v, sizeof(out));
+  return out;
+}
+
+// FNV-1a over the sorted quotes.
+std::uint64_t fingerprint(const std::vector<OptionQuotePoint> &quotes) {
+  std::uint64_t h = 0xcbf29ce484222325ULL;
+  for (const OptionQuotePoint &q : quotes) {
+    for (double v : {q.K, q.price, q.S, q.r, q.q}) {
+      h = (h ^ bits(v)) * 0x100000001b3ULL;
+    }
+  }
+  return h;
+}
+
+// Keeps the parameters where raw SVI is a valid smile: b >= 0, |rho| < 1,
+// s > 0 and min_k w(k) = a + b s sqrt(1 - rho^2) >= 0.
+void project(double x[kParams]) {
+  x[1] = std::max(x[1], 0.0);
+  x[2] = std::clamp(x[2], -kMaxRho, kMaxRho);
+  x[4] = std::max(x[4], kMinS);
+  x[0] = std::max(x[0], -x[1] * x[4] * std::sqrt(1.0 - x[2] * x[2]));
+}
+
+struct Point {
+  double k;
+  double vol;
+};
+
+// Residuals sqrt(w(k)/T) - vol and, when jac is set, their gradients in
+// (a, b, rho, m, s). Returns half the sum of squares.
+double residuals(const double x[kParams], const std::vector<Point> &pts,
+                 double T, double *res, std::array<double, kParams> *jac) {
+  double cost = 0.0;
+  for (std::size_t i = 0; i < pts.size(); ++i) {
+    const double d = pts[i].k - x[3];
+    const double root = std::sqrt(d * d + x[4] * x[4]);
+    const double w = x[0] + x[1] * (x[2] * d + root);
+    const double sigma = std::sqrt(std::max(w, kMinSmileVol * kMinSmileVol * T) / T);
+    res[i] = sigma - pts[i].vol;
+    cost += 0.5 * res[i] * res[i];
+    if (jac) {
+      const double scale = 1.0 / (2.0 * sigma * T);
+      jac[i][0] = scale;
+      jac[i][1] = scale * (x[2] * d + root);
+      jac[i][2] = scale * x[1] * d;
+      jac[i][3] = -scale * x[1] * (x[2] + d / root);
+      jac[i][4] = scale * x[1] * x[4] / root;
+    }
+  }
+  return cost;
+}
+
+// Solves A x = b for symmetric positive definite A in place; false when a
+// pivot is not positive.
+bool cholesky_solve(double A[kParams][kParams], double b[kParams]) {
+  for (int j = 0; j < kParams; ++j) {
+    double d = A[j][j];
+    for (int k = 0; k < j; ++k) {
+      d -= A[j][k] * A[j][k];
+    }
+    if (!(d > 0.0)) {
+      return false;
+    }
+    A[j][j] = std::sqrt(d);
+    for (int i = j + 1; i < kParams; ++i) {
+      double v = A[i][j];
+      for (int k = 0; k < j; ++k) {
+        v -= A[i][k] * A[j][k];
+      }
+      A[i][j] = v / A[j][j];
+    }
+  }
+  for (int i = 0; i < kParams; ++i) {
+    for (int k = 0; k < i; ++k) {
+      b[i] -= A[i][k] * b[k];
+    }
+    b[i] /= A[i][i];
+  }
+  for (int i = kParams - 1; i >= 0; --i) {
+    for (int k = i + 1; k < kParams; ++k) {
+      b[i] -= A[k][i] * b[k];
+    }
+    b[i] /= A[i][i];
+  }
+  return true;
+}
+
+// Seed from the quotes: the level at the quote nearest the money and the
+// wing slopes from the outermost quotes on either side.
+SviParams seed(const std::vector<Point> &pts, double T) {
+  std::size_t atm = 0;
+  std::size_t lo = 0;
+  std::size_t hi = 0;
+  for (std::size_t i = 1; i < pts.size(); ++i) {
+    if (std::fabs(pts[i].k) < std::fabs(pts[atm].k)) {
+      atm = i;
+    }
+    lo = pts[i].k < pts[lo].k ? i : lo;
+    hi = pts[i].k > pts[hi].k ? i : hi;
+  }
+  auto w = [&](std::size_t i) { return pts[i].vol * pts[i].vol * T; };
+  const double k0 = pts[atm].k;
+  const double left = pts[lo].k < k0 ? (w(lo) - w(atm)) / (pts[lo].k - k0) : 0.0;
+  const double right =
+      pts[hi].k > k0 ? (w(hi) - w(atm)) / (pts[hi].k - k0) : 0.0;
+
+  SviParams p;
+  p.b = std::max(0.5 * (right - left), 1e-3 * w(atm) + 1e-6);
+  p.rho = std::clamp((right + left) / (right - left + 1e-300), -0.9, 0.9);
+  p.m = k0;
+  p.s = 0.1;
+  p.a = w(atm) - p.b * p.s;
+  return p;
+}
+
+} // namespace
+
+double svi_total_variance(const SviParams &p, double k) {
+  const double d = k - p.m;
+  return p.a + p.b * (p.rho * d + std::sqrt(d * d + p.s * p.s));
+}
+
+bool implied_call_vol(double price, double S, double K, double r, double q,
+                      double T, double &out) {
+  if (!(std::isfinite(price) && S > 0.0 && K > 0.0 && T > 0.0 &&
+        std::isfinite(S) && std::isfinite(K) && std::isfinite(T) &&
+        std::isfinite(r) && std::isfinite(q))) {
+    return false;
+  }
+  const double upper = S * std::exp(-q * T);
+  const double lower = std::max(upper - K * std::exp(-r * T), 0.0);
+  if (!(price > lower && price < upper)) {
+    return false;
+  }
+
+  // Start where vega peaks in log-moneyness, bracket every step, and fall
+  // back to bisection when Newton leaves the bracket.
+  double lo = 0.0;
+  double hi = kMaxImpliedVol;
+  if (OptionPricer::black_scholes_call(S, K, r, q, hi, T) < price) {
+    return false;
+  }
+  const double x = std::log(S / K) + (r - q) * T;
+  double sigma = std::clamp(std::sqrt(2.0 * std::fabs(x) / T), 0.1, 2.0);
+  for (int i = 0; i < kMaxImpliedIterations; ++i) {
+    const CallGreeks g =
+        OptionPricer::black_scholes_call_greeks(S, K, r, q, sigma, T);
+    const double diff = g.price - price;
+    if (std::fabs(diff) <= 1e-14 * price) {
+      break;
+    }
+    (diff > 0.0 ? hi : lo) = sigma;
+    double next = g.vega > 0.0 ? sigma - diff / g.vega : 0.5 * (lo + hi);
+    if (!(next > lo && next < hi)) {
+      next = 0.5 * (lo + hi);
+    }
+    if (std::fabs(next - sigma) <= 1e-15 * sigma) {
+      sigma = next;
+      break;
+    }
+    sigma = next;
+  }
+  out = sigma;
+  return true;
+}
+
+SmileFit calibrate_svi(const SmileSlice &slice, const SviParams *warm) {
+  SmileFit fit;
+  fit.ticker_id = slice.ticker_id;
+  fit.T = slice.T;
+  if (!(slice.T > 0.0) || !std::isfinite(slice.T)) {
+    return fit;
+  }
+
+  std::vector<Point> pts;
+  pts.reserve(slice.quotes.size());
+  double forward_sum = 0.0;
+  for (const OptionQuotePoint &q : slice.quotes) {
+    double vol;
+    if (!implied_call_vol(q.price, q.S, q.K, q.r, q.q, slice.T, vol)) {
+      continue;
+    }
+    const double F = q.S * std::exp((q.r - q.q) * slice.T);
+    pts.push_back(Point{std::log(q.K / F), vol});
+    forward_sum += F;
+  }
+  fit.quotes = pts.size();
+  if (pts.size() < kMinSmileQuotes) {
+    return fit;
+  }
+  fit.forward = forward_sum / static_cast<double>(pts.size());
+
+  const SviParams start = warm ? *warm : seed(pts, slice.T);
+  double x[kParams] = {start.a, start.b, start.rho, start.m, start.s};
+  project(x);
+
+  const std::size_t n = pts.size();
+  std::vector<double> res(n);
+  std::vector<double> trial(n);
+  std::vector<std::array<double, kParams>> jac(n);
+  double cost = residuals(x, pts, slice.T, res.data(), jac.data());
+  double lambda = 1e-3;
+  int it = 0;
+  for (; it < kMaxLmIterations && !fit.converged; ++it) {
+    double JtJ[kParams][kParams] = {};
+    double g[kParams] = {};
+    for (std::size_t i = 0; i < n; ++i) {
+      for (int a = 0; a < kParams; ++a) {
+        g[a] += jac[i][a] * res[i];
+        for (int b = 0; b <= a; ++b) {
+          JtJ[a][b] += jac[i][a] * jac[i][b];
+        }
+      }
+    }
+    double gmax = 0.0;
+    for (int a = 0; a < kParams; ++a) {
+      gmax = std::max(gmax, std::fabs(g[a]));
+      for (int b = 0; b < a; ++b) {
+        JtJ[b][a] = JtJ[a][b];
+      }
+    }
+    if (gmax <= 1e-15) {
+      fit.converged = true;
+      break;
+    }
+
+    // Damp until a step lowers the cost; a damping this large means the
+    // projected gradient has nowhere left to go.
+    bool accepted = false;
+    while (lambda < 1e12) {
+      double A[kParams][kParams];
+      double step[kParams];
+      for (int a = 0; a < kParams; ++a) {
+        for (int b = 0; b < kParams; ++b) {
+          A[a][b] = JtJ[a][b];
+        }
+        A[a][a] += lambda * (JtJ[a][a] + 1e-12);
+        step[a] = -g[a];
+      }
+      if (!cholesky_solve(A, step)) {
+        lambda *= 4.0;
+        continue;
+      }
+      double next[kParams];
+      double moved = 0.0;
+      for (int a = 0; a < kParams; ++a) {
+        next[a] = x[a] + step[a];
+      }
+      project(next);
+      for (int a = 0; a < kParams; ++a) {
+        moved = std::max(moved, std::fabs(next[a] - x[a]));
+      }
+      const double next_cost =
+          residuals(next, pts, slice.T, trial.data(), nullptr);
+      if (next_cost < cost) {
+        const double drop = cost - next_cost;
+        std::copy(next, next + kParams, x);
+        cost = residuals(x, pts, slice.T, res.data(), jac.data());
+        lambda = std::max(lambda / 3.0, 1e-12);
+        accepted = true;
+        fit.converged = moved <= 1e-12 || drop <= 1e-15 * cost + 1e-30;
+        break;
+      }
+      lambda *= 4.0;
+    }
+    if (!accepted) {
+      fit.converged = true;
+    }
+  }
+
+  fit.svi = SviParams{x[0], x[1], x[2], x[3], x[4]};
+  fit.iterations = it;
+  fit.rms_vol_error = std::sqrt(2.0 * cost / static_cast<double>(n));
+  fit.valid = std::isfinite(fit.rms_vol_error);
+  return fit;
+}
+
+CalibrationStats
+SmileCalibrator::update(const std::vector<OptionQuotePoint> &quotes) {
+  const auto start = std::chrono::steady_clock::now();
+
+  std::unordered_map<long long, std::map<double, std::vector<OptionQuotePoint>>>
+      grouped;
+  std::size_t dropped = 0;
+  for (const OptionQuotePoint &q : quotes) {
+    if (!usable(q)) {
+      ++dropped;
+      continue;
+    }
+    grouped[q.ticker_id][q.T].push_back(q);
+  }
+  if (dropped > 0) {
+    log_warn("SmileCalibrator", "dropped invalid option quotes",
+             {{"count", dropped}});
+  }
+
+  struct Job {
+    long long ticker_id;
+    std::size_t index; // into next[ticker_id]
+    SmileSlice slice;
+    bool warm;
+    SviParams previous;
+  };
+  CalibrationStats stats;
+  std::unordered_map<long long, std::vector<Entry>> next;
+  std::vector<Job> jobs;
+  std::size_t thin = 0;
+  for (auto &ticker : grouped) {
+    auto old = slices_.find(ticker.first);
+    std::vector<Entry> &entries = next[ticker.first];
+    for (auto &maturity : ticker.second) {
+      std::vector<OptionQuotePoint> &qs = maturity.second;
+      if (qs.size() < kMinSmileQuotes) {
+        ++thin;
+        continue;
+      }
+      ++stats.slices;
+      std::sort(qs.begin(), qs.end(), by_strike);
+      const std::uint64_t fp = fingerprint(qs);
+
+      const Entry *previous = nullptr;
+      if (old != slices_.end()) {
+        for (const Entry &e : old->second) {
+          if (e.fit.T == maturity.first) {
+            previous = &e;
+            break;
+          }
+        }
+      }
+      if (previous && previous->fingerprint == fp) {
+        entries.push_back(*previous);
+        ++stats.reused;
+        continue;
+      }
+      Job job{ticker.first, entries.size(),
+              SmileSlice{ticker.first, maturity.first, std::move(qs)},
+              previous && previous->fit.valid, SviParams{}};
+      if (job.warm) {
+        job.previous = previous->fit.svi;
+      }
+      jobs.push_back(std::move(job));
+      entries.push_back(Entry{fp, SmileFit{}});
+    }
+    if (entries.empty()) {
+      next.erase(ticker.first);
+    }
+  }
+  if (thin > 0) {
+    log_warn("SmileCalibrator", "skipped slices with too few quotes",
+             {{"count", thin}, {"min_quotes", kMinSmileQuotes}});
+  }
+
+  std::vector<SmileFit> results(jobs.size());
+  pool_.parallel_for(jobs.size(), [&](std::size_t i) {
+    const Job &job = jobs[i];
+    results[i] = calibrate_svi(job.slice, job.warm ? &job.previous : nullptr);
+  });
+  for (std::size_t i = 0; i < jobs.size(); ++i) {
+    next[jobs[i].ticker_id][jobs[i].index].fit = results[i];
+    ++stats.fitted;
+    if (!results[i].valid) {
+      ++stats.failed;
+      log_warn("SmileCalibrator", "smile calibration failed",
+               {{"ticker_id", jobs[i].ticker_id},
+                {"maturity", jobs[i].slice.T},
+                {"usable_quotes", results[i].quotes}});
+    }
+  }
+
+  slices_ = std::move(next);
+  stats.wall_ms = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  stats_ = stats;
+  return stats;
+}
+
+bool SmileCalibrator::sigma(long long ticker_id, double K, double T,
+                            double &out) const {
+  auto it = slices_.find(ticker_id);
+  if (it == slices_.end() || !(K > 0.0) || !(T > 0.0)) {
+    return false;
+  }
+  const SmileFit *before = nullptr;
+  const SmileFit *after = nullptr;
+  for (const Entry &e : it->second) {
+    if (!e.fit.valid) {
+      continue;
+    }
+    if (e.fit.T <= T) {
+      before = &e.fit;
+    } else {
+      after = &e.fit;
+      break;
+    }
+  }
+  if (!before && !after) {
+    return false;
+  }
+  auto w = [K](const SmileFit &f) {
+    return std::max(svi_total_variance(f.svi, std::log(K / f.forward)), 0.0);
+  };
+
+  double vol;
+  if (!before) {
+    vol = std::sqrt(w(*after) / after->T);
+  } else if (!after || before->T == T) {
+    vol = std::sqrt(w(*before) / before->T);
+  } else {
+    const double t = (T - before->T) / (after->T - before->T);
+    vol = std::sqrt(((1.0 - t) * w(*before) + t * w(*after)) / T);
+  }
+  out = std::max(vol, kMinSmileVol);
+  return true;
+}
+
+std::size_t SmileCalibrator::apply(
+    std::unordered_map<long long, BsmParams> &params) const {
+  std::size_t changed = 0;
+  for (auto &entry : params) {
+    BsmParams &p = entry.second;
+    double s;
+    if (sigma(p.ticker_id, p.K, p.T, s)) {
+      p.sigma = s;
+      ++changed;
+    }
+  }
+  return changed;
+}
+
+std::vector<SmileFit> SmileCalibrator::fits() const {
+  std::vector<SmileFit> out;
+  for (const auto &ticker : slices_) {
+    for (const Entry &e : ticker.second) {
+      if (e.fit.valid) {
+        out.push_back(e.fit);
+      }
+    }
+  }
+  std::sort(out.begin(), out.end(), [](const SmileFit &l, const SmileFit &r) {
+    return l.ticker_id != r.ticker_id ? l.ticker_id < r.ticker_id : l.T < r.T;
+  });
+  return out;
+}
@@ -0,0 +1,70 @@
+#include "sobol.hpp"
+
+#include <stdexcept>
+
+namespace {
+
+struct Primitive {
+  unsigned degree;
+  unsigned coeffs;
+  unsigned m[6];
+};
+
+// Dimensions 2..16 of new-joe-kuo-6.21201; dimension 1 is van der Corput.
+constexpr Primitive kJoeKuo[SobolSequence::kMaxDims - 1] = {
+    {1, 0, {1}},
+    {2, 1, {1, 3}},
+    {3, 1, {1, 3, 1}},
+    {3, 2, {1, 1, 1}},
+    {4, 1, {1, 1, 3, 3}},
+    {4, 4, {1, 3, 5, 13}},
+    {5, 2, {1, 1, 5, 5, 17}},
+    {5, 4, {1, 1, 5, 5, 5}},
+    {5, 7, {1, 1, 7, 11, 19}},
+    {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},
+    {5, 14, {1, 3, 5, 5, 31}},
+    {6, 1, {1, 3, 3, 9, 7, 49}},
+    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}},
+};
+
+} // namespace
+
+SobolSequence::SobolSequence(std::size_t dims) : dims_(dims) {
+  if (dims == 0 || dims > kMaxDims) {
+    throw std::invalid_argument("SobolSequence: dims must be in [1, 16]");
+  }
+  for (unsigned i = 0; i < 32; ++i) {
+    directions_[0][i] = 1u << (31 - i);
+  }
+  for (std::size_t d = 1; d < dims; ++d) {
+    const Primitive &p = kJoeKuo[d - 1];
+    auto &v = directions_[d];
+    for (unsigned i = 0; i < 32; ++i) {
+      if (i < p.degree) {
+        v[i] = p.m[i] << (31 - i);
+        continue;
+      }
+      v[i] = v[i - p.degree] ^ (v[i - p.degree] >> p.degree);
+      for (unsigned k = 1; k < p.degree; ++k) {
+        if ((p.coeffs >> (p.degree - 1 - k)) & 1u) {
+          v[i] ^= v[i - k];
+        }
+      }
+    }
+  }
+}
+
+void SobolSequence::point(std::uint64_t index, double *out) const {
+  for (std::size_t d = 0; d < dims_; ++d) {
+    std::uint32_t x = 0;
+    std::uint64_t bits = index;
+    for (unsigned b = 0; bits != 0 && b < 32; ++b, bits >>= 1) {
+      if (bits & 1u) {
+        x ^= directions_[d][b];
+      }
+    }
+    out[d] = static_cast<double>(x) * (1.0 / 4294967296.0);
+  }
+}
@@ -0,0 +1,95 @@
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <exception>
+
+struct ThreadPool::Job {
+  const std::function<void(std::size_t)> *fn;
+  std::size_t n;
+  std::atomic<std::size_t> next{0};
+  std::mutex error_mutex;
+  std::exception_ptr error;
+};
+
+ThreadPool::ThreadPool(std::size_t threads) {
+  for (std::size_t i = 1; i < threads; ++i) {
+    workers_.emplace_back(&ThreadPool::worker_loop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto &w : workers_) {
+    w.join();
+  }
+}
+
+void ThreadPool::parallel_for(std::size_t n,
+                              const std::function<void(std::size_t)> &fn) {
+  if (n == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> serial(submit_mutex_);
+  Job job;
+  job.fn = &fn;
+  job.n = n;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job_ = &job;
+    busy_ = workers_.size();
+    ++generation_;
+  }
+  cv_.notify_all();
+
+  run(job);
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return busy_ == 0; });
+    job_ = nullptr;
+  }
+  if (job.error) {
+    std::rethrow_exception(job.error);
+  }
+}
+
+void ThreadPool::worker_loop() {
+  std::uint64_t seen = 0;
+  while (true) {
+    Job *job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+      job = job_;
+    }
+    run(*job);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--busy_ == 0) {
+        done_cv_.notify_all();
+      }
+    }
+  }
+}
+
+void ThreadPool::run(Job &job) {
+  std::size_t i;
+  while ((i = job.next.fetch_add(1, std::memory_order_relaxed)) < job.n) {
+    try {
+      (*job.fn)(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(job.error_mutex);
+      if (!job.error) {
+        job.error = std::current_exception();
+      }
+    }
+  }
+}
@@ -0,0 +1,407 @@
+#include "tick_store.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+constexpr std::uint8_t kNoWindow = 0xff;
+// Replies carry at most this many points; a range past it is cut short.
+constexpr std::size_t kMaxReplyPoints = 100000;
+
+std::uint64_t mask(unsigned width) {
+  return width >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << width) - 1;
+}
+
+std::uint64_t to_bits(double v) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  return bits;
+}
+
+double from_bits(std::uint64_t bits) {
+  double v;
+  std::memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+struct BitReader {
+  const std::uint64_t *words;
+  std::uint64_t pos{0};
+
+  std::uint64_t get(unsigned width) {
+    if (width == 0) {
+      return 0;
+    }
+    const std::uint64_t word = words[pos >> 6];
+    const unsigned avail = 64 - static_cast<unsigned>(pos & 63);
+    std::uint64_t v;
+    if (width <= avail) {
+      v = (word >> (avail - width)) & mask(width);
+    } else {
+      const unsigned rest = width - avail;
+      v = ((word & mask(avail)) << rest) | (words[(pos >> 6) + 1] >> (64 - rest));
+    }
+    pos += width;
+    return v;
+  }
+};
+
+std::int64_t read_dod(BitReader &r) {
+  if (!r.get(1)) {
+    return 0;
+  }
+  if (!r.get(1)) {
+    return static_cast<std::int64_t>(r.get(7)) - 63;
+  }
+  if (!r.get(1)) {
+    return static_cast<std::int64_t>(r.get(9)) - 255;
+  }
+  if (!r.get(1)) {
+    return static_cast<std::int64_t>(r.get(12)) - 2047;
+  }
+  return static_cast<std::int64_t>(r.get(64));
+}
+
+std::uint64_t read_value(BitReader &r, std::uint64_t prev, std::uint8_t &lead,
+                         std::uint8_t &trail) {
+  if (!r.get(1)) {
+    return prev;
+  }
+  if (r.get(1)) {
+    lead = static_cast<std::uint8_t>(r.get(5));
+    unsigned sig = static_cast<unsigned>(r.get(6));
+    if (sig == 0) {
+      sig = 64;
+    }
+    trail = static_cast<std::uint8_t>(64 - lead - sig);
+  }
+  const unsigned sig = 64 - lead - trail;
+  return prev ^ (r.get(sig) << trail);
+}
+
+// Shortest round-trip form, so a client reads back the stored doubles.
+void append_points(std::string &out, const std::vector<TickPoint> &points) {
+  char buf[96];
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    char *p = buf;
+    *p++ = i ? ',' : '[';
+    if (i) {
+      *p++ = '[';
+    }
+    p = std::to_chars(p, buf + sizeof(buf), points[i].timestamp).ptr;
+    *p++ = ',';
+    p = std::to_chars(p, buf + sizeof(buf), points[i].spot).ptr;
+    *p++ = ',';
+    p = std::to_chars(p, buf + sizeof(buf), points[i].price).ptr;
+    *p++ = ']';
+    out.append(buf, static_cast<std::size_t>(p - buf));
+  }
+}
+
+} // namespace
+
+void TickStore::Chunk::put(std::uint64_t value, unsigned width) {
+  if (width == 0) {
+    return;
+  }
+  value &= mask(width);
+  const unsigned off = static_cast<unsigned>(bits & 63);
+  if (off == 0) {
+    words.push_back(0);
+  }
+  const unsigned avail = 64 - off;
+  if (width <= avail) {
+    words.back() |= value << (avail - width);
+  } else {
+    const unsigned rest = width - avail;
+    words.back() |= value >> rest;
+    words.push_back(value << (64 - rest));
+  }
+  bits += width;
+}
+
+void TickStore::Chunk::append(std::int64_t timestamp, double spot,
+                              double price) {
+  const std::uint64_t values[2] = {to_bits(spot), to_bits(price)};
+  if (count == 0) {
+    put(static_cast<std::uint64_t>(timestamp), 64);
+    put(values[0], 64);
+    put(values[1], 64);
+    min_ts = max_ts = prev_ts = timestamp;
+    prev_delta = 0;
+    for (int v = 0; v < 2; ++v) {
+      prev_value[v] = values[v];
+      lead[v] = kNoWindow;
+      trail[v] = 0;
+    }
+    ++count;
+    return;
+  }
+
+  const std::int64_t delta = timestamp - prev_ts;
+  const std::int64_t dod = delta - prev_delta;
+  if (dod == 0) {
+    put(0, 1);
+  } else if (dod >= -63 && dod <= 64) {
+    put(0b10, 2);
+    put(static_cast<std::uint64_t>(dod + 63), 7);
+  } else if (dod >= -255 && dod <= 256) {
+    put(0b110, 3);
+    put(static_cast<std::uint64_t>(dod + 255), 9);
+  } else if (dod >= -2047 && dod <= 2048) {
+    put(0b1110, 4);
+    put(static_cast<std::uint64_t>(dod + 2047), 12);
+  } else {
+    put(0b1111, 4);
+    put(static_cast<std::uint64_t>(dod), 64);
+  }
+  prev_delta = delta;
+  prev_ts = timestamp;
+  min_ts = std::min(min_ts, timestamp);
+  max_ts = std::max(max_ts, timestamp);
+
+  for (int v = 0; v < 2; ++v) {
+    const std::uint64_t x = values[v] ^ prev_value[v];
+    prev_value[v] = values[v];
+    if (x == 0) {
+      put(0, 1);
+      continue;
+    }
+    put(1, 1);
+    const unsigned lz = std::min(31, __builtin_clzll(x));
+    const unsigned tz = static_cast<unsigned>(__builtin_ctzll(x));
+    if (lead[v] != kNoWindow && lz >= lead[v] && tz >= trail[v]) {
+      put(0, 1);
+      put(x >> trail[v], 64 - lead[v] - trail[v]);
+    } else {
+      const unsigned sig = 64 - lz - tz;
+      put(1, 1);
+      put(lz, 5);
+      put(sig == 64 ? 0 : sig, 6);
+      put(x >> tz, sig);
+      lead[v] = static_cast<std::uint8_t>(lz);
+      trail[v] = static_cast<std::uint8_t>(tz);
+    }
+  }
+  ++count;
+}
+
+void TickStore::Chunk::decode(std::vector<TickPoint> &out) const {
+  if (count == 0) {
+    return;
+  }
+  BitReader r{words.data()};
+  TickPoint p;
+  p.timestamp = static_cast<std::int64_t>(r.get(64));
+  std::uint64_t values[2] = {r.get(64), r.get(64)};
+  p.spot = from_bits(values[0]);
+  p.price = from_bits(values[1]);
+  out.push_back(p);
+
+  std::int64_t delta = 0;
+  std::uint8_t lead_bits[2] = {0, 0};
+  std::uint8_t trail_bits[2] = {0, 0};
+  for (std::uint32_t i = 1; i < count; ++i) {
+    delta += read_dod(r);
+    p.timestamp += delta;
+    for (int v = 0; v < 2; ++v) {
+      values[v] = read_value(r, values[v], lead_bits[v], trail_bits[v]);
+    }
+    p.spot = from_bits(values[0]);
+    p.price = from_bits(values[1]);
+    out.push_back(p);
+  }
+}
+
+const std::size_t TickStore::kSeriesBytes =
+    sizeof(std::pair<const long long, Series>) + 4 * sizeof(void *) +
+    sizeof(long long);
+const std::size_t TickStore::kSealedBytes = sizeof(Chunk) + sizeof(long long);
+
+TickStore::TickStore(const TickStoreConfig &config) : config_(config) {
+  config_.chunk_points = std::max<std::size_t>(config_.chunk_points, 2);
+}
+
+void TickStore::append(long long conf_id, std::int64_t timestamp, double spot,
+                       double price) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto [it, inserted] = series_.try_emplace(conf_id);
+  Series &s = it->second;
+  if (inserted) {
+    s.lru = lru_.insert(lru_.end(), conf_id);
+    bytes_ += kSeriesBytes;
+  } else {
+    lru_.splice(lru_.end(), lru_, s.lru);
+  }
+  Chunk &open = s.open;
+  std::size_t before = open.bytes();
+  open.append(timestamp, spot, price);
+  bytes_ += open.bytes() - before;
+  ++points_;
+
+  if (open.count >= config_.chunk_points) {
+    before = open.bytes();
+    open.words.shrink_to_fit();
+    bytes_ -= before - open.bytes();
+    s.sealed.push_back(std::move(open));
+    open = Chunk{};
+    seal_order_.push_back(conf_id);
+    bytes_ += kSealedBytes;
+  }
+  evict(conf_id);
+}
+
+void TickStore::evict(long long keep) {
+  while (bytes_ > config_.memory_budget_bytes && !seal_order_.empty()) {
+    Series &s = series_[seal_order_.front()];
+    seal_order_.pop_front();
+    bytes_ -= s.sealed.front().bytes() + kSealedBytes;
+    points_ -= s.sealed.front().count;
+    s.sealed.pop_front();
+    ++evicted_chunks_;
+  }
+  // Nothing sealed is left, so every other series is an open chunk only.
+  while (bytes_ > config_.memory_budget_bytes && lru_.front() != keep) {
+    auto it = series_.find(lru_.front());
+    lru_.pop_front();
+    bytes_ -= it->second.open.bytes() + kSeriesBytes;
+    points_ -= it->second.open.count;
+    evicted_chunks_ += it->second.open.count > 0;
+    series_.erase(it);
+  }
+}
+
+std::vector<TickPoint> TickStore::last(long long conf_id,
+                                       std::size_t n) const {
+  std::vector<TickPoint> out;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = series_.find(conf_id);
+  if (it == series_.end() || n == 0) {
+    return out;
+  }
+  // Newest chunk first, until they hold n points; then decode oldest first.
+  std::vector<const Chunk *> chunks;
+  std::size_t have = 0;
+  if (it->second.open.count > 0) {
+    chunks.push_back(&it->second.open);
+    have += it->second.open.count;
+  }
+  for (auto c = it->second.sealed.rbegin();
+       c != it->second.sealed.rend() && have < n; ++c) {
+    chunks.push_back(&*c);
+    have += c->count;
+  }
+  out.reserve(have);
+  for (std::size_t i = chunks.size(); i-- > 0;) {
+    chunks[i]->decode(out);
+  }
+  if (out.size() > n) {
+    out.erase(out.begin(), out.end() - static_cast<std::ptrdiff_t>(n));
+  }
+  return out;
+}
+
+std::vector<TickPoint> TickStore::range(long long conf_id, std::int64_t from,
+                                        std::int64_t to) const {
+  std::vector<TickPoint> out;
+  std::vector<TickPoint> points;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = series_.find(conf_id);
+  if (it == series_.end()) {
+    return out;
+  }
+  auto scan = [&](const Chunk &c) {
+    if (c.count == 0 || c.max_ts < from || c.min_ts > to) {
+      return;
+    }
+    points.clear();
+    c.decode(points);
+    for (const TickPoint &p : points) {
+      if (p.timestamp >= from && p.timestamp <= to) {
+        out.push_back(p);
+      }
+    }
+  };
+  for (const Chunk &c : it->second.sealed) {
+    scan(c);
+  }
+  scan(it->second.open);
+  return out;
+}
+
+TickStoreStats TickStore::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  TickStoreStats st;
+  st.contracts = series_.size();
+  st.points = points_;
+  st.chunks = seal_order_.size();
+  for (const auto &entry : series_) {
+    st.chunks += entry.second.open.count > 0;
+  }
+  st.evicted_chunks = evicted_chunks_;
+  st.bytes = bytes_;
+  st.raw_bytes = points_ * sizeof(TickPoint);
+  return st;
+}
+
+std::string tick_query_reply(const TickStore &store,
+                             const std::string &request) {
+  std::istringstream in(request);
+  std::string cmd;
+  in >> cmd;
+  if (cmd == "stats") {
+    const TickStoreStats st = store.stats();
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"contracts\":%zu,\"points\":%llu,\"chunks\":%llu,"
+                  "\"evicted_chunks\":%llu,\"bytes\":%zu,\"raw_bytes\":%zu,"
+                  "\"ratio\":%.4g}",
+                  st.contracts, static_cast<unsigned long long>(st.points),
+                  static_cast<unsigned long long>(st.chunks),
+                  static_cast<unsigned long long>(st.evicted_chunks), st.bytes,
+                  st.raw_bytes,
+                  st.bytes ? static_cast<double>(st.raw_bytes) / st.bytes : 0.0);
+    return buf;
+  }
+
+  long long conf_id = 0;
+  std::vector<TickPoint> points;
+  if (cmd == "last") {
+    long long n = 0;
+    if (!(in >> conf_id >> n) || n < 0) {
+      return "{\"error\":\"usage: last CONF_ID N\"}";
+    }
+    points = store.last(
+        conf_id, std::min(static_cast<std::size_t>(n), kMaxReplyPoints));
+  } else if (cmd == "range") {
+    long long from = 0, to = 0;
+    if (!(in >> conf_id >> from >> to)) {
+      return "{\"error\":\"usage: range CONF_ID FROM TO\"}";
+    }
+    points = store.range(conf_id, from, to);
+  } else {
+    return "{\"error\":\"unknown request\"}";
+  }
+
+  const bool truncated = points.size() > kMaxReplyPoints;
+  if (truncated) {
+    points.resize(kMaxReplyPoints);
+  }
+  std::string out = "{\"conf_id\":" + std::to_string(conf_id) + ",";
+  if (truncated) {
+    out += "\"truncated\":true,";
+  }
+  out += "\"points\":[";
+  append_points(out, points);
+  return out + "]}";
+}
+
+TickQueryServer::TickQueryServer(const TickStore &store, std::string path)
+    : LineQueryServer("TickQueryServer", std::move(path),
+                      [&store](const std::string &request) {
+                        return tick_query_reply(store, request);
+                      }) {}
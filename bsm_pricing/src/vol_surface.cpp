@@ -0,0 +1,200 @@
+#include "vol_surface.hpp"
+
+#include "async_logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+bool usable(const VolPoint &p) {
+  return std::isfinite(p.K) && std::isfinite(p.T) && std::isfinite(p.sigma) &&
+         p.K > 0.0 && p.T > 0.0 && p.sigma > 0.0;
+}
+
+bool by_maturity_then_strike(const VolPoint &l, const VolPoint &r) {
+  return l.T != r.T ? l.T < r.T : l.K < r.K;
+}
+
+std::uint64_t bits(double v) {
+  std::uint64_t out;
+  std::memcpy(&out, &v, sizeof(out));
+  return out;
+}
+
+// FNV-1a over the sorted points.
+std::uint64_t fingerprint(const std::vector<VolPoint> &points) {
+  std::uint64_t h = 0xcbf29ce484222325ULL;
+  for (const VolPoint &p : points) {
+    for (std::uint64_t word : {bits(p.K), bits(p.T), bits(p.sigma)}) {
+      for (int i = 0; i < 8; ++i) {
+        h ^= (word >> (8 * i)) & 0xff;
+        h *= 0x100000001b3ULL;
+      }
+    }
+  }
+  return h;
+}
+
+} // namespace
+
+VolSurface::VolSurface(std::vector<VolPoint> points) {
+  if (points.empty()) {
+    throw std::invalid_argument("VolSurface: no points");
+  }
+  for (const VolPoint &p : points) {
+    if (!usable(p)) {
+      throw std::invalid_argument("VolSurface: invalid point");
+    }
+  }
+  std::stable_sort(points.begin(), points.end(), by_maturity_then_strike);
+
+  for (std::size_t begin = 0; begin < points.size();) {
+    std::size_t end = begin;
+    Slice s;
+    s.T = points[begin].T;
+    for (; end < points.size() && points[end].T == s.T; ++end) {
+      if (s.x.empty() || points[end].K != s.x.back()) {
+        s.x.push_back(points[end].K);
+        s.a.push_back(points[end].sigma);
+      }
+    }
+    begin = end;
+
+    // Natural spline: solve the tridiagonal system for the second
+    // derivatives m (m[0] = m[n-1] = 0) with the Thomas algorithm.
+    const std::size_t n = s.x.size();
+    std::vector<double> m(n, 0.0);
+    if (n > 2) {
+      std::vector<double> diag(n, 0.0);
+      std::vector<double> rhs(n, 0.0);
+      for (std::size_t i = 1; i + 1 < n; ++i) {
+        const double h0 = s.x[i] - s.x[i - 1];
+        const double h1 = s.x[i + 1] - s.x[i];
+        diag[i] = 2.0 * (h0 + h1);
+        rhs[i] = 6.0 * ((s.a[i + 1] - s.a[i]) / h1 - (s.a[i] - s.a[i - 1]) / h0);
+        if (i > 1) {
+          const double w = h0 / diag[i - 1];
+          diag[i] -= w * h0;
+          rhs[i] -= w * rhs[i - 1];
+        }
+      }
+      for (std::size_t i = n - 1; i-- > 1;) {
+        const double h1 = s.x[i + 1] - s.x[i];
+        m[i] = (rhs[i] - h1 * m[i + 1]) / diag[i];
+      }
+    }
+    for (std::size_t i = 0; i + 1 < n; ++i) {
+      const double h = s.x[i + 1] - s.x[i];
+      s.b.push_back((s.a[i + 1] - s.a[i]) / h - h * (2.0 * m[i] + m[i + 1]) / 6.0);
+      s.c.push_back(0.5 * m[i]);
+      s.d.push_back((m[i + 1] - m[i]) / (6.0 * h));
+    }
+    slices_.push_back(std::move(s));
+  }
+}
+
+double VolSurface::eval(const Slice &s, double K) {
+  if (K <= s.x.front()) {
+    return s.a.front();
+  }
+  if (K >= s.x.back()) {
+    return s.a.back();
+  }
+  const std::size_t i =
+      static_cast<std::size_t>(std::upper_bound(s.x.begin(), s.x.end(), K) -
+                               s.x.begin()) -
+      1;
+  const double h = K - s.x[i];
+  return s.a[i] + h * (s.b[i] + h * (s.c[i] + h * s.d[i]));
+}
+
+double VolSurface::sigma(double K, double T) const {
+  double v;
+  if (T <= slices_.front().T) {
+    v = eval(slices_.front(), K);
+  } else if (T >= slices_.back().T) {
+    v = eval(slices_.back(), K);
+  } else {
+    auto it = std::upper_bound(
+        slices_.begin(), slices_.end(), T,
+        [](double t, const Slice &s) { return t < s.T; });
+    const Slice &hi = *it;
+    const Slice &lo = *(it - 1);
+    const double s0 = eval(lo, K);
+    const double s1 = eval(hi, K);
+    const double w0 = s0 * s0 * lo.T;
+    const double w1 = s1 * s1 * hi.T;
+    const double w = w0 + (w1 - w0) * (T - lo.T) / (hi.T - lo.T);
+    v = std::sqrt(std::max(w, 0.0) / T);
+  }
+  return std::max(v, kMinSurfaceVol);
+}
+
+std::size_t VolSurfaceSet::update(const std::vector<VolPoint> &points) {
+  std::unordered_map<long long, std::vector<VolPoint>> by_ticker;
+  std::size_t dropped = 0;
+  for (const VolPoint &p : points) {
+    if (!usable(p)) {
+      ++dropped;
+      continue;
+    }
+    by_ticker[p.ticker_id].push_back(p);
+  }
+  if (dropped > 0) {
+    log_warn("VolSurfaceSet", "dropped invalid surface points",
+             {{"count", dropped}});
+  }
+
+  std::unordered_map<long long, Entry> next;
+  next.reserve(by_ticker.size());
+  std::size_t rebuilt = 0;
+  for (auto &group : by_ticker) {
+    std::vector<VolPoint> &ps = group.second;
+    std::stable_sort(ps.begin(), ps.end(), by_maturity_then_strike);
+    const std::uint64_t fp = fingerprint(ps);
+    auto old = surfaces_.find(group.first);
+    if (old != surfaces_.end() && old->second.fingerprint == fp) {
+      next.emplace(group.first, std::move(old->second));
+      continue;
+    }
+    next.emplace(group.first, Entry{fp, VolSurface(std::move(ps)), {}});
+    ++rebuilt;
+  }
+  surfaces_ = std::move(next);
+  return rebuilt;
+}
+
+bool VolSurfaceSet::sigma(long long ticker_id, double K, double T,
+                          double &out) {
+  auto it = surfaces_.find(ticker_id);
+  if (it == surfaces_.end()) {
+    return false;
+  }
+  Entry &e = it->second;
+  const ContractKey key{bits(K), bits(T)};
+  auto hit = e.sigmas.find(key);
+  if (hit != e.sigmas.end()) {
+    out = hit->second;
+    return true;
+  }
+  out = e.surface.sigma(K, T);
+  e.sigmas.emplace(key, out);
+  return true;
+}
+
+std::size_t VolSurfaceSet::apply(
+    std::unordered_map<long long, BsmParams> &params) {
+  std::size_t changed = 0;
+  for (auto &entry : params) {
+    BsmParams &p = entry.second;
+    double s;
+    if (sigma(p.ticker_id, p.K, p.T, s)) {
+      p.sigma = s;
+      ++changed;
+    }
+  }
+  return changed;
+}
@@ -1,10 +1,45 @@
 #include "bsm_service.hpp"
+#include "heston.hpp"
+#include "lattice.hpp"
+#include "line_query_server.hpp"
+#include "params_snapshot.hpp"
 #include "price_pipe.hpp"
 
 #include <gtest/gtest.h>
 
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
 #include <thread>
+#include <vector>
+
+namespace {
+
+// A bsm_params row; the fields not given keep their defaults.
+BsmParams params_row(double K, double r, double q, double sigma, double T,
+                     long long ticker_id, long long conf_id,
+                     PricingModel model = PricingModel::Bsm) {
+  BsmParams p;
+  p.K = K;
+  p.r = r;
+  p.q = q;
+  p.sigma = sigma;
+  p.T = T;
+  p.ticker_id = ticker_id;
+  p.conf_id = conf_id;
+  p.model = model;
+  return p;
+}
+
+} // namespace
 
 TEST(BsmServiceFunctionalTest, ProcessesJsonAndPrintsOptionQuoteToStdout) {
   PricePipe<std::string> pipe;
@@ -42,3 +77,662 @@ TEST(BsmServiceFunctionalTest, ProcessesJsonAndPrintsOptionQuoteToStdout) {
   auto pos = output.find("\"option_price\":");
   ASSERT_NE(pos, std::string::npos);
 }
+
+TEST(BsmServiceFunctionalTest, PricesTypedUpdatesWithoutJson) {
+  BsmService service(/*num_threads=*/2, /*conninfo=*/"");
+  service.set_params_for_testing("SBER", 100.0, 0.05, 0.0, 0.2, 1.0, 7, 9);
+
+  std::mutex mutex;
+  std::vector<OptionQuote> quotes;
+  service.set_quote_sink([&](const OptionQuote &q) {
+    std::lock_guard<std::mutex> lock(mutex);
+    quotes.push_back(q);
+  });
+  service.start();
+
+  std::vector<PriceUpdateIn> batch(3);
+  for (int i = 0; i < 3; ++i) {
+    batch[i].timestamp = 1700000000 + i;
+    batch[i].ticker = "SBER";
+    batch[i].price = 100.0;
+    batch[i].status = "OK";
+  }
+  batch[2].ticker = "UNKNOWN";
+  service.submit(batch);
+  EXPECT_TRUE(batch.empty());
+
+  PriceUpdateIn failed;
+  failed.ticker = "SBER";
+  failed.status = "ERROR";
+  failed.error = "upstream timeout";
+  service.submit(failed);
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < deadline) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (quotes.size() >= 3) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  service.stop();
+
+  ASSERT_EQ(quotes.size(), 3u);
+  int ok = 0;
+  for (const auto &q : quotes) {
+    if (q.status == "OK") {
+      ++ok;
+      EXPECT_EQ(q.ticker_id, 7);
+      EXPECT_NEAR(q.option_price,
+                  OptionPricer::black_scholes_call(100.0, 100.0, 0.05, 0.0,
+                                                   0.2, 1.0),
+                  1e-12);
+    } else {
+      EXPECT_EQ(q.error, "upstream timeout");
+    }
+  }
+  EXPECT_EQ(ok, 2);
+}
+
+TEST(BsmServiceFunctionalTest, KeepsEachTickersTicksInOrderAcrossWorkers) {
+  BsmService service(/*num_threads=*/4, /*conninfo=*/"");
+  service.set_params_for_testing("SBER", 100.0, 0.05, 0.0, 0.2, 1.0, 1, 1);
+  service.set_params_for_testing("GAZP", 100.0, 0.05, 0.0, 0.2, 1.0, 2, 2);
+
+  std::mutex mutex;
+  std::vector<OptionQuote> quotes;
+  service.set_quote_sink([&](const OptionQuote &q) {
+    std::lock_guard<std::mutex> lock(mutex);
+    quotes.push_back(q);
+  });
+  service.start();
+
+  constexpr int kTicks = 2000;
+  std::vector<PriceUpdateIn> batch(2 * kTicks);
+  for (int i = 0; i < kTicks; ++i) {
+    for (int t = 0; t < 2; ++t) {
+      PriceUpdateIn &u = batch[2 * i + t];
+      u.timestamp = 1700000000 + i;
+      u.ticker = t == 0 ? "SBER" : "GAZP";
+      u.price = 100.0 + (i % 7); // changing spot, so nothing is cached
+      u.status = "OK";
+    }
+  }
+  service.submit(batch);
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (std::chrono::steady_clock::now() < deadline) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (quotes.size() >= 2u * kTicks) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  service.stop();
+
+  ASSERT_EQ(quotes.size(), 2u * kTicks);
+  std::int64_t last[2] = {0, 0};
+  for (const auto &q : quotes) {
+    std::int64_t &prev = last[q.ticker == "SBER" ? 0 : 1];
+    EXPECT_GT(q.timestamp, prev) << q.ticker;
+    prev = q.timestamp;
+  }
+}
+
+TEST(BsmServiceFunctionalTest, SubmitPastQueueBoundWaitsForWorkers) {
+  BsmService service(/*num_threads=*/2, /*conninfo=*/"");
+  service.set_quote_sink([](const OptionQuote &) {});
+  service.start();
+
+  // Several times the queue bound, in batches and singly; every update
+  // still reaches a worker (and is dropped there for lack of params).
+  constexpr std::size_t kBatches = 50;
+  constexpr std::size_t kBatch = 4096;
+  std::vector<PriceUpdateIn> batch;
+  for (std::size_t b = 0; b < kBatches; ++b) {
+    batch.resize(kBatch);
+    for (auto &u : batch) {
+      u.ticker = "UNKNOWN";
+      u.price = 1.0;
+      u.status = "OK";
+    }
+    service.submit(batch);
+    PriceUpdateIn single;
+    single.ticker = "UNKNOWN";
+    single.status = "OK";
+    service.submit(single);
+  }
+  const std::uint64_t total = kBatches * (kBatch + 1);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (std::chrono::steady_clock::now() < deadline &&
+         service.dropped_no_params() < total) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  service.stop();
+  EXPECT_EQ(service.dropped_no_params(), total);
+}
+
+TEST(BsmServiceFunctionalTest, WarmStartsFromSnapshotAndCountsDrops) {
+  const std::string path = ::testing::TempDir() + "bsm_params_warm.bin";
+  std::unordered_map<long long, BsmParams> params;
+  params[9] = params_row(100.0, 0.05, 0.0, 0.2, 1.0, 7, 9);
+  params[9].ticker = "SBER";
+  ASSERT_TRUE(write_params_snapshot(path, params));
+
+  BsmService service(/*num_threads=*/2, /*conninfo=*/"");
+  service.set_params_snapshot(path);
+
+  std::mutex mutex;
+  std::vector<OptionQuote> quotes;
+  service.set_quote_sink([&](const OptionQuote &q) {
+    std::lock_guard<std::mutex> lock(mutex);
+    quotes.push_back(q);
+  });
+  service.start();
+
+  std::vector<PriceUpdateIn> batch(2);
+  batch[0].ticker = "SBER";
+  batch[0].price = 100.0;
+  batch[0].status = "OK";
+  batch[1].ticker = "UNKNOWN";
+  batch[1].price = 50.0;
+  batch[1].status = "OK";
+  service.submit(batch);
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < deadline &&
+         service.dropped_no_params() < 1) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  while (std::chrono::steady_clock::now() < deadline) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!quotes.empty()) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  service.stop();
+  std::remove(path.c_str());
+
+  ASSERT_EQ(quotes.size(), 1u);
+  EXPECT_EQ(quotes[0].ticker, "SBER");
+  EXPECT_EQ(quotes[0].ticker_id, 7);
+  EXPECT_EQ(quotes[0].status, "OK");
+  EXPECT_EQ(service.dropped_no_params(), 1u);
+}
+
+TEST(BsmServiceFunctionalTest, ReusesCachedPriceForRepeatedSpot) {
+  BsmService service(/*num_threads=*/1, /*conninfo=*/"");
+  service.set_params_for_testing("SBER", 100.0, 0.05, 0.0, 0.2, 1.0, 7, 9);
+  service.set_skip_unchanged_writes(true);
+
+  std::mutex mutex;
+  std::vector<OptionQuote> quotes;
+  service.set_quote_sink([&](const OptionQuote &q) {
+    std::lock_guard<std::mutex> lock(mutex);
+    quotes.push_back(q);
+  });
+  service.start();
+
+  const double spots[] = {100.0, 100.0, 100.0, 101.0, 101.0, 100.0};
+  for (double spot : spots) {
+    PriceUpdateIn in;
+    in.ticker = "SBER";
+    in.price = spot;
+    in.status = "OK";
+    service.submit(in);
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < deadline &&
+         service.cache_hits() + service.cache_misses() < 6) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  // A reload drops the cache even when the spot has not moved.
+  service.set_params_for_testing("SBER", 110.0, 0.05, 0.0, 0.2, 1.0, 7, 9);
+  PriceUpdateIn again;
+  again.ticker = "SBER";
+  again.price = 100.0;
+  again.status = "OK";
+  service.submit(again);
+  while (std::chrono::steady_clock::now() < deadline &&
+         service.cache_hits() + service.cache_misses() < 7) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  service.stop();
+
+  EXPECT_EQ(service.cache_hits(), 3u);
+  EXPECT_EQ(service.cache_misses(), 4u);
+  EXPECT_EQ(service.skipped_writes(), 3u);
+  ASSERT_EQ(quotes.size(), 4u);
+  EXPECT_EQ(quotes[3].conf_id, 9);
+  EXPECT_NEAR(quotes[3].option_price,
+              OptionPricer::black_scholes_call(100.0, 110.0, 0.05, 0.0, 0.2,
+                                               1.0),
+              1e-12);
+  EXPECT_GT(quotes[0].delta, 0.5);
+  EXPECT_GT(quotes[0].vega, 0.0);
+}
+
+TEST(BsmServiceFunctionalTest, PricesAmericanModelOnLattice) {
+  BsmService service(/*num_threads=*/2, /*conninfo=*/"");
+  BsmParams american = params_row(100.0, 0.05, 0.08, 0.3, 1.0, 7, 9,
+                                  PricingModel::AmericanBinomial);
+  american.lattice_steps = 400;
+  service.set_params_for_testing("SBER", american);
+  service.set_params_for_testing("GAZP", 100.0, 0.05, 0.08, 0.3, 1.0, 8, 10);
+
+  std::mutex mutex;
+  std::vector<OptionQuote> quotes;
+  service.set_quote_sink([&](const OptionQuote &q) {
+    std::lock_guard<std::mutex> lock(mutex);
+    quotes.push_back(q);
+  });
+  service.start();
+  for (const char *ticker : {"SBER", "GAZP"}) {
+    PriceUpdateIn in;
+    in.ticker = ticker;
+    in.price = 130.0;
+    in.status = "OK";
+    service.submit(in);
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < deadline &&
+         service.cache_misses() < 2) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  service.stop();
+
+  ASSERT_EQ(quotes.size(), 2u);
+  const double european =
+      OptionPricer::black_scholes_call(130.0, 100.0, 0.05, 0.08, 0.3, 1.0);
+  LatticeContract lattice{130.0, 100.0, 0.05, 0.08, 0.3, 1.0, 400};
+  for (const OptionQuote &q : quotes) {
+    EXPECT_EQ(q.status, "OK");
+    if (q.ticker == "SBER") {
+      EXPECT_NEAR(q.option_price, american_call(lattice), 1e-12);
+      EXPECT_GT(q.option_price, european + 0.5);
+      EXPECT_GT(q.delta, 0.0);
+      EXPECT_LE(q.delta, 1.0);
+    } else {
+      EXPECT_NEAR(q.option_price, european, 1e-9);
+    }
+  }
+}
+
+TEST(BsmServiceFunctionalTest, PricesHestonModelByFourierQuadrature) {
+  BsmService service(/*num_threads=*/2, /*conninfo=*/"");
+  const HestonParams heston{1.5, 0.04, 0.6, -0.7, 0.05};
+  BsmParams p =
+      params_row(100.0, 0.05, 0.01, 0.2, 0.5, 7, 9, PricingModel::Heston);
+  p.heston = heston;
+  service.set_params_for_testing("SBER", p);
+  // Another strike of the same maturity shares the slice and the batch call;
+  // another maturity gets its own.
+  p.K = 110.0;
+  p.conf_id = 10;
+  service.set_params_for_testing("SBER", p);
+  p.T = 1.0;
+  p.conf_id = 11;
+  service.set_params_for_testing("SBER", p);
+
+  std::mutex mutex;
+  std::vector<OptionQuote> quotes;
+  service.set_quote_sink([&](const OptionQuote &q) {
+    std::lock_guard<std::mutex> lock(mutex);
+    quotes.push_back(q);
+  });
+  service.start();
+  PriceUpdateIn in;
+  in.ticker = "SBER";
+  in.price = 104.0;
+  in.status = "OK";
+  service.submit(in);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < deadline &&
+         service.cache_misses() < 3) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  service.stop();
+
+  ASSERT_EQ(quotes.size(), 3u);
+  const struct {
+    long long conf_id;
+    double K;
+    double T;
+  } expected[] = {{9, 100.0, 0.5}, {10, 110.0, 0.5}, {11, 110.0, 1.0}};
+  for (std::size_t i = 0; i < 3; ++i) {
+    const CallGreeks g = heston_call_greeks(
+        compile_heston(heston, 0.05, 0.01, expected[i].T), 104.0,
+        expected[i].K);
+    EXPECT_EQ(quotes[i].conf_id, expected[i].conf_id);
+    EXPECT_EQ(quotes[i].status, "OK");
+    EXPECT_NEAR(quotes[i].option_price, g.price, 1e-12);
+    EXPECT_NEAR(quotes[i].delta, g.delta, 1e-12);
+    EXPECT_NEAR(quotes[i].vega, g.vega, 1e-12);
+  }
+}
+
+TEST(BsmServiceFunctionalTest, WritesScenarioReportFromLastSpots) {
+  const std::string path = ::testing::TempDir() + "bsm_scenarios.json";
+  std::remove(path.c_str());
+
+  BsmService service(/*num_threads=*/1, /*conninfo=*/"");
+  service.set_params_for_testing("SBER", 100.0, 0.05, 0.0, 0.2, 1.0, 7, 9);
+  service.set_params_for_testing("GAZP", 150.0, 0.05, 0.0, 0.2, 1.0, 8, 10);
+  service.set_quote_sink([](const OptionQuote &) {});
+  service.set_scenario_report(path, make_scenario_grid(3, 0.1, 3, 0.05),
+                              /*interval_sec=*/1, /*threads=*/2);
+  service.start();
+
+  PriceUpdateIn in;
+  in.ticker = "SBER";
+  in.price = 101.0;
+  in.status = "OK";
+  service.submit(in);
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (std::chrono::steady_clock::now() < deadline &&
+         service.scenario_runs() == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  service.stop();
+  ASSERT_GE(service.scenario_runs(), 1u);
+
+  std::ifstream file(path);
+  std::string json((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+  // GAZP never ticked, so it has no spot to shock from.
+  EXPECT_NE(json.find("\"ticker\":\"SBER\""), std::string::npos);
+  EXPECT_EQ(json.find("GAZP"), std::string::npos);
+  EXPECT_NE(json.find("\"spot_shocks\":[-0.1,0,0.1]"), std::string::npos);
+  std::remove(path.c_str());
+}
+
+TEST(BsmServiceFunctionalTest, AggregatesPositionsAndServesThemOnSocket) {
+  const std::string path = ::testing::TempDir() + "bsm_positions.sock";
+  BsmService service(/*num_threads=*/2, /*conninfo=*/"");
+  service.set_params_for_testing("SBER", 100.0, 0.05, 0.0, 0.2, 1.0, 1, 11);
+  service.set_params_for_testing("GAZP", 150.0, 0.04, 0.0, 0.3, 0.5, 2, 12);
+  service.set_params_for_testing("SBER", 130.0, 0.05, 0.0, 0.25, 0.5, 1, 13);
+  service.set_positions_for_testing({Position{11, 1, "SBER", 10.0},
+                                     Position{12, 2, "GAZP", -4.0},
+                                     Position{13, 1, "SBER", 3.0}});
+  service.set_position_socket(path);
+  service.set_quote_sink([](const OptionQuote &) {});
+  service.start();
+  for (const char *ticker : {"SBER", "GAZP"}) {
+    PriceUpdateIn in;
+    in.ticker = ticker;
+    in.price = 120.0;
+    in.status = "OK";
+    service.submit(in);
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < deadline &&
+         service.position_book().updates() < 3) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  // One SBER tick prices both of its contracts.
+  const CallGreeks sber =
+      OptionPricer::black_scholes_call_greeks(120.0, 100.0, 0.05, 0.0, 0.2, 1.0);
+  const CallGreeks sber2 = OptionPricer::black_scholes_call_greeks(
+      120.0, 130.0, 0.05, 0.0, 0.25, 0.5);
+  const CallGreeks gazp =
+      OptionPricer::black_scholes_call_greeks(120.0, 150.0, 0.04, 0.0, 0.3, 0.5);
+  const Exposure total = service.position_book().portfolio();
+  EXPECT_EQ(total.priced, 3u);
+  EXPECT_NEAR(total.delta,
+              10.0 * sber.delta + 3.0 * sber2.delta - 4.0 * gazp.delta, 1e-9);
+  EXPECT_NEAR(total.value,
+              10.0 * sber.price + 3.0 * sber2.price - 4.0 * gazp.price, 1e-9);
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_GE(fd, 0);
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)),
+            0);
+  const std::string request = "ticker GAZP\n";
+  ASSERT_EQ(::send(fd, request.data(), request.size(), 0),
+            static_cast<ssize_t>(request.size()));
+  std::string reply;
+  char buf[512];
+  ssize_t n;
+  while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) {
+    reply.append(buf, static_cast<std::size_t>(n));
+  }
+  ::close(fd);
+  service.stop();
+
+  EXPECT_EQ(reply.rfind("{\"ticker\":\"GAZP\",\"exposure\":", 0), 0u);
+  EXPECT_NE(reply.find("\"positions\":1,\"priced\":1}"), std::string::npos);
+  EXPECT_EQ(reply.back(), '\n');
+  EXPECT_NE(::access(path.c_str(), F_OK), 0);
+}
+
+TEST(BsmServiceFunctionalTest, PricesWithRealizedVolOnceReady) {
+  BsmService service(/*num_threads=*/1, /*conninfo=*/"");
+  RealizedVolConfig config;
+  config.min_returns = 10;
+  service.set_realized_vol(config, /*persist_sec=*/0);
+  BsmParams p = params_row(100.0, 0.05, 0.0, 0.2, 1.0, 1, 11);
+  p.vol_source = VolSource::RealizedWindow;
+  service.set_params_for_testing("SBER", p);
+
+  std::mutex mutex;
+  std::vector<OptionQuote> quotes;
+  service.set_quote_sink([&](const OptionQuote &q) {
+    std::lock_guard<std::mutex> lock(mutex);
+    quotes.push_back(q);
+  });
+  service.start();
+  // Alternating returns of 0.45 / sqrt(year) each second.
+  const double step = 0.45 / std::sqrt(config.seconds_per_year);
+  for (int i = 0; i <= 20; ++i) {
+    PriceUpdateIn in;
+    in.timestamp = 1000 + i;
+    in.ticker = "SBER";
+    in.price = 100.0 * std::exp(i % 2 ? step : 0.0);
+    in.status = "OK";
+    service.submit(in);
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < deadline &&
+         service.cache_misses() + service.cache_hits() < 21) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  service.stop();
+
+  ASSERT_EQ(quotes.size(), 21u);
+  // Spots repeat every other tick, but the vol moves until it is ready.
+  EXPECT_NEAR(quotes[2].option_price,
+              OptionPricer::black_scholes_call(100.0, 100.0, 0.05, 0.0, 0.2,
+                                               1.0),
+              1e-9);
+  EXPECT_NEAR(quotes[20].option_price,
+              OptionPricer::black_scholes_call(100.0, 100.0, 0.05, 0.0, 0.45,
+                                               1.0),
+              1e-9);
+  RealizedVol rv;
+  ASSERT_TRUE(service.realized_vol().get("SBER", rv));
+  EXPECT_EQ(rv.returns, 20u);
+}
+
+TEST(BsmServiceFunctionalTest, SpoolsQuotesWhileDatabaseIsDown) {
+  const std::string dir = ::testing::TempDir() + "bsm_service_spool";
+  std::filesystem::remove_all(dir);
+  // No server listens on this socket directory, so every write fails.
+  BsmService service(/*num_threads=*/2,
+                     "host=/nonexistent_bsm_socket_dir dbname=bsm");
+  service.set_quote_spool(dir);
+  service.set_params_for_testing("SBER", 100.0, 0.05, 0.0, 0.2, 1.0, 1, 11);
+  service.start();
+  for (int i = 0; i < 5; ++i) {
+    PriceUpdateIn in;
+    in.timestamp = 1000 + i;
+    in.ticker = "SBER";
+    in.price = 100.0 + i;
+    in.status = "OK";
+    service.submit(in);
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < deadline &&
+         service.spooled_quotes() < 5) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  service.stop();
+  EXPECT_EQ(service.failed_writes(), 5u);
+
+  QuoteSpool spool(dir);
+  ASSERT_EQ(spool.pending(), 5u);
+  std::vector<SpoolRecord> records;
+  for (const std::string &path : spool.seal_and_list()) {
+    ASSERT_TRUE(QuoteSpool::read_segment(path, records));
+  }
+  ASSERT_EQ(records.size(), 5u);
+  EXPECT_EQ(records[0].ticker_id, 1);
+  EXPECT_EQ(records[0].conf_id, 11);
+  std::filesystem::remove_all(dir);
+}
+
+TEST(BsmServiceFunctionalTest, WritesQuotesToColumnarFilesOnly) {
+  const std::string dir = ::testing::TempDir() + "bsm_service_columnar";
+  std::filesystem::remove_all(dir);
+  BsmService service(/*num_threads=*/2, /*conninfo=*/"");
+  ColumnarSinkConfig config;
+  config.dir = dir;
+  service.set_columnar_sink(config, /*exclusive=*/true);
+  service.set_params_for_testing("SBER", 100.0, 0.05, 0.0, 0.2, 1.0, 1, 11);
+  service.start();
+  for (int i = 0; i < 8; ++i) {
+    PriceUpdateIn in;
+    in.timestamp = 1000 + i;
+    in.ticker = "SBER";
+    in.price = 100.0 + i;
+    in.status = "OK";
+    service.submit(in);
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < deadline &&
+         service.cache_misses() + service.cache_hits() < 8) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  service.stop();
+
+  std::vector<OptionQuote> quotes;
+  ASSERT_TRUE(read_columnar_file(
+      dir + "/quotes_s0_00000000000000000000.bsmcol", quotes));
+  ASSERT_EQ(quotes.size(), 8u);
+  for (const OptionQuote &q : quotes) {
+    EXPECT_EQ(q.conf_id, 11);
+    EXPECT_NEAR(q.option_price,
+                OptionPricer::black_scholes_call(
+                    100.0 + (q.timestamp - 1000), 100.0, 0.05, 0.0, 0.2, 1.0),
+                1e-9);
+  }
+  std::filesystem::remove_all(dir);
+}
+
+TEST(LineQueryServerFunctionalTest, DropsClientThatNeverReadsItsReply) {
+  const std::string path = ::testing::TempDir() + "line_query_stall.sock";
+  LineQueryServer server("StallTest", path, [](const std::string &request) {
+    return request == "big" ? std::string(16 << 20, 'x') : request;
+  });
+  ASSERT_TRUE(server.start());
+  auto connect_to = [&path] {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    EXPECT_EQ(
+        ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+    return fd;
+  };
+
+  // Asks for far more than the socket buffers hold and never reads it.
+  const int stalled = connect_to();
+  ASSERT_EQ(::send(stalled, "big\n", 4, 0), 4);
+
+  const auto start = std::chrono::steady_clock::now();
+  const int fd = connect_to();
+  ASSERT_EQ(::send(fd, "ping\n", 5, 0), 5);
+  std::string reply;
+  char buf[64];
+  ssize_t n;
+  while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) {
+    reply.append(buf, static_cast<std::size_t>(n));
+  }
+  const auto waited = std::chrono::steady_clock::now() - start;
+  ::close(fd);
+  ::close(stalled);
+  server.stop();
+
+  EXPECT_EQ(reply, "ping\n");
+  EXPECT_LT(waited, std::chrono::seconds(3));
+  EXPECT_EQ(server.requests(), 2u);
+}
+
+TEST(BsmServiceFunctionalTest, KeepsTickHistoryAndServesItOnSocket) {
+  const std::string path = ::testing::TempDir() + "bsm_ticks.sock";
+  BsmService service(/*num_threads=*/1, /*conninfo=*/"");
+  service.set_params_for_testing("SBER", 100.0, 0.05, 0.0, 0.2, 1.0, 1, 11);
+  service.set_tick_store(TickStoreConfig{}, path);
+  service.set_quote_sink([](const OptionQuote &) {});
+  service.start();
+  for (int i = 0; i < 10; ++i) {
+    PriceUpdateIn in;
+    in.timestamp = 1000 + i;
+    in.ticker = "SBER";
+    in.price = 100.0 + i;
+    in.status = "OK";
+    service.submit(in);
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < deadline &&
+         service.tick_store()->stats().points < 10) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  const std::vector<TickPoint> last = service.tick_store()->last(11, 3);
+  ASSERT_EQ(last.size(), 3u);
+  EXPECT_EQ(last[0].timestamp, 1007);
+  EXPECT_EQ(last[2].spot, 109.0);
+  EXPECT_NEAR(last[2].price,
+              OptionPricer::black_scholes_call(109.0, 100.0, 0.05, 0.0, 0.2,
+                                               1.0),
+              1e-9);
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_GE(fd, 0);
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)),
+            0);
+  const std::string request = "range 11 1002 1004\n";
+  ASSERT_EQ(::send(fd, request.data(), request.size(), 0),
+            static_cast<ssize_t>(request.size()));
+  std::string reply;
+  char buf[512];
+  ssize_t n;
+  while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) {
+    reply.append(buf, static_cast<std::size_t>(n));
+  }
+  ::close(fd);
+  service.stop();
+
+  EXPECT_EQ(reply.rfind("{\"conf_id\":11,\"points\":[[1002,102,", 0), 0u);
+  EXPECT_NE(reply.find("],[1004,104,"), std::string::npos);
+  EXPECT_EQ(reply.find("1005"), std::string::npos);
+  EXPECT_EQ(reply.back(), '\n');
+}
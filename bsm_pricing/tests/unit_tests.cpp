@@ -1,9 +1,60 @@
+#include "async_logger.hpp"
+#include "columnar_sink.hpp"
+#include "compiled_contract.hpp"
+#include "heston.hpp"
+#include "lattice.hpp"
+#include "monte_carlo.hpp"
+#include "normal_cdf.hpp"
 #include "option_pricer.hpp"
+#include "params_snapshot.hpp"
+#include "philox.hpp"
+#include "position_book.hpp"
+#include "position_query_server.hpp"
+#include "postgres_writer.hpp"
 #include "price_pipe.hpp"
+#include "quote_spool.hpp"
+#include "realized_vol.hpp"
+#include "scenario_engine.hpp"
+#include "smile_calibration.hpp"
+#include "sobol.hpp"
+#include "thread_pool.hpp"
+#include "tick_store.hpp"
+#include "vol_surface.hpp"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
 #include <thread>
+#include <vector>
+
+namespace {
+
+// A bsm_params row; the fields not given keep their defaults.
+BsmParams params_row(double K, double r, double q, double sigma, double T,
+                     long long ticker_id, long long conf_id,
+                     PricingModel model = PricingModel::Bsm) {
+  BsmParams p;
+  p.K = K;
+  p.r = r;
+  p.q = q;
+  p.sigma = sigma;
+  p.T = T;
+  p.ticker_id = ticker_id;
+  p.conf_id = conf_id;
+  p.model = model;
+  return p;
+}
+
+} // namespace
 
 TEST(OptionPricerTest, BlackScholesCallBasic) {
   double S = 100.0;
@@ -52,3 +103,1288 @@ TEST(PricePipeTest, WriteRead) {
   ASSERT_TRUE(pipe.read(v));
   EXPECT_EQ(v, 42);
 }
+
+TEST(ParamsSnapshotTest, RoundTripsParams) {
+  const std::string path = ::testing::TempDir() + "bsm_params_roundtrip.bin";
+  std::unordered_map<long long, BsmParams> params;
+  params[11] = params_row(100.0, 0.05, 0.01, 0.2, 1.0, 1, 11);
+  params[12] = params_row(150.0, 0.04, 0.0, 0.3, 0.5, 2, 12,
+                          PricingModel::AmericanTrinomial);
+  params[12].lattice_steps = 800;
+  params[13] = params_row(1.0, 0.0, 0.0, 0.1, 0.1, 3, 13);
+  params[14] = params_row(90.0, 0.03, 0.02, 0.25, 2.0, 4, 14,
+                          PricingModel::Heston);
+  params[14].heston = HestonParams{1.5, 0.04, 0.6, -0.7, 0.05};
+  params[15] = params_row(50.0, 0.03, 0.0, 0.3, 0.25, 5, 15);
+  params[15].vol_source = VolSource::RealizedWindow;
+  params[16] = params_row(120.0, 0.05, 0.01, 0.2, 1.0, 1, 16); // second SBER
+  const char *tickers[] = {"SBER", "GAZP", "", "LKOH", "ROSN", "SBER"};
+  for (long long id = 11; id <= 16; ++id) {
+    params[id].ticker = tickers[id - 11];
+  }
+
+  ASSERT_TRUE(write_params_snapshot(path, params));
+
+  std::unordered_map<long long, BsmParams> loaded;
+  ASSERT_TRUE(read_params_snapshot(path, loaded));
+  ASSERT_EQ(loaded.size(), params.size());
+  for (const auto &entry : params) {
+    auto it = loaded.find(entry.first);
+    ASSERT_NE(it, loaded.end()) << entry.first;
+    EXPECT_EQ(it->second.ticker, entry.second.ticker);
+    EXPECT_EQ(it->second.K, entry.second.K);
+    EXPECT_EQ(it->second.sigma, entry.second.sigma);
+    EXPECT_EQ(it->second.T, entry.second.T);
+    EXPECT_EQ(it->second.ticker_id, entry.second.ticker_id);
+    EXPECT_EQ(it->second.conf_id, entry.second.conf_id);
+    EXPECT_EQ(it->second.model, entry.second.model);
+    EXPECT_EQ(it->second.lattice_steps, entry.second.lattice_steps);
+    EXPECT_EQ(it->second.heston.kappa, entry.second.heston.kappa);
+    EXPECT_EQ(it->second.heston.rho, entry.second.heston.rho);
+    EXPECT_EQ(it->second.heston.v0, entry.second.heston.v0);
+    EXPECT_EQ(it->second.vol_source, entry.second.vol_source);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(ParamsSnapshotTest, RejectsTruncatedOrMissingFile) {
+  const std::string path = ::testing::TempDir() + "bsm_params_truncated.bin";
+  std::unordered_map<long long, BsmParams> params;
+  params[1] = params_row(100.0, 0.05, 0.0, 0.2, 1.0, 1, 1);
+  params[1].ticker = "SBER";
+  ASSERT_TRUE(write_params_snapshot(path, params));
+
+  std::string bytes;
+  {
+    std::ifstream in(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 3));
+  }
+
+  std::unordered_map<long long, BsmParams> loaded;
+  loaded[42] = BsmParams{};
+  EXPECT_FALSE(read_params_snapshot(path, loaded));
+  EXPECT_EQ(loaded.count(42), 1u);
+
+  std::remove(path.c_str());
+  EXPECT_FALSE(read_params_snapshot(path, loaded));
+}
+
+TEST(AsyncLoggerTest, StdoutLinesAreNeverTruncatedOrDropped) {
+  auto &logger = AsyncLogger::instance();
+  const std::string longest(4 * AsyncLogger::kLineBytes, 'q');
+  const std::size_t count = 2 * AsyncLogger::kRingSlots;
+
+  ::testing::internal::CaptureStdout();
+  for (std::size_t i = 0; i < count; ++i) {
+    logger.write_stdout(i == 7 ? longest : "{\"n\":" + std::to_string(i) + "}");
+  }
+  logger.flush();
+  const std::string output = ::testing::internal::GetCapturedStdout();
+
+  EXPECT_EQ(std::count(output.begin(), output.end(), '\n'),
+            static_cast<std::ptrdiff_t>(count));
+  EXPECT_NE(output.find("\n" + longest + "\n"), std::string::npos);
+  EXPECT_NE(output.find("{\"n\":" + std::to_string(count - 1) + "}\n"),
+            std::string::npos);
+}
+
+TEST(AsyncLoggerTest, WritesFieldsAndRateLimitsRepeats) {
+  auto &logger = AsyncLogger::instance();
+  const auto suppressed_before = logger.suppressed();
+
+  ::testing::internal::CaptureStderr();
+  for (int i = 0; i < 20; ++i) {
+    log_error("UnitTest", "repeated failure",
+              {{"attempt", i}, {"error", "connection refused\n"}});
+  }
+  logger.flush();
+  std::string output = ::testing::internal::GetCapturedStderr();
+
+  std::size_t lines = 0;
+  for (std::size_t pos = 0;
+       (pos = output.find("msg=\"repeated failure\"", pos)) !=
+       std::string::npos;
+       ++pos) {
+    ++lines;
+  }
+  EXPECT_EQ(lines, AsyncLogger::kBurst);
+  EXPECT_EQ(logger.suppressed() - suppressed_before, 20 - AsyncLogger::kBurst);
+  EXPECT_NE(output.find("level=error component=UnitTest"), std::string::npos);
+  EXPECT_NE(output.find("attempt=0 error=\"connection refused\"\n"),
+            std::string::npos);
+}
+
+TEST(OptionPricerTest, GreeksMatchFiniteDifferences) {
+  // Second differences need a C2 CDF; the fast one is only C1.
+  const CdfMode mode = OptionPricer::cdf_mode();
+  OptionPricer::set_cdf_mode(CdfMode::Exact);
+  const double S = 105.0, K = 100.0, r = 0.05, q = 0.02, sigma = 0.25,
+               T = 0.75;
+  CallGreeks g =
+      OptionPricer::black_scholes_call_greeks(S, K, r, q, sigma, T);
+  auto price = [&](double s, double rr, double v, double t) {
+    return OptionPricer::black_scholes_call(s, K, rr, q, v, t);
+  };
+
+  EXPECT_EQ(g.price, price(S, r, sigma, T));
+  const double h = 1e-4;
+  EXPECT_NEAR(g.delta, (price(S + h, r, sigma, T) - price(S - h, r, sigma, T)) /
+                           (2 * h),
+              1e-6);
+  EXPECT_NEAR(g.gamma,
+              (price(S + h, r, sigma, T) - 2 * price(S, r, sigma, T) +
+               price(S - h, r, sigma, T)) /
+                  (h * h),
+              1e-4);
+  EXPECT_NEAR(g.vega, (price(S, r, sigma + h, T) - price(S, r, sigma - h, T)) /
+                          (2 * h),
+              1e-5);
+  EXPECT_NEAR(g.rho, (price(S, r + h, sigma, T) - price(S, r - h, sigma, T)) /
+                         (2 * h),
+              1e-5);
+  EXPECT_NEAR(g.theta, -(price(S, r, sigma, T + h) - price(S, r, sigma, T - h)) /
+                           (2 * h),
+              1e-5);
+  OptionPricer::set_cdf_mode(mode);
+}
+
+TEST(CompiledContractTest, MatchesDirectPricingAcrossGrid) {
+  ContractCompiler compiler;
+  for (double K : {50.0, 100.0, 175.0}) {
+    for (double sigma : {0.05, 0.3, 1.2}) {
+      for (double T : {0.01, 0.5, 3.0}) {
+        const BsmParams p = params_row(K, 0.07, 0.02, sigma, T, 1, 1);
+        CompiledContract c = compiler.compile(p);
+        for (double S : {1.0, 60.0, 100.0, 140.0, 400.0}) {
+          double direct =
+              OptionPricer::black_scholes_call(S, K, 0.07, 0.02, sigma, T);
+          EXPECT_NEAR(price_call(c, S), direct, 1e-10 * (1.0 + direct))
+              << "S=" << S << " K=" << K << " sigma=" << sigma << " T=" << T;
+
+          CallGreeks a =
+              OptionPricer::black_scholes_call_greeks(S, K, 0.07, 0.02, sigma,
+                                                      T);
+          CallGreeks b = call_greeks(c, S);
+          EXPECT_NEAR(b.delta, a.delta, 1e-12);
+          EXPECT_NEAR(b.gamma, a.gamma, 1e-10 * (1.0 + a.gamma));
+          EXPECT_NEAR(b.vega, a.vega, 1e-10 * (1.0 + a.vega));
+          EXPECT_NEAR(b.theta, a.theta, 1e-10 * (1.0 + std::fabs(a.theta)));
+          EXPECT_NEAR(b.rho, a.rho, 1e-10 * (1.0 + a.rho));
+        }
+      }
+    }
+  }
+  // Three maturities at the same rates: strikes and vols share factors.
+  EXPECT_EQ(compiler.distinct_factors(), 3u);
+
+  CompiledContract bad =
+      compiler.compile(params_row(100.0, 0.05, 0.0, 0.0, 1.0, 1, 1));
+  EXPECT_EQ(price_call(bad, 100.0), 0.0);
+}
+
+TEST(NormalCdfTest, FastPathStaysWithinErrorBound) {
+  double max_err = 0.0;
+  double worst_x = 0.0;
+  for (double x = -12.0; x <= 12.0; x += 1e-5) {
+    double err = std::fabs(fast_normal_cdf(x) - exact_normal_cdf(x));
+    if (err > max_err) {
+      max_err = err;
+      worst_x = x;
+    }
+  }
+  EXPECT_LT(max_err, kFastNormalCdfMaxError) << "at x=" << worst_x;
+
+  EXPECT_EQ(fast_normal_cdf(0.0), 0.5);
+  EXPECT_NEAR(fast_normal_cdf(-1e300), 0.0, 1e-15);
+  EXPECT_NEAR(fast_normal_cdf(1e300), 1.0, 1e-15);
+  EXPECT_NEAR(fast_normal_cdf(-INFINITY), 0.0, 1e-15);
+  EXPECT_NEAR(fast_normal_cdf(INFINITY), 1.0, 1e-15);
+  EXPECT_TRUE(std::isnan(fast_normal_cdf(NAN)));
+}
+
+TEST(NormalCdfTest, BatchMatchesScalar) {
+  std::vector<double> x;
+  for (double v = -10.0; v <= 10.0; v += 3.3e-4) {
+    x.push_back(v);
+  }
+  x.push_back(NAN);
+  x.push_back(INFINITY);
+  x.push_back(-INFINITY);
+  x.push_back(0.123); // odd length exercises the scalar tail
+
+  std::vector<double> out(x.size());
+  fast_normal_cdf_batch(x.data(), out.data(), x.size());
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    if (std::isnan(x[i])) {
+      EXPECT_TRUE(std::isnan(out[i]));
+      continue;
+    }
+    EXPECT_NEAR(out[i], fast_normal_cdf(x[i]), 1e-15) << "x=" << x[i];
+    EXPECT_NEAR(out[i], exact_normal_cdf(x[i]), kFastNormalCdfMaxError)
+        << "x=" << x[i];
+  }
+
+  // In place.
+  std::vector<double> inplace(x.begin(), x.begin() + 9);
+  fast_normal_cdf_batch(inplace.data(), inplace.data(), inplace.size());
+  for (std::size_t i = 0; i < inplace.size(); ++i) {
+    EXPECT_EQ(inplace[i], out[i]);
+  }
+}
+
+TEST(NormalCdfTest, ModeSwitchesPricerPath) {
+  const CdfMode mode = OptionPricer::cdf_mode();
+  OptionPricer::set_cdf_mode(CdfMode::Exact);
+  EXPECT_EQ(OptionPricer::normal_cdf(0.3), exact_normal_cdf(0.3));
+  OptionPricer::set_cdf_mode(CdfMode::Fast);
+  EXPECT_EQ(OptionPricer::normal_cdf(0.3), fast_normal_cdf(0.3));
+  OptionPricer::set_cdf_mode(mode);
+}
+
+TEST(PhiloxTest, MatchesRandom123KnownAnswers) {
+  auto zero = Philox4x32::generate({0, 0, 0, 0}, {0, 0});
+  EXPECT_EQ(zero, (Philox4x32::Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c,
+                                       0x9b00dbd8}));
+  auto ones = Philox4x32::generate(
+      {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+      {0xffffffff, 0xffffffff});
+  EXPECT_EQ(ones, (Philox4x32::Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6,
+                                       0x6d5451fd}));
+
+  const double u = Philox4x32::to_unit(0, 0);
+  EXPECT_GT(u, 0.0);
+  EXPECT_LT(Philox4x32::to_unit(0xffffffff, 0xffffffff), 1.0);
+  EXPECT_NEAR(exact_normal_cdf(inverse_normal_cdf(0.975)), 0.975, 1e-9);
+  EXPECT_NEAR(exact_normal_cdf(inverse_normal_cdf(1e-8)), 1e-8, 1e-15);
+}
+
+TEST(SobolTest, FirstPowerOfTwoPointsStratifyEachDimension) {
+  SobolSequence sobol(SobolSequence::kMaxDims);
+  constexpr std::size_t kPoints = 64;
+  std::vector<std::vector<int>> hits(SobolSequence::kMaxDims,
+                                     std::vector<int>(kPoints, 0));
+  double u[SobolSequence::kMaxDims];
+  for (std::size_t i = 0; i < kPoints; ++i) {
+    sobol.point(i, u);
+    for (std::size_t d = 0; d < SobolSequence::kMaxDims; ++d) {
+      ASSERT_GE(u[d], 0.0);
+      ASSERT_LT(u[d], 1.0);
+      ++hits[d][static_cast<std::size_t>(u[d] * kPoints)];
+    }
+  }
+  for (std::size_t d = 0; d < SobolSequence::kMaxDims; ++d) {
+    for (std::size_t b = 0; b < kPoints; ++b) {
+      EXPECT_EQ(hits[d][b], 1) << "dim " << d << " bin " << b;
+    }
+  }
+  EXPECT_THROW(SobolSequence(0), std::invalid_argument);
+  EXPECT_THROW(SobolSequence(SobolSequence::kMaxDims + 1),
+               std::invalid_argument);
+}
+
+TEST(ThreadPoolTest, RunsEveryIndexAndRethrows) {
+  ThreadPool pool(3);
+  std::vector<int> seen(1000, 0);
+  pool.parallel_for(seen.size(), [&](std::size_t i) { seen[i] += 1; });
+  for (int v : seen) {
+    EXPECT_EQ(v, 1);
+  }
+  EXPECT_THROW(pool.parallel_for(10,
+                                 [](std::size_t i) {
+                                   if (i == 7) {
+                                     throw std::runtime_error("boom");
+                                   }
+                                 }),
+               std::runtime_error);
+  pool.parallel_for(0, [](std::size_t) { FAIL(); });
+}
+
+TEST(MonteCarloTest, EuropeanMatchesBlackScholesOnAnyThreadCount) {
+  McContract c{100.0, 105.0, 0.05, 0.01, 0.25, 1.0};
+  McConfig cfg;
+  cfg.paths = 200000;
+  ThreadPool one(1);
+  ThreadPool three(3);
+  const McResult a = MonteCarloEngine(one).price(c, cfg);
+  const McResult b = MonteCarloEngine(three).price(c, cfg);
+  EXPECT_EQ(a.price, b.price);
+  EXPECT_EQ(a.std_error, b.std_error);
+  EXPECT_EQ(a.paths, 200000u);
+
+  const double bs = OptionPricer::black_scholes_call(100.0, 105.0, 0.05, 0.01,
+                                                     0.25, 1.0);
+  EXPECT_NEAR(a.price, bs, 4.0 * a.std_error);
+
+  cfg.antithetic = false;
+  cfg.control_variate = false;
+  const McResult plain = MonteCarloEngine(one).price(c, cfg);
+  EXPECT_NEAR(plain.price, bs, 4.0 * plain.std_error);
+  EXPECT_LT(a.std_error, 0.5 * plain.std_error);
+
+  cfg.seed = 2;
+  EXPECT_NE(MonteCarloEngine(one).price(c, cfg).price, plain.price);
+  c.sigma = 0.0;
+  EXPECT_THROW(MonteCarloEngine(one).price(c, cfg), std::invalid_argument);
+}
+
+TEST(MonteCarloTest, PathDependentPayoffsAndSobol) {
+  ThreadPool pool(2);
+  MonteCarloEngine engine(pool);
+  McConfig cfg;
+  cfg.paths = 50000;
+
+  McContract asian{100.0, 100.0, 0.05, 0.0, 0.3, 1.0, 12,
+                   McPayoff::AsianArithmeticCall};
+  const double geometric =
+      geometric_asian_call(100.0, 100.0, 0.05, 0.0, 0.3, 1.0, 12);
+  const McResult a = engine.price(asian, cfg);
+  // The arithmetic average dominates the geometric one, by little.
+  EXPECT_GT(a.price, geometric);
+  EXPECT_LT(a.price, geometric + 0.6);
+  EXPECT_LT(a.std_error, 0.01);
+
+  // One fixing: the geometric Asian is the European call.
+  EXPECT_NEAR(geometric_asian_call(100.0, 100.0, 0.05, 0.0, 0.3, 1.0, 1),
+              OptionPricer::black_scholes_call(100.0, 100.0, 0.05, 0.0, 0.3,
+                                               1.0),
+              1e-6);
+
+  McContract up{100.0, 100.0, 0.05, 0.0, 0.3, 1.0, 50, McPayoff::UpAndOutCall,
+                130.0};
+  const double vanilla =
+      OptionPricer::black_scholes_call(100.0, 100.0, 0.05, 0.0, 0.3, 1.0);
+  const McResult knocked = engine.price(up, cfg);
+  EXPECT_GT(knocked.price, 0.0);
+  EXPECT_LT(knocked.price, 0.5 * vanilla);
+  up.barrier = 1e9;
+  EXPECT_NEAR(engine.price(up, cfg).price, vanilla, 0.05);
+
+  McContract european{100.0, 105.0, 0.05, 0.01, 0.25, 1.0, 32};
+  cfg.sobol = true;
+  cfg.control_variate = false;
+  cfg.antithetic = false;
+  cfg.paths = 1 << 14;
+  const McResult qmc = engine.price(european, cfg);
+  EXPECT_NEAR(qmc.price,
+              OptionPricer::black_scholes_call(100.0, 105.0, 0.05, 0.01, 0.25,
+                                               1.0),
+              0.02);
+}
+
+TEST(LatticeTest, ConvergesAndDominatesEuropean) {
+  LatticeContract c{100.0, 100.0, 0.05, 0.04, 0.3, 1.0, 8000};
+  const double reference = american_call(c);
+  const double european =
+      OptionPricer::black_scholes_call(100.0, 100.0, 0.05, 0.04, 0.3, 1.0);
+  EXPECT_GT(reference, european + 0.03);
+
+  for (LatticeKind kind : {LatticeKind::Binomial, LatticeKind::Trinomial}) {
+    c.kind = kind;
+    c.steps = 256;
+    EXPECT_NEAR(american_call(c), reference, 5e-4);
+    c.steps = 2000;
+    EXPECT_NEAR(american_call(c), reference, 2e-5);
+  }
+
+  // Without dividends early exercise never pays.
+  LatticeContract no_dividend{100.0, 90.0, 0.05, 0.0, 0.25, 0.5};
+  EXPECT_EQ(american_call(no_dividend),
+            OptionPricer::black_scholes_call(100.0, 90.0, 0.05, 0.0, 0.25,
+                                             0.5));
+
+  // Deep in the money on a heavy dividend: exercise now.
+  LatticeContract deep{200.0, 100.0, 0.05, 0.5, 0.2, 1.0, 100};
+  EXPECT_NEAR(american_call(deep), 100.0, 1e-9);
+  deep.kind = LatticeKind::Trinomial;
+  EXPECT_NEAR(american_call(deep), 100.0, 1e-9);
+
+  deep.sigma = 0.0;
+  EXPECT_EQ(american_call(deep), 0.0);
+}
+
+TEST(LatticeTest, GreeksMatchBumpsAndBatchMatchesScalar) {
+  for (LatticeKind kind : {LatticeKind::Binomial, LatticeKind::Trinomial}) {
+    LatticeContract c{95.0, 100.0, 0.05, 0.06, 0.25, 0.75, 1000, kind};
+    const CallGreeks g = american_call_greeks(c);
+    EXPECT_EQ(g.price, american_call(c));
+
+    auto bumped = [&](double LatticeContract::*field, double h) {
+      LatticeContract up = c;
+      LatticeContract down = c;
+      up.*field += h;
+      down.*field -= h;
+      return (american_call(up) - american_call(down)) / (2.0 * h);
+    };
+    EXPECT_NEAR(g.delta, bumped(&LatticeContract::S, 0.5), 2e-3);
+    EXPECT_NEAR(g.vega, bumped(&LatticeContract::sigma, 1e-3), 5e-2);
+    EXPECT_NEAR(g.rho, bumped(&LatticeContract::r, 1e-3), 5e-2);
+    EXPECT_NEAR(g.theta, -bumped(&LatticeContract::T, 1e-3), 5e-2);
+
+    LatticeContract up = c;
+    LatticeContract down = c;
+    up.S += 0.5;
+    down.S -= 0.5;
+    EXPECT_NEAR(g.gamma,
+                (american_call(up) - 2.0 * g.price + american_call(down)) /
+                    0.25,
+                2e-3);
+  }
+
+  std::vector<LatticeContract> contracts;
+  for (int i = 0; i < 20; ++i) {
+    contracts.push_back(LatticeContract{80.0 + 2.0 * i, 100.0, 0.05, 0.03,
+                                        0.3, 0.5, 200,
+                                        i % 2 ? LatticeKind::Trinomial
+                                              : LatticeKind::Binomial});
+  }
+  ThreadPool pool(3);
+  std::vector<double> out(contracts.size());
+  american_call_batch(pool, contracts.data(), contracts.size(), out.data());
+  for (std::size_t i = 0; i < contracts.size(); ++i) {
+    EXPECT_EQ(out[i], american_call(contracts[i]));
+  }
+}
+
+TEST(HestonTest, MatchesReferenceAndBlackScholesLimit) {
+  const CdfMode mode = OptionPricer::cdf_mode();
+  OptionPricer::set_cdf_mode(CdfMode::Exact);
+  // Fang & Oosterlee's COS reference, 5.785155450 at 1e-9.
+  const HestonParams p{1.5768, 0.0398, 0.5751, -0.5711, 0.0175};
+  const HestonSlice s = compile_heston(p, 0.0, 0.0, 1.0);
+  ASSERT_TRUE(s.valid);
+  EXPECT_NEAR(heston_call(s, 100.0, 100.0), 5.785155450, 1e-6);
+
+  // Vanishing vol of vol with v0 = theta is Black-Scholes at sqrt(v0).
+  const HestonSlice flat =
+      compile_heston(HestonParams{2.0, 0.04, 1e-4, 0.0, 0.04}, 0.05, 0.02, 0.5);
+  for (double K : {70.0, 90.0, 100.0, 110.0, 140.0}) {
+    EXPECT_NEAR(heston_call(flat, 100.0, K),
+                OptionPricer::black_scholes_call(100.0, K, 0.05, 0.02, 0.2,
+                                                 0.5),
+                1e-6)
+        << K;
+  }
+
+  EXPECT_FALSE(compile_heston(HestonParams{1.0, 0.04, 0.5, 1.0, 0.04}, 0.0,
+                              0.0, 1.0)
+                   .valid);
+  EXPECT_EQ(heston_call(compile_heston(p, 0.0, 0.0, 0.0), 100.0, 90.0), 0.0);
+  OptionPricer::set_cdf_mode(mode);
+}
+
+TEST(HestonTest, GreeksMatchBumpsAndBatchMatchesScalar) {
+  const CdfMode mode = OptionPricer::cdf_mode();
+  OptionPricer::set_cdf_mode(CdfMode::Exact);
+  const HestonParams p{1.2, 0.05, 0.7, -0.6, 0.06};
+  const double r = 0.04, q = 0.01, T = 0.75, S = 95.0, K = 100.0;
+  const HestonSlice s = compile_heston(p, r, q, T);
+  const CallGreeks g = heston_call_greeks(s, S, K);
+  EXPECT_NEAR(g.price, heston_call(s, S, K), 1e-12);
+
+  const double hS = 1e-2;
+  const double up = heston_call(s, S + hS, K);
+  const double down = heston_call(s, S - hS, K);
+  EXPECT_NEAR(g.delta, (up - down) / (2 * hS), 1e-6);
+  EXPECT_NEAR(g.gamma, (up - 2 * g.price + down) / (hS * hS), 1e-4);
+
+  const double hv = 1e-4;
+  const double sqrt_v0 = std::sqrt(p.v0);
+  HestonParams v_up = p, v_down = p;
+  v_up.v0 = (sqrt_v0 + hv) * (sqrt_v0 + hv);
+  v_down.v0 = (sqrt_v0 - hv) * (sqrt_v0 - hv);
+  EXPECT_NEAR(g.vega,
+              (heston_call(compile_heston(v_up, r, q, T), S, K) -
+               heston_call(compile_heston(v_down, r, q, T), S, K)) /
+                  (2 * hv),
+              1e-4);
+
+  const double hT = 1e-4;
+  EXPECT_NEAR(g.theta,
+              -(heston_call(compile_heston(p, r, q, T + hT), S, K) -
+                heston_call(compile_heston(p, r, q, T - hT), S, K)) /
+                  (2 * hT),
+              5e-2);
+
+  std::vector<double> strikes;
+  for (int i = 0; i <= 20; ++i) {
+    strikes.push_back(70.0 + 3.0 * i);
+  }
+  std::vector<double> out(strikes.size());
+  heston_call_batch(s, S, strikes.data(), out.data(), strikes.size());
+  for (std::size_t i = 0; i < strikes.size(); ++i) {
+    EXPECT_EQ(out[i], heston_call(s, S, strikes[i])) << strikes[i];
+  }
+  OptionPricer::set_cdf_mode(mode);
+}
+
+TEST(VolSurfaceTest, InterpolatesSmileAndTotalVariance) {
+  std::vector<VolPoint> points;
+  const double strikes[] = {80.0, 90.0, 100.0, 110.0, 120.0};
+  const double short_smile[] = {0.32, 0.27, 0.24, 0.25, 0.28};
+  const double long_smile[] = {0.28, 0.25, 0.23, 0.23, 0.24};
+  for (int i = 4; i >= 0; --i) {
+    points.push_back(VolPoint{1, strikes[i], 0.25, short_smile[i]});
+    points.push_back(VolPoint{1, strikes[i], 1.0, long_smile[i]});
+  }
+  const VolSurface surface(points);
+  EXPECT_EQ(surface.maturities(), 2u);
+
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_NEAR(surface.sigma(strikes[i], 0.25), short_smile[i], 1e-15);
+    EXPECT_NEAR(surface.sigma(strikes[i], 1.0), long_smile[i], 1e-15);
+  }
+  // Flat beyond the strikes and the maturities.
+  EXPECT_EQ(surface.sigma(50.0, 0.25), 0.32);
+  EXPECT_EQ(surface.sigma(500.0, 0.1), 0.28);
+  EXPECT_EQ(surface.sigma(100.0, 5.0), 0.23);
+
+  // Linear in total variance between slices.
+  const double w = 0.5 * (0.24 * 0.24 * 0.25 + 0.23 * 0.23 * 1.0);
+  EXPECT_NEAR(surface.sigma(100.0, 0.625), std::sqrt(w / 0.625), 1e-15);
+
+  // Smooth across a knot: the one-sided slopes agree.
+  const double h = 1e-6;
+  const double left = (surface.sigma(100.0, 0.25) -
+                       surface.sigma(100.0 - h, 0.25)) / h;
+  const double right = (surface.sigma(100.0 + h, 0.25) -
+                        surface.sigma(100.0, 0.25)) / h;
+  EXPECT_NEAR(left, right, 1e-6);
+
+  EXPECT_THROW(VolSurface(std::vector<VolPoint>{}), std::invalid_argument);
+  EXPECT_THROW(VolSurface({VolPoint{1, 100.0, 0.0, 0.2}}),
+               std::invalid_argument);
+}
+
+TEST(VolSurfaceTest, SetRebuildsOnlyChangedSurfacesAndOverridesRows) {
+  std::vector<VolPoint> points = {
+      {1, 90.0, 0.5, 0.3}, {1, 110.0, 0.5, 0.2}, {2, 100.0, 1.0, 0.4},
+      {3, 100.0, 1.0, -0.1}};
+  VolSurfaceSet set;
+  EXPECT_EQ(set.update(points), 2u);
+  EXPECT_EQ(set.size(), 2u);
+  EXPECT_EQ(set.update(points), 0u);
+
+  points[2].sigma = 0.45;
+  EXPECT_EQ(set.update(points), 1u);
+
+  std::unordered_map<long long, BsmParams> params;
+  params[11] = params_row(100.0, 0.05, 0.0, 0.99, 0.5, 1, 11);
+  params[12] = params_row(100.0, 0.05, 0.0, 0.99, 1.0, 2, 12);
+  params[13] = params_row(100.0, 0.05, 0.0, 0.99, 1.0, 4, 13);
+  EXPECT_EQ(set.apply(params), 2u);
+  EXPECT_NEAR(params[11].sigma, 0.25, 1e-15);
+  EXPECT_EQ(params[12].sigma, 0.45);
+  EXPECT_EQ(params[13].sigma, 0.99);
+
+  double sigma = 0.0;
+  EXPECT_TRUE(set.sigma(1, 100.0, 0.5, sigma));
+  EXPECT_NEAR(sigma, 0.25, 1e-15);
+  EXPECT_FALSE(set.sigma(4, 100.0, 0.5, sigma));
+
+  EXPECT_EQ(set.update({}), 0u);
+  EXPECT_EQ(set.size(), 0u);
+}
+
+namespace {
+
+// Call quotes priced off a known SVI smile.
+std::vector<OptionQuotePoint> svi_quotes(long long ticker_id, double T,
+                                         const SviParams &svi) {
+  const double S = 100.0, r = 0.03, q = 0.01;
+  const double F = S * std::exp((r - q) * T);
+  std::vector<OptionQuotePoint> out;
+  for (double K = 70.0; K <= 140.0; K += 5.0) {
+    const double vol =
+        std::sqrt(svi_total_variance(svi, std::log(K / F)) / T);
+    out.push_back(OptionQuotePoint{
+        ticker_id, K, T,
+        OptionPricer::black_scholes_call(S, K, r, q, vol, T), S, r, q});
+  }
+  return out;
+}
+
+} // namespace
+
+TEST(SmileCalibrationTest, RecoversSviFromPricesAndWarmStarts) {
+  const CdfMode mode = OptionPricer::cdf_mode();
+  OptionPricer::set_cdf_mode(CdfMode::Exact);
+
+  double vol = 0.0;
+  const double price =
+      OptionPricer::black_scholes_call(100.0, 120.0, 0.03, 0.01, 0.37, 0.5);
+  ASSERT_TRUE(implied_call_vol(price, 100.0, 120.0, 0.03, 0.01, 0.5, vol));
+  EXPECT_NEAR(vol, 0.37, 1e-12);
+  EXPECT_FALSE(implied_call_vol(101.0, 100.0, 120.0, 0.03, 0.01, 0.5, vol));
+  EXPECT_FALSE(implied_call_vol(0.0, 100.0, 120.0, 0.03, 0.01, 0.5, vol));
+
+  const SviParams truth{0.02, 0.1, -0.4, 0.05, 0.15};
+  const SmileSlice slice{1, 0.5, svi_quotes(1, 0.5, truth)};
+  const SmileFit cold = calibrate_svi(slice, nullptr);
+  ASSERT_TRUE(cold.valid);
+  EXPECT_TRUE(cold.converged);
+  EXPECT_EQ(cold.quotes, slice.quotes.size());
+  EXPECT_LT(cold.rms_vol_error, 1e-8);
+  EXPECT_NEAR(cold.svi.a, truth.a, 1e-5);
+  EXPECT_NEAR(cold.svi.b, truth.b, 1e-5);
+  EXPECT_NEAR(cold.svi.rho, truth.rho, 1e-4);
+  EXPECT_NEAR(cold.svi.m, truth.m, 1e-4);
+  EXPECT_NEAR(cold.svi.s, truth.s, 1e-4);
+
+  // A small move in the market from the previous fit.
+  SviParams moved = truth;
+  moved.a += 0.002;
+  moved.rho -= 0.05;
+  const SmileSlice next{1, 0.5, svi_quotes(1, 0.5, moved)};
+  const SmileFit warm = calibrate_svi(next, &cold.svi);
+  ASSERT_TRUE(warm.valid);
+  EXPECT_LT(warm.rms_vol_error, 1e-8);
+  EXPECT_TRUE(warm.converged);
+  EXPECT_NEAR(warm.svi.rho, moved.rho, 1e-4);
+
+  SmileSlice thin = slice;
+  thin.quotes.resize(kMinSmileQuotes - 1);
+  EXPECT_FALSE(calibrate_svi(thin, nullptr).valid);
+  OptionPricer::set_cdf_mode(mode);
+}
+
+TEST(SmileCalibrationTest, RefitsOnlyChangedSlicesAndOverridesRows) {
+  const CdfMode mode = OptionPricer::cdf_mode();
+  OptionPricer::set_cdf_mode(CdfMode::Exact);
+  const SviParams near{0.01, 0.08, -0.5, 0.0, 0.1};
+  const SviParams far{0.04, 0.12, -0.3, 0.02, 0.2};
+  std::vector<OptionQuotePoint> quotes;
+  for (long long ticker : {1, 2}) {
+    for (const auto &q : svi_quotes(ticker, 0.25, near)) {
+      quotes.push_back(q);
+    }
+    for (const auto &q : svi_quotes(ticker, 1.0, far)) {
+      quotes.push_back(q);
+    }
+  }
+  // Too few strikes to fit, and an unusable quote.
+  for (int i = 0; i < 3; ++i) {
+    quotes.push_back(
+        OptionQuotePoint{2, 100.0 + i, 2.0, 10.0, 100.0, 0.03, 0.01});
+  }
+  quotes.push_back(OptionQuotePoint{2, -1.0, 1.0, 10.0, 100.0, 0.03, 0.01});
+
+  ThreadPool one(1);
+  ThreadPool three(3);
+  SmileCalibrator serial(one);
+  SmileCalibrator calibrator(three);
+  serial.update(quotes);
+  CalibrationStats stats = calibrator.update(quotes);
+  EXPECT_EQ(stats.slices, 4u);
+  EXPECT_EQ(stats.fitted, 4u);
+  EXPECT_EQ(stats.reused, 0u);
+  EXPECT_EQ(stats.failed, 0u);
+  EXPECT_GE(stats.wall_ms, 0.0);
+  const std::vector<SmileFit> fits = calibrator.fits();
+  ASSERT_EQ(fits.size(), 4u);
+  EXPECT_EQ(fits[1].ticker_id, 1);
+  EXPECT_EQ(fits[1].T, 1.0);
+  const std::vector<SmileFit> serial_fits = serial.fits();
+  for (std::size_t i = 0; i < fits.size(); ++i) {
+    EXPECT_EQ(fits[i].svi.a, serial_fits[i].svi.a);
+    EXPECT_EQ(fits[i].svi.rho, serial_fits[i].svi.rho);
+  }
+
+  stats = calibrator.update(quotes);
+  EXPECT_EQ(stats.fitted, 0u);
+  EXPECT_EQ(stats.reused, 4u);
+
+  quotes[3].price *= 1.01;
+  stats = calibrator.update(quotes);
+  EXPECT_EQ(stats.fitted, 1u);
+  EXPECT_EQ(stats.reused, 3u);
+
+  // On a calibrated maturity the smile itself; between two, total variance
+  // interpolated at each slice's forward moneyness.
+  const double F_near = 100.0 * std::exp(0.02 * 0.25);
+  const double F_far = 100.0 * std::exp(0.02 * 1.0);
+  double sigma = 0.0;
+  ASSERT_TRUE(calibrator.sigma(2, 110.0, 0.25, sigma));
+  EXPECT_NEAR(sigma,
+              std::sqrt(svi_total_variance(near, std::log(110.0 / F_near)) /
+                        0.25),
+              1e-6);
+  ASSERT_TRUE(calibrator.sigma(2, 110.0, 0.625, sigma));
+  const double w =
+      0.5 * svi_total_variance(near, std::log(110.0 / F_near)) +
+      0.5 * svi_total_variance(far, std::log(110.0 / F_far));
+  EXPECT_NEAR(sigma, std::sqrt(w / 0.625), 1e-6);
+  EXPECT_FALSE(calibrator.sigma(3, 110.0, 0.5, sigma));
+
+  std::unordered_map<long long, BsmParams> params;
+  params[11] = params_row(110.0, 0.03, 0.01, 0.9, 0.25, 2, 11);
+  params[12] = params_row(110.0, 0.03, 0.01, 0.9, 0.25, 3, 12);
+  EXPECT_EQ(calibrator.apply(params), 1u);
+  EXPECT_NEAR(params[11].sigma,
+              std::sqrt(svi_total_variance(near, std::log(110.0 / F_near)) /
+                        0.25),
+              1e-6);
+  EXPECT_EQ(params[12].sigma, 0.9);
+  OptionPricer::set_cdf_mode(mode);
+}
+
+TEST(ScenarioEngineTest, PnlMatchesDirectRevaluationOnAnyPoolSize) {
+  const ScenarioGrid grid = make_scenario_grid(21, 0.2, 5, 0.1);
+  ASSERT_EQ(grid.spot_shocks.size(), 21u);
+  ASSERT_EQ(grid.vol_shocks.size(), 5u);
+  EXPECT_EQ(grid.spot_shocks[10], 0.0);
+  EXPECT_EQ(grid.vol_shocks[2], 0.0);
+  EXPECT_NEAR(grid.spot_shocks.front(), -0.2, 1e-15);
+  EXPECT_NEAR(grid.vol_shocks.back(), 0.1, 1e-15);
+
+  std::vector<ScenarioContract> contracts = {
+      {"SBER", params_row(100.0, 0.05, 0.0, 0.2, 1.0, 1, 11), 102.0},
+      {"GAZP", params_row(150.0, 0.04, 0.02, 0.3, 0.5, 2, 12), 140.0},
+      {"SBER", params_row(110.0, 0.05, 0.0, 0.25, 0.5, 1, 13), 102.0},
+      {"LKOH",
+       params_row(100.0, 0.05, 0.06, 0.05, 1.0, 3, 14,
+                  PricingModel::AmericanBinomial),
+       100.0},
+      {"TATN",
+       params_row(95.0, 0.03, 0.01, 0.2, 0.75, 4, 15, PricingModel::Heston),
+       100.0}};
+  contracts[3].params.lattice_steps = 100;
+  contracts[4].params.heston = HestonParams{1.5, 0.04, 0.5, -0.7, 0.09};
+
+  ThreadPool one(1);
+  ThreadPool three(3);
+  const ScenarioReport a = ScenarioEngine(one).run(contracts, grid);
+  const ScenarioReport b = ScenarioEngine(three).run(contracts, grid);
+  ASSERT_EQ(a.tickers.size(), 4u);
+  EXPECT_EQ(a.tickers[0].ticker, "GAZP");
+  EXPECT_EQ(a.tickers[2].ticker, "SBER");
+  EXPECT_EQ(a.tickers[2].contracts, 2u);
+  for (std::size_t t = 0; t < a.tickers.size(); ++t) {
+    EXPECT_EQ(a.tickers[t].pnl, b.tickers[t].pnl);
+  }
+
+  const TickerPnl &sber = a.tickers[2];
+  ASSERT_EQ(sber.pnl.size(), 21u * 5u);
+  for (std::size_t i = 0; i < 21; ++i) {
+    for (std::size_t j = 0; j < 5; ++j) {
+      const double S = 102.0 * (1.0 + grid.spot_shocks[i]);
+      double expected = 0.0;
+      for (const auto &c : {contracts[0], contracts[2]}) {
+        const BsmParams &p = c.params;
+        expected += OptionPricer::black_scholes_call(
+                        S, p.K, p.r, p.q, p.sigma + grid.vol_shocks[j], p.T) -
+                    OptionPricer::black_scholes_call(102.0, p.K, p.r, p.q,
+                                                     p.sigma, p.T);
+      }
+      EXPECT_NEAR(sber.pnl[i * 5 + j], expected, 1e-9);
+    }
+  }
+  EXPECT_NEAR(sber.pnl[10 * 5 + 2], 0.0, 1e-12);
+
+  // American: the floored vol shock (0.05 - 0.1) and the lattice path.
+  const TickerPnl &lkoh = a.tickers[1];
+  LatticeContract base{100.0, 100.0, 0.05, 0.06, 0.05, 1.0, 100};
+  LatticeContract shocked = base;
+  shocked.S = 80.0;
+  shocked.sigma = 1e-4;
+  EXPECT_NEAR(lkoh.base_value, american_call(base), 1e-12);
+  EXPECT_NEAR(lkoh.pnl[0], american_call(shocked) - american_call(base),
+              1e-12);
+
+  // Heston: a vol shock moves sqrt(v0) and sqrt(theta) together.
+  const TickerPnl &tatn = a.tickers[3];
+  const HestonParams &h = contracts[4].params.heston;
+  const double h_base =
+      heston_call(compile_heston(h, 0.03, 0.01, 0.75), 100.0, 95.0);
+  HestonParams h_up = h;
+  h_up.v0 = (0.3 + 0.1) * (0.3 + 0.1);
+  h_up.theta = (0.2 + 0.1) * (0.2 + 0.1);
+  EXPECT_NEAR(tatn.base_value, h_base, 1e-12);
+  EXPECT_NEAR(tatn.pnl[20 * 5 + 4],
+              heston_call(compile_heston(h_up, 0.03, 0.01, 0.75), 120.0, 95.0) -
+                  h_base,
+              1e-9);
+
+  const std::string path = ::testing::TempDir() + "scenario_report.json";
+  ASSERT_TRUE(write_scenario_report(path, a));
+  std::ifstream in(path);
+  std::string json((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  EXPECT_NE(json.find("\"ticker\":\"SBER\",\"contracts\":2"),
+            std::string::npos);
+  EXPECT_EQ(json.back(), '\n');
+  std::remove(path.c_str());
+}
+
+TEST(PositionBookTest, IncrementalAggregatesMatchFullResum) {
+  std::vector<Position> positions;
+  for (long long i = 0; i < 40; ++i) {
+    positions.push_back(Position{100 + i, i % 4, "T" + std::to_string(i % 4),
+                                 static_cast<double>(i % 7) - 3.0});
+  }
+  positions.push_back(Position{100, 0, "T0", 99.0}); // repeat: first kept
+  PositionBook book;
+  book.set_positions(positions);
+  positions.pop_back();
+  EXPECT_EQ(book.portfolio().positions, 40u);
+  EXPECT_EQ(book.portfolio().priced, 0u);
+
+  std::mt19937_64 rng(5);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::unordered_map<long long, OptionQuote> last;
+  for (int n = 0; n < 5000; ++n) {
+    OptionQuote q;
+    q.conf_id = 100 + static_cast<long long>(rng() % 40);
+    q.option_price = 10.0 * unit(rng);
+    q.delta = unit(rng);
+    q.gamma = 0.1 * unit(rng);
+    q.vega = 40.0 * unit(rng);
+    q.theta = -5.0 * unit(rng);
+    q.rho = 30.0 * unit(rng);
+    q.status = "OK";
+    ASSERT_TRUE(book.on_quote(q));
+    last[q.conf_id] = q;
+  }
+  OptionQuote failed;
+  failed.conf_id = 100;
+  failed.option_price = 1e6;
+  failed.status = "ERROR";
+  EXPECT_FALSE(book.on_quote(failed));
+  failed.status = "OK";
+  failed.conf_id = 7;
+  EXPECT_FALSE(book.on_quote(failed));
+  EXPECT_EQ(book.updates(), 5000u);
+
+  // A quote older than the one applied is dropped, not applied over it.
+  OptionQuote newer = last[100];
+  newer.timestamp = 1700000010;
+  ASSERT_TRUE(book.on_quote(newer));
+  OptionQuote older = newer;
+  older.timestamp = 1700000005;
+  older.option_price = 1e6;
+  EXPECT_FALSE(book.on_quote(older));
+  EXPECT_EQ(book.stale_quotes(), 1u);
+  last[100] = newer;
+
+  auto expected = [&](const std::string &ticker) {
+    Exposure e;
+    for (const Position &p : positions) {
+      if (!ticker.empty() && p.ticker != ticker) {
+        continue;
+      }
+      auto it = last.find(p.conf_id);
+      if (it != last.end()) {
+        e.value += p.quantity * it->second.option_price;
+        e.delta += p.quantity * it->second.delta;
+        e.vega += p.quantity * it->second.vega;
+        ++e.priced;
+      }
+    }
+    return e;
+  };
+  const Exposure total = book.portfolio();
+  EXPECT_NEAR(total.value, expected("").value, 1e-9);
+  EXPECT_NEAR(total.delta, expected("").delta, 1e-9);
+  EXPECT_NEAR(total.vega, expected("").vega, 1e-9);
+  EXPECT_EQ(total.priced, expected("").priced);
+  Exposure t2;
+  ASSERT_TRUE(book.underlying("T2", t2));
+  EXPECT_NEAR(t2.delta, expected("T2").delta, 1e-9);
+  EXPECT_EQ(t2.positions, 10u);
+  EXPECT_FALSE(book.underlying("T9", t2));
+  ASSERT_EQ(book.underlyings().size(), 4u);
+  EXPECT_EQ(book.underlyings()[3].first, "T3");
+
+  // A reload keeps the last quotes, rescaled to the new quantities.
+  for (Position &p : positions) {
+    p.quantity *= 2.0;
+  }
+  positions.resize(20);
+  book.set_positions(positions);
+  EXPECT_EQ(book.portfolio().positions, 20u);
+  EXPECT_NEAR(book.portfolio().delta, expected("").delta, 1e-9);
+  EXPECT_EQ(book.portfolio().priced, expected("").priced);
+
+  // Crossing kResumEvery re-sums from the contributions.
+  for (long long i = 0; book.updates() % PositionBook::kResumEvery != 0; ++i) {
+    ASSERT_TRUE(book.on_quote(last[100 + i % 20]));
+  }
+  EXPECT_NEAR(book.portfolio().value, expected("").value, 1e-9);
+  EXPECT_EQ(book.portfolio().priced, expected("").priced);
+
+  const std::string reply = position_query_reply(book, "ticker T1\n");
+  EXPECT_EQ(reply.rfind("{\"ticker\":\"T1\",\"exposure\":{\"value\":", 0), 0u);
+  EXPECT_NE(reply.find("\"positions\":5,"), std::string::npos);
+  EXPECT_EQ(position_query_reply(book, "ticker XX"),
+            "{\"error\":\"unknown ticker\"}");
+  EXPECT_EQ(position_query_reply(book, "portfolio").rfind("{\"portfolio\":", 0),
+            0u);
+  EXPECT_NE(position_query_reply(book, "all").find("\"underlyings\":[{"),
+            std::string::npos);
+  EXPECT_EQ(position_query_reply(book, "bogus"),
+            "{\"error\":\"unknown request\"}");
+}
+
+TEST(RealizedVolTest, EstimatesVarianceRateOverIrregularTicks) {
+  RealizedVolConfig config;
+  config.half_life_sec = 60.0;
+  config.max_gap_sec = 30;
+  config.min_returns = 10;
+  RealizedVolBook book(config);
+
+  // Returns of +-sigma sqrt(dt / year): every estimator of sum(r^2) /
+  // sum(dt) sees exactly sigma, whatever the spacing. Two ticks share each
+  // third timestamp; their return carries no time but no variance either.
+  const double sigma = 0.3;
+  double log_price = std::log(100.0);
+  std::int64_t ts = 1000;
+  RealizedVol rv = book.on_tick("SBER", ts, 100.0);
+  EXPECT_EQ(rv.returns, 0u);
+  for (int i = 0; i < 600; ++i) {
+    const std::int64_t dt = 1 + i % 3;
+    ts += dt;
+    log_price += (i % 2 ? -1.0 : 1.0) * sigma *
+                 std::sqrt(dt / config.seconds_per_year);
+    rv = book.on_tick("SBER", ts, std::exp(log_price));
+    if (i % 3 == 0) {
+      rv = book.on_tick("SBER", ts, std::exp(log_price));
+    }
+    if (i == 5) {
+      EXPECT_FALSE(rv.ewma_ready);
+      EXPECT_FALSE(rv.window_ready);
+    }
+  }
+  EXPECT_TRUE(rv.ewma_ready);
+  EXPECT_TRUE(rv.window_ready);
+  EXPECT_NEAR(rv.ewma, sigma, 1e-9);
+  EXPECT_NEAR(rv.window, sigma, 1e-9);
+  EXPECT_EQ(rv.returns, 800u);
+
+  // An older tick is ignored; a gap past max_gap_sec restarts the chain
+  // without a return across it.
+  EXPECT_EQ(book.on_tick("SBER", ts - 5, 1.0).returns, 800u);
+  EXPECT_EQ(book.on_tick("SBER", ts + 31, 1.0).returns, 800u);
+  rv = book.on_tick("SBER", ts + 32, 1.0);
+  EXPECT_EQ(rv.returns, 801u);
+  EXPECT_LT(rv.ewma, sigma);
+
+  // Another ticker keeps its own state; after several laps of the ring the
+  // re-summed window is still exact.
+  for (int i = 0; i < 1200; ++i) {
+    ts = 5000 + i;
+    rv = book.on_tick("GAZP", ts,
+                      100.0 * std::exp((i % 2 ? 0.0 : 1.0) * 0.6 *
+                                       std::sqrt(1.0 / config.seconds_per_year)));
+  }
+  EXPECT_NEAR(rv.ewma, 0.6, 1e-9);
+  EXPECT_NEAR(rv.window, 0.6, 1e-9);
+
+  RealizedVol got;
+  ASSERT_TRUE(book.get("GAZP", got));
+  EXPECT_EQ(got.returns, rv.returns);
+  EXPECT_FALSE(book.get("LKOH", got));
+  ASSERT_EQ(book.snapshot().size(), 2u);
+  EXPECT_EQ(book.snapshot()[0].first, "GAZP");
+}
+
+TEST(QuoteSpoolTest, SegmentsSurviveRestartAndStopAtTornRecords) {
+  const std::string dir = ::testing::TempDir() + "bsm_quote_spool";
+  std::filesystem::remove_all(dir);
+
+  auto quote = [](int i) {
+    OptionQuote q;
+    q.timestamp = 1700000000 + i;
+    q.ticker_id = 7;
+    q.conf_id = 100 + i;
+    q.underlying_price = 250.0 + i;
+    q.option_price = 0.1 * i;
+    q.status = "OK";
+    return q;
+  };
+
+  std::vector<std::string> segments;
+  {
+    QuoteSpool spool(dir, 4);
+    for (int i = 0; i < 10; ++i) {
+      ASSERT_TRUE(spool.append(quote(i)));
+    }
+    OptionQuote skipped = quote(99);
+    skipped.status = "NO_PARAMS";
+    EXPECT_TRUE(spool.append(skipped));
+    EXPECT_EQ(spool.appended(), 10u);
+    EXPECT_EQ(spool.pending(), 10u);
+
+    segments = spool.seal_and_list();
+    ASSERT_EQ(segments.size(), 3u);
+    std::vector<SpoolRecord> records;
+    for (const std::string &path : segments) {
+      ASSERT_TRUE(QuoteSpool::read_segment(path, records));
+    }
+    ASSERT_EQ(records.size(), 10u);
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_EQ(records[i].timestamp, 1700000000 + i);
+      EXPECT_EQ(records[i].conf_id, 100 + i);
+      EXPECT_EQ(records[i].base_price, 250.0 + i);
+      EXPECT_EQ(records[i].calculated_price, 0.1 * i);
+    }
+
+    // Left in the active segment when the spool goes away.
+    for (int i = 10; i < 13; ++i) {
+      ASSERT_TRUE(spool.append(quote(i)));
+    }
+  }
+
+  // A record whose commit word never landed ends its segment.
+  {
+    std::fstream f(segments[1], std::ios::in | std::ios::out | std::ios::binary);
+    const std::uint32_t zero = 0;
+    f.seekp(64 + 2 * sizeof(SpoolRecord) + offsetof(SpoolRecord, commit));
+    f.write(reinterpret_cast<const char *>(&zero), sizeof(zero));
+  }
+
+  QuoteSpool spool(dir, 4);
+  EXPECT_EQ(spool.pending(), 11u);
+  EXPECT_EQ(spool.appended(), 0u);
+  ASSERT_TRUE(spool.append(quote(13)));
+  const std::vector<std::string> pending = spool.seal_and_list();
+  ASSERT_EQ(pending.size(), 5u);
+  EXPECT_EQ(pending.front(), segments.front());
+  std::vector<SpoolRecord> records;
+  ASSERT_TRUE(QuoteSpool::read_segment(pending[1], records));
+  EXPECT_EQ(records.size(), 2u);
+  ASSERT_TRUE(QuoteSpool::read_segment(pending.back(), records));
+  EXPECT_EQ(records.back().conf_id, 113);
+
+  for (const std::string &path : pending) {
+    spool.remove_segment(path);
+  }
+  EXPECT_EQ(spool.pending(), 0u);
+  EXPECT_TRUE(std::filesystem::is_empty(dir));
+  std::filesystem::remove_all(dir);
+
+  EXPECT_THROW(QuoteSpool("/proc/no_such_dir/spool"), std::runtime_error);
+}
+
+TEST(PostgresWriterTest, NamesDailyPartitionByUtcDay) {
+  EXPECT_EQ(ticker_price_partition(0), "ticker_price_p19700101");
+  EXPECT_EQ(ticker_price_partition(-1), "ticker_price_p19691231");
+  // 2024-02-29 00:00:00 and 23:59:59 UTC, then the next day.
+  EXPECT_EQ(ticker_price_partition(1709164800), "ticker_price_p20240229");
+  EXPECT_EQ(ticker_price_partition(1709251199), "ticker_price_p20240229");
+  EXPECT_EQ(ticker_price_partition(1709251200), "ticker_price_p20240301");
+}
+
+TEST(ColumnarSinkTest, RoundTripsBatchesAcrossRotatedFiles) {
+  const std::string dir = ::testing::TempDir() + "bsm_columnar_sink";
+  std::filesystem::remove_all(dir);
+
+  ColumnarSinkConfig config;
+  config.dir = dir;
+  config.batch_rows = 300;
+  config.file_rows = 500;
+  config.flush_ms = 60000;
+
+  // Timestamps step back now and then; 300 conf ids a batch need 2-byte
+  // indices.
+  std::vector<OptionQuote> quotes;
+  std::mt19937_64 rng(3);
+  std::int64_t ts = 1700000000;
+  for (int i = 0; i < 1200; ++i) {
+    OptionQuote q;
+    ts += static_cast<std::int64_t>(rng() % 5) - 1;
+    q.timestamp = ts;
+    q.ticker_id = 1 + i % 7;
+    q.conf_id = 1000 + i % 300;
+    q.underlying_price = 100.0 + 0.01 * i;
+    q.option_price = 0.5 * i;
+    q.delta = 0.001 * i;
+    q.gamma = -0.25;
+    q.vega = 1e-300;
+    q.theta = -3.5 * i;
+    q.rho = 7.0;
+    q.status = "OK";
+    quotes.push_back(q);
+  }
+
+  {
+    ColumnarSink sink(config);
+    for (const OptionQuote &q : quotes) {
+      sink.append(q);
+    }
+    OptionQuote skipped = quotes[0];
+    skipped.status = "NO_PARAMS";
+    sink.append(skipped);
+    sink.close();
+    EXPECT_EQ(sink.rows_written(), 1200u);
+    EXPECT_EQ(sink.batches_written(), 4u);
+    // Rotated once a file reaches 500 rows, i.e. every second batch.
+    EXPECT_EQ(sink.files_closed(), 2u);
+  }
+
+  std::vector<std::string> files;
+  std::uintmax_t bytes = 0;
+  for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+    files.push_back(entry.path().string());
+    bytes += entry.file_size();
+  }
+  std::sort(files.begin(), files.end());
+  ASSERT_EQ(files.size(), 2u);
+  EXPECT_EQ(files[0], dir + "/quotes_00000000000000000000.bsmcol");
+
+  std::vector<OptionQuote> read;
+  for (const std::string &path : files) {
+    ASSERT_TRUE(read_columnar_file(path, read)) << path;
+  }
+  ASSERT_EQ(read.size(), quotes.size());
+  for (std::size_t i = 0; i < quotes.size(); ++i) {
+    EXPECT_EQ(read[i].timestamp, quotes[i].timestamp);
+    EXPECT_EQ(read[i].ticker_id, quotes[i].ticker_id);
+    EXPECT_EQ(read[i].conf_id, quotes[i].conf_id);
+    EXPECT_EQ(read[i].underlying_price, quotes[i].underlying_price);
+    EXPECT_EQ(read[i].option_price, quotes[i].option_price);
+    EXPECT_EQ(read[i].delta, quotes[i].delta);
+    EXPECT_EQ(read[i].vega, quotes[i].vega);
+    EXPECT_EQ(read[i].theta, quotes[i].theta);
+    EXPECT_EQ(read[i].status, "OK");
+  }
+  // Seven raw doubles plus a few bytes of encoded integers per row.
+  EXPECT_LT(bytes, 1200u * (7 * sizeof(double) + 16));
+
+  // A truncated file is rejected rather than partly read.
+  std::filesystem::resize_file(files[0],
+                               std::filesystem::file_size(files[0]) - 8);
+  read.clear();
+  EXPECT_FALSE(read_columnar_file(files[0], read));
+
+  // A partial batch goes out once it is flush_ms old; a sink reopened on
+  // the directory continues the numbering.
+  config.flush_ms = 20;
+  ColumnarSink sink(config);
+  for (int i = 0; i < 5; ++i) {
+    sink.append(quotes[i]);
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < deadline &&
+         sink.batches_written() == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(sink.rows_written(), 5u);
+  sink.close();
+  read.clear();
+  ASSERT_TRUE(read_columnar_file(dir + "/quotes_00000000000000000002.bsmcol",
+                                 read));
+  EXPECT_EQ(read.size(), 5u);
+  std::filesystem::remove_all(dir);
+}
+
+TEST(TickStoreTest, RoundTripsExactlyAndAnswersLastAndRange) {
+  TickStoreConfig config;
+  config.chunk_points = 64;
+  TickStore store(config);
+
+  // Regular ticks with some jitter, a repeat, a step back and a long gap;
+  // spots on a 0.01 grid, prices arbitrary doubles.
+  std::mt19937_64 rng(5);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<TickPoint> points;
+  std::int64_t ts = 1700000000;
+  double spot = 250.0;
+  for (int i = 0; i < 1000; ++i) {
+    ts += i == 500 ? 100000 : i == 700 ? -3 : static_cast<std::int64_t>(rng() % 3);
+    if (i % 10 != 0) {
+      spot = std::round((spot + (unit(rng) - 0.5) * 0.1) * 100.0) / 100.0;
+    }
+    const double price = i % 7 == 0 ? 0.0 : std::exp(unit(rng)) * 1e-3 * i;
+    points.push_back(TickPoint{ts, spot, price});
+    store.append(11, ts, spot, price);
+    store.append(12, ts, spot * 2.0, -price);
+  }
+
+  const std::vector<TickPoint> all = store.last(11, 5000);
+  ASSERT_EQ(all.size(), points.size());
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    EXPECT_EQ(all[i].timestamp, points[i].timestamp) << i;
+    EXPECT_EQ(all[i].spot, points[i].spot) << i;
+    EXPECT_EQ(all[i].price, points[i].price) << i;
+  }
+  // Across a chunk boundary, oldest first.
+  const std::vector<TickPoint> tail = store.last(11, 100);
+  ASSERT_EQ(tail.size(), 100u);
+  EXPECT_EQ(tail.front().timestamp, points[900].timestamp);
+  EXPECT_EQ(tail.back().price, points.back().price);
+  EXPECT_EQ(store.last(12, 1).front().spot, 2.0 * points.back().spot);
+  EXPECT_TRUE(store.last(13, 10).empty());
+
+  const std::int64_t from = points[450].timestamp;
+  const std::int64_t to = points[520].timestamp;
+  std::size_t expected = 0;
+  for (const TickPoint &p : points) {
+    expected += p.timestamp >= from && p.timestamp <= to;
+  }
+  EXPECT_EQ(store.range(11, from, to).size(), expected);
+
+  const TickStoreStats st = store.stats();
+  EXPECT_EQ(st.contracts, 2u);
+  EXPECT_EQ(st.points, 2000u);
+  EXPECT_EQ(st.chunks, 2u * 16u);
+  EXPECT_GT(static_cast<double>(st.raw_bytes) / st.bytes, 1.2);
+
+  // Doubles go out in shortest round-trip form.
+  const std::string reply = tick_query_reply(store, "last 11 1");
+  const std::string head =
+      "{\"conf_id\":11,\"points\":[[" + std::to_string(ts) + ",";
+  ASSERT_EQ(reply.rfind(head, 0), 0u);
+  char *end = nullptr;
+  EXPECT_EQ(std::strtod(reply.c_str() + head.size(), &end), points.back().spot);
+  ASSERT_EQ(*end, ',');
+  EXPECT_EQ(std::strtod(end + 1, &end), points.back().price);
+  EXPECT_EQ(std::string(end), "]]}");
+  EXPECT_EQ(tick_query_reply(store, "last 11"),
+            "{\"error\":\"usage: last CONF_ID N\"}");
+  EXPECT_EQ(tick_query_reply(store, "stats").rfind("{\"contracts\":2,", 0), 0u);
+  EXPECT_EQ(tick_query_reply(store, "bogus"), "{\"error\":\"unknown request\"}");
+}
+
+TEST(TickStoreTest, EvictsOldestSealedChunksWithinBudget) {
+  TickStoreConfig config;
+  config.chunk_points = 32;
+  config.memory_budget_bytes = 16 << 10;
+  TickStore store(config);
+  std::mt19937_64 rng(8);
+  for (int i = 0; i < 20000; ++i) {
+    const long long conf = i % 4;
+    store.append(conf, 1000 + i / 4,
+                 static_cast<double>(rng() % 1000000) / 7.0,
+                 static_cast<double>(rng()) / 3.0);
+    EXPECT_LE(store.stats().bytes,
+              config.memory_budget_bytes + 4 * 32 * 3 * sizeof(double) * 2)
+        << i;
+  }
+  const TickStoreStats st = store.stats();
+  EXPECT_GT(st.evicted_chunks, 0u);
+  // The newest history survives, the oldest is gone.
+  EXPECT_EQ(store.last(3, 1).front().timestamp, 1000 + 19999 / 4);
+  EXPECT_TRUE(store.range(0, 1000, 1100).empty());
+  EXPECT_LT(store.last(0, 1000000).size(), 5000u);
+}
+
+TEST(TickStoreTest, BudgetCoversOpenChunksOfManyContracts) {
+  TickStoreConfig config;
+  config.chunk_points = 256;
+  config.memory_budget_bytes = 64 << 10;
+  TickStore store(config);
+  for (long long conf = 0; conf < 20000; ++conf) {
+    store.append(conf, 1000, 100.0, 5.0);
+    store.append(conf, 1001, 100.5, 5.25);
+    ASSERT_LE(store.stats().bytes, config.memory_budget_bytes) << conf;
+  }
+  // Nothing ever sealed, so whole idle contracts went, oldest first.
+  const TickStoreStats st = store.stats();
+  EXPECT_LT(st.contracts, 20000u);
+  EXPECT_GT(st.evicted_chunks, 0u);
+  EXPECT_TRUE(store.last(0, 10).empty());
+  EXPECT_EQ(store.last(19999, 10).size(), 2u);
+}
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Non-blocking logger for hot paths. A logging thread formats its line into
+// a ring only it writes to and moves on; one background thread drains every
+// ring to stderr. A full ring drops the line instead of blocking. Data lines
+// for stdout take a separate path that never drops (see write_stdout).
+//
+// Lines are logfmt:
+//   ts=2024-01-02T03:04:05.678Z level=warn component=PostgresWriter
+//   msg="insert failed" error="..." suppressed=12
+// The same component+msg is let through at most kBurst times per second per
+// thread; the next one admitted carries the number held back as suppressed=.
+//
+// Shared by api_cli and bsm_pricing, so the embedded pipeline that links both
+// runs a single logger instance.
+
+enum class LogLevel : std::uint8_t { Debug, Info, Warn, Error };
+
+class LogField {
+public:
+  LogField(std::string_view key, std::string_view value)
+      : key_(key), value_(trim(value)) {}
+  LogField(std::string_view key, const char *value)
+      : key_(key), value_(trim(value ? value : "")) {}
+  LogField(std::string_view key, const std::string &value)
+      : key_(key), value_(trim(value)) {}
+  template <typename T,
+            typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+  LogField(std::string_view key, T value) : key_(key) {
+    int n;
+    if constexpr (std::is_floating_point_v<T>) {
+      n = std::snprintf(buf_, sizeof(buf_), "%.10g",
+                        static_cast<double>(value));
+    } else if constexpr (std::is_signed_v<T>) {
+      n = std::snprintf(buf_, sizeof(buf_), "%lld",
+                        static_cast<long long>(value));
+    } else {
+      n = std::snprintf(buf_, sizeof(buf_), "%llu",
+                        static_cast<unsigned long long>(value));
+    }
+    len_ = static_cast<std::uint8_t>(n);
+  }
+
+  std::string_view key() const { return key_; }
+  std::string_view value() const {
+    return len_ ? std::string_view(buf_, len_) : value_;
+  }
+
+private:
+  // libpq and strerror messages end in a newline.
+  static std::string_view trim(std::string_view v) {
+    while (!v.empty() && (v.back() == '\n' || v.back() == ' ')) {
+      v.remove_suffix(1);
+    }
+    return v;
+  }
+
+  std::string_view key_;
+  std::string_view value_;
+  char buf_[32];
+  std::uint8_t len_{0};
+};
+
+class AsyncLogger {
+public:
+  static constexpr std::size_t kLineBytes = 480;
+  static constexpr std::size_t kRingSlots = 1024;
+  static constexpr std::uint32_t kBurst = 5;
+  static constexpr std::size_t kMaxPendingStdout = std::size_t{16} << 20;
+
+  static AsyncLogger &instance() {
+    static AsyncLogger logger;
+    return logger;
+  }
+
+  AsyncLogger(const AsyncLogger &) = delete;
+  AsyncLogger &operator=(const AsyncLogger &) = delete;
+
+  ~AsyncLogger() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  void set_level(LogLevel level) { min_level_.store(level); }
+
+  void log(LogLevel level, std::string_view component, std::string_view msg,
+           std::initializer_list<LogField> fields = {}) {
+    if (level < min_level_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    Ring &ring = local_ring();
+    std::uint64_t held_back = 0;
+    if (!ring.admit(component, msg, held_back)) {
+      suppressed_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    Record *rec = ring.claim();
+    if (!rec) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    Line line(*rec);
+    append_timestamp(line);
+    line.put(" level=");
+    line.put(level_name(level));
+    line.put(" component=");
+    line.put_value(component);
+    line.put(" msg=");
+    line.put_quoted(msg);
+    for (const auto &f : fields) {
+      line.put(' ');
+      line.put(f.key());
+      line.put('=');
+      line.put_value(f.value());
+    }
+    if (held_back) {
+      line.put(" suppressed=");
+      line.put(LogField("", held_back).value());
+    }
+    line.finish();
+    ring.publish();
+  }
+
+  // A preformatted line for stdout (data output, not diagnostics). It skips
+  // the rings: never rate limited, truncated or dropped. Lines collect in a
+  // buffer the flusher drains; once kMaxPendingStdout bytes are waiting the
+  // caller blocks until it has.
+  void write_stdout(std::string_view text) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] {
+      return pending_stdout_.size() < kMaxPendingStdout || stop_;
+    });
+    pending_stdout_.append(text);
+    pending_stdout_ += '\n';
+  }
+
+  // Blocks until every line logged before the call has been written.
+  void flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const std::uint64_t generation = ++flush_requested_;
+    cv_.notify_all();
+    done_cv_.wait(lock, [&] { return flushed_ >= generation || stop_; });
+  }
+
+  std::uint64_t dropped() const { return dropped_.load(); }
+  std::uint64_t suppressed() const { return suppressed_.load(); }
+
+private:
+  struct Record {
+    std::uint16_t len;
+    char text[kLineBytes];
+  };
+
+  struct Limit {
+    std::int64_t window_start_ns{0};
+    std::uint32_t admitted{0};
+    std::uint64_t held_back{0};
+  };
+
+  // Single producer (the owning thread), single consumer (the flusher).
+  struct Ring {
+    std::unique_ptr<Record[]> slots{new Record[kRingSlots]};
+    alignas(64) std::atomic<std::uint64_t> head{0};
+    alignas(64) std::atomic<std::uint64_t> tail{0};
+    std::atomic<bool> retired{false};
+    std::unordered_map<std::uint64_t, Limit> limits; // producer only
+
+    Record *claim() {
+      const std::uint64_t h = head.load(std::memory_order_relaxed);
+      if (h - tail.load(std::memory_order_acquire) >= kRingSlots) {
+        return nullptr;
+      }
+      return &slots[h % kRingSlots];
+    }
+    void publish() {
+      head.store(head.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);
+    }
+
+    bool admit(std::string_view component, std::string_view msg,
+               std::uint64_t &held_back) {
+      const std::uint64_t key = std::hash<std::string_view>()(component) * 31 ^
+                                std::hash<std::string_view>()(msg);
+      const std::int64_t now =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now().time_since_epoch())
+              .count();
+      Limit &limit = limits[key];
+      if (now - limit.window_start_ns >= 1000000000LL) {
+        limit.window_start_ns = now;
+        limit.admitted = 0;
+      }
+      if (limit.admitted >= kBurst) {
+        ++limit.held_back;
+        return false;
+      }
+      ++limit.admitted;
+      held_back = limit.held_back;
+      limit.held_back = 0;
+      return true;
+    }
+  };
+
+  struct RingHandle {
+    std::shared_ptr<Ring> ring;
+    ~RingHandle() {
+      if (ring) {
+        ring->retired.store(true, std::memory_order_release);
+      }
+    }
+  };
+
+  // Bounded writer into a Record; an overlong line ends in "...".
+  class Line {
+  public:
+    explicit Line(Record &rec) : rec_(rec) {}
+
+    void put(char c) {
+      if (len_ < kLineBytes - 4) {
+        rec_.text[len_++] = c;
+      } else {
+        truncated_ = true;
+      }
+    }
+    void put(std::string_view s) {
+      for (char c : s) {
+        put(c);
+      }
+    }
+    void put_quoted(std::string_view s) {
+      put('"');
+      for (char c : s) {
+        if (c == '"' || c == '\\') {
+          put('\\');
+          put(c);
+        } else if (c == '\n') {
+          put("\\n");
+        } else {
+          put(c);
+        }
+      }
+      put('"');
+    }
+    void put_value(std::string_view s) {
+      const bool bare =
+          !s.empty() && std::none_of(s.begin(), s.end(), [](char c) {
+            return c == ' ' || c == '=' || c == '"' || c == '\n';
+          });
+      if (bare) {
+        put(s);
+      } else {
+        put_quoted(s);
+      }
+    }
+    void finish() {
+      if (truncated_) {
+        rec_.text[len_++] = '.';
+        rec_.text[len_++] = '.';
+        rec_.text[len_++] = '.';
+      }
+      rec_.text[len_++] = '\n';
+      rec_.len = static_cast<std::uint16_t>(len_);
+    }
+
+  private:
+    Record &rec_;
+    std::size_t len_{0};
+    bool truncated_{false};
+  };
+
+  AsyncLogger() : thread_(&AsyncLogger::run, this) {}
+
+  static const char *level_name(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug:
+      return "debug";
+    case LogLevel::Info:
+      return "info";
+    case LogLevel::Warn:
+      return "warn";
+    case LogLevel::Error:
+      return "error";
+    }
+    return "info";
+  }
+
+  static void append_timestamp(Line &line) {
+    const auto now = std::chrono::system_clock::now();
+    const std::time_t secs = std::chrono::system_clock::to_time_t(now);
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        now.time_since_epoch())
+                        .count() %
+                    1000;
+    std::tm tm{};
+    gmtime_r(&secs, &tm);
+    char buf[40];
+    std::size_t n = std::strftime(buf, sizeof(buf), "ts=%Y-%m-%dT%H:%M:%S", &tm);
+    n += static_cast<std::size_t>(
+        std::snprintf(buf + n, sizeof(buf) - n, ".%03dZ", static_cast<int>(ms)));
+    line.put(std::string_view(buf, n));
+  }
+
+  Ring &local_ring() {
+    thread_local RingHandle handle;
+    if (!handle.ring) {
+      handle.ring = std::make_shared<Ring>();
+      std::lock_guard<std::mutex> lock(mutex_);
+      rings_.push_back(handle.ring);
+    }
+    return *handle.ring;
+  }
+
+  void run() {
+    std::vector<std::shared_ptr<Ring>> rings;
+    std::string out;
+    std::string err;
+    while (true) {
+      bool stopping;
+      std::uint64_t generation;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, std::chrono::milliseconds(20), [this] {
+          return stop_ || flush_requested_ > flushed_;
+        });
+        stopping = stop_;
+        generation = flush_requested_;
+        rings = rings_;
+        out.swap(pending_stdout_);
+      }
+
+      std::vector<Ring *> finished;
+      for (auto &ring : rings) {
+        const bool retired = ring->retired.load(std::memory_order_acquire);
+        const std::uint64_t t = ring->tail.load(std::memory_order_relaxed);
+        const std::uint64_t h = ring->head.load(std::memory_order_acquire);
+        for (std::uint64_t i = t; i < h; ++i) {
+          const Record &rec = ring->slots[i % kRingSlots];
+          err.append(rec.text, rec.len);
+        }
+        ring->tail.store(h, std::memory_order_release);
+        if (retired) {
+          finished.push_back(ring.get());
+        }
+      }
+      rings.clear();
+
+      if (!err.empty()) {
+        std::fwrite(err.data(), 1, err.size(), stderr);
+        std::fflush(stderr);
+        err.clear();
+      }
+      if (!out.empty()) {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+        out.clear();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                    [&](const std::shared_ptr<Ring> &r) {
+                                      return std::find(finished.begin(),
+                                                       finished.end(),
+                                                       r.get()) !=
+                                             finished.end();
+                                    }),
+                     rings_.end());
+        flushed_ = generation;
+      }
+      done_cv_.notify_all();
+      if (stopping) {
+        break;
+      }
+    }
+  }
+
+  std::atomic<LogLevel> min_level_{LogLevel::Info};
+  std::atomic<std::uint64_t> dropped_{0};
+  std::atomic<std::uint64_t> suppressed_{0};
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable done_cv_;
+  std::vector<std::shared_ptr<Ring>> rings_;
+  std::string pending_stdout_;
+  std::uint64_t flush_requested_{0};
+  std::uint64_t flushed_{0};
+  bool stop_{false};
+
+  std::thread thread_;
+};
+
+inline void log_info(std::string_view component, std::string_view msg,
+                     std::initializer_list<LogField> fields = {}) {
+  AsyncLogger::instance().log(LogLevel::Info, component, msg, fields);
+}
+
+inline void log_warn(std::string_view component, std::string_view msg,
+                     std::initializer_list<LogField> fields = {}) {
+  AsyncLogger::instance().log(LogLevel::Warn, component, msg, fields);
+}
+
+inline void log_error(std::string_view component, std::string_view msg,
+                      std::initializer_list<LogField> fields = {}) {
+  AsyncLogger::instance().log(LogLevel::Error, component, msg, fields);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Consistent-hash ring mapping tickers to shard ids. Every shard owns
+// `virtual_nodes` points on the ring, so adding or removing a shard only moves
+// the tickers that hash next to its points. api_cli and bsm_pricing both build
+// against this header so both sides agree on ownership.
+class ShardRing {
+public:
+  explicit ShardRing(std::size_t virtual_nodes = 64)
+      : virtual_nodes_(virtual_nodes) {}
+
+  static std::uint64_t hash(std::string_view key) {
+    std::uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : key) {
+      h ^= c;
+      h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  void add_shard(int shard) {
+    if (contains(shard)) {
+      return;
+    }
+    for (std::size_t v = 0; v < virtual_nodes_; ++v) {
+      const std::string key =
+          "shard-" + std::to_string(shard) + "#" + std::to_string(v);
+      points_.emplace_back(hash(key), shard);
+    }
+    std::sort(points_.begin(), points_.end());
+  }
+
+  void remove_shard(int shard) {
+    points_.erase(std::remove_if(points_.begin(), points_.end(),
+                                 [shard](const auto &p) {
+                                   return p.second == shard;
+                                 }),
+                  points_.end());
+  }
+
+  bool contains(int shard) const {
+    return std::any_of(points_.begin(), points_.end(),
+                       [shard](const auto &p) { return p.second == shard; });
+  }
+
+  bool empty() const { return points_.empty(); }
+
+  // Returns -1 when no shard is registered.
+  int owner(std::string_view key) const {
+    if (points_.empty()) {
+      return -1;
+    }
+    const std::uint64_t h = hash(key);
+    auto it = std::lower_bound(
+        points_.begin(), points_.end(), h,
+        [](const auto &p, std::uint64_t value) { return p.first < value; });
+    if (it == points_.end()) {
+      it = points_.begin();
+    }
+    return it->second;
+  }
+
+private:
+  std::size_t virtual_nodes_;
+  std::vector<std::pair<std::uint64_t, int>> points_;
+};
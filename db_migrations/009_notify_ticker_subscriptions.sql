@@ -0,0 +1,16 @@
+CREATE OR REPLACE FUNCTION notify_ticker_subscriptions() RETURNS trigger AS $$
+BEGIN
+    PERFORM pg_notify('ticker_subscriptions', TG_TABLE_NAME);
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+DROP TRIGGER IF EXISTS trg_ticker_subscriptions ON ticker;
+CREATE TRIGGER trg_ticker_subscriptions
+    AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON ticker
+    FOR EACH STATEMENT EXECUTE FUNCTION notify_ticker_subscriptions();
+
+DROP TRIGGER IF EXISTS trg_ticker_subscriptions ON bsm_params;
+CREATE TRIGGER trg_ticker_subscriptions
+    AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON bsm_params
+    FOR EACH STATEMENT EXECUTE FUNCTION notify_ticker_subscriptions();
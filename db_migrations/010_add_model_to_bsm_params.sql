@@ -0,0 +1,17 @@
+ALTER TABLE bsm_params
+    ADD COLUMN IF NOT EXISTS model varchar NOT NULL DEFAULT 'bsm',
+    ADD COLUMN IF NOT EXISTS lattice_steps integer NULL;
+
+DO $$
+BEGIN
+    IF NOT EXISTS (
+        SELECT 1
+        FROM pg_constraint
+        WHERE conname = 'chk_bsm_params_model'
+    ) THEN
+        ALTER TABLE bsm_params
+            ADD CONSTRAINT chk_bsm_params_model
+                CHECK (model IN ('bsm', 'american_binomial', 'american_trinomial')
+                       AND (lattice_steps IS NULL OR lattice_steps BETWEEN 4 AND 100000));
+    END IF;
+END$$;
@@ -0,0 +1,16 @@
+CREATE TABLE IF NOT EXISTS vol_surface_point (
+    id              bigserial PRIMARY KEY,
+    ticker_id       bigint           NOT NULL,
+    strike          double precision NOT NULL,
+    maturity_years  double precision NOT NULL,
+    volatility      double precision NOT NULL,
+    updated_at      timestamptz      NOT NULL DEFAULT now(),
+
+    CONSTRAINT fk_vol_surface_point_ticker
+        FOREIGN KEY (ticker_id) REFERENCES ticker(id) ON DELETE CASCADE,
+    CONSTRAINT chk_vol_surface_point_values
+        CHECK (strike > 0 AND maturity_years > 0 AND volatility > 0)
+);
+
+CREATE UNIQUE INDEX IF NOT EXISTS idx_vol_surface_point_ticker_strike_maturity
+    ON vol_surface_point (ticker_id, maturity_years, strike);
@@ -0,0 +1,28 @@
+ALTER TABLE bsm_params
+    ADD COLUMN IF NOT EXISTS heston_kappa double precision NULL,
+    ADD COLUMN IF NOT EXISTS heston_theta double precision NULL,
+    ADD COLUMN IF NOT EXISTS heston_xi    double precision NULL,
+    ADD COLUMN IF NOT EXISTS heston_rho   double precision NULL,
+    ADD COLUMN IF NOT EXISTS heston_v0    double precision NULL;
+
+ALTER TABLE bsm_params DROP CONSTRAINT IF EXISTS chk_bsm_params_model;
+ALTER TABLE bsm_params
+    ADD CONSTRAINT chk_bsm_params_model
+        CHECK (model IN ('bsm', 'american_binomial', 'american_trinomial', 'heston')
+               AND (lattice_steps IS NULL OR lattice_steps BETWEEN 4 AND 100000));
+
+DO $$
+BEGIN
+    IF NOT EXISTS (
+        SELECT 1
+        FROM pg_constraint
+        WHERE conname = 'chk_bsm_params_heston'
+    ) THEN
+        ALTER TABLE bsm_params
+            ADD CONSTRAINT chk_bsm_params_heston
+                CHECK (model <> 'heston'
+                       OR (heston_kappa > 0 AND heston_theta > 0 AND heston_xi > 0
+                           AND heston_rho > -1 AND heston_rho < 1
+                           AND heston_v0 >= 0));
+    END IF;
+END$$;
@@ -0,0 +1,20 @@
+CREATE TABLE IF NOT EXISTS option_quote (
+    id               bigserial PRIMARY KEY,
+    ticker_id        bigint           NOT NULL,
+    strike           double precision NOT NULL,
+    maturity_years   double precision NOT NULL,
+    price            double precision NOT NULL,
+    underlying_price double precision NOT NULL,
+    rate             double precision NOT NULL DEFAULT 0,
+    dividend_yield   double precision NOT NULL DEFAULT 0,
+    updated_at       timestamptz      NOT NULL DEFAULT now(),
+
+    CONSTRAINT fk_option_quote_ticker
+        FOREIGN KEY (ticker_id) REFERENCES ticker(id) ON DELETE CASCADE,
+    CONSTRAINT chk_option_quote_values
+        CHECK (strike > 0 AND maturity_years > 0 AND price > 0
+               AND underlying_price > 0)
+);
+
+CREATE UNIQUE INDEX IF NOT EXISTS idx_option_quote_ticker_maturity_strike
+    ON option_quote (ticker_id, maturity_years, strike);
@@ -0,0 +1,12 @@
+CREATE TABLE IF NOT EXISTS position (
+    id          bigserial PRIMARY KEY,
+    conf_id     bigint           NOT NULL,
+    quantity    double precision NOT NULL,
+    updated_at  timestamptz      NOT NULL DEFAULT now(),
+
+    CONSTRAINT fk_position_conf
+        FOREIGN KEY (conf_id) REFERENCES bsm_params(id) ON DELETE CASCADE
+);
+
+CREATE UNIQUE INDEX IF NOT EXISTS idx_position_conf
+    ON position (conf_id);
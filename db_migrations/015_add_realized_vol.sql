@@ -0,0 +1,26 @@
+ALTER TABLE bsm_params
+    ADD COLUMN IF NOT EXISTS vol_source varchar NOT NULL DEFAULT 'param';
+
+DO $$
+BEGIN
+    IF NOT EXISTS (
+        SELECT 1
+        FROM pg_constraint
+        WHERE conname = 'chk_bsm_params_vol_source'
+    ) THEN
+        ALTER TABLE bsm_params
+            ADD CONSTRAINT chk_bsm_params_vol_source
+                CHECK (vol_source IN ('param', 'realized_ewma', 'realized_window'));
+    END IF;
+END$$;
+
+CREATE TABLE IF NOT EXISTS realized_vol (
+    ticker_id   bigint PRIMARY KEY,
+    ewma_vol    double precision,
+    window_vol  double precision,
+    returns     bigint           NOT NULL,
+    updated_at  timestamptz      NOT NULL DEFAULT now(),
+
+    CONSTRAINT fk_realized_vol_ticker
+        FOREIGN KEY (ticker_id) REFERENCES ticker(id) ON DELETE CASCADE
+);
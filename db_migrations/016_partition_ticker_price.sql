@@ -0,0 +1,155 @@
+-- ticker_price becomes range-partitioned by ts_exchange, one partition per
+-- UTC day named ticker_price_pYYYYMMDD. The existing heap table is attached
+-- as-is as the partition for everything before its last day, so no rows
+-- are copied; retention drops it whole once its upper bound has aged out.
+DO $$
+DECLARE
+    bound timestamptz;
+BEGIN
+    IF EXISTS (
+        SELECT 1
+        FROM pg_class
+        WHERE oid = to_regclass('public.ticker_price')
+          AND relkind = 'r'
+    ) THEN
+        ALTER TABLE ticker_price RENAME TO ticker_price_legacy;
+        ALTER INDEX IF EXISTS idx_ticker_price_ts_ticker_conf_uniq
+            RENAME TO idx_ticker_price_legacy_ts_ticker_conf_uniq;
+
+        CREATE TABLE ticker_price (
+            id                bigint         NOT NULL
+                DEFAULT nextval('ticker_price_id_seq'),
+            ts_exchange       timestamptz    NOT NULL,
+            ticker_id         bigint         NOT NULL,
+            conf_id           bigint         NOT NULL,
+            base_price        double precision,
+            calculated_price  double precision NOT NULL,
+            created_at        timestamptz    NOT NULL DEFAULT now(),
+
+            CONSTRAINT fk_ticker_price_ticker
+                FOREIGN KEY (ticker_id) REFERENCES ticker(id) ON DELETE CASCADE,
+            CONSTRAINT fk_ticker_price_conf
+                FOREIGN KEY (conf_id) REFERENCES bsm_params(id) ON DELETE RESTRICT
+        ) PARTITION BY RANGE (ts_exchange);
+        ALTER SEQUENCE ticker_price_id_seq OWNED BY ticker_price.id;
+
+        CREATE UNIQUE INDEX idx_ticker_price_ts_ticker_conf_uniq
+            ON ticker_price (ts_exchange, ticker_id, conf_id);
+
+        -- Attaching reuses the legacy table's matching index and foreign
+        -- keys instead of building and validating new ones; it only scans
+        -- the table once to check the range.
+        SELECT greatest(
+                   date_trunc('day', now() AT TIME ZONE 'UTC'),
+                   date_trunc('day', max(ts_exchange) AT TIME ZONE 'UTC')
+                       + interval '1 day'
+               ) AT TIME ZONE 'UTC'
+        INTO bound
+        FROM ticker_price_legacy;
+
+        EXECUTE format(
+            'ALTER TABLE ticker_price ATTACH PARTITION ticker_price_legacy '
+            'FOR VALUES FROM (MINVALUE) TO (%L)', bound);
+    END IF;
+END$$;
+
+-- Rows no daily partition covers (clock skew, replays of old days) land
+-- here instead of failing the insert.
+CREATE TABLE IF NOT EXISTS ticker_price_default
+    PARTITION OF ticker_price DEFAULT;
+
+-- Time-range scans; tiny next to the btree since rows arrive in ts order.
+CREATE INDEX IF NOT EXISTS idx_ticker_price_ts_brin
+    ON ticker_price USING brin (ts_exchange);
+
+-- Creates the daily partitions for today .. today + days_ahead (UTC) that
+-- do not exist yet and returns how many it created. A day an existing
+-- partition already covers is skipped. Rows of that day already sitting in
+-- ticker_price_default are moved into the new partition, since the default
+-- partition holding them would otherwise block it forever.
+--
+-- Every bsm_pricing shard calls this; the advisory lock lets one of them do
+-- the work and the others return 0.
+CREATE OR REPLACE FUNCTION ticker_price_ensure_partitions(days_ahead integer)
+RETURNS integer AS $$
+DECLARE
+    today     date := (now() AT TIME ZONE 'UTC')::date;
+    d         date;
+    lo        timestamptz;
+    hi        timestamptz;
+    part_name text;
+    created   integer := 0;
+BEGIN
+    IF NOT pg_try_advisory_xact_lock(hashtext('ticker_price_maintenance')) THEN
+        RETURN 0;
+    END IF;
+    FOR i IN 0..greatest(days_ahead, 0) LOOP
+        d := today + i;
+        lo := d::timestamp AT TIME ZONE 'UTC';
+        hi := (d + 1)::timestamp AT TIME ZONE 'UTC';
+        part_name := 'ticker_price_p' || to_char(d, 'YYYYMMDD');
+        CONTINUE WHEN to_regclass(part_name) IS NOT NULL;
+        BEGIN
+            EXECUTE format(
+                'CREATE TABLE %I (LIKE ticker_price INCLUDING DEFAULTS)',
+                part_name);
+            EXECUTE format(
+                'WITH moved AS ('
+                '    DELETE FROM ticker_price_default'
+                '    WHERE ts_exchange >= %L AND ts_exchange < %L'
+                '    RETURNING *) '
+                'INSERT INTO %I SELECT * FROM moved',
+                lo, hi, part_name);
+            EXECUTE format(
+                'ALTER TABLE ticker_price ATTACH PARTITION %I '
+                'FOR VALUES FROM (%L) TO (%L)',
+                part_name, lo, hi);
+            created := created + 1;
+        EXCEPTION
+            WHEN duplicate_table THEN
+                NULL;
+            WHEN invalid_object_definition THEN
+                -- The legacy partition still covers that day.
+                RAISE NOTICE 'ticker_price: % overlaps an existing partition',
+                    part_name;
+        END;
+    END LOOP;
+    RETURN created;
+END;
+$$ LANGUAGE plpgsql;
+
+-- Retention: detaches and drops every partition whose upper bound is at or
+-- before cutoff, and returns how many it dropped. Dropping a detached
+-- partition is a file unlink, with none of the dead tuples and vacuum
+-- debt a DELETE leaves behind. Shares the maintenance lock with
+-- ticker_price_ensure_partitions, so concurrent shards never race on the
+-- same partition.
+CREATE OR REPLACE FUNCTION ticker_price_drop_before(cutoff timestamptz)
+RETURNS integer AS $$
+DECLARE
+    part        record;
+    upper_bound text;
+    dropped     integer := 0;
+BEGIN
+    IF NOT pg_try_advisory_xact_lock(hashtext('ticker_price_maintenance')) THEN
+        RETURN 0;
+    END IF;
+    FOR part IN
+        SELECT c.oid::regclass AS rel,
+               pg_get_expr(c.relpartbound, c.oid) AS bound
+        FROM pg_inherits i
+        JOIN pg_class c ON c.oid = i.inhrelid
+        WHERE i.inhparent = 'ticker_price'::regclass
+    LOOP
+        upper_bound := substring(part.bound FROM 'TO \(''([^'']+)''\)');
+        CONTINUE WHEN upper_bound IS NULL OR upper_bound::timestamptz > cutoff;
+        EXECUTE format('ALTER TABLE ticker_price DETACH PARTITION %s',
+                       part.rel);
+        EXECUTE format('DROP TABLE %s', part.rel);
+        dropped := dropped + 1;
+    END LOOP;
+    RETURN dropped;
+END;
+$$ LANGUAGE plpgsql;
+
+SELECT ticker_price_ensure_partitions(2);
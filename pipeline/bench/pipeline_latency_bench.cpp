@@ -0,0 +1,204 @@
+#include "bsm_service.hpp"
+#include "messages.hpp"
+#include "price_pipe.hpp"
+#include "sharded_publisher.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Tick-to-priced latency for the two deployments, measured in one process:
+//
+//   fifo:     PriceQueue -> JSON -> FIFO -> getline -> PricePipe<string>
+//             -> parse -> BsmService workers
+//   embedded: PriceQueue -> BsmService::submit -> BsmService workers
+//
+// Each update carries its production time (steady clock, ns) in `timestamp`;
+// the quote sink records now - timestamp once the option is priced.
+
+namespace {
+
+constexpr double kTicksPerSec = 20000.0;
+constexpr int kDurationMs = 2000;
+constexpr std::size_t kWorkers = 4;
+const char *const kTickers[] = {"SBER", "GAZP", "LKOH", "YNDX"};
+
+std::int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+class LatencySink {
+public:
+  void record(const OptionQuote &q) {
+    const std::int64_t latency = now_ns() - q.timestamp;
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_.push_back(latency);
+  }
+
+  std::size_t count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samples_.size();
+  }
+
+  void report(const char *mode) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (samples_.empty()) {
+      std::cout << mode << ": no samples\n";
+      return;
+    }
+    std::sort(samples_.begin(), samples_.end());
+    double sum = 0.0;
+    for (auto s : samples_) {
+      sum += static_cast<double>(s);
+    }
+    auto pct = [&](double p) {
+      return samples_[static_cast<std::size_t>(
+                 p * static_cast<double>(samples_.size() - 1))] /
+             1000.0;
+    };
+    std::printf("%-9s n=%zu mean=%.1fus p50=%.1fus p99=%.1fus max=%.1fus\n",
+                mode, samples_.size(),
+                sum / static_cast<double>(samples_.size()) / 1000.0, pct(0.5),
+                pct(0.99), pct(1.0));
+  }
+
+private:
+  std::mutex mutex_;
+  std::vector<std::int64_t> samples_;
+};
+
+void configure(BsmService &bsm, LatencySink &sink) {
+  for (const char *t : kTickers) {
+    bsm.set_params_for_testing(t, 100.0, 0.05, 0.0, 0.2, 1.0, 1, 1);
+  }
+  bsm.set_quote_sink([&](const OptionQuote &q) { sink.record(q); });
+}
+
+// Paced producer standing in for PricingService workers.
+std::size_t produce(PriceQueue &queue) {
+  using clock = std::chrono::steady_clock;
+  const auto start = clock::now();
+  const auto interval = std::chrono::duration_cast<clock::duration>(
+      std::chrono::duration<double>(1.0 / kTicksPerSec));
+  std::size_t produced = 0;
+  PriceUpdate u;
+  u.status = "OK";
+  while (clock::now() - start < std::chrono::milliseconds(kDurationMs)) {
+    std::this_thread::sleep_until(start + interval * produced);
+    u.ticker = kTickers[produced % 4];
+    u.price = 100.0 + static_cast<double>(produced % 100) * 0.01;
+    u.timestamp = now_ns();
+    queue.write(u);
+    ++produced;
+  }
+  queue.close();
+  return produced;
+}
+
+void wait_for(LatencySink &sink, std::size_t expected) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (sink.count() < expected &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+}
+
+void run_embedded() {
+  LatencySink sink;
+  BsmService bsm(kWorkers, "");
+  configure(bsm, sink);
+  bsm.start();
+
+  PriceQueue queue;
+  std::size_t produced = 0;
+  std::thread producer([&] { produced = produce(queue); });
+
+  std::vector<PriceUpdate> batch;
+  std::vector<PriceUpdateIn> typed;
+  while (queue.read_batch(batch, 512)) {
+    for (auto &u : batch) {
+      PriceUpdateIn in;
+      in.timestamp = u.timestamp;
+      in.ticker = std::move(u.ticker);
+      in.price = u.price;
+      in.status = std::move(u.status);
+      typed.push_back(std::move(in));
+    }
+    bsm.submit(typed);
+  }
+  producer.join();
+  wait_for(sink, produced);
+  bsm.stop();
+  sink.report("embedded");
+}
+
+void run_fifo() {
+  LatencySink sink;
+  PricePipe<std::string> json_pipe;
+  BsmService bsm(json_pipe, kWorkers, "");
+  configure(bsm, sink);
+  bsm.start();
+
+  const std::string path =
+      "/tmp/pipeline_latency_bench_" + std::to_string(::getpid());
+  auto publisher = std::make_unique<ShardedPublisher>(
+      std::vector<std::string>{path}, 10);
+  if (!publisher->init()) {
+    return;
+  }
+
+  std::thread reader([&] {
+    FILE *f = std::fopen(path.c_str(), "r");
+    char *lineptr = nullptr;
+    size_t n = 0;
+    ssize_t len;
+    while ((len = getline(&lineptr, &n, f)) > 0) {
+      json_pipe.write(std::string(lineptr, static_cast<std::size_t>(len)));
+    }
+    free(lineptr);
+    std::fclose(f);
+    json_pipe.close();
+  });
+  while (publisher->live_channels() == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    publisher->probe();
+  }
+
+  PriceQueue queue;
+  std::size_t produced = 0;
+  std::thread producer([&] { produced = produce(queue); });
+
+  std::vector<PriceUpdate> batch;
+  while (queue.read_batch(batch, 512)) {
+    publisher->publish(batch);
+  }
+  producer.join();
+  wait_for(sink, produced);
+  publisher.reset();
+  reader.join();
+  bsm.stop();
+  ::unlink(path.c_str());
+  sink.report("fifo");
+}
+
+} // namespace
+
+int main() {
+  std::signal(SIGPIPE, SIG_IGN);
+  std::cout << kTicksPerSec << " ticks/sec for " << kDurationMs << "ms, "
+            << kWorkers << " pricing workers\n";
+  run_fifo();
+  run_embedded();
+  return 0;
+}
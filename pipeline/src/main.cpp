@@ -0,0 +1,281 @@
+#include "bsm_service.hpp"
+#include "messages.hpp"
+#include "moex_client.hpp"
+#include "pricing_service.hpp"
+#include "randomized_provider.hpp"
+#include "subscription_registry.hpp"
+#include "synthetic_provider.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// api_cli and bsm_pricing in one process: PriceUpdates go from the provider
+// queue straight into BsmService as typed messages, with no FIFO and no JSON.
+
+namespace {
+
+struct CliConfig {
+  bool test_mode{false};
+  bool synthetic{false};
+  int synthetic_symbols{0};
+  double synthetic_rate{1000.0};
+  std::size_t threads{0};
+  std::string params_snapshot;
+  bool skip_unchanged_writes{false};
+  std::string scenario_report;
+  int scenario_interval{5};
+  std::size_t scenario_threads{1};
+  std::size_t calibration_threads{1};
+  std::string positions_socket;
+  std::string quote_spool;
+  int retention_days{0};
+  std::string columnar_dir;
+  bool columnar_only{false};
+  std::string tick_socket;
+  std::size_t tick_memory_mb{64};
+  double realized_vol_half_life{600.0};
+  int realized_vol_persist{60};
+  std::string pg_conninfo;
+  std::string pg_host;
+  std::string pg_port;
+  std::string pg_user;
+  std::string pg_password;
+  std::string pg_db;
+};
+
+CliConfig parse_cli(int argc, char **argv) {
+  CliConfig cfg;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto next_string = [&](std::string &value) {
+      if (i + 1 >= argc)
+        return;
+      value = argv[++i];
+    };
+
+    if (arg == "--test") {
+      cfg.test_mode = true;
+    } else if (arg == "--synthetic") {
+      cfg.synthetic = true;
+    } else if (arg == "--synthetic-symbols") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.synthetic_symbols = std::max(0, std::stoi(value));
+    } else if (arg == "--synthetic-rate") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.synthetic_rate = std::max(0.0, std::stod(value));
+    } else if (arg == "--threads") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.threads = static_cast<std::size_t>(std::max(1, std::stoi(value)));
+    } else if (arg == "--params-snapshot") {
+      next_string(cfg.params_snapshot);
+    } else if (arg == "--skip-unchanged-writes") {
+      cfg.skip_unchanged_writes = true;
+    } else if (arg == "--scenario-report") {
+      next_string(cfg.scenario_report);
+    } else if (arg == "--scenario-interval") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.scenario_interval = std::max(1, std::stoi(value));
+    } else if (arg == "--scenario-threads") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.scenario_threads =
+            static_cast<std::size_t>(std::max(1, std::stoi(value)));
+    } else if (arg == "--realized-vol-half-life") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.realized_vol_half_life = std::stod(value);
+    } else if (arg == "--realized-vol-persist") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.realized_vol_persist = std::max(0, std::stoi(value));
+    } else if (arg == "--positions-socket") {
+      next_string(cfg.positions_socket);
+    } else if (arg == "--quote-spool") {
+      next_string(cfg.quote_spool);
+    } else if (arg == "--columnar-dir") {
+      next_string(cfg.columnar_dir);
+    } else if (arg == "--columnar-only") {
+      cfg.columnar_only = true;
+    } else if (arg == "--tick-socket") {
+      next_string(cfg.tick_socket);
+    } else if (arg == "--tick-memory-mb") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.tick_memory_mb =
+            static_cast<std::size_t>(std::max(1, std::stoi(value)));
+    } else if (arg == "--retention-days") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.retention_days = std::max(0, std::stoi(value));
+    } else if (arg == "--calibration-threads") {
+      std::string value;
+      next_string(value);
+      if (!value.empty())
+        cfg.calibration_threads =
+            static_cast<std::size_t>(std::max(1, std::stoi(value)));
+    } else if (arg == "--pg-conninfo") {
+      next_string(cfg.pg_conninfo);
+    } else if (arg == "--pg-host") {
+      next_string(cfg.pg_host);
+    } else if (arg == "--pg-port") {
+      next_string(cfg.pg_port);
+    } else if (arg == "--pg-user") {
+      next_string(cfg.pg_user);
+    } else if (arg == "--pg-password") {
+      next_string(cfg.pg_password);
+    } else if (arg == "--pg-db" || arg == "--pg-database") {
+      next_string(cfg.pg_db);
+    }
+  }
+  return cfg;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  CliConfig cfg = parse_cli(argc, argv);
+
+  if (cfg.pg_conninfo.empty()) {
+    if (cfg.pg_host.empty() || cfg.pg_user.empty() || cfg.pg_db.empty()) {
+      std::cerr << "Missing database connection parameters. "
+                << "Provide either --pg-conninfo "
+                << "or all of --pg-host, --pg-user, --pg-db\n";
+      return 1;
+    }
+    std::string ci =
+        "host=" + cfg.pg_host + " user=" + cfg.pg_user + " dbname=" + cfg.pg_db;
+    if (!cfg.pg_port.empty())
+      ci += " port=" + cfg.pg_port;
+    if (!cfg.pg_password.empty())
+      ci += " password=" + cfg.pg_password;
+    cfg.pg_conninfo = std::move(ci);
+  }
+
+  const bool generated = cfg.synthetic && cfg.synthetic_symbols > 0;
+  SubscriptionRegistry registry(cfg.pg_conninfo);
+  std::vector<std::string> tickers;
+  if (generated) {
+    tickers = SyntheticMarketDataProvider::symbol_names(
+        static_cast<std::size_t>(cfg.synthetic_symbols));
+  } else {
+    if (!registry.load()) {
+      std::cerr << "No tickers loaded from DB\n Waiting for new\n";
+    }
+    tickers = registry.tickers();
+  }
+
+  PriceQueue prices;
+  std::shared_ptr<SyntheticMarketDataProvider> synthetic_provider;
+  std::shared_ptr<MarketDataProvider> provider =
+      std::make_shared<MoexClient>();
+  if (cfg.synthetic) {
+    SyntheticConfig synthetic_cfg;
+    synthetic_cfg.ticks_per_sec = cfg.synthetic_rate;
+    synthetic_provider =
+        std::make_shared<SyntheticMarketDataProvider>(synthetic_cfg);
+    synthetic_provider->subscribe(tickers);
+  } else if (cfg.test_mode) {
+    provider = std::make_shared<RandomizedMarketDataProvider>(provider);
+  }
+  PricingService service(provider, tickers, prices, 500);
+
+  std::size_t threads = cfg.threads;
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency()) * 4;
+  }
+  BsmService bsm(threads, cfg.pg_conninfo);
+  if (!cfg.params_snapshot.empty()) {
+    bsm.set_params_snapshot(cfg.params_snapshot);
+  }
+  bsm.set_skip_unchanged_writes(cfg.skip_unchanged_writes);
+  bsm.set_calibration_threads(cfg.calibration_threads);
+  RealizedVolConfig realized_vol;
+  realized_vol.half_life_sec = cfg.realized_vol_half_life;
+  bsm.set_realized_vol(realized_vol, cfg.realized_vol_persist);
+  if (!cfg.positions_socket.empty()) {
+    bsm.set_position_socket(cfg.positions_socket);
+  }
+  if (!cfg.quote_spool.empty()) {
+    bsm.set_quote_spool(cfg.quote_spool);
+  }
+  bsm.set_ticker_price_retention(cfg.retention_days);
+  if (!cfg.tick_socket.empty()) {
+    TickStoreConfig ticks;
+    ticks.memory_budget_bytes = cfg.tick_memory_mb << 20;
+    bsm.set_tick_store(ticks, cfg.tick_socket);
+  }
+  if (!cfg.columnar_dir.empty()) {
+    ColumnarSinkConfig columnar;
+    columnar.dir = cfg.columnar_dir;
+    bsm.set_columnar_sink(columnar, cfg.columnar_only);
+  }
+  if (!cfg.scenario_report.empty()) {
+    // 21x21: spot -20%..+20% in 2% steps, vol -10..+10 points in 1s.
+    bsm.set_scenario_report(cfg.scenario_report,
+                            make_scenario_grid(21, 0.2, 21, 0.1),
+                            cfg.scenario_interval, cfg.scenario_threads);
+  }
+  bsm.start();
+
+  if (synthetic_provider) {
+    synthetic_provider->start(prices);
+  } else {
+    service.start();
+  }
+
+  if (!generated) {
+    registry.start([&](const std::vector<std::string> &added,
+                       const std::vector<std::string> &removed) {
+      if (synthetic_provider) {
+        synthetic_provider->unsubscribe(removed);
+        synthetic_provider->subscribe(added);
+      } else {
+        service.remove_tickers(removed);
+        service.add_tickers(added);
+      }
+    });
+  }
+
+  constexpr std::size_t kMaxBatch = 512;
+  std::vector<PriceUpdate> batch;
+  std::vector<PriceUpdateIn> typed;
+  batch.reserve(kMaxBatch);
+  typed.reserve(kMaxBatch);
+  while (prices.read_batch(batch, kMaxBatch)) {
+    for (auto &u : batch) {
+      PriceUpdateIn in;
+      in.timestamp = u.timestamp;
+      in.ticker = std::move(u.ticker);
+      in.price = u.price;
+      in.status = std::move(u.status);
+      in.error = std::move(u.error);
+      typed.push_back(std::move(in));
+    }
+    bsm.submit(typed);
+  }
+
+  registry.stop();
+  if (synthetic_provider) {
+    synthetic_provider->stop();
+  }
+  service.stop();
+  bsm.stop();
+  return 0;
+}